@@ -74,6 +74,9 @@ namespace golos { namespace api {
         
         string root_title;
 
+        bool content_in_store = false; // not reflected, title and body are deferred to the content store
+        bool root_content_in_store = false; // not reflected, root_title is deferred to the content store
+
         protocol::asset max_accepted_payout;
         uint16_t percent_steem_dollars = 0;
         bool allow_replies = 0;
@@ -0,0 +1,110 @@
+#include <golos/chain/async_block_subscription.hpp>
+
+namespace golos { namespace chain {
+
+    async_block_subscription::async_block_subscription(std::string name, uint32_t capacity, handler_type handler)
+        : _name(std::move(name)),
+          _capacity(std::max<uint32_t>(capacity, 1)),
+          _handler(std::move(handler)) {
+        _stats.name = _name;
+        _stats.capacity = _capacity;
+    }
+
+    async_block_subscription::~async_block_subscription() {
+        stop();
+    }
+
+    void async_block_subscription::start() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_stopped) {
+            return;
+        }
+        _stopped = false;
+        _thread = std::thread([this] { loop(); });
+    }
+
+    void async_block_subscription::stop() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped = true;
+        }
+        _not_empty.notify_all();
+        _not_full.notify_all();
+
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    void async_block_subscription::push(applied_block_bundle_ptr bundle) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_stopped) {
+            return;
+        }
+
+        if (_queue.size() >= _capacity) {
+            auto start = fc::time_point::now();
+            _not_full.wait(lock, [&] { return _stopped || _queue.size() < _capacity; });
+            _stats.blocked_time += (fc::time_point::now() - start).count();
+            if (_stopped) {
+                return;
+            }
+        }
+
+        _stats.last_pushed_block = bundle->block_num;
+        ++_stats.pushed;
+        _queue.push_back(std::move(bundle));
+        _stats.max_lag_blocks = std::max<uint32_t>(_stats.max_lag_blocks, _queue.size());
+        _not_empty.notify_one();
+    }
+
+    void async_block_subscription::loop() {
+        while (true) {
+            applied_block_bundle_ptr bundle;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _not_empty.wait(lock, [&] { return _stopped || !_queue.empty(); });
+                if (_queue.empty()) {
+                    return;
+                }
+                bundle = _queue.front();
+            }
+
+            bool failed = false;
+            try {
+                _handler(*bundle);
+            } catch (const fc::exception& e) {
+                elog("Subscription ${name} failed on block ${n}: ${e}",
+                    ("name", _name)("n", bundle->block_num)("e", e.to_detail_string()));
+                failed = true;
+            } catch (const std::exception& e) {
+                elog("Subscription ${name} failed on block ${n}: ${e}",
+                    ("name", _name)("n", bundle->block_num)("e", e.what()));
+                failed = true;
+            } catch (...) {
+                elog("Subscription ${name} failed on block ${n}: unknown exception",
+                    ("name", _name)("n", bundle->block_num));
+                failed = true;
+            }
+
+            // remove the bundle only after processing, so the lag includes the current block
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.pop_front();
+            _stats.last_processed_block = bundle->block_num;
+            ++_stats.processed;
+            if (failed) {
+                ++_stats.failed;
+            }
+            _not_full.notify_one();
+        }
+    }
+
+    async_subscription_stats async_block_subscription::get_stats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto stats = _stats;
+        stats.queue_size = _queue.size();
+        stats.lag_blocks = _queue.size();
+        return stats;
+    }
+
+} } // golos::chain
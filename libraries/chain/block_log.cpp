@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <fstream>
 #include <golos/chain/block_log.hpp>
+#include <golos/chain/compressed_block_log.hpp>
 #include <golos/protocol/exceptions.hpp>
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/filesystem.hpp>
@@ -24,6 +25,10 @@ namespace golos { namespace chain {
             boost::iostreams::mapped_file index_mapped_file;
             read_write_mutex mutex;
 
+            // old blocks can be moved to the compressed archive, then the block file starts from first_block_num
+            compressed_block_log archive;
+            uint32_t first_block_num = 1;
+
             bool has_block_records() const {
                 auto size = block_mapped_file.size();
                 return (size > min_valid_file_size);
@@ -71,9 +76,9 @@ namespace golos { namespace chain {
             uint64_t get_block_pos(uint32_t block_num) const {
                 if (head.valid() &&
                     block_num <= protocol::block_header::num_from_id(head_id) &&
-                    block_num > 0
+                    block_num >= first_block_num
                 ) {
-                    return get_uint64(index_mapped_file, sizeof(uint64_t) * (block_num - 1));
+                    return get_uint64(index_mapped_file, sizeof(uint64_t) * (block_num - first_block_num));
                 }
                 return block_log::npos;
             }
@@ -132,7 +137,7 @@ namespace golos { namespace chain {
                 index_mapped_file.close();
                 boost::filesystem::remove_all(index_path);
                 open_index_mapped_file();
-                index_mapped_file.resize(head->block_num() * sizeof(uint64_t));
+                index_mapped_file.resize((head->block_num() - first_block_num + 1) * sizeof(uint64_t));
 
                 uint64_t pos = 0;
                 uint64_t end_pos = get_last_uint64(block_mapped_file);
@@ -149,10 +154,17 @@ namespace golos { namespace chain {
             void open(const fc::path& file) { try {
                 block_mapped_file.close();
                 index_mapped_file.close();
+                archive.close();
 
                 block_path = file.string();
                 index_path = boost::filesystem::path(file.string() + ".index").string();
 
+                first_block_num = 1;
+                if (compressed_block_log::exists(file)) {
+                    archive.open(file);
+                    first_block_num = archive.head_num() + 1;
+                }
+
                 open_block_mapped_file();
                 open_index_mapped_file();
 
@@ -180,6 +192,15 @@ namespace golos { namespace chain {
                     head = read_head();
                     head_id = head->id();
 
+                    if (archive.is_open()) {
+                        signed_block first_block;
+                        read_block(0, first_block);
+                        GOLOS_CHECK_DATABASE(first_block.block_num() == first_block_num,
+                            database_corrupted::wrong_block_num_was_read,
+                            "Block log doesn't continue compressed block log (read ${block_num}, expected ${expected}).",
+                            ("block_num", first_block.block_num())("expected", first_block_num));
+                    }
+
                     if (has_index_records()) {
                         ilog("Index is nonempty");
 
@@ -205,16 +226,22 @@ namespace golos { namespace chain {
                     open_block_mapped_file();
                     open_index_mapped_file();
                 }
+
+                if (!head.valid() && archive.head_num()) {
+                    ilog("Log is empty, head is in compressed log");
+                    head = archive.read_block_by_num(archive.head_num());
+                    head_id = head->id();
+                }
             } FC_LOG_AND_RETHROW() }
 
             uint64_t append(const signed_block& b, const std::vector<char>& data) { try {
                 const auto index_pos = get_mapped_size(index_mapped_file);
 
-                GOLOS_CHECK_DATABASE(index_pos == sizeof(uint64_t) * (b.block_num() - 1),
+                GOLOS_CHECK_DATABASE(index_pos == sizeof(uint64_t) * (b.block_num() - first_block_num),
                     database_corrupted::append_index_file_at_wrong_position,
                     "Append to index file occuring at wrong position.",
                     ("position", index_pos)
-                    ("expected", (b.block_num() - 1) * sizeof(uint64_t)));
+                    ("expected", (b.block_num() - first_block_num) * sizeof(uint64_t)));
 
                 uint64_t block_pos = get_mapped_size(block_mapped_file);
 
@@ -236,6 +263,8 @@ namespace golos { namespace chain {
             void close() {
                 block_mapped_file.close();
                 index_mapped_file.close();
+                archive.close();
+                first_block_num = 1;
                 head.reset();
                 head_id = block_id_type();
             }
@@ -285,6 +314,15 @@ namespace golos { namespace chain {
     optional<signed_block> block_log::read_block_by_num(uint32_t block_num) const { try {
         detail::read_lock lock(my->mutex);
         optional<signed_block> result;
+        if (block_num < my->first_block_num) {
+            result = my->archive.read_block_by_num(block_num);
+            GOLOS_CHECK_DATABASE(!result.valid() || result->block_num() == block_num,
+                database_corrupted::wrong_block_num_was_read,
+                "Wrong block was read from compressed block log (read ${block_num}, expected ${expected}).",
+                ("block_num", result->block_num())("expected", block_num));
+            return result;
+        }
+
         uint64_t pos = my->get_block_pos(block_num);
         if (pos != npos) {
             signed_block block;
@@ -305,9 +343,22 @@ namespace golos { namespace chain {
 
     signed_block block_log::read_head() const {
         detail::read_lock lock(my->mutex);
+        if (!my->has_block_records() && my->archive.head_num()) {
+            return *my->archive.read_block_by_num(my->archive.head_num());
+        }
         return my->read_head();
     }
 
+    uint32_t block_log::first_block_num() const {
+        detail::read_lock lock(my->mutex);
+        return my->first_block_num;
+    }
+
+    void block_log::set_chunk_cache_size(uint32_t chunks) {
+        detail::read_lock lock(my->mutex);
+        my->archive.set_cache_size(chunks);
+    }
+
     const optional<signed_block>& block_log::head() const {
         detail::read_lock lock(my->mutex);
         return my->head;
@@ -0,0 +1,446 @@
+#include <golos/chain/compressed_block_log.hpp>
+#include <golos/chain/block_log.hpp>
+#include <golos/chain/database_exceptions.hpp>
+#include <golos/protocol/exceptions.hpp>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/filesystem.hpp>
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace golos { namespace chain {
+    namespace detail {
+        static constexpr uint32_t compressed_block_log_magic = 0x4c425a47; // "GZBL"
+        static constexpr uint32_t compressed_block_log_version = 1;
+
+        struct compressed_data_header {
+            uint32_t magic = compressed_block_log_magic;
+            uint32_t version = compressed_block_log_version;
+            uint32_t blocks_per_chunk = 0;
+            uint32_t dictionary_size = 0;
+        };
+
+        struct compressed_index_header {
+            uint32_t magic = compressed_block_log_magic;
+            uint32_t version = compressed_block_log_version;
+            uint32_t blocks_per_chunk = 0;
+            uint32_t block_count = 0;
+        };
+
+        struct compressed_chunk_record {
+            uint64_t pos = 0;
+            uint32_t compressed_size = 0;
+            uint32_t raw_size = 0;
+        };
+
+        using chunk_ptr = std::shared_ptr<const std::vector<char>>;
+
+        class compressed_block_log_impl {
+        public:
+            boost::iostreams::mapped_file_source data_mapped_file;
+            boost::iostreams::mapped_file_source index_mapped_file;
+
+            const compressed_index_header* index_header = nullptr;
+            const compressed_chunk_record* chunks = nullptr;
+            const uint32_t* block_offsets = nullptr;
+            uint32_t chunk_count = 0;
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+            ZSTD_DDict* dictionary = nullptr;
+#endif
+
+            std::mutex cache_mutex;
+            std::size_t cache_size = 16;
+            std::list<std::pair<uint32_t, chunk_ptr>> cache;
+            std::unordered_map<uint32_t, decltype(cache)::iterator> cache_index;
+
+            ~compressed_block_log_impl() {
+                close();
+            }
+
+            uint32_t head_num() const {
+                return index_header ? index_header->block_count : 0;
+            }
+
+            void open(const fc::path& file) {
+                close();
+
+                auto data_path = compressed_block_log::data_path(file).string();
+                auto index_path = compressed_block_log::index_path(file).string();
+
+                data_mapped_file.open(data_path);
+                index_mapped_file.open(index_path);
+
+                GOLOS_CHECK_DATABASE(data_mapped_file.size() >= sizeof(compressed_data_header),
+                    database_corrupted::reading_data_beyond_end_of_file,
+                    "Compressed block log is too small", ("file", data_path)("size", data_mapped_file.size()));
+
+                GOLOS_CHECK_DATABASE(index_mapped_file.size() >= sizeof(compressed_index_header),
+                    database_corrupted::reading_data_beyond_end_of_file,
+                    "Compressed block log index is too small", ("file", index_path)("size", index_mapped_file.size()));
+
+                const auto* data_header = reinterpret_cast<const compressed_data_header*>(data_mapped_file.data());
+                index_header = reinterpret_cast<const compressed_index_header*>(index_mapped_file.data());
+
+                GOLOS_CHECK_DATABASE(
+                    data_header->magic == compressed_block_log_magic &&
+                    data_header->version == compressed_block_log_version &&
+                    index_header->magic == compressed_block_log_magic &&
+                    index_header->version == compressed_block_log_version &&
+                    index_header->blocks_per_chunk == data_header->blocks_per_chunk &&
+                    index_header->blocks_per_chunk > 0,
+                    database_corrupted::unknown_file_format,
+                    "Unknown format of compressed block log", ("file", data_path));
+
+                const auto bpc = index_header->blocks_per_chunk;
+                chunk_count = (index_header->block_count + bpc - 1) / bpc;
+
+                const auto index_size =
+                    sizeof(compressed_index_header) +
+                    sizeof(compressed_chunk_record) * chunk_count +
+                    sizeof(uint32_t) * index_header->block_count;
+
+                GOLOS_CHECK_DATABASE(index_mapped_file.size() == index_size,
+                    database_corrupted::reading_data_beyond_end_of_file,
+                    "Wrong size of compressed block log index",
+                    ("file", index_path)("size", index_mapped_file.size())("expected", index_size));
+
+                chunks = reinterpret_cast<const compressed_chunk_record*>(
+                    index_mapped_file.data() + sizeof(compressed_index_header));
+                block_offsets = reinterpret_cast<const uint32_t*>(chunks + chunk_count);
+
+                if (chunk_count) {
+                    const auto& last = chunks[chunk_count - 1];
+                    GOLOS_CHECK_DATABASE(last.pos + last.compressed_size <= data_mapped_file.size(),
+                        database_corrupted::reading_data_beyond_end_of_file,
+                        "Compressed block log is truncated",
+                        ("file", data_path)("size", data_mapped_file.size())("expected", last.pos + last.compressed_size));
+                }
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+                if (data_header->dictionary_size) {
+                    GOLOS_CHECK_DATABASE(
+                        sizeof(compressed_data_header) + data_header->dictionary_size <= data_mapped_file.size(),
+                        database_corrupted::reading_data_beyond_end_of_file,
+                        "Compressed block log is truncated", ("file", data_path));
+
+                    dictionary = ZSTD_createDDict(
+                        data_mapped_file.data() + sizeof(compressed_data_header), data_header->dictionary_size);
+                }
+#endif
+
+                ilog("Opened compressed block log with ${n} blocks in ${c} chunks",
+                    ("n", index_header->block_count)("c", chunk_count));
+            }
+
+            void close() {
+                {
+                    std::lock_guard<std::mutex> lock(cache_mutex);
+                    cache.clear();
+                    cache_index.clear();
+                }
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+                if (dictionary) {
+                    ZSTD_freeDDict(dictionary);
+                    dictionary = nullptr;
+                }
+#endif
+
+                index_header = nullptr;
+                chunks = nullptr;
+                block_offsets = nullptr;
+                chunk_count = 0;
+
+                data_mapped_file.close();
+                index_mapped_file.close();
+            }
+
+            chunk_ptr decompress_chunk(uint32_t chunk_num) const {
+                const auto& record = chunks[chunk_num];
+                auto result = std::make_shared<std::vector<char>>(record.raw_size);
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+                std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+                const auto* src = data_mapped_file.data() + record.pos;
+
+                std::size_t size;
+                if (dictionary) {
+                    size = ZSTD_decompress_usingDDict(
+                        ctx.get(), result->data(), result->size(), src, record.compressed_size, dictionary);
+                } else {
+                    size = ZSTD_decompressDCtx(
+                        ctx.get(), result->data(), result->size(), src, record.compressed_size);
+                }
+
+                GOLOS_CHECK_DATABASE(!ZSTD_isError(size) && size == record.raw_size,
+                    database_corrupted::decompression_failed,
+                    "Can't decompress chunk ${chunk} of compressed block log",
+                    ("chunk", chunk_num)("size", size)("expected", record.raw_size));
+#endif
+
+                return result;
+            }
+
+            chunk_ptr get_chunk(uint32_t chunk_num) {
+                {
+                    std::lock_guard<std::mutex> lock(cache_mutex);
+                    auto itr = cache_index.find(chunk_num);
+                    if (itr != cache_index.end()) {
+                        cache.splice(cache.begin(), cache, itr->second);
+                        return itr->second->second;
+                    }
+                }
+
+                // decompress without lock, so different chunks can be read in parallel
+                auto chunk = decompress_chunk(chunk_num);
+
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                if (!cache_size || cache_index.count(chunk_num)) {
+                    return chunk;
+                }
+
+                cache.emplace_front(chunk_num, chunk);
+                cache_index.emplace(chunk_num, cache.begin());
+                while (cache.size() > cache_size) {
+                    cache_index.erase(cache.back().first);
+                    cache.pop_back();
+                }
+                return chunk;
+            }
+
+            optional<signed_block> read_block_by_num(uint32_t block_num) {
+                optional<signed_block> result;
+                if (block_num == 0 || block_num > head_num()) {
+                    return result;
+                }
+
+                const auto bpc = index_header->blocks_per_chunk;
+                const auto chunk_num = (block_num - 1) / bpc;
+                auto chunk = get_chunk(chunk_num);
+
+                const auto begin = block_offsets[block_num - 1];
+                const auto end = (block_num % bpc == 0 || block_num == head_num())
+                    ? chunk->size()
+                    : block_offsets[block_num];
+
+                GOLOS_CHECK_DATABASE(begin < end && end <= chunk->size(),
+                    database_corrupted::reading_data_beyond_end_of_file,
+                    "Reading data beyond end of chunk",
+                    ("block_num", block_num)("begin", begin)("end", end)("chunk_size", chunk->size()));
+
+                fc::datastream<const char*> ds(chunk->data() + begin, end - begin);
+                signed_block block;
+                fc::raw::unpack(ds, block);
+                result = std::move(block);
+                return result;
+            }
+        };
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+        static std::vector<char> train_dictionary(
+            const block_log& src, uint32_t last_block_num, const compressed_block_log_options& opts
+        ) {
+            std::vector<char> dictionary;
+            if (!opts.dictionary_size) {
+                return dictionary;
+            }
+
+            // zstd recommends about 100 times more samples than the dictionary size
+            const std::size_t max_samples_size = std::size_t(opts.dictionary_size) * 100;
+            const uint32_t step = std::max<uint32_t>(1, last_block_num / 100000);
+
+            std::vector<char> samples;
+            std::vector<std::size_t> sample_sizes;
+            for (uint32_t block_num = 1; block_num <= last_block_num && samples.size() < max_samples_size; block_num += step) {
+                auto data = fc::raw::pack(*src.read_block_by_num(block_num));
+                samples.insert(samples.end(), data.begin(), data.end());
+                sample_sizes.push_back(data.size());
+            }
+
+            dictionary.resize(opts.dictionary_size);
+            auto size = ZDICT_trainFromBuffer(
+                dictionary.data(), dictionary.size(), samples.data(), sample_sizes.data(), sample_sizes.size());
+            if (ZDICT_isError(size)) {
+                wlog("Can't train dictionary: ${e}, compress without it", ("e", ZDICT_getErrorName(size)));
+                size = 0;
+            }
+            dictionary.resize(size);
+
+            ilog("Trained dictionary of ${size} bytes on ${n} blocks", ("size", size)("n", sample_sizes.size()));
+            return dictionary;
+        }
+#endif
+    }
+
+    compressed_block_log::compressed_block_log()
+            : my(std::make_unique<detail::compressed_block_log_impl>()) {
+    }
+
+    compressed_block_log::~compressed_block_log() {
+    }
+
+    bool compressed_block_log::is_supported() {
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    fc::path compressed_block_log::data_path(const fc::path& block_log_file) {
+        return fc::path(block_log_file.string() + ".zst");
+    }
+
+    fc::path compressed_block_log::index_path(const fc::path& block_log_file) {
+        return fc::path(block_log_file.string() + ".zst.index");
+    }
+
+    bool compressed_block_log::exists(const fc::path& block_log_file) {
+        return fc::exists(data_path(block_log_file)) && fc::exists(index_path(block_log_file));
+    }
+
+    void compressed_block_log::write(
+        const block_log& src, uint32_t last_block_num,
+        const fc::path& block_log_file, const compressed_block_log_options& opts
+    ) { try {
+        GOLOS_ASSERT(is_supported(), block_log_exception, "Node is built without support of compressed block log");
+        GOLOS_ASSERT(opts.blocks_per_chunk > 0, block_log_exception, "Number of blocks per chunk should be positive");
+        GOLOS_ASSERT(src.head() && src.head()->block_num() >= last_block_num, block_log_exception,
+            "Block log doesn't contain block ${n}", ("n", last_block_num));
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+        auto dictionary = detail::train_dictionary(src, last_block_num, opts);
+
+        std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+        std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> cdict(nullptr, &ZSTD_freeCDict);
+        if (!dictionary.empty()) {
+            cdict.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(), opts.compression_level));
+        }
+
+        // write to temporary files, so an interrupted conversion doesn't leave a broken archive
+        auto data_tmp_path = data_path(block_log_file).string() + ".tmp";
+        auto index_tmp_path = index_path(block_log_file).string() + ".tmp";
+        std::ofstream data_stream(data_tmp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        std::ofstream index_stream(index_tmp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        detail::compressed_data_header data_header;
+        data_header.blocks_per_chunk = opts.blocks_per_chunk;
+        data_header.dictionary_size = dictionary.size();
+        data_stream.write(reinterpret_cast<const char*>(&data_header), sizeof(data_header));
+        data_stream.write(dictionary.data(), dictionary.size());
+
+        uint64_t pos = sizeof(data_header) + dictionary.size();
+        std::vector<detail::compressed_chunk_record> chunks;
+        std::vector<uint32_t> block_offsets;
+        block_offsets.reserve(last_block_num);
+
+        std::vector<char> raw;
+        std::vector<char> compressed;
+        uint64_t total_raw_size = 0;
+
+        for (uint32_t first = 1; first <= last_block_num; first += opts.blocks_per_chunk) {
+            auto last = std::min(last_block_num, first + opts.blocks_per_chunk - 1);
+
+            raw.clear();
+            for (auto block_num = first; block_num <= last; ++block_num) {
+                auto block = src.read_block_by_num(block_num);
+                GOLOS_CHECK_DATABASE(block.valid() && block->block_num() == block_num,
+                    database_corrupted::wrong_block_num_was_read,
+                    "Block ${block_num} is absent in block log.", ("block_num", block_num));
+
+                block_offsets.push_back(raw.size());
+                auto data = fc::raw::pack(*block);
+                raw.insert(raw.end(), data.begin(), data.end());
+            }
+
+            compressed.resize(ZSTD_compressBound(raw.size()));
+            std::size_t size;
+            if (cdict) {
+                size = ZSTD_compress_usingCDict(
+                    ctx.get(), compressed.data(), compressed.size(), raw.data(), raw.size(), cdict.get());
+            } else {
+                size = ZSTD_compressCCtx(
+                    ctx.get(), compressed.data(), compressed.size(), raw.data(), raw.size(), opts.compression_level);
+            }
+            GOLOS_ASSERT(!ZSTD_isError(size), block_log_exception,
+                "Can't compress blocks from ${first} to ${last}: ${e}",
+                ("first", first)("last", last)("e", ZSTD_getErrorName(size)));
+
+            data_stream.write(compressed.data(), size);
+
+            detail::compressed_chunk_record record;
+            record.pos = pos;
+            record.compressed_size = size;
+            record.raw_size = raw.size();
+            chunks.push_back(record);
+
+            pos += size;
+            total_raw_size += raw.size();
+
+            if (chunks.size() % 1000 == 0) {
+                ilog("Compressed ${n} of ${total} blocks, ratio ${ratio}%",
+                    ("n", last)("total", last_block_num)("ratio", pos * 100 / std::max<uint64_t>(total_raw_size, 1)));
+            }
+        }
+
+        detail::compressed_index_header index_header;
+        index_header.blocks_per_chunk = opts.blocks_per_chunk;
+        index_header.block_count = last_block_num;
+        index_stream.write(reinterpret_cast<const char*>(&index_header), sizeof(index_header));
+        index_stream.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(chunks[0]));
+        index_stream.write(reinterpret_cast<const char*>(block_offsets.data()), block_offsets.size() * sizeof(uint32_t));
+
+        data_stream.close();
+        index_stream.close();
+        GOLOS_ASSERT(data_stream && index_stream, block_log_exception, "Can't write compressed block log");
+
+        boost::filesystem::rename(data_tmp_path, data_path(block_log_file).string());
+        boost::filesystem::rename(index_tmp_path, index_path(block_log_file).string());
+
+        ilog("Compressed ${n} blocks from ${raw} to ${size} bytes",
+            ("n", last_block_num)("raw", total_raw_size)("size", pos));
+#endif
+    } FC_LOG_AND_RETHROW() }
+
+    void compressed_block_log::open(const fc::path& block_log_file) { try {
+        GOLOS_ASSERT(is_supported(), block_log_exception,
+            "Found compressed block log ${file}, but node is built without its support",
+            ("file", data_path(block_log_file).string()));
+        my->open(block_log_file);
+    } FC_LOG_AND_RETHROW() }
+
+    void compressed_block_log::close() {
+        my->close();
+    }
+
+    bool compressed_block_log::is_open() const {
+        return my->index_header != nullptr;
+    }
+
+    uint32_t compressed_block_log::head_num() const {
+        return my->head_num();
+    }
+
+    optional<signed_block> compressed_block_log::read_block_by_num(uint32_t block_num) const { try {
+        return my->read_block_by_num(block_num);
+    } FC_LOG_AND_RETHROW() }
+
+    void compressed_block_log::set_cache_size(uint32_t chunks) {
+        std::lock_guard<std::mutex> lock(my->cache_mutex);
+        my->cache_size = chunks;
+        while (my->cache.size() > my->cache_size) {
+            my->cache_index.erase(my->cache.back().first);
+            my->cache.pop_back();
+        }
+    }
+
+} } // golos::chain
@@ -4,7 +4,9 @@
 
 #include <golos/protocol/steem_operations.hpp>
 
+#include <golos/chain/async_block_subscription.hpp>
 #include <golos/chain/block_summary_object.hpp>
+#include <golos/chain/compressed_block_log.hpp>
 #include <golos/chain/compound.hpp>
 #include <golos/chain/custom_operation_interpreter.hpp>
 #include <golos/chain/database.hpp>
@@ -20,6 +22,9 @@
 #include <golos/chain/operation_notification.hpp>
 #include <golos/chain/proposal_object.hpp>
 #include <golos/chain/curation_info.hpp>
+#include <golos/chain/replay_pipeline.hpp>
+#include <golos/chain/signature_recovery.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/smart_ref_impl.hpp>
 
@@ -32,6 +37,7 @@
 #include <csignal>
 #include <cerrno>
 #include <cstring>
+#include <mutex>
 
 #define VIRTUAL_SCHEDULE_LAP_LENGTH  ( fc::uint128_t(uint64_t(-1)) )
 #define VIRTUAL_SCHEDULE_LAP_LENGTH2 ( fc::uint128_t::max_value() )
@@ -172,6 +178,198 @@ namespace golos { namespace chain {
 
             database &_self;
             evaluator_registry<operation> _evaluator_registry;
+
+            /// block from replay pipeline, which is applied now
+            const prepared_block* _prepared_block = nullptr;
+
+            signature_recovery_pool _signature_recovery;
+
+            static constexpr std::size_t max_recovered_blocks = 64;
+            std::mutex _recovered_keys_mutex;
+            std::deque<recovered_block_keys_ptr> _recovered_keys;
+
+            /// keys of the block, which is applied now
+            recovered_block_keys_ptr _block_keys;
+            const signed_block* _block_keys_block = nullptr;
+
+            mutable std::mutex _async_subscriptions_mutex;
+            std::vector<async_block_subscription_ptr> _async_subscriptions;
+
+            /// bundle of the block, which is applied now, it is collected only for async subscribers
+            std::shared_ptr<applied_block_bundle> _bundle;
+
+            std::vector<async_block_subscription_ptr> async_subscriptions() const {
+                std::lock_guard<std::mutex> lock(_async_subscriptions_mutex);
+                return _async_subscriptions;
+            }
+
+            void add_bundled_operation(const operation_notification& note) {
+                if (_bundle == nullptr) {
+                    return;
+                }
+                bundled_operation item;
+                item.op = note.op;
+                item.trx_id = note.trx_id;
+                item.trx_in_block = note.trx_in_block;
+                item.op_in_trx = note.op_in_trx;
+                item.virtual_op = note.virtual_op;
+                _bundle->operations.push_back(std::move(item));
+            }
+
+            void publish_bundle(const signed_block& b) {
+                if (_bundle == nullptr) {
+                    return;
+                }
+                _bundle->block = b;
+                _bundle->block_id = block_id(b);
+                _bundle->block_num = b.block_num();
+
+                applied_block_bundle_ptr bundle = std::move(_bundle);
+                for (auto& subscription: async_subscriptions()) {
+                    subscription->push(bundle);
+                }
+            }
+
+            static int64_t trx_index(const signed_block& b, const signed_transaction& trx) {
+                const auto& trxs = b.transactions;
+                std::less<const signed_transaction*> less;
+                if (trxs.empty() || less(&trx, trxs.data()) || !less(&trx, trxs.data() + trxs.size())) {
+                    return -1;
+                }
+                return &trx - trxs.data();
+            }
+
+            int64_t prepared_trx_index(const signed_transaction& trx) const {
+                if (_prepared_block == nullptr) {
+                    return -1;
+                }
+                return trx_index(_prepared_block->block, trx);
+            }
+
+            void add_recovered_keys(recovered_block_keys_ptr keys) {
+                std::lock_guard<std::mutex> lock(_recovered_keys_mutex);
+                _recovered_keys.push_back(std::move(keys));
+                if (_recovered_keys.size() > max_recovered_blocks) {
+                    _recovered_keys.pop_front();
+                }
+            }
+
+            recovered_block_keys_ptr take_recovered_keys(const signed_block& b) {
+                std::lock_guard<std::mutex> lock(_recovered_keys_mutex);
+                if (_recovered_keys.empty()) {
+                    return nullptr;
+                }
+                auto id = block_id(b);
+                auto itr = std::find_if(_recovered_keys.begin(), _recovered_keys.end(), [&](const auto& keys) {
+                    return keys->block_id == id;
+                });
+                if (itr == _recovered_keys.end()) {
+                    return nullptr;
+                }
+                auto result = std::move(*itr);
+                _recovered_keys.erase(itr);
+                return result;
+            }
+
+            const public_key_type* recovered_signee(const signed_block& b) const {
+                if (_block_keys == nullptr || _block_keys_block != &b || !_block_keys->signee.valid()) {
+                    return nullptr;
+                }
+                return &(*_block_keys->signee);
+            }
+
+            const flat_set<public_key_type>* recovered_trx_keys(const signed_transaction& trx) const {
+                if (_block_keys == nullptr) {
+                    return nullptr;
+                }
+                auto idx = trx_index(*_block_keys_block, trx);
+                if (idx < 0 || std::size_t(idx) >= _block_keys->trx_keys.size() || !_block_keys->trx_keys[idx].valid()) {
+                    return nullptr;
+                }
+                return &(*_block_keys->trx_keys[idx]);
+            }
+
+            block_id_type block_id(const signed_block& b) const {
+                if (_prepared_block != nullptr && &_prepared_block->block == &b) {
+                    return _prepared_block->block_id;
+                }
+                return b.id();
+            }
+
+            uint32_t block_size(const signed_block& b) const {
+                if (_prepared_block != nullptr && &_prepared_block->block == &b) {
+                    return _prepared_block->block_size;
+                }
+                return fc::raw::pack_size(b);
+            }
+
+            transaction_id_type trx_id(const signed_transaction& trx) const {
+                auto idx = prepared_trx_index(trx);
+                if (idx >= 0) {
+                    return _prepared_block->trx_ids[idx];
+                }
+                return trx.id();
+            }
+
+            uint32_t trx_size(const signed_transaction& trx) const {
+                auto idx = prepared_trx_index(trx);
+                if (idx >= 0) {
+                    return _prepared_block->trx_sizes[idx];
+                }
+                return fc::raw::pack_size(trx);
+            }
+        };
+
+        class prepared_block_scope final {
+        public:
+            prepared_block_scope(database_impl& impl, const prepared_block& item)
+                    : _impl(impl) {
+                _impl._prepared_block = &item;
+            }
+
+            ~prepared_block_scope() {
+                _impl._prepared_block = nullptr;
+            }
+
+        private:
+            database_impl& _impl;
+        };
+
+        class block_bundle_scope final {
+        public:
+            block_bundle_scope(database_impl& impl)
+                    : _impl(impl) {
+                std::lock_guard<std::mutex> lock(_impl._async_subscriptions_mutex);
+                if (!_impl._async_subscriptions.empty()) {
+                    _impl._bundle = std::make_shared<applied_block_bundle>();
+                }
+            }
+
+            ~block_bundle_scope() {
+                _impl._bundle.reset();
+            }
+
+        private:
+            database_impl& _impl;
+        };
+
+        class block_keys_scope final {
+        public:
+            block_keys_scope(database_impl& impl, const signed_block& b, recovered_block_keys_ptr keys)
+                    : _impl(impl) {
+                if (keys != nullptr) {
+                    _impl._block_keys = std::move(keys);
+                    _impl._block_keys_block = &b;
+                }
+            }
+
+            ~block_keys_scope() {
+                _impl._block_keys.reset();
+                _impl._block_keys_block = nullptr;
+            }
+
+        private:
+            database_impl& _impl;
         };
 
         database_impl::database_impl(database &self)
@@ -206,7 +404,11 @@ namespace golos { namespace chain {
 
                     if (!find<dynamic_global_property_object>()) {
                         with_strong_write_lock([&]() {
-                            init_genesis(initial_supply);
+                            if (_snapshot_to_load.empty()) {
+                                init_genesis(initial_supply);
+                            } else {
+                                load_snapshot();
+                            }
                         });
                     }
 
@@ -238,6 +440,12 @@ namespace golos { namespace chain {
 
                         _fork_db.start_block(*head_block);
                     }
+
+                    auto log_head = _block_log.head();
+                    if (log_head && log_head->block_num() > head_block_num()) {
+                        wlog("State is behind the block log, blocks from ${from} to ${to} should be replayed",
+                            ("from", head_block_num() + 1)("to", log_head->block_num()));
+                    }
                     end = fc::time_point::now();
                     wlog("Done opening block log, elapsed time ${t} sec", ("t", double((end - start).count()) / 1000000.0));
                 }
@@ -279,39 +487,94 @@ namespace golos { namespace chain {
                     auto last_block_pos = _block_log.get_block_pos(last_block_num);
                     int last_reindex_percent = 0;
 
-                    set_reserved_memory(1024*1024*1024); // protect from memory fragmentations ...
-                    while (cur_block_num < last_block_num) {
-                        if (signal_guard::get_is_interrupted()) {
-                            return;
-                        }
+                    // blocks from the compressed archive don't have positions, so count progress by numbers
+                    const bool progress_by_pos = _block_log.first_block_num() == 1 && last_block_pos > 0;
 
+                    auto print_progress = [&](uint32_t block_num) -> bool {
                         auto end = fc::time_point::now();
-                        auto cur_block_pos = _block_log.get_block_pos(cur_block_num);
-                        auto cur_block = *_block_log.read_block_by_num(cur_block_num);
 
-                        auto reindex_percent = cur_block_pos * 100 / last_block_pos;
+                        auto reindex_percent = progress_by_pos
+                            ? _block_log.get_block_pos(block_num) * 100 / last_block_pos
+                            : uint64_t(block_num) * 100 / last_block_num;
                         if (reindex_percent - last_reindex_percent >= 1) {
                             std::cerr
                                 << "   " << reindex_percent << "%   "
-                                << cur_block_num << " of " << last_block_num
+                                << block_num << " of " << last_block_num
                                 << "   ("  << (free_memory() / (1024 * 1024)) << "M free"
                                 << ", elapsed " << double((end - start).count()) / 1000000.0 << " sec)\n";
 
                             last_reindex_percent = reindex_percent;
+                            return true;
                         }
+                        return false;
+                    };
 
-                        apply_block(cur_block, skip_flags);
+                    set_reserved_memory(1024*1024*1024); // protect from memory fragmentations ...
+                    if (_replay_pipeline_size) {
+                        ilog("Using pipelined replay with ring size ${n}", ("n", _replay_pipeline_size));
+
+                        replay_pipeline pipeline(_block_log, cur_block_num, last_block_num, _replay_pipeline_size);
+                        pipeline.start();
+
+                        prepared_block item;
+                        while (pipeline.next(item)) {
+                            if (signal_guard::get_is_interrupted()) {
+                                return;
+                            }
+
+                            cur_block_num = item.block.block_num();
+                            if (print_progress(cur_block_num)) {
+                                pipeline.print_stats(std::cerr);
+                            }
+
+                            auto apply_start = fc::time_point::now();
+                            {
+                                prepared_block_scope scope(*_my, item);
+                                apply_block(item.block, skip_flags);
+                            }
+                            pipeline.on_applied(fc::time_point::now() - apply_start);
+
+                            if (cur_block_num % 1000 == 0) {
+                                set_revision(head_block_num());
+                            }
+
+                            if (_profiler && _profile_dump_interval && cur_block_num % _profile_dump_interval == 0) {
+                                _profiler->log_stats();
+                            }
 
-                        if (cur_block_num % 1000 == 0) {
-                            set_revision(head_block_num());
+                            check_free_memory(true, cur_block_num);
                         }
+                        pipeline.stop();
 
-                        check_free_memory(true, cur_block_num);
-                        cur_block_num++;
-                    }
+                        std::cerr << "   Replay pipeline stages:\n";
+                        pipeline.print_stats(std::cerr);
+                    } else {
+                        while (cur_block_num < last_block_num) {
+                            if (signal_guard::get_is_interrupted()) {
+                                return;
+                            }
+
+                            auto cur_block = *_block_log.read_block_by_num(cur_block_num);
+
+                            print_progress(cur_block_num);
+
+                            apply_block(cur_block, skip_flags);
+
+                            if (cur_block_num % 1000 == 0) {
+                                set_revision(head_block_num());
+                            }
+
+                            if (_profiler && _profile_dump_interval && cur_block_num % _profile_dump_interval == 0) {
+                                _profiler->log_stats();
+                            }
+
+                            check_free_memory(true, cur_block_num);
+                            cur_block_num++;
+                        }
 
-                    auto cur_block = *_block_log.read_block_by_num(cur_block_num);
-                    apply_block(cur_block, skip_flags);
+                        auto cur_block = *_block_log.read_block_by_num(cur_block_num);
+                        apply_block(cur_block, skip_flags);
+                    }
                     set_reserved_memory(0);
                     set_revision(head_block_num());
                 });
@@ -328,11 +591,87 @@ namespace golos { namespace chain {
                 auto end = fc::time_point::now();
                 ilog("Done reindexing, elapsed time: ${t} sec", ("t",
                         double((end - start).count()) / 1000000.0));
+                if (_profiler && _profile_dump_interval) {
+                    _profiler->log_stats();
+                }
             }
             FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir))
 
         }
 
+        void database::set_replay_pipeline_size(uint32_t ring_size) {
+            _replay_pipeline_size = ring_size;
+        }
+
+        void database::set_signature_recovery_threads(uint32_t threads) {
+            _my->_signature_recovery.start(threads);
+        }
+
+        void database::set_block_log_chunk_cache_size(uint32_t chunks) {
+            _block_log.set_chunk_cache_size(chunks);
+        }
+
+        void database::set_bulk_sync_buffer_size(uint32_t blocks) {
+            _bulk_sync_buffer_size = blocks;
+        }
+
+        void database::set_operation_profiling(bool enabled, uint32_t dump_interval) {
+            if (enabled) {
+                if (!_profiler) {
+                    _profiler = std::make_unique<database_profiler>(*this);
+                }
+            } else {
+                _profiler.reset();
+            }
+            _profile_dump_interval = dump_interval;
+        }
+
+        async_block_subscription_ptr database::subscribe_async(
+            std::string name, uint32_t capacity, async_block_subscription::handler_type handler
+        ) {
+            auto subscription = std::make_shared<async_block_subscription>(
+                std::move(name), capacity, std::move(handler));
+            subscription->start();
+
+            std::lock_guard<std::mutex> lock(_my->_async_subscriptions_mutex);
+            _my->_async_subscriptions.push_back(subscription);
+            return subscription;
+        }
+
+        void database::unsubscribe_async(const async_block_subscription_ptr& subscription) {
+            {
+                std::lock_guard<std::mutex> lock(_my->_async_subscriptions_mutex);
+                auto& subscriptions = _my->_async_subscriptions;
+                subscriptions.erase(
+                    std::remove(subscriptions.begin(), subscriptions.end(), subscription), subscriptions.end());
+            }
+            subscription->stop();
+        }
+
+        std::vector<async_subscription_stats> database::get_async_subscription_stats() const {
+            std::vector<async_subscription_stats> result;
+            for (const auto& subscription: _my->async_subscriptions()) {
+                result.push_back(subscription->get_stats());
+            }
+            return result;
+        }
+
+        void database::set_read_epoch_mode(bool value) {
+            // a reader waits for the block not longer than for the read lock with all its retries
+            _read_epoch.set_wait_timeout(fc::microseconds(read_wait_micro() * (max_read_wait_retries() + 1)));
+            _read_epoch.set_enabled(value);
+        }
+
+        void database::set_lock_metrics(bool value) {
+            _lock_metrics.set_enabled(value);
+        }
+
+        database_lock_stats database::get_lock_stats() const {
+            auto stats = _lock_metrics.get_stats();
+            stats.epoch = _read_epoch.epoch();
+            return stats;
+        }
+
         void database::set_min_free_shared_memory_size(size_t value) {
             _min_free_shared_memory_size = value;
         }
@@ -452,6 +791,8 @@ namespace golos { namespace chain {
             if (include_blocks) {
                 fc::remove_all(data_dir / "block_log");
                 fc::remove_all(data_dir / "block_log.index");
+                fc::remove_all(compressed_block_log::data_path(data_dir / "block_log"));
+                fc::remove_all(compressed_block_log::index_path(data_dir / "block_log"));
             }
         }
 
@@ -1015,6 +1356,22 @@ namespace golos { namespace chain {
             return skip;
         }
 
+        void database::recover_signature_keys(const signed_block& new_block, uint32_t skip) {
+            if (!_my->_signature_recovery.is_started()) {
+                return;
+            }
+
+            bool with_transactions = !(skip & (skip_transaction_signatures | skip_authority_check));
+            if (!with_transactions && (skip & skip_witness_signature)) {
+                return;
+            }
+
+            auto keys = _my->_signature_recovery.recover(new_block, get_chain_id(), with_transactions);
+            if (keys != nullptr) {
+                _my->add_recovered_keys(std::move(keys));
+            }
+        }
+
         void database::_validate_block(const signed_block& new_block, uint32_t skip) {
             uint32_t new_block_num = new_block.block_num();
 
@@ -1063,7 +1420,7 @@ namespace golos { namespace chain {
             //fc::time_point begin_time = fc::time_point::now();
 
             bool result;
-            with_strong_write_lock([&]() {
+            with_block_write_lock([&]() {
                 detail::without_pending_transactions(*this, skip, std::move(_pending_tx), [&]() {
                     try {
                         result = _push_block(new_block, skip);
@@ -1091,6 +1448,128 @@ namespace golos { namespace chain {
             return result;
         }
 
+        bool database::bulk_sync_block(const signed_block &new_block) {
+            try {
+                if (_checkpoints.empty() || _checkpoints.rbegin()->second == block_id_type()) {
+                    return false;
+                }
+
+                auto new_block_num = new_block.block_num();
+                if (new_block_num > _checkpoints.rbegin()->first) {
+                    return false;
+                }
+
+                auto log_head = _block_log.head();
+                auto log_head_num = log_head ? log_head->block_num() : 0;
+                if (new_block_num <= log_head_num) {
+                    auto block = _block_log.read_block_by_num(new_block_num);
+                    FC_ASSERT(block && block->id() == new_block.id(), "Block doesn't match the block log",
+                        ("block_num", new_block_num)("block_id", new_block.id()));
+                    return true;
+                }
+
+                auto buffered_num = log_head_num + uint32_t(_bulk_sync_blocks.size());
+                if (new_block_num <= buffered_num) {
+                    auto index = new_block_num - log_head_num - 1;
+                    if (_bulk_sync_blocks[index].id() == new_block.id()) {
+                        return true;
+                    }
+                    auto previous_id = index ? _bulk_sync_blocks[index - 1].id()
+                                             : (log_head ? log_head->id() : block_id_type());
+                    FC_ASSERT(new_block.previous == previous_id, "Block doesn't link to the previous block",
+                        ("block_num", new_block_num)("previous", new_block.previous));
+
+                    // only one of the chains leads to the checkpoint, so the linked block replaces received ones
+                    _bulk_sync_blocks.erase(_bulk_sync_blocks.begin() + index, _bulk_sync_blocks.end());
+                    _bulk_sync_head_id = previous_id;
+                    buffered_num = new_block_num - 1;
+                }
+
+                // reversible blocks of the state aren't in the block log yet, they are pushed through the fork database
+                auto head_num = with_weak_read_lock([&]() {
+                    return head_block_num();
+                });
+                if (new_block_num != buffered_num + 1 || head_num > log_head_num) {
+                    return false;
+                }
+
+                // the block can be written only with all blocks up to the next checkpoint
+                auto checkpoint = _checkpoints.lower_bound(new_block_num);
+                if (checkpoint->first - log_head_num > _bulk_sync_buffer_size) {
+                    return false;
+                }
+
+                if (_bulk_sync_blocks.empty()) {
+                    _bulk_sync_head_id = log_head ? log_head->id() : block_id_type();
+                }
+                FC_ASSERT(new_block.previous == _bulk_sync_head_id,
+                    "Block doesn't link to the previous block",
+                    ("block_num", new_block_num)("previous", new_block.previous));
+
+                // the merkle root binds transactions to the header, which is chained to the checkpoint
+                _validate_block(new_block, skip_block_size_check);
+
+                auto new_block_id = new_block.id();
+                if (checkpoint->first != new_block_num) {
+                    _bulk_sync_blocks.push_back(new_block);
+                    _bulk_sync_head_id = new_block_id;
+                    return true;
+                }
+
+                if (new_block_id != checkpoint->second) {
+                    // a peer sent the chain of other blocks, they are received again
+                    _bulk_sync_blocks.clear();
+                    FC_THROW("Block did not match checkpoint", ("checkpoint", *checkpoint)("block_id", new_block_id));
+                }
+
+                for (const auto& block: _bulk_sync_blocks) {
+                    _block_log.append(block);
+                }
+                _block_log.append(new_block);
+                _block_log.flush();
+                _bulk_sync_blocks.clear();
+                return true;
+            } FC_CAPTURE_AND_RETHROW((new_block.block_num()))
+        }
+
+        uint32_t database::apply_bulk_synced_blocks(uint32_t max_blocks) {
+            try {
+                uint32_t applied = 0;
+                with_block_write_lock([&]() {
+                    auto log_head = _block_log.head();
+                    if (!log_head || log_head->block_num() <= head_block_num()) {
+                        return;
+                    }
+
+                    auto last_block_num = log_head->block_num();
+                    if (uint64_t(head_block_num()) + max_blocks < last_block_num) {
+                        last_block_num = head_block_num() + max_blocks;
+                    }
+
+                    // blocks are covered by checkpoints, so apply_block() reduces checks like on reindex
+                    const uint32_t skip_flags = skip_block_log;
+
+                    optional<signed_block> block;
+                    for (auto block_num = head_block_num() + 1; block_num <= last_block_num; ++block_num) {
+                        block = _block_log.read_block_by_num(block_num);
+                        GOLOS_ASSERT(block && block->previous == head_block_id(), block_log_exception,
+                            "Block ${block_num} of block log doesn't link to the head block", ("block_num", block_num));
+
+                        apply_block(*block, skip_flags);
+                        check_free_memory(true, block_num);
+                        ++applied;
+                    }
+
+                    set_revision(head_block_num());
+
+                    // next blocks after the checkpoint are pushed as usual on top of the applied ones
+                    _fork_db.reset();
+                    _fork_db.start_block(*block);
+                });
+                return applied;
+            } FC_CAPTURE_AND_RETHROW((max_blocks))
+        }
+
         void database::_maybe_warn_multiple_production(uint32_t height) const {
             auto blocks = _fork_db.fetch_block_by_number(height);
             if (blocks.size() > 1) {
@@ -1272,7 +1751,7 @@ namespace golos { namespace chain {
 
             signed_block pending_block;
 
-            with_strong_write_lock([&]() { detail::with_generating(*this, [&]() {
+            with_block_write_lock([&]() { detail::with_generating(*this, [&]() {
                 //
                 // The following code throws away existing pending_tx_session and
                 // rebuilds it by re-applying pending transactions.
@@ -1430,6 +1909,8 @@ namespace golos { namespace chain {
         }
 
         void database::notify_post_apply_operation(const operation_notification &note) {
+            _my->add_bundled_operation(note);
+
             if (!is_producing() || _enable_plugins_on_push_transaction) {
                 STEEMIT_TRY_NOTIFY(post_apply_operation, note);
             }
@@ -3675,6 +4156,8 @@ namespace golos { namespace chain {
             add_core_index<asset_index>(*this);
             add_core_index<account_balance_index>(*this);
 
+            initialize_snapshot_indexes();
+
             _plugin_index_signal();
         }
 
@@ -4005,7 +4488,12 @@ namespace golos { namespace chain {
                 };
 
                 try {
-                    trx.verify_authority(chain_id, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                    auto keys = _my->recovered_trx_keys(trx);
+                    if (keys != nullptr) {
+                        golos::protocol::verify_authority(trx.operations, *keys, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                    } else {
+                        trx.verify_authority(chain_id, get_active, get_owner, get_posting, STEEMIT_MAX_SIG_CHECK_DEPTH);
+                    }
                 }
                 catch (protocol::tx_missing_active_auth &e) {
                     if (get_shared_db_merkle().find(head_block_num() + 1) == get_shared_db_merkle().end()) {
@@ -4099,7 +4587,7 @@ namespace golos { namespace chain {
                     _checkpoints.rbegin()->second != block_id_type()) {
                     auto itr = _checkpoints.find(block_num);
                     if (itr != _checkpoints.end())
-                        FC_ASSERT(next_block.id() ==
+                        FC_ASSERT(_my->block_id(next_block) ==
                                   itr->second, "Block did not match checkpoint", ("checkpoint", *itr)("block_id", next_block.id()));
 
                     if (_checkpoints.rbegin()->first >= block_num) {
@@ -4162,6 +4650,11 @@ namespace golos { namespace chain {
                 const auto &gprops = get_dynamic_global_properties();
                 //block_id_type next_block_id = next_block.id();
 
+                block_keys_scope keys_scope(*_my, next_block, _my->take_recovered_keys(next_block));
+                block_bundle_scope bundle_scope(*_my);
+                database_profiler::phase_sequence phases(_profiler.get());
+
+                phases.next("validate_block");
                 _validate_block(next_block, skip);
 
                 const witness_object &signing_witness = validate_block_header(skip, next_block);
@@ -4190,6 +4683,7 @@ namespace golos { namespace chain {
                     );
                 }
 
+                phases.next("apply_transactions");
                 for (const auto &trx : next_block.transactions) {
                     /* We do not need to push the undo state for each transaction
                      * because they either all apply and are valid or the
@@ -4205,6 +4699,7 @@ namespace golos { namespace chain {
                 _current_op_in_trx = 0;
                 _current_virtual_op = 0;
 
+                phases.next("update_global_properties");
                 update_global_dynamic_data(next_block, skip);
                 update_signing_witness(signing_witness, next_block);
 
@@ -4212,45 +4707,67 @@ namespace golos { namespace chain {
 
                 create_block_summary(next_block);
 
+                phases.next("clear_expired");
                 clear_expired_proposals();
                 clear_expired_transactions();
                 clear_expired_orders();
                 clear_expired_delegations();
 
+                phases.next("update_witness_schedule");
                 check_witness_idleness();
                 update_witness_schedule();
 
+                phases.next("update_median_feed");
                 update_median_feed();
                 update_virtual_supply();
 
+                phases.next("process_funds");
                 clear_null_account_balance();
                 process_funds();
                 process_accumulative_distributions();
                 process_conversions();
                 process_sbd_debt_conversions();
+
+                phases.next("process_comment_cashout");
                 process_comment_cashout();
+
+                phases.next("process_workers");
                 process_worker_votes();
                 process_worker_cashout();
+
+                phases.next("check_idleness");
                 check_account_idleness();
                 check_claim_idleness();
+
+                phases.next("process_withdrawals");
                 process_vesting_withdrawals();
                 process_savings_withdraws();
                 pay_liquidity_reward();
                 update_virtual_supply();
 
+                phases.next("process_expirations");
                 account_recovery_processing();
                 expire_escrow_ratification();
                 process_decline_voting_rights();
 
+                phases.next("process_hardforks");
                 process_hardforks();
 
                 // notify observers that the block has been applied
+                phases.next("notify_applied_block");
                 notify_applied_block(next_block);
 
                 process_transit_to_cyberway(next_block, skip);
 
                 notify_changed_objects();
 
+                _my->publish_bundle(next_block);
+
+                phases.stop();
+                if (_profiler) {
+                    _profiler->on_block(next_block_num);
+                }
+
             } FC_CAPTURE_LOG_AND_RETHROW((next_block.block_num()))
         }
 
@@ -4386,11 +4903,11 @@ namespace golos { namespace chain {
 
         void database::_apply_transaction(const signed_transaction &trx, uint32_t skip) {
             try {
-                _current_trx_id = trx.id();
+                auto trx_id = _my->trx_id(trx);
+                _current_trx_id = trx_id;
                 _current_virtual_op = 0;
 
                 auto &trx_idx = get_index<transaction_index>();
-                auto trx_id = trx.id();
                 // idump((trx_id)(skip&skip_transaction_dupe_check));
                 if (!(skip & skip_transaction_dupe_check) &&
                           trx_idx.indices().get<by_trx_id>().find(trx_id) != trx_idx.indices().get<by_trx_id>().end()) {
@@ -4404,7 +4921,7 @@ namespace golos { namespace chain {
                 vector<authority> other;
                 trx.get_required_authorities(required, required, required, other);
 
-                auto trx_size = fc::raw::pack_size(trx);
+                auto trx_size = _my->trx_size(trx);
 
                 const auto& props = get_dynamic_global_properties();
 
@@ -4469,7 +4986,10 @@ namespace golos { namespace chain {
                 note.virtual_op = _current_virtual_op;
             }
             notify_pre_apply_operation(note);
-            _my->_evaluator_registry.get_evaluator(op).apply(op);
+            {
+                database_profiler::operation_scope scope(_profiler.get(), op.which());
+                _my->_evaluator_registry.get_evaluator(op).apply(op);
+            }
             notify_post_apply_operation(note);
         }
 
@@ -4481,8 +5001,14 @@ namespace golos { namespace chain {
                           next_block.timestamp, "", ("head_block_time", head_block_time())("next", next_block.timestamp)("blocknum", next_block.block_num()));
                 const witness_object &witness = get_witness(next_block.witness);
 
-                if (!(skip & skip_witness_signature))
-                    FC_ASSERT(next_block.validate_signee(witness.signing_key));
+                if (!(skip & skip_witness_signature)) {
+                    auto signee = _my->recovered_signee(next_block);
+                    if (signee != nullptr) {
+                        FC_ASSERT(*signee == witness.signing_key);
+                    } else {
+                        FC_ASSERT(next_block.validate_signee(witness.signing_key));
+                    }
+                }
 
                 if (!(skip & skip_witness_schedule_check)) {
                     uint32_t slot_num = get_slot_at_time(next_block.timestamp);
@@ -4503,14 +5029,14 @@ namespace golos { namespace chain {
             try {
                 block_summary_id_type sid(next_block.block_num() & 0xffff);
                 modify(get_block_summary(sid), [&](block_summary_object &p) {
-                    p.block_id = next_block.id();
+                    p.block_id = _my->block_id(next_block);
                 });
             } FC_CAPTURE_AND_RETHROW()
         }
 
         void database::update_global_dynamic_data(const signed_block &b, uint32_t skip) {
             try {
-                auto block_size = fc::raw::pack_size(b);
+                auto block_size = _my->block_size(b);
                 const dynamic_global_property_object &_dgp =
                         get_dynamic_global_properties();
 
@@ -4567,7 +5093,7 @@ namespace golos { namespace chain {
                     }
 
                     dgp.head_block_number = b.block_num();
-                    dgp.head_block_id = b.id();
+                    dgp.head_block_id = _my->block_id(b);
                     dgp.time = b.timestamp;
                     dgp.current_aslot += missed_blocks + 1;
                     dgp.average_block_size =
@@ -4972,6 +5498,8 @@ namespace golos { namespace chain {
                    (head_block_time() > dedupe_index.begin()->expiration)) {
                 remove(*dedupe_index.begin());
             }
+
+            signature_cache::instance().remove_expired(head_block_time());
         }
 
         void database::clear_expired_orders() {
@@ -0,0 +1,151 @@
+#include <golos/chain/database_profiler.hpp>
+#include <golos/protocol/operations.hpp>
+#include <golos/protocol/operation_util_impl.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace golos { namespace chain {
+
+    void profile_counters::add(const profile_counters& other) {
+        calls += other.calls;
+        time += other.time;
+        creates += other.creates;
+        modifies += other.modifies;
+        removes += other.removes;
+        memory += other.memory;
+    }
+
+    database_profiler::database_profiler(const chainbase::database& db)
+            : _db(db),
+              _operations(protocol::operation::count()) {
+    }
+
+    void database_profiler::suspend(frame& f, const fc::time_point& now, uint64_t free_memory) {
+        f.counters->time += (now - f.start).count();
+        f.counters->memory += int64_t(f.free_memory) - int64_t(free_memory);
+    }
+
+    void database_profiler::push(profile_counters& counters) {
+        const auto now = fc::time_point::now();
+        const auto free_memory = _db.free_memory();
+        if (!_frames.empty()) {
+            suspend(_frames.back(), now, free_memory);
+        }
+
+        ++counters.calls;
+        _frames.push_back({&counters, now, free_memory});
+        _current = &counters;
+    }
+
+    void database_profiler::begin_operation(int which) {
+        push(_operations[which]);
+    }
+
+    void database_profiler::begin_phase(const char* name) {
+        auto itr = _block_phases.find(name);
+        if (itr == _block_phases.end()) {
+            itr = _block_phases.emplace(name, profile_counters()).first;
+        }
+        push(itr->second);
+    }
+
+    void database_profiler::end() {
+        if (_frames.empty()) {
+            return;
+        }
+
+        const auto now = fc::time_point::now();
+        const auto free_memory = _db.free_memory();
+        suspend(_frames.back(), now, free_memory);
+        _frames.pop_back();
+
+        if (_frames.empty()) {
+            _current = nullptr;
+        } else {
+            auto& parent = _frames.back();
+            parent.start = now;
+            parent.free_memory = free_memory;
+            _current = parent.counters;
+        }
+    }
+
+    void database_profiler::on_block(uint32_t block_num) {
+        if (!_first_block) {
+            _first_block = block_num;
+        }
+        _last_block = block_num;
+        ++_blocks;
+    }
+
+    profile_stats database_profiler::get_stats() const {
+        profile_stats result;
+        result.first_block = _first_block;
+        result.last_block = _last_block;
+        result.blocks = _blocks;
+
+        for (std::size_t i = 0; i < _operations.size(); ++i) {
+            const auto& counters = _operations[i];
+            if (!counters.calls) {
+                continue;
+            }
+
+            protocol::operation op;
+            op.set_which(i);
+            std::string name;
+            op.visit(fc::get_operation_name(name));
+
+            result.operations.emplace(name, counters);
+            result.total.add(counters);
+        }
+
+        for (const auto& phase: _block_phases) {
+            result.block_phases.emplace(phase.first, phase.second);
+            result.total.add(phase.second);
+        }
+        return result;
+    }
+
+    void database_profiler::reset() {
+        std::fill(_operations.begin(), _operations.end(), profile_counters());
+        for (auto& phase: _block_phases) {
+            phase.second = profile_counters();
+        }
+        _first_block = 0;
+        _last_block = 0;
+        _blocks = 0;
+    }
+
+    void database_profiler::log_stats(std::size_t limit) const {
+        auto stats = get_stats();
+        if (!stats.blocks) {
+            return;
+        }
+
+        auto log_top = [&](const char* title, const std::map<std::string, profile_counters>& items) {
+            std::vector<std::pair<std::string, profile_counters>> sorted(items.begin(), items.end());
+            std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.second.time > rhs.second.time;
+            });
+            if (sorted.size() > limit) {
+                sorted.resize(limit);
+            }
+
+            ilog("Profile of ${title}:", ("title", title));
+            for (const auto& item: sorted) {
+                const auto& c = item.second;
+                ilog("   ${name}: ${calls} calls, ${time} ms (${percent}%), ${creates}/${modifies}/${removes} created/modified/removed, ${memory} KB",
+                    ("name", item.first)("calls", c.calls)("time", c.time / 1000)
+                    ("percent", stats.total.time ? c.time * 100 / stats.total.time : 0)
+                    ("creates", c.creates)("modifies", c.modifies)("removes", c.removes)("memory", c.memory / 1024));
+            }
+        };
+
+        ilog("Profile of blocks from ${first} to ${last}: ${blocks} blocks, ${time} ms",
+            ("first", stats.first_block)("last", stats.last_block)("blocks", stats.blocks)("time", stats.total.time / 1000));
+        log_top("operations", stats.operations);
+        log_top("block phases", stats.block_phases);
+    }
+
+} } // golos::chain
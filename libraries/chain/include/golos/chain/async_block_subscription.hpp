@@ -0,0 +1,106 @@
+#pragma once
+
+#include <golos/protocol/block.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace golos { namespace chain {
+
+    using namespace golos::protocol;
+
+    /// Operation with the same metadata as in operation_notification
+    struct bundled_operation {
+        operation op;
+        transaction_id_type trx_id;
+        uint32_t trx_in_block = 0;
+        uint16_t op_in_trx = 0;
+        uint32_t virtual_op = 0;
+    };
+
+    /**
+     * Immutable result of applying of one block: the block and all its operations with virtual ones
+     * in the order of post_apply_operation notifications.
+     *
+     * Bundles are published for each applied block, so after a fork switch a subscriber receives
+     * blocks with the same numbers again. It can detect it by the previous block id.
+     */
+    struct applied_block_bundle {
+        signed_block block;
+        block_id_type block_id;
+        uint32_t block_num = 0;
+        std::vector<bundled_operation> operations;
+    };
+
+    using applied_block_bundle_ptr = std::shared_ptr<const applied_block_bundle>;
+
+    struct async_subscription_stats {
+        std::string name;
+        uint32_t capacity = 0;
+        uint32_t queue_size = 0;
+        uint64_t pushed = 0;
+        uint64_t processed = 0;
+        uint64_t failed = 0;
+        uint32_t last_pushed_block = 0;
+        uint32_t last_processed_block = 0;
+        uint32_t lag_blocks = 0;
+        uint32_t max_lag_blocks = 0;
+        uint64_t blocked_time = 0; ///< microseconds, which the block application waited for the full queue
+    };
+
+    /**
+     * Subscriber, which receives bundles of applied blocks in its own thread.
+     *
+     * Bundles are pushed from the block application under the write lock, and the handler runs without
+     * any database lock, so it should use only the bundle. The queue is bounded: if the subscriber lags
+     * on capacity blocks, the block application waits for it.
+     */
+    class async_block_subscription final {
+    public:
+        using handler_type = std::function<void(const applied_block_bundle&)>;
+
+        async_block_subscription(std::string name, uint32_t capacity, handler_type handler);
+
+        ~async_block_subscription();
+
+        const std::string& name() const {
+            return _name;
+        }
+
+        void start();
+
+        /// Stops the thread after processing of all queued bundles
+        void stop();
+
+        void push(applied_block_bundle_ptr bundle);
+
+        async_subscription_stats get_stats() const;
+
+    private:
+        void loop();
+
+        const std::string _name;
+        const uint32_t _capacity;
+        handler_type _handler;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _not_full;
+        std::deque<applied_block_bundle_ptr> _queue;
+        bool _stopped = true;
+        std::thread _thread;
+
+        async_subscription_stats _stats;
+    };
+
+    using async_block_subscription_ptr = std::shared_ptr<async_block_subscription>;
+
+} } // golos::chain
+
+FC_REFLECT((golos::chain::async_subscription_stats),
+    (name)(capacity)(queue_size)(pushed)(processed)(failed)
+    (last_pushed_block)(last_processed_block)(lag_blocks)(max_lag_blocks)(blocked_time))
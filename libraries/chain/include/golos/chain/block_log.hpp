@@ -33,6 +33,9 @@ namespace golos {
          *
          * The main file is the only file that needs to persist. The index file can be reconstructed during a
          * linear scan of the main file.
+         *
+         * Old blocks can be moved to the compressed_block_log archive. In this case the main file starts from
+         * the block following the head of the archive, and blocks from the archive are read transparently.
          */
 
         class block_log {
@@ -56,10 +59,17 @@ namespace golos {
             optional <signed_block> read_block_by_num(uint32_t block_num) const;
 
             /**
-             * Return offset of block in file, or block_log::npos if it does not exist.
+             * Return offset of block in file, or block_log::npos if it does not exist or it is in the compressed archive.
              */
             uint64_t get_block_pos(uint32_t block_num) const;
 
+            /**
+             * Return number of the first block in the main file, blocks before it are in the compressed archive.
+             */
+            uint32_t first_block_num() const;
+
+            void set_chunk_cache_size(uint32_t chunks);
+
             signed_block read_head() const;
 
             const optional <signed_block>& head() const;
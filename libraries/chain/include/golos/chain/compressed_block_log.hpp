@@ -0,0 +1,84 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <golos/protocol/block.hpp>
+
+namespace golos { namespace chain {
+
+    using namespace golos::protocol;
+
+    class block_log;
+
+    namespace detail { class compressed_block_log_impl; }
+
+    struct compressed_block_log_options {
+        uint32_t blocks_per_chunk = 1024;
+        uint32_t dictionary_size = 112640; ///< 0 disables training of a dictionary
+        int compression_level = 19;
+    };
+
+    /* The compressed block log is a read-only archive of the first blocks of the chain. It is written
+     * once by the compress_block_log utility, and the block log reads old blocks from it, while new blocks
+     * are appended to the usual uncompressed log.
+     *
+     * Blocks are grouped into chunks of a fixed number of blocks. Each chunk is compressed with zstd
+     * using a dictionary trained on samples of the whole log, so chunks can be decompressed independently.
+     *
+     * +--------+------------+---------+---------+-----+---------+
+     * | Header | Dictionary | Chunk 1 | Chunk 2 | ... | Chunk N |
+     * +--------+------------+---------+---------+-----+---------+
+     *
+     * The index file contains a fixed header, a table of chunk positions and sizes, and an offset of each
+     * block inside its decompressed chunk. The chunk of a block is (block_num - 1) / blocks_per_chunk,
+     * so lookup by block number is O(1).
+     *
+     * +--------+---------+-----+---------+-------------------+-----+----------------------+
+     * | Header | Chunk 1 | ... | Chunk N | Offset of Block 1 | ... | Offset of Head Block |
+     * +--------+---------+-----+---------+-------------------+-----+----------------------+
+     *
+     * Recently decompressed chunks are kept in a LRU cache, so sequential reading during replay
+     * decompresses each chunk only once.
+     */
+    class compressed_block_log final {
+    public:
+        compressed_block_log();
+
+        ~compressed_block_log();
+
+        /// @return true if the node was built with zstd
+        static bool is_supported();
+
+        static fc::path data_path(const fc::path& block_log_file);
+
+        static fc::path index_path(const fc::path& block_log_file);
+
+        /// @return true if the archive exists for the block log file
+        static bool exists(const fc::path& block_log_file);
+
+        /**
+         * Write an archive of blocks from 1 to last_block_num for the block log file.
+         * last_block_num should be a multiple of blocks_per_chunk, except the case when it is the head of the chain.
+         */
+        static void write(
+            const block_log& src, uint32_t last_block_num,
+            const fc::path& block_log_file, const compressed_block_log_options& opts);
+
+        void open(const fc::path& block_log_file);
+
+        void close();
+
+        bool is_open() const;
+
+        /// @return number of the last block in the archive, 0 if it is not open
+        uint32_t head_num() const;
+
+        optional<signed_block> read_block_by_num(uint32_t block_num) const;
+
+        /// @param chunks maximum number of decompressed chunks in the LRU cache
+        void set_cache_size(uint32_t chunks);
+
+    private:
+        std::unique_ptr<detail::compressed_block_log_impl> my;
+    };
+
+} } // golos::chain
@@ -4,7 +4,10 @@
 #include <golos/chain/node_property_object.hpp>
 #include <golos/chain/worker_objects.hpp>
 #include <golos/chain/fork_database.hpp>
+#include <golos/chain/async_block_subscription.hpp>
 #include <golos/chain/block_log.hpp>
+#include <golos/chain/read_epoch.hpp>
+#include <golos/chain/database_profiler.hpp>
 #include <golos/chain/hardfork.hpp>
 #include <golos/protocol/protocol.hpp>
 
@@ -31,6 +34,8 @@ namespace golos { namespace chain {
 
         struct comment_curation_info;
 
+        class abstract_snapshot_index;
+
         /**
          *   @class database
          *   @brief tracks the blockchain state in an extensible manner
@@ -41,7 +46,56 @@ namespace golos { namespace chain {
 
             ~database();
 
-            using chainbase::database::remove;
+            /**
+             * Wrappers of chainbase methods, which count changes of objects by the profiler
+             */
+            template<typename ObjectType, typename Constructor>
+            const ObjectType& create(Constructor&& con) {
+                if (_profiler) {
+                    _profiler->on_create();
+                }
+                return chainbase::database::create<ObjectType>(std::forward<Constructor>(con));
+            }
+
+            template<typename ObjectType, typename Modifier>
+            void modify(const ObjectType& obj, Modifier&& m) {
+                if (_profiler) {
+                    _profiler->on_modify();
+                }
+                chainbase::database::modify(obj, std::forward<Modifier>(m));
+            }
+
+            template<typename ObjectType>
+            void remove(const ObjectType& obj) {
+                if (_profiler) {
+                    _profiler->on_remove();
+                }
+                chainbase::database::remove(obj);
+            }
+
+            /**
+             * Removes objects from the begin of the Tag index while pred(obj) is true, bypassing the undo states.
+             * It is only for objects, which are created by irreversible blocks and never changed after that:
+             * undo states have no records of them, so nothing is copied on removal, and the removal can't be
+             * reverted, because irreversible blocks are never popped. Call it after the last irreversible block
+             * is committed, e.g. from applied_block.
+             * @return number of removed objects
+             */
+            template<typename MultiIndexType, typename Tag, typename Predicate>
+            uint32_t remove_irreversible(Predicate&& pred) {
+                using index_type = typename chainbase::generic_index<MultiIndexType>::index_type;
+                // chainbase removes objects only through the undo tracking, so its container is changed directly
+                auto& idx = const_cast<index_type&>(get_index<MultiIndexType>().indices()).template get<Tag>();
+                auto end = idx.begin();
+                uint32_t removed = 0;
+                for (; end != idx.end() && pred(*end); ++end, ++removed) {
+                    if (_profiler) {
+                        _profiler->on_remove();
+                    }
+                }
+                idx.erase(idx.begin(), end);
+                return removed;
+            }
 
             bool is_producing() const {
                 return _is_producing;
@@ -112,6 +166,66 @@ namespace golos { namespace chain {
             void reindex(const fc::path &data_dir, const fc::path &shared_mem_dir, uint32_t from_block_num, uint64_t shared_file_size = (
                     1024l * 1024l * 1024l * 8l));
 
+            /**
+             * @brief Enable pipelined replay
+             *
+             * Blocks are read and prepared by separate threads ahead of the apply cursor.
+             * @param ring_size maximum number of blocks between stages, 0 disables pipelined replay
+             */
+            void set_replay_pipeline_size(uint32_t ring_size);
+
+            /**
+             * @brief Set number of threads to recover public keys from signatures of incoming blocks
+             * @param threads number of threads, 0 disables the parallel recovery
+             */
+            void set_signature_recovery_threads(uint32_t threads);
+
+            /**
+             * @brief Set maximum number of decompressed chunks of the compressed block log kept in memory
+             */
+            void set_block_log_chunk_cache_size(uint32_t chunks);
+
+            /**
+             * @brief Set maximum number of bulk synced blocks kept in memory until their checkpoint is received
+             * @param blocks blocks farther than this from the next checkpoint are pushed as usual
+             */
+            void set_bulk_sync_buffer_size(uint32_t blocks);
+
+            /**
+             * @brief Enable profiling of operation evaluators and phases of block applying
+             * @param dump_interval number of blocks between writing of stats to the log during replay, 0 disables it
+             */
+            void set_operation_profiling(bool enabled, uint32_t dump_interval);
+
+            /// @return profiler, or nullptr if profiling is disabled
+            database_profiler* profiler() const {
+                return _profiler.get();
+            }
+
+            /**
+             * @brief Register an index, which is written to state snapshots
+             *
+             * Core indexes are registered by the database, plugins can add their indexes with own lists of fields.
+             * See state_snapshot.hpp.
+             */
+            void add_snapshot_index(std::shared_ptr<abstract_snapshot_index> index);
+
+            /**
+             * @brief Write a snapshot of the current state to a new subdirectory of dir
+             *
+             * The state should be irreversible, and nothing should modify the database until the end,
+             * e.g. it is called from the handler of applied block. Indexes are serialized in parallel threads,
+             * chunks which didn't change since the previous snapshot in dir are hard-linked from it.
+             * @return directory of the snapshot
+             */
+            fc::path write_snapshot(const fc::path& dir, uint32_t threads);
+
+            /**
+             * @brief Load state from the snapshot in open() instead of the genesis, if the shared memory is empty
+             * @param threads number of threads to read chunks and to verify their checksums
+             */
+            void set_snapshot_to_load(const fc::path& dir, uint32_t threads);
+
             void set_min_free_shared_memory_size(size_t);
             void set_inc_shared_memory_size(size_t);
             void set_block_num_check_free_size(uint32_t);
@@ -276,8 +390,34 @@ namespace golos { namespace chain {
 
             uint32_t validate_block(const signed_block &b, uint32_t skip = skip_nothing);
 
+            /**
+             *  Recovers public keys from the witness signature and from all transaction signatures of the block
+             *  on the worker pool. It doesn't take any lock, so it should be called before push_block().
+             *  The keys are used on applying of the block, and the authority check only compares them with state.
+             */
+            void recover_signature_keys(const signed_block &b, uint32_t skip = skip_nothing);
+
             bool push_block(const signed_block &b, uint32_t skip = skip_nothing);
 
+            /**
+             *  Writes a block at or below the last checkpoint straight to the block log without applying.
+             *  Blocks are kept in memory until the block of the next checkpoint is received, then they are written,
+             *  because the id of the checkpoint covers headers of all linked blocks, and headers cover transactions
+             *  by merkle roots. The state is built later by apply_bulk_synced_blocks(). It should be called from one thread.
+             *
+             *  @return false if the block isn't covered by checkpoints or doesn't continue the block log,
+             *  so it should be pushed as usual; true if it is buffered, written or is already in the block log
+             *  @throw if the block doesn't link to previous ones, or doesn't match the checkpoint or the block log
+             */
+            bool bulk_sync_block(const signed_block &b);
+
+            /**
+             *  Applies blocks of the block log above the head block, which were written by bulk_sync_block().
+             *  @param max_blocks maximum number of blocks applied under one write lock
+             *  @return number of applied blocks
+             */
+            uint32_t apply_bulk_synced_blocks(uint32_t max_blocks);
+
             void enable_plugins_on_push_transaction(bool);
 
             void push_transaction(const signed_transaction &trx, uint32_t skip = skip_nothing);
@@ -345,6 +485,19 @@ namespace golos { namespace chain {
              */
             fc::signal<void(const signed_block &)> applied_block;
 
+            /**
+             * Subscribe to bundles of applied blocks, which are processed by the own thread of the subscriber
+             * without any database lock. It is intended for plugins, which don't read the chain state,
+             * e.g. to export operations to external storages. Subscribers should unsubscribe on shutdown.
+             * @param capacity maximum number of queued blocks, the block application waits when the queue is full
+             */
+            async_block_subscription_ptr subscribe_async(
+                std::string name, uint32_t capacity, async_block_subscription::handler_type handler);
+
+            void unsubscribe_async(const async_block_subscription_ptr& subscription);
+
+            std::vector<async_subscription_stats> get_async_subscription_stats() const;
+
             /**
              * This signal is emitted any time a new transaction is added to the pending
              * block state.
@@ -557,6 +710,10 @@ namespace golos { namespace chain {
 
             void init_genesis(uint64_t initial_supply = STEEMIT_INIT_SUPPLY);
 
+            void initialize_snapshot_indexes();
+
+            void load_snapshot();
+
             /**
              *  This method validates transactions without adding it to the pending state.
              *  @throw if an error occurs
@@ -615,6 +772,62 @@ namespace golos { namespace chain {
 
             const block_log &get_block_log() const;
 
+            /**
+             * @brief Enable epoch ordering of readers and block writers
+             *
+             * A pushed or generated block retires the current epoch: new readers wait for it,
+             * and it waits only for readers from the retired epoch.
+             * Readers wait for the block not longer than read_wait_micro() with all retries,
+             * so it should be called after they are set.
+             */
+            void set_read_epoch_mode(bool value);
+
+            /**
+             * @brief Enable metrics of lock wait time per API method, see api_method_scope
+             */
+            void set_lock_metrics(bool value);
+
+            database_lock_stats get_lock_stats() const;
+
+            /**
+             * Locks hide the chainbase ones to pass the epoch gate and to collect wait time.
+             * Locks taken through a chainbase::database reference skip the gate and the metrics,
+             * they work as plain chainbase locks: such a writer doesn't retire the epoch,
+             * and such a reader doesn't wait for writers of the gate. Code of golos calls locks of
+             * golos::chain::database only, so keep new callers on this interface.
+             */
+            template <typename Lambda>
+            auto with_weak_read_lock(Lambda&& callback) -> decltype(callback()) {
+                auto start = fc::time_point::now();
+                read_epoch_gate::reader reader(_read_epoch);
+                return chainbase::database::with_weak_read_lock([&]() {
+                    _lock_metrics.on_read_lock(fc::time_point::now() - start);
+                    return callback();
+                });
+            }
+
+            template <typename Lambda>
+            auto with_strong_read_lock(Lambda&& callback) -> decltype(callback()) {
+                auto start = fc::time_point::now();
+                read_epoch_gate::reader reader(_read_epoch);
+                return chainbase::database::with_strong_read_lock([&]() {
+                    _lock_metrics.on_read_lock(fc::time_point::now() - start);
+                    return callback();
+                });
+            }
+
+            template <typename Lambda>
+            auto with_weak_write_lock(Lambda&& callback) -> decltype(callback()) {
+                read_epoch_gate::holder holder;
+                return chainbase::database::with_weak_write_lock(std::forward<Lambda>(callback));
+            }
+
+            template <typename Lambda>
+            auto with_strong_write_lock(Lambda&& callback) -> decltype(callback()) {
+                read_epoch_gate::holder holder;
+                return chainbase::database::with_strong_write_lock(std::forward<Lambda>(callback));
+            }
+
         protected:
             //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
             //void pop_undo() { object_database::pop_undo(); }
@@ -623,6 +836,19 @@ namespace golos { namespace chain {
         private:
             optional<chainbase::database::session> _pending_tx_session;
 
+            /// Lock for a pushed or a generated block, it retires the current read epoch
+            template <typename Lambda>
+            auto with_block_write_lock(Lambda&& callback) -> decltype(callback()) {
+                auto start = fc::time_point::now();
+                read_epoch_gate::writer writer(_read_epoch);
+                return chainbase::database::with_strong_write_lock([&]() {
+                    if (writer.is_top()) {
+                        _lock_metrics.on_block_write_lock(fc::time_point::now() - start);
+                    }
+                    return callback();
+                });
+            }
+
             void apply_block(const signed_block &next_block, uint32_t skip = skip_nothing);
 
             void apply_transaction(const signed_transaction &trx, uint32_t skip = skip_nothing);
@@ -706,6 +932,10 @@ namespace golos { namespace chain {
 
             flat_map<uint32_t, block_id_type> _checkpoints;
 
+            std::vector<signed_block> _bulk_sync_blocks; ///< blocks waiting for the block of the next checkpoint
+            block_id_type _bulk_sync_head_id;
+            uint32_t _bulk_sync_buffer_size = 10000;
+
             uint32_t _flush_blocks = 0;
             uint32_t _next_flush_block = 0;
 
@@ -716,6 +946,14 @@ namespace golos { namespace chain {
 
             uint32_t _block_num_check_free_memory = 1000;
 
+            uint32_t _replay_pipeline_size = 0;
+
+            std::unique_ptr<database_profiler> _profiler;
+            uint32_t _profile_dump_interval = 0;
+
+            read_epoch_gate _read_epoch;
+            lock_metrics _lock_metrics;
+
             uint32_t _clear_votes_block = 0;
             bool _skip_virtual_ops = false;
             bool _enable_plugins_on_push_transaction = true;
@@ -729,6 +967,10 @@ namespace golos { namespace chain {
 
             bool _clear_old_worker_votes = false;
 
+            std::map<uint16_t, std::shared_ptr<abstract_snapshot_index>> _snapshot_indexes;
+            fc::path _snapshot_to_load;
+            uint32_t _snapshot_threads = 1;
+
             flat_map<std::string, std::shared_ptr<custom_operation_interpreter>> _custom_operation_interpreters;
             std::string _json_schema;
         };
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace golos { namespace chain {
+
+    /**
+     * Counters of one operation type or one phase of block applying.
+     * Time and memory are exclusive: they don't include nested operations, e.g. virtual operations of a phase.
+     */
+    struct profile_counters {
+        uint64_t calls = 0;
+        uint64_t time = 0;     ///< wall time in microseconds
+        uint64_t creates = 0;  ///< number of created objects
+        uint64_t modifies = 0; ///< number of modified objects
+        uint64_t removes = 0;  ///< number of removed objects
+        int64_t memory = 0;    ///< bytes allocated in the shared memory, it is negative if more memory is freed
+
+        void add(const profile_counters& other);
+    };
+
+    struct profile_stats {
+        uint32_t first_block = 0;
+        uint32_t last_block = 0;
+        uint64_t blocks = 0;
+        profile_counters total;
+        std::map<std::string, profile_counters> operations;
+        std::map<std::string, profile_counters> block_phases;
+    };
+
+    /**
+     * Profiler of operation evaluators and phases of block applying.
+     *
+     * Scopes of operations and phases are nested, each scope accumulates time and changes of objects
+     * until its nested scope is started. The profiler is used only by the thread, which holds the write lock
+     * of the database, so its stats can be read under the read lock.
+     */
+    class database_profiler final {
+    public:
+        explicit database_profiler(const chainbase::database& db);
+
+        void begin_operation(int which);
+
+        void begin_phase(const char* name);
+
+        void end();
+
+        void on_create() {
+            if (_current) {
+                ++_current->creates;
+            }
+        }
+
+        void on_modify() {
+            if (_current) {
+                ++_current->modifies;
+            }
+        }
+
+        void on_remove() {
+            if (_current) {
+                ++_current->removes;
+            }
+        }
+
+        void on_block(uint32_t block_num);
+
+        profile_stats get_stats() const;
+
+        void reset();
+
+        /// Writes the most expensive operations and phases to the log
+        void log_stats(std::size_t limit = 10) const;
+
+        /// Scope of an operation, it does nothing if the profiler is disabled
+        class operation_scope final {
+        public:
+            operation_scope(database_profiler* profiler, int which): _profiler(profiler) {
+                if (_profiler) {
+                    _profiler->begin_operation(which);
+                }
+            }
+
+            ~operation_scope() {
+                if (_profiler) {
+                    _profiler->end();
+                }
+            }
+
+        private:
+            database_profiler* _profiler;
+        };
+
+        /// Sequence of phases, each call of next() ends the previous phase
+        class phase_sequence final {
+        public:
+            explicit phase_sequence(database_profiler* profiler): _profiler(profiler) {
+            }
+
+            ~phase_sequence() {
+                stop();
+            }
+
+            void next(const char* name) {
+                if (_profiler) {
+                    stop();
+                    _profiler->begin_phase(name);
+                    _started = true;
+                }
+            }
+
+            void stop() {
+                if (_started) {
+                    _profiler->end();
+                    _started = false;
+                }
+            }
+
+        private:
+            database_profiler* _profiler;
+            bool _started = false;
+        };
+
+    private:
+        struct frame {
+            profile_counters* counters;
+            fc::time_point start;
+            uint64_t free_memory;
+        };
+
+        void push(profile_counters& counters);
+
+        void suspend(frame& f, const fc::time_point& now, uint64_t free_memory);
+
+        const chainbase::database& _db;
+        std::vector<frame> _frames;
+        profile_counters* _current = nullptr;
+
+        uint32_t _first_block = 0;
+        uint32_t _last_block = 0;
+        uint64_t _blocks = 0;
+        std::vector<profile_counters> _operations;
+        std::map<std::string, profile_counters, std::less<>> _block_phases;
+    };
+
+} } // golos::chain
+
+FC_REFLECT((golos::chain::profile_counters), (calls)(time)(creates)(modifies)(removes)(memory))
+
+FC_REFLECT((golos::chain::profile_stats), (first_block)(last_block)(blocks)(total)(operations)(block_phases))
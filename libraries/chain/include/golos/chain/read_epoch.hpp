@@ -0,0 +1,158 @@
+#pragma once
+
+#include <fc/time.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace golos { namespace chain {
+
+    /// Time in microseconds which was spent on waiting for a database lock
+    struct lock_wait_stats {
+        uint64_t calls = 0;
+        uint64_t wait_time = 0;
+        uint64_t max_wait_time = 0;
+    };
+
+    struct database_lock_stats {
+        uint64_t epoch = 0;
+        lock_wait_stats block_write;
+        std::map<std::string, lock_wait_stats> read;
+    };
+
+    /**
+     * Name of the API method, which is executed by the current thread.
+     * It is used to split metrics of read locks by API methods.
+     * The name is built only when lock metrics are enabled, otherwise the scope costs nothing.
+     */
+    class api_method_scope final {
+    public:
+        api_method_scope(const std::string& plugin, const std::string& method);
+
+        explicit api_method_scope(std::string name);
+
+        ~api_method_scope();
+
+        /// @return name of the current API method, or empty string for internal reads
+        static const std::string& current();
+
+        /// Enabled by lock_metrics, while they collect the wait time
+        static void set_enabled(bool value);
+
+    private:
+        std::string _name;
+        const std::string* _prev;
+        bool _entered = false;
+    };
+
+    /**
+     * Gate which orders readers and block writers by epochs.
+     *
+     * Each applied block finishes an epoch. When a block writer comes, the current epoch is retired: new readers
+     * wait for the next epoch, and the writer waits only for readers, which entered before it. So a stream of API
+     * requests can't starve the block application through retries of the read lock.
+     *
+     * A thread, which already holds any database lock, passes the gate, because the writer may wait for it.
+     * A reader waits for writers no longer than the wait timeout, then it goes to the chainbase lock,
+     * which has its own timeout and retries.
+     */
+    class read_epoch_gate final {
+    public:
+        void set_enabled(bool value) {
+            _enabled = value;
+        }
+
+        void set_wait_timeout(const fc::microseconds& value) {
+            _wait_timeout = value.count();
+        }
+
+        bool is_enabled() const {
+            return _enabled;
+        }
+
+        uint64_t epoch() const {
+            return _epoch;
+        }
+
+        class reader final {
+        public:
+            explicit reader(read_epoch_gate& gate);
+
+            ~reader();
+
+        private:
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+        };
+
+        class writer final {
+        public:
+            explicit writer(read_epoch_gate& gate);
+
+            ~writer();
+
+            /// @return false for a block writer nested into another one, e.g. push of a generated block
+            bool is_top() const {
+                return _top;
+            }
+
+        private:
+            writer(const writer&) = delete;
+            writer& operator=(const writer&) = delete;
+
+            read_epoch_gate& _gate;
+            bool _top;
+            bool _entered = false;
+        };
+
+        /// Marks the current thread as a lock holder, so nested readers pass the gate
+        class holder final {
+        public:
+            holder();
+
+            ~holder();
+        };
+
+    private:
+        std::atomic<bool> _enabled{false};
+        std::atomic<uint64_t> _epoch{0};
+        std::atomic<int64_t> _wait_timeout{0}; ///< microseconds, 0 means no limit
+
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        uint32_t _writers = 0;
+    };
+
+    class lock_metrics final {
+    public:
+        void set_enabled(bool value) {
+            _enabled = value;
+            api_method_scope::set_enabled(value);
+        }
+
+        bool is_enabled() const {
+            return _enabled;
+        }
+
+        void on_read_lock(const fc::microseconds& wait);
+
+        void on_block_write_lock(const fc::microseconds& wait);
+
+        database_lock_stats get_stats() const;
+
+    private:
+        static void add(lock_wait_stats& stats, const fc::microseconds& wait);
+
+        std::atomic<bool> _enabled{false};
+        mutable std::mutex _mutex;
+        database_lock_stats _stats;
+    };
+
+} } // golos::chain
+
+FC_REFLECT((golos::chain::lock_wait_stats), (calls)(wait_time)(max_wait_time))
+FC_REFLECT((golos::chain::database_lock_stats), (epoch)(block_write)(read))
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <golos/chain/block_log.hpp>
+
+#include <fc/time.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace golos { namespace chain {
+
+    /**
+     * Block with all values, which depend only on block data, calculated before
+     * the block reaches the apply thread.
+     */
+    struct prepared_block {
+        signed_block block;
+        block_id_type block_id;
+        uint32_t block_size = 0;
+        std::vector<transaction_id_type> trx_ids;
+        std::vector<uint32_t> trx_sizes;
+    };
+
+    /**
+     * Counters of one replay stage. All times are in microseconds.
+     */
+    struct replay_stage_stats {
+        std::atomic<uint64_t> blocks{0};
+        std::atomic<uint64_t> busy_time{0};    ///< time spent on own work
+        std::atomic<uint64_t> blocked_time{0}; ///< time spent waiting for input or free space in output
+    };
+
+    namespace detail {
+
+        /**
+         * Bounded FIFO between two replay stages.
+         */
+        template<typename T>
+        class replay_ring final {
+        public:
+            explicit replay_ring(std::size_t capacity)
+                    : _capacity(std::max<std::size_t>(capacity, 1)) {
+            }
+
+            /// @return false if ring was closed
+            bool push(T&& item, std::atomic<uint64_t>& blocked_time) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_items.size() >= _capacity && !_closed) {
+                    auto start = fc::time_point::now();
+                    _not_full.wait(lock, [&] { return _items.size() < _capacity || _closed; });
+                    blocked_time += (fc::time_point::now() - start).count();
+                }
+                if (_closed) {
+                    return false;
+                }
+                _items.push_back(std::move(item));
+                _not_empty.notify_one();
+                return true;
+            }
+
+            /// @return false if ring was closed and all items were consumed
+            bool pop(T& item, std::atomic<uint64_t>& blocked_time) {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_items.empty() && !_closed) {
+                    auto start = fc::time_point::now();
+                    _not_empty.wait(lock, [&] { return !_items.empty() || _closed; });
+                    blocked_time += (fc::time_point::now() - start).count();
+                }
+                if (_items.empty()) {
+                    return false;
+                }
+                item = std::move(_items.front());
+                _items.pop_front();
+                _not_full.notify_one();
+                return true;
+            }
+
+            void close() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _closed = true;
+                _not_empty.notify_all();
+                _not_full.notify_all();
+            }
+
+        private:
+            const std::size_t _capacity;
+            std::deque<T> _items;
+            bool _closed = false;
+            std::mutex _mutex;
+            std::condition_variable _not_empty;
+            std::condition_variable _not_full;
+        };
+
+    } // detail
+
+    /**
+     * Pipelined block source for database::reindex().
+     *
+     * The read stage unpacks blocks from the mmapped block log, the prepare stage calculates
+     * block and transaction ids and packed sizes, so the apply thread only mutates state.
+     * Both stages work ahead of the apply cursor and are limited by the ring size.
+     */
+    class replay_pipeline final {
+    public:
+        replay_pipeline(const block_log& log, uint32_t from_block_num, uint32_t last_block_num, uint32_t ring_size);
+
+        ~replay_pipeline();
+
+        void start();
+
+        void stop();
+
+        /**
+         * Get next prepared block in order of block numbers.
+         * @return false if all blocks were consumed
+         * @throw exception from read or prepare stage
+         */
+        bool next(prepared_block& item);
+
+        const replay_stage_stats& read_stats() const {
+            return _read_stats;
+        }
+
+        const replay_stage_stats& prepare_stats() const {
+            return _prepare_stats;
+        }
+
+        const replay_stage_stats& apply_stats() const {
+            return _apply_stats;
+        }
+
+        /// should be called by apply thread after it finishes the block got from next()
+        void on_applied(const fc::microseconds& apply_time);
+
+        void print_stats(std::ostream& out) const;
+
+    private:
+        void read_loop();
+
+        void prepare_loop();
+
+        void set_exception(std::exception_ptr e);
+
+        const block_log& _block_log;
+        const uint32_t _from_block_num;
+        const uint32_t _last_block_num;
+
+        detail::replay_ring<signed_block> _read_ring;
+        detail::replay_ring<prepared_block> _prepare_ring;
+
+        std::thread _read_thread;
+        std::thread _prepare_thread;
+
+        std::mutex _exception_mutex;
+        std::exception_ptr _exception;
+
+        fc::time_point _start_time;
+
+        replay_stage_stats _read_stats;
+        replay_stage_stats _prepare_stats;
+        replay_stage_stats _apply_stats;
+    };
+
+} } // golos::chain
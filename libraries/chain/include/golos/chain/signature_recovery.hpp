@@ -0,0 +1,62 @@
+#pragma once
+
+#include <golos/protocol/block.hpp>
+
+#include <boost/asio/io_service.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace golos { namespace chain {
+
+    using namespace golos::protocol;
+
+    /**
+     * Public keys recovered from signatures of a block and its transactions.
+     *
+     * Keys are stored only for blocks, which transactions match the merkle root of the header,
+     * so they can be safely found by the block id. An empty optional means that the recovery failed,
+     * and the signatures should be checked in the usual way to get a proper error.
+     */
+    struct recovered_block_keys {
+        block_id_type block_id;
+        optional<public_key_type> signee;
+        std::vector<optional<flat_set<public_key_type>>> trx_keys;
+    };
+
+    using recovered_block_keys_ptr = std::shared_ptr<const recovered_block_keys>;
+
+    /**
+     * Pool of threads, which recovers public keys from block signatures in parallel.
+     * It doesn't use the database, so it can work without any lock before a block is pushed.
+     */
+    class signature_recovery_pool final {
+    public:
+        signature_recovery_pool();
+
+        ~signature_recovery_pool();
+
+        /// @param threads number of worker threads, 0 disables the pool
+        void start(uint32_t threads);
+
+        void stop();
+
+        bool is_started() const {
+            return !_threads.empty();
+        }
+
+        /**
+         * Recover keys of the witness signature and of all transaction signatures.
+         * Blocks the calling thread until all keys are recovered.
+         * @return nullptr if transactions don't match the merkle root of the block
+         */
+        recovered_block_keys_ptr recover(const signed_block& block, const chain_id_type& chain_id, bool with_transactions);
+
+    private:
+        boost::asio::io_service _service;
+        std::unique_ptr<boost::asio::io_service::work> _work;
+        std::vector<std::thread> _threads;
+    };
+
+} } // golos::chain
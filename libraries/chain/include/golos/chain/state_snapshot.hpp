@@ -0,0 +1,486 @@
+#pragma once
+
+#include <golos/chain/database.hpp>
+#include <golos/chain/shared_authority.hpp>
+#include <golos/chain/steem_object_types.hpp>
+#include <golos/protocol/exceptions.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/interprocess/containers/deque.hpp>
+#include <boost/interprocess/containers/flat_map.hpp>
+#include <boost/interprocess/containers/flat_set.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/preprocessor/seq/for_each.hpp>
+
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace golos { namespace chain {
+
+    namespace bip = boost::interprocess;
+
+    /// Part of an index in a separate file
+    struct state_snapshot_chunk {
+        std::string file;
+        uint32_t records = 0;
+        uint64_t size = 0;
+        fc::sha256 checksum;
+    };
+
+    struct state_snapshot_index {
+        std::string name;
+        uint16_t type_id = 0;
+        uint64_t records = 0;
+        std::vector<state_snapshot_chunk> chunks;
+    };
+
+    struct state_snapshot_manifest {
+        uint32_t version = 0;
+        chain_id_type chain_id;
+        uint32_t block_num = 0;
+        block_id_type block_id;
+        fc::time_point_sec time;
+        std::vector<state_snapshot_index> indexes;
+    };
+
+    /**
+     * Index, which is written to state snapshots.
+     *
+     * The snapshot doesn't use FC_REFLECT of objects, because reflections are made for the API and skip
+     * some fields of the state. Each object has its own full list of fields, see GOLOS_SNAPSHOT_OBJECT.
+     */
+    class abstract_snapshot_index {
+    public:
+        using chunk_handler = std::function<void(const std::vector<char>& data, uint32_t records)>;
+
+        abstract_snapshot_index(std::string name, uint16_t type_id, bool required)
+            : _name(std::move(name)), _type_id(type_id), _required(required) {
+        }
+
+        virtual ~abstract_snapshot_index() = default;
+
+        const std::string& name() const {
+            return _name;
+        }
+
+        uint16_t type_id() const {
+            return _type_id;
+        }
+
+        /// Snapshot can't be loaded without required index, other indexes are left empty if they are absent
+        bool required() const {
+            return _required;
+        }
+
+        virtual bool empty(const database& db) const = 0;
+
+        /**
+         * Packs objects in the order of ids and passes them to the handler by chunks
+         * @return number of packed objects
+         */
+        virtual uint64_t write_chunks(const database& db, uint32_t chunk_records, const chunk_handler& handler) const = 0;
+
+        /**
+         * Creates objects from the chunk.
+         * Chunks should be loaded in the order of ids.
+         * @param last_id id of the last loaded object of the snapshot, -1 before the first chunk
+         * @return number of created objects
+         */
+        virtual uint32_t load_chunk(database& db, const std::vector<char>& data, int64_t& last_id) const = 0;
+
+    private:
+        const std::string _name;
+        const uint16_t _type_id;
+        const bool _required;
+    };
+
+    using snapshot_index_ptr = std::shared_ptr<abstract_snapshot_index>;
+
+    /// Full list of fields of the object for snapshots, specialized by GOLOS_SNAPSHOT_OBJECT
+    template<typename T>
+    struct snapshot_object {
+        static constexpr bool is_defined = false;
+    };
+
+    namespace snapshot_detail {
+
+        template<typename S, typename T>
+        void pack(S& s, const T& v);
+
+        template<typename S, typename T>
+        void unpack(S& s, T& v);
+
+        template<typename S>
+        void pack(S& s, const shared_string& v);
+
+        template<typename S>
+        void unpack(S& s, shared_string& v);
+
+        template<typename S>
+        void pack(S& s, const shared_authority& v);
+
+        template<typename S>
+        void unpack(S& s, shared_authority& v);
+
+        template<typename S, typename T, typename A>
+        void pack(S& s, const bip::vector<T, A>& v);
+
+        template<typename S, typename T, typename A>
+        void unpack(S& s, bip::vector<T, A>& v);
+
+        template<typename S, typename T, typename A>
+        void pack(S& s, const bip::deque<T, A>& v);
+
+        template<typename S, typename T, typename A>
+        void unpack(S& s, bip::deque<T, A>& v);
+
+        template<typename S, typename T, typename C, typename A>
+        void pack(S& s, const bip::flat_set<T, C, A>& v);
+
+        template<typename S, typename T, typename C, typename A>
+        void unpack(S& s, bip::flat_set<T, C, A>& v);
+
+        template<typename S, typename K, typename V, typename C, typename A>
+        void pack(S& s, const bip::flat_map<K, V, C, A>& v);
+
+        template<typename S, typename K, typename V, typename C, typename A>
+        void unpack(S& s, bip::flat_map<K, V, C, A>& v);
+
+        enum class value_kind {
+            raw,
+            enumeration,
+            object,
+        };
+
+        template<typename T>
+        using kind_of = std::integral_constant<value_kind,
+            std::is_enum<T>::value ? value_kind::enumeration :
+            snapshot_object<T>::is_defined ? value_kind::object : value_kind::raw>;
+
+        template<typename S, typename T>
+        void pack_value(S& s, const T& v, std::integral_constant<value_kind, value_kind::raw>) {
+            fc::raw::pack(s, v);
+        }
+
+        template<typename S, typename T>
+        void unpack_value(S& s, T& v, std::integral_constant<value_kind, value_kind::raw>) {
+            fc::raw::unpack(s, v);
+        }
+
+        // not all enums are reflected, so they are packed as their underlying types
+        template<typename S, typename T>
+        void pack_value(S& s, const T& v, std::integral_constant<value_kind, value_kind::enumeration>) {
+            fc::raw::pack(s, static_cast<typename std::underlying_type<T>::type>(v));
+        }
+
+        template<typename S, typename T>
+        void unpack_value(S& s, T& v, std::integral_constant<value_kind, value_kind::enumeration>) {
+            typename std::underlying_type<T>::type value;
+            fc::raw::unpack(s, value);
+            v = static_cast<T>(value);
+        }
+
+        template<typename S, typename T>
+        void pack_value(S& s, const T& v, std::integral_constant<value_kind, value_kind::object>) {
+            snapshot_object<T>::pack(s, v);
+        }
+
+        template<typename S, typename T>
+        void unpack_value(S& s, T& v, std::integral_constant<value_kind, value_kind::object>) {
+            snapshot_object<T>::unpack(s, v);
+        }
+
+        template<typename S, typename T>
+        void pack(S& s, const T& v) {
+            pack_value(s, v, kind_of<T>());
+        }
+
+        template<typename S, typename T>
+        void unpack(S& s, T& v) {
+            unpack_value(s, v, kind_of<T>());
+        }
+
+        template<typename S>
+        void pack(S& s, const shared_string& v) {
+            fc::raw::pack(s, to_string(v));
+        }
+
+        template<typename S>
+        void unpack(S& s, shared_string& v) {
+            std::string value;
+            fc::raw::unpack(s, value);
+            from_string(v, value);
+        }
+
+        template<typename S>
+        void pack(S& s, const shared_authority& v) {
+            fc::raw::pack(s, authority(v));
+        }
+
+        template<typename S>
+        void unpack(S& s, shared_authority& v) {
+            authority value;
+            fc::raw::unpack(s, value);
+            v = value;
+        }
+
+        template<typename S, typename Container>
+        void pack_sequence(S& s, const Container& v) {
+            fc::raw::pack(s, fc::unsigned_int(v.size()));
+            for (const auto& item: v) {
+                pack(s, item);
+            }
+        }
+
+        template<typename S, typename T, typename A>
+        void pack(S& s, const bip::vector<T, A>& v) {
+            pack_sequence(s, v);
+        }
+
+        template<typename S, typename T, typename A>
+        void unpack(S& s, bip::vector<T, A>& v) {
+            fc::unsigned_int size;
+            fc::raw::unpack(s, size);
+            v.clear();
+            v.reserve(size.value);
+            for (uint32_t i = 0; i < size.value; ++i) {
+                T item;
+                unpack(s, item);
+                v.push_back(std::move(item));
+            }
+        }
+
+        template<typename S, typename T, typename A>
+        void pack(S& s, const bip::deque<T, A>& v) {
+            pack_sequence(s, v);
+        }
+
+        template<typename S, typename T, typename A>
+        void unpack(S& s, bip::deque<T, A>& v) {
+            fc::unsigned_int size;
+            fc::raw::unpack(s, size);
+            v.clear();
+            for (uint32_t i = 0; i < size.value; ++i) {
+                T item;
+                unpack(s, item);
+                v.push_back(std::move(item));
+            }
+        }
+
+        template<typename S, typename T, typename C, typename A>
+        void pack(S& s, const bip::flat_set<T, C, A>& v) {
+            pack_sequence(s, v);
+        }
+
+        template<typename S, typename T, typename C, typename A>
+        void unpack(S& s, bip::flat_set<T, C, A>& v) {
+            fc::unsigned_int size;
+            fc::raw::unpack(s, size);
+            v.clear();
+            v.reserve(size.value);
+            for (uint32_t i = 0; i < size.value; ++i) {
+                T item;
+                unpack(s, item);
+                v.insert(std::move(item));
+            }
+        }
+
+        template<typename S, typename K, typename V, typename C, typename A>
+        void pack(S& s, const bip::flat_map<K, V, C, A>& v) {
+            fc::raw::pack(s, fc::unsigned_int(v.size()));
+            for (const auto& item: v) {
+                pack(s, item.first);
+                pack(s, item.second);
+            }
+        }
+
+        template<typename S, typename K, typename V, typename C, typename A>
+        void unpack(S& s, bip::flat_map<K, V, C, A>& v) {
+            fc::unsigned_int size;
+            fc::raw::unpack(s, size);
+            v.clear();
+            v.reserve(size.value);
+            for (uint32_t i = 0; i < size.value; ++i) {
+                K key;
+                V value;
+                unpack(s, key);
+                unpack(s, value);
+                v.emplace(std::move(key), std::move(value));
+            }
+        }
+
+    } // snapshot_detail
+
+    /**
+     * Index of objects with the full list of fields.
+     *
+     * Ids are kept only for objects, which are referenced by ids from other objects (accounts, comments, ...).
+     * Chainbase doesn't allow to set the next id, so ids of removed objects are skipped by creating and removing
+     * of empty objects. Other indexes (transactions, votes, orders, ...) are loaded with new ids in the same order,
+     * so their removed objects cost nothing.
+     */
+    template<typename MultiIndexType>
+    class snapshot_index final: public abstract_snapshot_index {
+    public:
+        using object_type = typename MultiIndexType::value_type;
+
+        snapshot_index(std::string name, bool required, bool keep_ids)
+            : abstract_snapshot_index(std::move(name), object_type::type_id, required),
+              _keep_ids(keep_ids) {
+        }
+
+        bool empty(const database& db) const override {
+            return db.get_index<MultiIndexType>().indices().empty();
+        }
+
+        uint64_t write_chunks(const database& db, uint32_t chunk_records, const chunk_handler& handler) const override {
+            std::vector<char> data;
+            uint32_t records = 0;
+            uint64_t total = 0;
+
+            // the first index of chainbase containers is ordered by id
+            for (const auto& o: db.get_index<MultiIndexType>().indices()) {
+                fc::datastream<size_t> ss;
+                pack_record(ss, o);
+
+                auto pos = data.size();
+                data.resize(pos + ss.tellp());
+                fc::datastream<char*> ds(data.data() + pos, ss.tellp());
+                pack_record(ds, o);
+
+                ++total;
+                if (++records == chunk_records) {
+                    handler(data, records);
+                    data.clear();
+                    records = 0;
+                }
+            }
+            if (records) {
+                handler(data, records);
+            }
+            return total;
+        }
+
+        uint32_t load_chunk(database& db, const std::vector<char>& data, int64_t& last_id) const override {
+            fc::datastream<const char*> ds(data.data(), data.size());
+            uint32_t records = 0;
+
+            while (ds.remaining()) {
+                int64_t id = 0;
+                fc::raw::unpack(ds, id);
+
+                const auto offset = data.size() - ds.remaining();
+                size_t record_size = 0;
+                auto constructor = [&](object_type& o) {
+                    fc::datastream<const char*> rs(data.data() + offset, data.size() - offset);
+                    snapshot_object<object_type>::unpack(rs, o);
+                    record_size = rs.tellp();
+                };
+
+                GOLOS_CHECK_DATABASE(id > last_id,
+                    golos::database_corrupted::unknown_file_format,
+                    "Objects of ${index} are not ordered by id",
+                    ("index", name())("id", id)("last", last_id));
+                last_id = id;
+
+                if (_keep_ids) {
+                    skip_ids(db, id);
+                }
+                db.create<object_type>(constructor);
+
+                ds.skip(record_size);
+                ++records;
+            }
+            return records;
+        }
+
+    private:
+        template<typename S>
+        static void pack_record(S& s, const object_type& o) {
+            fc::raw::pack(s, o.id._id);
+            snapshot_object<object_type>::pack(s, o);
+        }
+
+        // the next created object gets the id
+        void skip_ids(database& db, int64_t id) const {
+            const auto& idx = db.get_index<MultiIndexType>().indices();
+            int64_t next_id = idx.empty() ? 0 : idx.rbegin()->id._id + 1;
+            for (; next_id < id; ++next_id) {
+                db.remove(db.create<object_type>([](object_type&) {}));
+            }
+        }
+
+        const bool _keep_ids;
+    };
+
+    /**
+     * Index of a plugin, which isn't written to snapshots and starts empty after loading,
+     * e.g. it keeps only history of operations.
+     */
+    template<typename MultiIndexType>
+    class empty_snapshot_index final: public abstract_snapshot_index {
+    public:
+        using object_type = typename MultiIndexType::value_type;
+
+        explicit empty_snapshot_index(std::string name)
+            : abstract_snapshot_index(std::move(name), object_type::type_id, false) {
+        }
+
+        bool empty(const database& db) const override {
+            return db.get_index<MultiIndexType>().indices().empty();
+        }
+
+        uint64_t write_chunks(const database&, uint32_t, const chunk_handler&) const override {
+            return 0;
+        }
+
+        uint32_t load_chunk(database&, const std::vector<char>&, int64_t&) const override {
+            return 0;
+        }
+    };
+
+    /// Plugin index with the full list of fields declared by GOLOS_SNAPSHOT_OBJECT, the snapshot should contain it
+    template<typename MultiIndexType>
+    void add_plugin_snapshot_index(database& db, const char* name, bool keep_ids = false) {
+        db.add_snapshot_index(std::make_shared<snapshot_index<MultiIndexType>>(name, true, keep_ids));
+    }
+
+    /// Plugin index, which starts empty after loading of a snapshot
+    template<typename MultiIndexType>
+    void add_plugin_empty_snapshot_index(database& db, const char* name) {
+        db.add_snapshot_index(std::make_shared<empty_snapshot_index<MultiIndexType>>(name));
+    }
+
+} } // golos::chain
+
+#define GOLOS_SNAPSHOT_PACK_FIELD(r, obj, field) golos::chain::snapshot_detail::pack(s, obj.field);
+#define GOLOS_SNAPSHOT_UNPACK_FIELD(r, obj, field) golos::chain::snapshot_detail::unpack(s, obj.field);
+
+/**
+ * Declares the full list of fields of an object, which are written to snapshots.
+ * The id is written separately, so it shouldn't be in the list.
+ */
+#define GOLOS_SNAPSHOT_OBJECT(TYPE, FIELDS) \
+    namespace golos { namespace chain { \
+        template<> \
+        struct snapshot_object<TYPE> { \
+            static constexpr bool is_defined = true; \
+            template<typename S> \
+            static void pack(S& s, const TYPE& o) { \
+                BOOST_PP_SEQ_FOR_EACH(GOLOS_SNAPSHOT_PACK_FIELD, o, FIELDS) \
+            } \
+            template<typename S> \
+            static void unpack(S& s, TYPE& o) { \
+                BOOST_PP_SEQ_FOR_EACH(GOLOS_SNAPSHOT_UNPACK_FIELD, o, FIELDS) \
+            } \
+        }; \
+    } }
+
+FC_REFLECT((golos::chain::state_snapshot_chunk), (file)(records)(size)(checksum))
+FC_REFLECT((golos::chain::state_snapshot_index), (name)(type_id)(records)(chunks))
+FC_REFLECT((golos::chain::state_snapshot_manifest), (version)(chain_id)(block_num)(block_id)(time)(indexes))
@@ -0,0 +1,125 @@
+#include <golos/chain/read_epoch.hpp>
+
+namespace golos { namespace chain {
+
+    namespace {
+        const std::string internal_method_name;
+
+        thread_local const std::string* current_method = nullptr;
+
+        std::atomic<bool> method_scope_enabled{false};
+
+        // number of database locks, which are held by the current thread
+        thread_local uint32_t lock_depth = 0;
+    }
+
+    api_method_scope::api_method_scope(const std::string& plugin, const std::string& method)
+        : _prev(current_method) {
+        if (method_scope_enabled) {
+            _name.reserve(plugin.size() + 1 + method.size());
+            _name.append(plugin).append(1, '.').append(method);
+            current_method = &_name;
+            _entered = true;
+        }
+    }
+
+    api_method_scope::api_method_scope(std::string name)
+        : _name(std::move(name)),
+          _prev(current_method),
+          _entered(true) {
+        current_method = &_name;
+    }
+
+    api_method_scope::~api_method_scope() {
+        if (_entered) {
+            current_method = _prev;
+        }
+    }
+
+    void api_method_scope::set_enabled(bool value) {
+        method_scope_enabled = value;
+    }
+
+    const std::string& api_method_scope::current() {
+        return current_method ? *current_method : internal_method_name;
+    }
+
+    read_epoch_gate::reader::reader(read_epoch_gate& gate) {
+        if (lock_depth == 0 && gate._enabled) {
+            std::unique_lock<std::mutex> lock(gate._mutex);
+            auto no_writers = [&] { return gate._writers == 0; };
+            const int64_t timeout = gate._wait_timeout;
+            if (timeout > 0) {
+                gate._cond.wait_for(lock, std::chrono::microseconds(timeout), no_writers);
+            } else {
+                gate._cond.wait(lock, no_writers);
+            }
+        }
+        ++lock_depth;
+    }
+
+    read_epoch_gate::reader::~reader() {
+        --lock_depth;
+    }
+
+    read_epoch_gate::writer::writer(read_epoch_gate& gate)
+        : _gate(gate),
+          _top(lock_depth == 0) {
+        if (_top && _gate._enabled) {
+            std::lock_guard<std::mutex> lock(_gate._mutex);
+            ++_gate._writers;
+            _entered = true;
+        }
+        ++lock_depth;
+    }
+
+    read_epoch_gate::writer::~writer() {
+        --lock_depth;
+        if (_entered) {
+            std::lock_guard<std::mutex> lock(_gate._mutex);
+            --_gate._writers;
+            _gate._cond.notify_all();
+        }
+        if (_top) {
+            ++_gate._epoch;
+        }
+    }
+
+    read_epoch_gate::holder::holder() {
+        ++lock_depth;
+    }
+
+    read_epoch_gate::holder::~holder() {
+        --lock_depth;
+    }
+
+    void lock_metrics::add(lock_wait_stats& stats, const fc::microseconds& wait) {
+        const uint64_t value = std::max<int64_t>(wait.count(), 0);
+        ++stats.calls;
+        stats.wait_time += value;
+        stats.max_wait_time = std::max(stats.max_wait_time, value);
+    }
+
+    void lock_metrics::on_read_lock(const fc::microseconds& wait) {
+        if (!_enabled) {
+            return;
+        }
+        const auto& method = api_method_scope::current();
+        std::lock_guard<std::mutex> lock(_mutex);
+        add(_stats.read[method], wait);
+    }
+
+    void lock_metrics::on_block_write_lock(const fc::microseconds& wait) {
+        if (!_enabled) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        add(_stats.block_write, wait);
+    }
+
+    database_lock_stats lock_metrics::get_stats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+
+} } // golos::chain
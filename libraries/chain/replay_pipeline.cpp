@@ -0,0 +1,134 @@
+#include <golos/chain/replay_pipeline.hpp>
+#include <golos/chain/database_exceptions.hpp>
+
+#include <iomanip>
+
+namespace golos { namespace chain {
+
+    replay_pipeline::replay_pipeline(
+        const block_log& log, uint32_t from_block_num, uint32_t last_block_num, uint32_t ring_size
+    ) : _block_log(log),
+        _from_block_num(from_block_num),
+        _last_block_num(last_block_num),
+        _read_ring(ring_size),
+        _prepare_ring(ring_size) {
+    }
+
+    replay_pipeline::~replay_pipeline() {
+        try {
+            stop();
+        } FC_CAPTURE_AND_LOG(())
+    }
+
+    void replay_pipeline::start() {
+        _start_time = fc::time_point::now();
+        _read_thread = std::thread([this] { read_loop(); });
+        _prepare_thread = std::thread([this] { prepare_loop(); });
+    }
+
+    void replay_pipeline::stop() {
+        _read_ring.close();
+        _prepare_ring.close();
+
+        if (_read_thread.joinable()) {
+            _read_thread.join();
+        }
+        if (_prepare_thread.joinable()) {
+            _prepare_thread.join();
+        }
+    }
+
+    void replay_pipeline::set_exception(std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(_exception_mutex);
+            if (!_exception) {
+                _exception = e;
+            }
+        }
+        _read_ring.close();
+        _prepare_ring.close();
+    }
+
+    void replay_pipeline::read_loop() {
+        try {
+            for (auto block_num = _from_block_num; block_num <= _last_block_num; ++block_num) {
+                auto start = fc::time_point::now();
+                auto block = _block_log.read_block_by_num(block_num);
+                GOLOS_CHECK_DATABASE(block.valid(),
+                    database_corrupted::wrong_block_num_was_read,
+                    "Block ${block_num} is absent in block log.", ("block_num", block_num));
+                _read_stats.busy_time += (fc::time_point::now() - start).count();
+                ++_read_stats.blocks;
+
+                if (!_read_ring.push(std::move(*block), _read_stats.blocked_time)) {
+                    return;
+                }
+            }
+            _read_ring.close();
+        } catch (...) {
+            set_exception(std::current_exception());
+        }
+    }
+
+    void replay_pipeline::prepare_loop() {
+        try {
+            signed_block block;
+            while (_read_ring.pop(block, _prepare_stats.blocked_time)) {
+                auto start = fc::time_point::now();
+
+                prepared_block item;
+                item.block_id = block.id();
+                item.block_size = fc::raw::pack_size(block);
+                item.trx_ids.reserve(block.transactions.size());
+                item.trx_sizes.reserve(block.transactions.size());
+                for (const auto& trx : block.transactions) {
+                    item.trx_ids.push_back(trx.id());
+                    item.trx_sizes.push_back(fc::raw::pack_size(trx));
+                }
+                item.block = std::move(block);
+
+                _prepare_stats.busy_time += (fc::time_point::now() - start).count();
+                ++_prepare_stats.blocks;
+
+                if (!_prepare_ring.push(std::move(item), _prepare_stats.blocked_time)) {
+                    return;
+                }
+            }
+            _prepare_ring.close();
+        } catch (...) {
+            set_exception(std::current_exception());
+        }
+    }
+
+    bool replay_pipeline::next(prepared_block& item) {
+        bool result = _prepare_ring.pop(item, _apply_stats.blocked_time);
+
+        std::lock_guard<std::mutex> lock(_exception_mutex);
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+        return result;
+    }
+
+    void replay_pipeline::on_applied(const fc::microseconds& apply_time) {
+        _apply_stats.busy_time += apply_time.count();
+        ++_apply_stats.blocks;
+    }
+
+    void replay_pipeline::print_stats(std::ostream& out) const {
+        auto elapsed = double(std::max<int64_t>((fc::time_point::now() - _start_time).count(), 1)) / 1000000.0;
+
+        auto print = [&](const char* name, const replay_stage_stats& stats) {
+            out << "      " << std::setw(7) << std::left << name << std::right
+                << std::fixed << std::setprecision(1)
+                << double(stats.blocks) / elapsed << " blocks/sec"
+                << ", busy " << double(stats.busy_time) / 1000000.0 << " sec"
+                << ", blocked " << double(stats.blocked_time) / 1000000.0 << " sec\n";
+        };
+
+        print("read", _read_stats);
+        print("prepare", _prepare_stats);
+        print("apply", _apply_stats);
+    }
+
+} } // golos::chain
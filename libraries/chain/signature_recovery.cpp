@@ -0,0 +1,95 @@
+#include <golos/chain/signature_recovery.hpp>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace golos { namespace chain {
+
+    signature_recovery_pool::signature_recovery_pool() {
+    }
+
+    signature_recovery_pool::~signature_recovery_pool() {
+        stop();
+    }
+
+    void signature_recovery_pool::start(uint32_t threads) {
+        stop();
+        if (!threads) {
+            return;
+        }
+
+        _service.reset();
+        _work = std::make_unique<boost::asio::io_service::work>(_service);
+        _threads.reserve(threads);
+        for (uint32_t i = 0; i < threads; ++i) {
+            _threads.emplace_back([this] { _service.run(); });
+        }
+    }
+
+    void signature_recovery_pool::stop() {
+        _work.reset();
+        _service.stop();
+        for (auto& thread: _threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        _threads.clear();
+    }
+
+    recovered_block_keys_ptr signature_recovery_pool::recover(
+        const signed_block& block, const chain_id_type& chain_id, bool with_transactions
+    ) {
+        if (!is_started()) {
+            return nullptr;
+        }
+
+        if (with_transactions && block.calculate_merkle_root() != block.transaction_merkle_root) {
+            return nullptr;
+        }
+
+        auto result = std::make_shared<recovered_block_keys>();
+        result->block_id = block.id();
+        if (with_transactions) {
+            result->trx_keys.resize(block.transactions.size());
+        }
+
+        // task 0 is the witness signature, task N is the transaction N-1
+        const std::size_t task_count = result->trx_keys.size() + 1;
+        const std::size_t chunk_size = (task_count + _threads.size() - 1) / _threads.size();
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t pending = (task_count + chunk_size - 1) / chunk_size;
+
+        auto recover_range = [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                try {
+                    if (i == 0) {
+                        result->signee = public_key_type(block.signee());
+                    } else {
+                        result->trx_keys[i - 1] = block.transactions[i - 1].get_signature_keys(chain_id);
+                    }
+                } catch (...) {
+                    // keys stay empty, the error will be reported on the usual check
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done.notify_one();
+            }
+        };
+
+        for (std::size_t begin = 0; begin < task_count; begin += chunk_size) {
+            auto end = std::min(begin + chunk_size, task_count);
+            _service.post([&recover_range, begin, end] { recover_range(begin, end); });
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return pending == 0; });
+
+        return result;
+    }
+
+} } // golos::chain
@@ -0,0 +1,503 @@
+#include <golos/chain/state_snapshot.hpp>
+#include <golos/chain/account_object.hpp>
+#include <golos/chain/block_summary_object.hpp>
+#include <golos/chain/comment_object.hpp>
+#include <golos/chain/global_property_object.hpp>
+#include <golos/chain/proposal_object.hpp>
+#include <golos/chain/steem_objects.hpp>
+#include <golos/chain/transaction_object.hpp>
+#include <golos/chain/witness_objects.hpp>
+#include <golos/chain/worker_objects.hpp>
+#include <golos/protocol/exceptions.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <atomic>
+#include <thread>
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::dynamic_global_property_object,
+    (head_block_number)(head_block_id)(time)(current_witness)(total_pow)(num_pow_witnesses)
+    (virtual_supply)(current_supply)(confidential_supply)(current_sbd_supply)(confidential_sbd_supply)
+    (total_vesting_fund_steem)(total_vesting_shares)(accumulative_balance)(total_reward_fund_steem)
+    (total_reward_shares2)(sbd_interest_rate)(sbd_print_rate)(sbd_debt_percent)(is_forced_min_price)(average_block_size)
+    (maximum_block_size)(current_aslot)(recent_slots_filled)(participation_count)(last_irreversible_block_num)
+    (max_virtual_bandwidth)(current_reserve_ratio)(custom_ops_bandwidth_multiplier)(transit_block_num)
+    (transit_witnesses)(worker_requests)(accumulative_emission_per_day))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_object,
+    (name)(memo_key)(proxy)(last_account_update)(created)(mined)(owner_challenged)(active_challenged)
+    (last_owner_proved)(last_active_proved)(recovery_account)(reset_account)(last_account_recovery)
+    (comment_count)(lifetime_vote_count)(post_count)(can_vote)(voting_power)(posts_capacity)
+    (comments_capacity)(voting_capacity)(last_vote_time)(balance)(savings_balance)(accumulative_balance)
+    (tip_balance)(sbd_balance)(sbd_seconds)(sbd_seconds_last_update)(sbd_last_interest_payment)
+    (savings_sbd_balance)(savings_sbd_seconds)(savings_sbd_seconds_last_update)
+    (savings_sbd_last_interest_payment)(savings_withdraw_requests)(benefaction_rewards)(curation_rewards)
+    (delegation_rewards)(posting_rewards)
+    (vesting_shares)(delegated_vesting_shares)(received_vesting_shares)(vesting_withdraw_rate)
+    (next_vesting_withdrawal)(withdrawn)(to_withdraw)(withdraw_routes)(proxied_vsf_votes)
+    (witnesses_voted_for)(last_comment)(last_post)(referrer_account)(referrer_interest_rate)
+    (referral_end_date)(referral_break_fee)(last_active_operation)(last_claim))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_authority_object,
+    (account)(owner)(active)(posting)(last_owner_update))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_bandwidth_object,
+    (account)(type)(average_bandwidth)(lifetime_bandwidth)(last_bandwidth_update))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::witness_object,
+    (owner)(created)(url)(votes)(schedule)(virtual_last_update)(virtual_position)(virtual_scheduled_time)
+    (total_missed)(last_aslot)(last_confirmed_block_num)(pow_worker)(signing_key)(props)(sbd_exchange_rate)
+    (last_sbd_exchange_update)(last_work)(running_version)(hardfork_version_vote)(hardfork_time_vote)
+    (transit_to_cyberway_vote))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::transaction_object,
+    (packed_trx)(trx_id)(expiration))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::block_summary_object,
+    (block_id))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::witness_schedule_object,
+    (current_virtual_time)(next_shuffle_block_num)(current_shuffled_witnesses)(num_scheduled_witnesses)
+    (top19_weight)(timeshare_weight)(miner_weight)(witness_pay_normalization_factor)(median_props)
+    (majority_version))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::comment_object,
+    (parent_author)(parent_permlink)(author)(permlink)(created)(last_payout)(depth)(children)
+    (children_rshares2)(net_rshares)(abs_rshares)(vote_rshares)(children_abs_rshares)(cashout_time)
+    (max_cashout_time)(reward_weight)(net_votes)(total_votes)(root_comment)(mode)(curation_reward_curve)
+    (auction_window_reward_destination)(auction_window_size)(max_accepted_payout)(percent_steem_dollars)
+    (allow_replies)(allow_votes)(allow_curation_rewards)(curation_rewards_percent)(beneficiaries))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::delegator_vote_interest_rate,
+    (account)(interest_rate)(payout_strategy))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::comment_vote_object,
+    (voter)(comment)(orig_rshares)(rshares)(vote_percent)(auction_time)(last_update)(num_changes)
+    (delegator_vote_interest_rates))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::witness_vote_object,
+    (witness)(account))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::limit_order_object,
+    (created)(expiration)(seller)(orderid)(for_sale)(sell_price))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::feed_history_object,
+    (current_median_history)(witness_median_history)(price_history))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::convert_request_object,
+    (owner)(requestid)(amount)(conversion_date))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::liquidity_reward_balance_object,
+    (owner)(steem_volume)(sbd_volume)(weight)(last_update))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::hardfork_property_object,
+    (processed_hardforks)(last_hardfork)(current_hardfork_version)(next_hardfork)(next_hardfork_time))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::withdraw_vesting_route_object,
+    (from_account)(to_account)(percent)(auto_vest))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::owner_authority_history_object,
+    (account)(previous_owner_authority)(last_valid_time))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_recovery_request_object,
+    (account_to_recover)(new_owner_authority)(expires))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::change_recovery_account_request_object,
+    (account_to_recover)(recovery_account)(effective_on))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::escrow_object,
+    (escrow_id)(from)(to)(agent)(ratification_deadline)(escrow_expiration)(sbd_balance)(steem_balance)
+    (pending_fee)(to_approved)(agent_approved)(disputed))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::savings_withdraw_object,
+    (from)(to)(memo)(request_id)(amount)(complete))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::decline_voting_rights_request_object,
+    (account)(effective_date))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::vesting_delegation_object,
+    (delegator)(delegatee)(vesting_shares)(interest_rate)(payout_strategy)(min_delegation_time))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::vesting_delegation_expiration_object,
+    (delegator)(vesting_shares)(expiration))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_metadata_object,
+    (account)(json_metadata))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::proposal_object,
+    (author)(title)(memo)(expiration_time)(review_period_time)(proposed_operations)
+    (required_active_approvals)(available_active_approvals)(required_owner_approvals)
+    (available_owner_approvals)(required_posting_approvals)(available_posting_approvals)
+    (available_key_approvals))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::required_approval_object,
+    (account)(proposal))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::worker_request_object,
+    (post)(worker)(state)(required_amount_min)(required_amount_max)(vest_reward)(duration)(created)
+    (vote_end_time)(stake_rshares)(stake_total)(remaining_payment))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::worker_request_vote_object,
+    (voter)(post)(vote_percent)(rshares)(stake))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::donate_object,
+    (app)(version)(target))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::invite_object,
+    (creator)(invite_key)(balance)(is_referral)(time)(last_transfer))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::asset_object,
+    (creator)(max_supply)(supply)(allow_fee)(allow_override_transfer)(created)(modified)
+    (symbols_whitelist)(fee_percent)(json_metadata))
+
+GOLOS_SNAPSHOT_OBJECT(golos::chain::account_balance_object,
+    (account)(balance)(tip_balance))
+
+namespace golos { namespace chain {
+
+    namespace bfs = boost::filesystem;
+
+    namespace {
+
+        // version 2 adds GBG and savings GBG balances of accounts and virtual schedule fields of witnesses
+        constexpr uint32_t state_snapshot_version = 2;
+
+        // fixed number of records allows to reuse chunks of old objects, which don't change
+        constexpr uint32_t snapshot_chunk_records = 100000;
+
+        const char* const snapshot_manifest_file = "manifest.json";
+
+        std::string snapshot_dir_name(uint32_t block_num) {
+            auto name = std::to_string(block_num);
+            return std::string(10 - std::min<size_t>(name.size(), 10), '0') + name;
+        }
+
+        std::string snapshot_chunk_name(uint16_t type_id, size_t chunk) {
+            return std::to_string(type_id) + "-" + std::to_string(chunk) + ".bin";
+        }
+
+        /// Runs f(i) for i in [0, count) in threads, rethrows the first exception
+        template<typename Lambda>
+        void run_parallel(size_t count, uint32_t threads, Lambda&& f) {
+            std::atomic<size_t> next{0};
+            std::vector<std::exception_ptr> errors(count);
+
+            auto worker = [&]() {
+                for (auto i = next++; i < count; i = next++) {
+                    try {
+                        f(i);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            };
+
+            std::vector<std::thread> pool;
+            const auto size = std::min<size_t>(std::max<uint32_t>(threads, 1), count);
+            for (size_t i = 1; i < size; ++i) {
+                pool.emplace_back(worker);
+            }
+            worker();
+            for (auto& thread: pool) {
+                thread.join();
+            }
+
+            for (auto& error: errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+        state_snapshot_manifest read_manifest(const fc::path& dir) {
+            const auto path = dir / snapshot_manifest_file;
+            GOLOS_CHECK_DATABASE(fc::exists(path),
+                database_corrupted::unknown_file_format,
+                "Snapshot manifest is not found", ("file", path));
+
+            auto manifest = fc::json::from_file(path).as<state_snapshot_manifest>();
+            GOLOS_CHECK_DATABASE(manifest.version == state_snapshot_version,
+                database_corrupted::unknown_file_format,
+                "Unsupported version of snapshot", ("file", path)("version", manifest.version));
+            return manifest;
+        }
+
+        /// @return chunks of the last snapshot before block_num in dir by their checksums
+        std::map<fc::sha256, fc::path> find_previous_chunks(const fc::path& dir, uint32_t block_num) {
+            std::map<fc::sha256, fc::path> result;
+
+            fc::path previous;
+            uint32_t previous_num = 0;
+            for (bfs::directory_iterator itr(dir), end; itr != end; ++itr) {
+                const auto path = itr->path();
+                if (!bfs::is_directory(path) || !bfs::exists(path / snapshot_manifest_file)) {
+                    continue;
+                }
+                try {
+                    auto num = read_manifest(path).block_num;
+                    if (num < block_num && num >= previous_num) {
+                        previous = path;
+                        previous_num = num;
+                    }
+                } catch (const fc::exception& e) {
+                    wlog("Skip snapshot ${path}: ${e}", ("path", path.string())("e", e.to_string()));
+                }
+            }
+
+            if (previous.string().empty()) {
+                return result;
+            }
+
+            for (const auto& index: read_manifest(previous).indexes) {
+                for (const auto& chunk: index.chunks) {
+                    auto path = previous / chunk.file;
+                    if (fc::exists(path) && fc::file_size(path) == chunk.size) {
+                        result.emplace(chunk.checksum, path);
+                    }
+                }
+            }
+            return result;
+        }
+
+        void write_chunk(
+            const fc::path& path, const std::vector<char>& data, const fc::sha256& checksum,
+            const std::map<fc::sha256, fc::path>& previous
+        ) {
+            auto itr = previous.find(checksum);
+            if (itr != previous.end()) {
+                boost::system::error_code ec;
+                bfs::create_hard_link(itr->second, path, ec);
+                if (!ec) {
+                    return;
+                }
+            }
+
+            bfs::ofstream out(path, std::ios_base::binary);
+            out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+            out.write(data.data(), data.size());
+        }
+
+        std::vector<char> read_chunk(const fc::path& dir, const state_snapshot_chunk& chunk) {
+            const auto path = dir / chunk.file;
+            GOLOS_CHECK_DATABASE(fc::exists(path) && fc::file_size(path) == chunk.size,
+                database_corrupted::reading_data_beyond_end_of_file,
+                "Snapshot chunk is missing or has wrong size", ("file", path)("size", chunk.size));
+
+            std::vector<char> data(chunk.size);
+            bfs::ifstream in(path, std::ios_base::binary);
+            in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            in.read(data.data(), data.size());
+
+            GOLOS_CHECK_DATABASE(fc::sha256::hash(data.data(), data.size()) == chunk.checksum,
+                database_corrupted::checksum_mismatch,
+                "Checksum of snapshot chunk doesn't match", ("file", path));
+            return data;
+        }
+
+    } // namespace
+
+    template<typename MultiIndexType>
+    void add_core_snapshot_index(database& db, const char* name, bool keep_ids = false) {
+        db.add_snapshot_index(std::make_shared<snapshot_index<MultiIndexType>>(name, true, keep_ids));
+    }
+
+    void database::initialize_snapshot_indexes() {
+        // ids are kept for objects, which are referenced by ids or found by fixed ids
+        add_core_snapshot_index<dynamic_global_property_index>(*this, "dynamic_global_property_index", true);
+        add_core_snapshot_index<account_index>(*this, "account_index", true);
+        add_core_snapshot_index<account_authority_index>(*this, "account_authority_index");
+        add_core_snapshot_index<account_bandwidth_index>(*this, "account_bandwidth_index");
+        add_core_snapshot_index<witness_index>(*this, "witness_index", true);
+        add_core_snapshot_index<transaction_index>(*this, "transaction_index");
+        add_core_snapshot_index<block_summary_index>(*this, "block_summary_index", true);
+        add_core_snapshot_index<witness_schedule_index>(*this, "witness_schedule_index", true);
+        add_core_snapshot_index<comment_index>(*this, "comment_index", true);
+        add_core_snapshot_index<comment_vote_index>(*this, "comment_vote_index");
+        add_core_snapshot_index<witness_vote_index>(*this, "witness_vote_index");
+        add_core_snapshot_index<limit_order_index>(*this, "limit_order_index");
+        add_core_snapshot_index<feed_history_index>(*this, "feed_history_index", true);
+        add_core_snapshot_index<convert_request_index>(*this, "convert_request_index");
+        add_core_snapshot_index<liquidity_reward_balance_index>(*this, "liquidity_reward_balance_index");
+        add_core_snapshot_index<hardfork_property_index>(*this, "hardfork_property_index", true);
+        add_core_snapshot_index<withdraw_vesting_route_index>(*this, "withdraw_vesting_route_index");
+        add_core_snapshot_index<owner_authority_history_index>(*this, "owner_authority_history_index");
+        add_core_snapshot_index<account_recovery_request_index>(*this, "account_recovery_request_index");
+        add_core_snapshot_index<change_recovery_account_request_index>(*this, "change_recovery_account_request_index");
+        add_core_snapshot_index<escrow_index>(*this, "escrow_index");
+        add_core_snapshot_index<savings_withdraw_index>(*this, "savings_withdraw_index");
+        add_core_snapshot_index<decline_voting_rights_request_index>(*this, "decline_voting_rights_request_index");
+        add_core_snapshot_index<vesting_delegation_index>(*this, "vesting_delegation_index");
+        add_core_snapshot_index<vesting_delegation_expiration_index>(*this, "vesting_delegation_expiration_index");
+        add_core_snapshot_index<account_metadata_index>(*this, "account_metadata_index");
+        add_core_snapshot_index<proposal_index>(*this, "proposal_index", true);
+        add_core_snapshot_index<required_approval_index>(*this, "required_approval_index");
+        add_core_snapshot_index<worker_request_index>(*this, "worker_request_index");
+        add_core_snapshot_index<worker_request_vote_index>(*this, "worker_request_vote_index");
+        add_core_snapshot_index<donate_index>(*this, "donate_index", true);
+        add_core_snapshot_index<invite_index>(*this, "invite_index");
+        add_core_snapshot_index<asset_index>(*this, "asset_index");
+        add_core_snapshot_index<account_balance_index>(*this, "account_balance_index");
+    }
+
+    void database::add_snapshot_index(std::shared_ptr<abstract_snapshot_index> index) {
+        // indexes are initialized on each open, so the same index can be added again
+        _snapshot_indexes[index->type_id()] = std::move(index);
+    }
+
+    void database::set_snapshot_to_load(const fc::path& dir, uint32_t threads) {
+        _snapshot_to_load = dir;
+        _snapshot_threads = std::max<uint32_t>(threads, 1);
+    }
+
+    fc::path database::write_snapshot(const fc::path& dir, uint32_t threads) {
+        try {
+            auto start = fc::time_point::now();
+
+            const auto name = snapshot_dir_name(head_block_num());
+            const auto path = dir / name;
+            const auto tmp_path = dir / (name + ".tmp");
+            FC_ASSERT(!fc::exists(path), "Snapshot already exists", ("path", path));
+
+            ilog("Writing snapshot of state at block ${n} to ${path}", ("n", head_block_num())("path", path.string()));
+
+            fc::remove_all(tmp_path);
+            fc::create_directories(tmp_path);
+
+            const auto previous = find_previous_chunks(dir, head_block_num());
+
+            std::vector<std::shared_ptr<abstract_snapshot_index>> indexes;
+            for (const auto& item: _snapshot_indexes) {
+                indexes.push_back(item.second);
+            }
+
+            state_snapshot_manifest manifest;
+            manifest.version = state_snapshot_version;
+            manifest.chain_id = get_chain_id();
+            manifest.block_num = head_block_num();
+            manifest.block_id = head_block_id();
+            manifest.time = head_block_time();
+            manifest.indexes.resize(indexes.size());
+
+            std::atomic<uint32_t> reused_chunks{0};
+
+            run_parallel(indexes.size(), threads, [&](size_t i) {
+                const auto& index = *indexes[i];
+                auto& info = manifest.indexes[i];
+                info.name = index.name();
+                info.type_id = index.type_id();
+                info.records = index.write_chunks(*this, snapshot_chunk_records,
+                    [&](const std::vector<char>& data, uint32_t records) {
+                        state_snapshot_chunk chunk;
+                        chunk.file = snapshot_chunk_name(info.type_id, info.chunks.size());
+                        chunk.records = records;
+                        chunk.size = data.size();
+                        chunk.checksum = fc::sha256::hash(data.data(), data.size());
+                        if (previous.count(chunk.checksum)) {
+                            ++reused_chunks;
+                        }
+                        write_chunk(tmp_path / chunk.file, data, chunk.checksum, previous);
+                        info.chunks.push_back(std::move(chunk));
+                    });
+            });
+
+            fc::json::save_to_file(manifest, tmp_path / snapshot_manifest_file);
+            fc::rename(tmp_path, path);
+
+            ilog("Done writing snapshot, ${reused} chunks are reused from the previous one, elapsed time ${t} sec",
+                ("reused", reused_chunks.load())
+                ("t", double((fc::time_point::now() - start).count()) / 1000000.0));
+            return path;
+        } FC_CAPTURE_AND_RETHROW((dir)(threads))
+    }
+
+    void database::load_snapshot() {
+        try {
+            auto start = fc::time_point::now();
+            auto manifest = read_manifest(_snapshot_to_load);
+
+            FC_ASSERT(manifest.chain_id == get_chain_id(), "Snapshot is made for another chain",
+                ("chain_id", manifest.chain_id)("expected", get_chain_id()));
+
+            ilog("Loading state at block ${n} from snapshot ${path}",
+                ("n", manifest.block_num)("path", _snapshot_to_load.string()));
+
+            std::map<uint16_t, const state_snapshot_index*> infos;
+            for (const auto& info: manifest.indexes) {
+                if (!_snapshot_indexes.count(info.type_id)) {
+                    wlog("Skip unknown index ${name} of snapshot", ("name", info.name));
+                    continue;
+                }
+                infos[info.type_id] = &info;
+            }
+
+            // plugin indexes, which can't be restored, would stay empty and inconsistent with the state
+            std::vector<std::string> unsupported;
+            for (auto itr = index_list_begin(); itr != index_list_end(); ++itr) {
+                if (!_snapshot_indexes.count((*itr)->type_id())) {
+                    unsupported.push_back((*itr)->name());
+                }
+            }
+            FC_ASSERT(unsupported.empty(),
+                "Snapshot can't restore indexes of enabled plugins, disable them or replay the blockchain",
+                ("indexes", unsupported));
+
+            for (const auto& item: _snapshot_indexes) {
+                const auto& index = *item.second;
+                FC_ASSERT(index.empty(*this), "Can't load snapshot to non-empty index", ("index", index.name()));
+
+                auto itr = infos.find(index.type_id());
+                if (itr == infos.end()) {
+                    GOLOS_CHECK_DATABASE(!index.required(),
+                        database_corrupted::unknown_file_format,
+                        "Snapshot doesn't contain required index", ("index", index.name()));
+                    ilog("Snapshot doesn't contain ${index}, it stays empty", ("index", index.name()));
+                    continue;
+                }
+
+                const auto& info = *itr->second;
+                GOLOS_CHECK_DATABASE(info.name == index.name(),
+                    database_corrupted::unknown_file_format,
+                    "Index of snapshot has other type", ("index", index.name())("name", info.name));
+
+                // chunks are read and verified in parallel, and objects are created in one thread
+                uint64_t records = 0;
+                int64_t last_id = -1;
+                for (size_t first = 0; first < info.chunks.size(); first += _snapshot_threads) {
+                    auto count = std::min<size_t>(_snapshot_threads, info.chunks.size() - first);
+                    std::vector<std::vector<char>> batch(count);
+                    run_parallel(count, _snapshot_threads, [&](size_t i) {
+                        batch[i] = read_chunk(_snapshot_to_load, info.chunks[first + i]);
+                    });
+
+                    for (size_t i = 0; i < count; ++i) {
+                        auto loaded = index.load_chunk(*this, batch[i], last_id);
+                        GOLOS_CHECK_DATABASE(loaded == info.chunks[first + i].records,
+                            database_corrupted::unknown_file_format,
+                            "Wrong number of records in snapshot chunk",
+                            ("file", info.chunks[first + i].file)("records", loaded));
+                        records += loaded;
+                    }
+                }
+
+                GOLOS_CHECK_DATABASE(records == info.records,
+                    database_corrupted::unknown_file_format,
+                    "Wrong number of records in snapshot index", ("index", info.name)("records", records));
+            }
+
+            GOLOS_CHECK_DATABASE(
+                head_block_num() == manifest.block_num && head_block_id() == manifest.block_id,
+                database_corrupted::unknown_file_format,
+                "Head block of snapshot state doesn't match its manifest",
+                ("head", head_block_num())("block_num", manifest.block_num));
+
+            set_revision(head_block_num());
+
+            ilog("Done loading snapshot, elapsed time ${t} sec",
+                ("t", double((fc::time_point::now() - start).count()) / 1000000.0));
+        } FC_CAPTURE_AND_RETHROW((_snapshot_to_load))
+    }
+
+} } // golos::chain
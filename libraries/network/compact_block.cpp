@@ -0,0 +1,117 @@
+#include <golos/network/compact_block.hpp>
+
+#include <cstring>
+
+namespace golos {
+    namespace network {
+
+        short_transaction_id_type short_transaction_id(const transaction_id_type &id) {
+            short_transaction_id_type result;
+            static_assert(sizeof(result) <= sizeof(id._hash), "too long short id");
+            std::memcpy(&result, id._hash, sizeof(result));
+            return result;
+        }
+
+        compact_block_message make_compact_block_message(const signed_block &block, const block_id_type &block_id,
+                const item_hash_t &item_hash) {
+            compact_block_message result;
+            result.item_hash = item_hash;
+            result.header = block;
+            result.block_id = block_id;
+            result.short_ids.reserve(block.transactions.size());
+            for (const auto &trx : block.transactions) {
+                result.short_ids.push_back(short_transaction_id(trx.id()));
+            }
+            return result;
+        }
+
+        compact_block_transactions_message make_compact_block_transactions_message(const signed_block &block,
+                const fetch_compact_block_transactions_message &request) {
+            compact_block_transactions_message result;
+            result.block_id = request.block_id;
+            result.indexes = request.indexes;
+            result.transactions.reserve(request.indexes.size());
+            for (auto index : request.indexes) {
+                FC_ASSERT(index < block.transactions.size(), "Transaction index is out of the block",
+                        ("index", index)("size", block.transactions.size()));
+                result.transactions.push_back(block.transactions[index]);
+            }
+            return result;
+        }
+
+        partial_compact_block::partial_compact_block(compact_block_message compact_block, const transaction_lookup &lookup)
+                : _compact_block(std::move(compact_block)) {
+            _transactions.reserve(_compact_block.short_ids.size());
+            for (auto short_id : _compact_block.short_ids) {
+                _transactions.push_back(lookup(short_id));
+            }
+        }
+
+        std::vector<uint32_t> partial_compact_block::missing_indexes() const {
+            std::vector<uint32_t> result;
+            for (uint32_t i = 0; i < _transactions.size(); ++i) {
+                if (!_transactions[i].valid()) {
+                    result.push_back(i);
+                }
+            }
+            return result;
+        }
+
+        bool partial_compact_block::is_complete() const {
+            for (const auto &trx : _transactions) {
+                if (!trx.valid()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool partial_compact_block::add_transactions(const compact_block_transactions_message &transactions) {
+            if (transactions.block_id != _compact_block.block_id ||
+                transactions.indexes.size() != transactions.transactions.size()) {
+                return false;
+            }
+            for (std::size_t i = 0; i < transactions.indexes.size(); ++i) {
+                auto index = transactions.indexes[i];
+                if (index >= _transactions.size() ||
+                    short_transaction_id(transactions.transactions[i].id()) != _compact_block.short_ids[index]) {
+                    return false;
+                }
+            }
+            for (std::size_t i = 0; i < transactions.indexes.size(); ++i) {
+                _transactions[transactions.indexes[i]] = transactions.transactions[i];
+            }
+            return true;
+        }
+
+        bool partial_compact_block::drop_known_transactions() {
+            if (_known_transactions_dropped) {
+                return false;
+            }
+            _known_transactions_dropped = true;
+            for (auto &trx : _transactions) {
+                trx.reset();
+            }
+            return true;
+        }
+
+        fc::optional<signed_block> partial_compact_block::build_block() const {
+            if (!is_complete()) {
+                return fc::optional<signed_block>();
+            }
+
+            signed_block block;
+            static_cast<golos::protocol::signed_block_header &>(block) = _compact_block.header;
+            block.transactions.reserve(_transactions.size());
+            for (const auto &trx : _transactions) {
+                block.transactions.push_back(*trx);
+            }
+
+            if (block.calculate_merkle_root() != block.transaction_merkle_root || block.id() != _compact_block.block_id) {
+                return fc::optional<signed_block>();
+            }
+            return block;
+        }
+
+    }
+} // golos::network
@@ -29,6 +29,9 @@ namespace golos {
 
         const core_message_type_enum trx_message::type = core_message_type_enum::trx_message_type;
         const core_message_type_enum block_message::type = core_message_type_enum::block_message_type;
+        const core_message_type_enum compact_block_message::type = core_message_type_enum::compact_block_message_type;
+        const core_message_type_enum fetch_compact_block_transactions_message::type = core_message_type_enum::fetch_compact_block_transactions_message_type;
+        const core_message_type_enum compact_block_transactions_message::type = core_message_type_enum::compact_block_transactions_message_type;
         const core_message_type_enum item_ids_inventory_message::type = core_message_type_enum::item_ids_inventory_message_type;
         const core_message_type_enum blockchain_item_ids_inventory_message::type = core_message_type_enum::blockchain_item_ids_inventory_message_type;
         const core_message_type_enum fetch_blockchain_item_ids_message::type = core_message_type_enum::fetch_blockchain_item_ids_message_type;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <golos/network/core_messages.hpp>
+
+#include <fc/optional.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace golos {
+    namespace network {
+
+        short_transaction_id_type short_transaction_id(const transaction_id_type &id);
+
+        compact_block_message make_compact_block_message(const signed_block &block, const block_id_type &block_id,
+                const item_hash_t &item_hash);
+
+        /// @throw fc::assert_exception if an index is out of the block
+        compact_block_transactions_message make_compact_block_transactions_message(const signed_block &block,
+                const fetch_compact_block_transactions_message &request);
+
+        /**
+         *  Block which is reconstructed from compact_block_message by transactions known to the node
+         *  and by transactions requested from the peer.
+         */
+        class partial_compact_block {
+        public:
+            /// finds a known transaction by its short id, returns nothing if it isn't known or isn't unique
+            using transaction_lookup = std::function<fc::optional<signed_transaction>(short_transaction_id_type)>;
+
+            partial_compact_block() = default;
+
+            partial_compact_block(compact_block_message compact_block, const transaction_lookup &lookup);
+
+            const compact_block_message &compact_block() const {
+                return _compact_block;
+            }
+
+            std::vector<uint32_t> missing_indexes() const;
+
+            bool is_complete() const;
+
+            /// @return false if the answer doesn't match the requested transactions
+            bool add_transactions(const compact_block_transactions_message &transactions);
+
+            /**
+             *  Forgets transactions taken from the node, so all of them are requested from the peer.
+             *  It is used when a known transaction has the same id but other signatures than one in the block.
+             *  @return false if they are already forgotten
+             */
+            bool drop_known_transactions();
+
+            /// @return nothing if the block doesn't match its header (wrong transactions were taken by short ids)
+            fc::optional<signed_block> build_block() const;
+
+        private:
+            compact_block_message _compact_block;
+            std::vector<fc::optional<signed_transaction>> _transactions;
+            bool _known_transactions_dropped = false;
+        };
+
+    }
+} // golos::network
@@ -23,7 +23,12 @@
  */
 #pragma once
 
-#define GRAPHENE_NET_PROTOCOL_VERSION                        106
+#define GRAPHENE_NET_PROTOCOL_VERSION                        107
+
+/**
+ * Peers starting from this version relay new blocks as headers with short ids of transactions
+ */
+#define GRAPHENE_NET_COMPACT_BLOCKS_PROTOCOL_VERSION         107
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -68,6 +73,12 @@
  */
 #define GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS        5
 
+/**
+ * Limit of memory used by the message cache.  When it is reached before messages
+ * are expired by blocks, the least recently used messages are removed.
+ */
+#define GRAPHENE_NET_MESSAGE_CACHE_MAX_BYTES                 (64 * 1024 * 1024)
+
 /**
  * We prevent a peer from offering us a list of blocks which, if we fetched them
  * all, would result in a blockchain that extended into the future.
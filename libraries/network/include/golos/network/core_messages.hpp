@@ -89,6 +89,9 @@ namespace golos {
             check_firewall_reply_message_type = 5015,
             get_current_connections_request_message_type = 5016,
             get_current_connections_reply_message_type = 5017,
+            compact_block_message_type = 5018,
+            fetch_compact_block_transactions_message_type = 5019,
+            compact_block_transactions_message_type = 5020,
             core_message_type_last = 5099
         };
 
@@ -122,6 +125,48 @@ namespace golos {
 
         };
 
+        /// First 8 bytes of the transaction id
+        typedef uint64_t short_transaction_id_type;
+
+        /**
+         *  Block relayed as its header and short ids of transactions, it is sent instead of block_message
+         *  to peers which support it. The receiver takes transactions from its message cache
+         *  and requests missing ones by fetch_compact_block_transactions_message.
+         */
+        struct compact_block_message {
+            static const core_message_type_enum type;
+
+            item_hash_t item_hash; ///< hash of the requested block_message
+            golos::protocol::signed_block_header header;
+            block_id_type block_id;
+            std::vector<short_transaction_id_type> short_ids;
+        };
+
+        struct fetch_compact_block_transactions_message {
+            static const core_message_type_enum type;
+
+            block_id_type block_id;
+            std::vector<uint32_t> indexes; ///< positions of transactions in the block
+
+            fetch_compact_block_transactions_message() {
+            }
+
+            fetch_compact_block_transactions_message(const block_id_type &block_id, std::vector<uint32_t> indexes)
+                    :
+                    block_id(block_id),
+                    indexes(std::move(indexes)) {
+            }
+        };
+
+        /// Answer to fetch_compact_block_transactions_message, transactions are empty if the block is unknown
+        struct compact_block_transactions_message {
+            static const core_message_type_enum type;
+
+            block_id_type block_id;
+            std::vector<uint32_t> indexes;
+            std::vector<signed_transaction> transactions;
+        };
+
         struct item_ids_inventory_message {
             static const core_message_type_enum type;
 
@@ -444,10 +489,16 @@ FC_REFLECT_ENUM(golos::network::core_message_type_enum,
                 (check_firewall_reply_message_type)
                 (get_current_connections_request_message_type)
                 (get_current_connections_reply_message_type)
+                (compact_block_message_type)
+                (fetch_compact_block_transactions_message_type)
+                (compact_block_transactions_message_type)
                 (core_message_type_last))
 
 FC_REFLECT((golos::network::trx_message), (trx))
 FC_REFLECT((golos::network::block_message), (block)(block_id))
+FC_REFLECT((golos::network::compact_block_message), (item_hash)(header)(block_id)(short_ids))
+FC_REFLECT((golos::network::fetch_compact_block_transactions_message), (block_id)(indexes))
+FC_REFLECT((golos::network::compact_block_transactions_message), (block_id)(indexes)(transactions))
 
 FC_REFLECT((golos::network::item_id), (item_type)
         (item_hash))
@@ -30,6 +30,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace golos {
     namespace network {
 
@@ -105,6 +107,11 @@ namespace golos {
             }
         };
 
+        /**
+         *  Received message shared by the message cache and send queues of peers,
+         *  so relaying of it to other peers reuses the original bytes
+         */
+        typedef std::shared_ptr<const message> shared_message_ptr;
 
     }
 } // golos::network
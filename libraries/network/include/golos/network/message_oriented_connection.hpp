@@ -36,7 +36,7 @@ namespace golos {
         /** receives incoming messages from a message_oriented_connection object */
         class message_oriented_connection_delegate {
         public:
-            virtual void on_message(message_oriented_connection *originating_connection, const message &received_message) = 0;
+            virtual void on_message(message_oriented_connection *originating_connection, const shared_message_ptr &received_message) = 0;
 
             virtual void on_connection_closed(message_oriented_connection *originating_connection) = 0;
         };
@@ -53,6 +53,18 @@ namespace golos {
             node_id_t originating_peer;
         };
 
+        /// counters of the cache of recently received messages, which are provided to peers by their requests
+        struct message_cache_stats {
+            uint32_t size = 0; ///< number of cached messages
+            uint64_t size_in_bytes = 0;
+            uint64_t max_size_in_bytes = 0;
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t inserted = 0;
+            uint64_t expired = 0; ///< removed after GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS blocks
+            uint64_t evicted = 0; ///< least recently used messages removed to fit into max_size_in_bytes
+        };
+
         /**
          *  @class node_delegate
          *  @brief used by node reports status to client or fetch data from client
@@ -293,6 +305,8 @@ namespace golos {
 
             fc::variant_object network_get_usage_stats() const;
 
+            message_cache_stats get_message_cache_stats() const;
+
             std::vector<potential_peer_record> get_potential_peers() const;
 
             void disable_peer_advertising();
@@ -352,3 +366,5 @@ namespace golos {
 
 FC_REFLECT((golos::network::message_propagation_data), (received_time)(validated_time)(originating_peer));
 FC_REFLECT((golos::network::peer_status), (version)(host)(info));
+FC_REFLECT((golos::network::message_cache_stats),
+        (size)(size_in_bytes)(max_size_in_bytes)(hits)(misses)(inserted)(expired)(evicted));
@@ -28,6 +28,7 @@
 #include <golos/network/message_oriented_connection.hpp>
 #include <golos/network/stcp_socket.hpp>
 #include <golos/network/config.hpp>
+#include <golos/network/compact_block.hpp>
 
 #include <boost/tuple/tuple.hpp>
 
@@ -65,11 +66,11 @@ namespace golos {
         class peer_connection_delegate {
         public:
             virtual void on_message(peer_connection *originating_peer,
-                    const message &received_message) = 0;
+                    const shared_message_ptr &received_message) = 0;
 
             virtual void on_connection_closed(peer_connection *originating_peer) = 0;
 
-            virtual message get_message_for_item(const item_id &item) = 0;
+            virtual shared_message_ptr get_message_for_item(const item_id &item) = 0;
         };
 
         class peer_connection;
@@ -122,7 +123,7 @@ namespace golos {
                         enqueue_time(enqueue_time) {
                 }
 
-                virtual message get_message(peer_connection_delegate *node) = 0;
+                virtual shared_message_ptr get_message(peer_connection_delegate *node) = 0;
 
                 /** returns roughly the number of bytes of memory the message is consuming while
                  * it is sitting on the queue
@@ -137,16 +138,31 @@ namespace golos {
              * stored on the heap until it is sent
              */
             struct real_queued_message : queued_message {
-                message message_to_send;
+                std::shared_ptr<message> message_to_send;
                 size_t message_send_time_field_offset;
 
                 real_queued_message(message message_to_send,
                         size_t message_send_time_field_offset = (size_t)-1) :
-                        message_to_send(std::move(message_to_send)),
+                        message_to_send(std::make_shared<message>(std::move(message_to_send))),
                         message_send_time_field_offset(message_send_time_field_offset) {
                 }
 
-                message get_message(peer_connection_delegate *node) override;
+                shared_message_ptr get_message(peer_connection_delegate *node) override;
+
+                size_t get_size_in_queue() override;
+            };
+
+            /* when you queue up a 'shared_queued_message', the message is shared with
+             * the message cache and with queues of other peers, it isn't copied
+             */
+            struct shared_queued_message : queued_message {
+                shared_message_ptr message_to_send;
+
+                shared_queued_message(shared_message_ptr message_to_send) :
+                        message_to_send(std::move(message_to_send)) {
+                }
+
+                shared_message_ptr get_message(peer_connection_delegate *node) override;
 
                 size_t get_size_in_queue() override;
             };
@@ -162,7 +178,7 @@ namespace golos {
                         item_to_send(std::move(item_to_send)) {
                 }
 
-                message get_message(peer_connection_delegate *node) override;
+                shared_message_ptr get_message(peer_connection_delegate *node) override;
 
                 size_t get_size_in_queue() override;
             };
@@ -265,6 +281,7 @@ namespace golos {
             timestamped_items_set_type inventory_advertised_to_peer;
 
             item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+            std::map<block_id_type, partial_compact_block> compact_blocks_in_progress; /// compact blocks received from this peer, which wait for their missing transactions
             /// @}
 
             // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -296,7 +313,7 @@ namespace golos {
 
             void connect_to(const fc::ip::endpoint &remote_endpoint, fc::optional<fc::ip::endpoint> local_endpoint = fc::optional<fc::ip::endpoint>());
 
-            void on_message(message_oriented_connection *originating_connection, const message &received_message) override;
+            void on_message(message_oriented_connection *originating_connection, const shared_message_ptr &received_message) override;
 
             void on_connection_closed(message_oriented_connection *originating_connection) override;
 
@@ -304,6 +321,8 @@ namespace golos {
 
             void send_message(const message &message_to_send, size_t message_send_time_field_offset = (size_t)-1);
 
+            void send_message(const shared_message_ptr &message_to_send);
+
             void send_item(const item_id &item_to_send);
 
             void close_connection();
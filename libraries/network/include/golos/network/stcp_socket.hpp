@@ -84,10 +84,8 @@ namespace golos {
             fc::tcp_socket _sock;
             fc::aes_encoder _send_aes;
             fc::aes_decoder _recv_aes;
-            std::shared_ptr<char> _read_buffer;
             std::shared_ptr<char> _write_buffer;
 #ifndef NDEBUG
-            bool _read_buffer_in_use;
             bool _write_buffer_in_use;
 #endif
         };
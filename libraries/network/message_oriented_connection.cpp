@@ -30,6 +30,9 @@
 #include <golos/network/stcp_socket.hpp>
 #include <golos/network/config.hpp>
 
+#include <mutex>
+#include <vector>
+
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
 #endif
@@ -44,6 +47,52 @@
 namespace golos {
     namespace network {
         namespace detail {
+            /**
+             * Buffers of received messages are returned here, when the last reference to the message is released,
+             * and are reused for next messages instead of allocating of new ones.
+             */
+            class message_buffer_pool final {
+            public:
+                static message_buffer_pool& instance() {
+                    // is never destroyed, because messages can be released after static destructors
+                    static auto* pool = new message_buffer_pool();
+                    return *pool;
+                }
+
+                std::shared_ptr<message> acquire() {
+                    auto* result = new message();
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        if (!_buffers.empty()) {
+                            result->data = std::move(_buffers.back());
+                            _buffers.pop_back();
+                        }
+                    }
+                    return std::shared_ptr<message>(result, [this](message* m) {
+                        release(std::move(m->data));
+                        delete m;
+                    });
+                }
+
+            private:
+                static constexpr std::size_t max_buffers = 64;
+                static constexpr std::size_t max_buffer_capacity = 256 * 1024;
+
+                void release(std::vector<char>&& buffer) {
+                    if (buffer.capacity() > max_buffer_capacity) {
+                        return;
+                    }
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_buffers.size() < max_buffers) {
+                        buffer.clear();
+                        _buffers.push_back(std::move(buffer));
+                    }
+                }
+
+                std::mutex _mutex;
+                std::vector<std::vector<char>> _buffers;
+            };
+
             class message_oriented_connection_impl {
             private:
                 message_oriented_connection *_self;
@@ -158,28 +207,32 @@ namespace golos {
                 bool call_on_connection_closed = false;
 
                 try {
-                    message m;
+                    auto& buffer_pool = message_buffer_pool::instance();
                     while (true) {
+                        // the message is shared with the node, which can keep it to relay to other peers
+                        auto m = buffer_pool.acquire();
+
                         char buffer[BUFFER_SIZE];
                         _sock.read(buffer, BUFFER_SIZE);
                         _bytes_received += BUFFER_SIZE;
-                        memcpy((char *)&m, buffer, sizeof(message_header));
+                        memcpy((char *)m.get(), buffer, sizeof(message_header));
 
-                        FC_ASSERT(m.size <=
-                                  MAX_MESSAGE_SIZE, "", ("m.size", m.size)("MAX_MESSAGE_SIZE", MAX_MESSAGE_SIZE));
+                        FC_ASSERT(m->size <=
+                                  MAX_MESSAGE_SIZE, "", ("m.size", m->size)("MAX_MESSAGE_SIZE", MAX_MESSAGE_SIZE));
 
                         size_t remaining_bytes_with_padding =
-                                16 * ((m.size - LEFTOVER + 15) / 16);
-                        m.data.resize(LEFTOVER +
+                                16 * ((m->size - LEFTOVER + 15) / 16);
+                        m->data.resize(LEFTOVER +
                                       remaining_bytes_with_padding); //give extra 16 bytes to allow for padding added in send call
                         std::copy(
                                 buffer + sizeof(message_header),
-                                buffer + sizeof(buffer), m.data.begin());
+                                buffer + sizeof(buffer), m->data.begin());
                         if (remaining_bytes_with_padding) {
-                            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+                            // decrypted in place by the socket
+                            _sock.read(&m->data[LEFTOVER], remaining_bytes_with_padding);
                             _bytes_received += remaining_bytes_with_padding;
                         }
-                        m.data.resize(m.size); // truncate off the padding bytes
+                        m->data.resize(m->size); // truncate off the padding bytes
 
                         _last_message_received_time = fc::time_point::now();
 
@@ -64,6 +64,7 @@
 #include <golos/network/node.hpp>
 #include <golos/network/peer_connection.hpp>
 #include <golos/network/exceptions.hpp>
+#include <golos/network/compact_block.hpp>
 
 #include <fc/git_revision.hpp>
 
@@ -119,18 +120,32 @@ namespace golos {
                 };
                 struct block_clock_index {
                 };
+                struct lru_index {
+                };
 
+                // hashes are uniformly distributed, so their first bytes are good enough as a hash value
+                struct message_hash_hasher {
+                    std::size_t operator()(const message_hash_type &hash) const {
+                        std::size_t result;
+                        memcpy(&result, hash._hash, sizeof(result));
+                        return result;
+                    }
+                };
+
+            public:
                 struct message_info {
                     message_hash_type message_hash;
-                    message message_body;
+                    shared_message_ptr message_body;
                     uint32_t block_clock_when_received;
 
                     // for network performance stats
                     message_propagation_data propagation_data;
                     fc::uint160_t message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
 
+                    uint32_t size_in_bytes; // approximate memory used by the message in the cache
+
                     message_info(const message_hash_type &message_hash,
-                            const message &message_body,
+                            const shared_message_ptr &message_body,
                             uint32_t block_clock_when_received,
                             const message_propagation_data &propagation_data,
                             fc::uint160_t message_contents_hash) :
@@ -138,70 +153,180 @@ namespace golos {
                             message_body(message_body),
                             block_clock_when_received(block_clock_when_received),
                             propagation_data(propagation_data),
-                            message_contents_hash(message_contents_hash) {
+                            message_contents_hash(message_contents_hash),
+                            size_in_bytes(uint32_t(sizeof(message_info) + sizeof(message) + message_body->data.size() +
+                                                   message_node_overhead)) {
                     }
+
+                private:
+                    static const uint32_t message_node_overhead = 16 * sizeof(void *);
                 };
 
+            private:
+                // contents hashes are ordered, because transactions are looked up by prefixes of their ids
                 typedef boost::multi_index_container
                         <message_info,
-                                bmi::indexed_by<bmi::ordered_unique<bmi::tag<message_hash_index>,
-                                        bmi::member<message_info, message_hash_type, &message_info::message_hash>>,
+                                bmi::indexed_by<bmi::hashed_unique<bmi::tag<message_hash_index>,
+                                        bmi::member<message_info, message_hash_type, &message_info::message_hash>,
+                                        message_hash_hasher>,
                                         bmi::ordered_non_unique<bmi::tag<message_contents_hash_index>,
                                                 bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash>>,
                                         bmi::ordered_non_unique<bmi::tag<block_clock_index>,
-                                                bmi::member<message_info, uint32_t, &message_info::block_clock_when_received>>>
+                                                bmi::member<message_info, uint32_t, &message_info::block_clock_when_received>>,
+                                        bmi::sequenced<bmi::tag<lru_index>>>
                         > message_cache_container;
 
                 message_cache_container _message_cache;
 
                 uint32_t block_clock;
 
+                message_cache_stats _stats;
+
+                template <typename Iterator>
+                const message_info *touch(const Iterator &iter);
+
+                template <typename Iterator>
+                void erase(const Iterator &iter);
+
+                void evict_to_fit();
+
             public:
                 blockchain_tied_message_cache() :
                         block_clock(0) {
+                    _stats.max_size_in_bytes = GRAPHENE_NET_MESSAGE_CACHE_MAX_BYTES;
                 }
 
                 void block_accepted();
 
-                void cache_message(const message &message_to_cache, const message_hash_type &hash_of_message_to_cache,
+                void cache_message(const shared_message_ptr &message_to_cache, const message_hash_type &hash_of_message_to_cache,
                         const message_propagation_data &propagation_data, const fc::uint160_t &message_content_hash);
 
-                message get_message(const message_hash_type &hash_of_message_to_lookup);
+                /// @return nullptr if the message isn't in the cache
+                const message_info *find_message(const message_hash_type &hash_of_message_to_lookup);
+
+                /// @return nullptr if the message isn't in the cache, blocks are found by their ids
+                const message_info *find_message_by_contents(const fc::uint160_t &hash_of_message_contents_to_lookup);
+
+                /// @return nullptr if no transaction or more than one transaction has the short id
+                const message_info *find_transaction_by_short_id(short_transaction_id_type short_id);
 
                 message_propagation_data get_message_propagation_data(const fc::uint160_t &hash_of_message_contents_to_lookup) const;
 
+                void set_max_size_in_bytes(uint64_t max_size_in_bytes);
+
                 size_t size() const {
                     return _message_cache.size();
                 }
+
+                message_cache_stats get_stats() const {
+                    auto result = _stats;
+                    result.size = uint32_t(_message_cache.size());
+                    return result;
+                }
             };
 
+            template <typename Iterator>
+            const blockchain_tied_message_cache::message_info *blockchain_tied_message_cache::touch(const Iterator &iter) {
+                auto lru_iter = _message_cache.project<lru_index>(iter);
+                auto &lru = _message_cache.get<lru_index>();
+                lru.relocate(lru.end(), lru_iter);
+                return &*lru_iter;
+            }
+
+            template <typename Iterator>
+            void blockchain_tied_message_cache::erase(const Iterator &iter) {
+                _stats.size_in_bytes -= iter->size_in_bytes;
+                _message_cache.get<lru_index>().erase(_message_cache.project<lru_index>(iter));
+            }
+
+            void blockchain_tied_message_cache::evict_to_fit() {
+                auto &lru = _message_cache.get<lru_index>();
+                while (_stats.size_in_bytes > _stats.max_size_in_bytes && !lru.empty()) {
+                    erase(lru.begin());
+                    ++_stats.evicted;
+                }
+            }
+
             void blockchain_tied_message_cache::block_accepted() {
                 ++block_clock;
                 if (block_clock > cache_duration_in_blocks) {
-                    _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                            _message_cache.get<block_clock_index>().lower_bound(
-                                    block_clock - cache_duration_in_blocks));
+                    auto &idx = _message_cache.get<block_clock_index>();
+                    auto end = idx.lower_bound(block_clock - cache_duration_in_blocks);
+                    for (auto iter = idx.begin(); iter != end;) {
+                        auto next = std::next(iter);
+                        erase(iter);
+                        ++_stats.expired;
+                        iter = next;
+                    }
                 }
             }
 
-            void blockchain_tied_message_cache::cache_message(const message &message_to_cache,
+            void blockchain_tied_message_cache::cache_message(const shared_message_ptr &message_to_cache,
                     const message_hash_type &hash_of_message_to_cache,
                     const message_propagation_data &propagation_data,
                     const fc::uint160_t &message_content_hash) {
-                _message_cache.insert(message_info(hash_of_message_to_cache,
+                auto result = _message_cache.insert(message_info(hash_of_message_to_cache,
                         message_to_cache,
                         block_clock,
                         propagation_data,
                         message_content_hash));
+                if (result.second) {
+                    _stats.size_in_bytes += result.first->size_in_bytes;
+                    ++_stats.inserted;
+                    evict_to_fit();
+                }
             }
 
-            message blockchain_tied_message_cache::get_message(const message_hash_type &hash_of_message_to_lookup) {
-                message_cache_container::index<message_hash_index>::type::const_iterator iter =
-                        _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup);
-                if (iter != _message_cache.get<message_hash_index>().end()) {
-                    return iter->message_body;
+            const blockchain_tied_message_cache::message_info *blockchain_tied_message_cache::find_message(
+                    const message_hash_type &hash_of_message_to_lookup) {
+                auto &idx = _message_cache.get<message_hash_index>();
+                auto iter = idx.find(hash_of_message_to_lookup);
+                if (iter != idx.end()) {
+                    ++_stats.hits;
+                    return touch(iter);
                 }
-                FC_THROW_EXCEPTION(fc::key_not_found_exception, "Requested message not in cache");
+                ++_stats.misses;
+                return nullptr;
+            }
+
+            const blockchain_tied_message_cache::message_info *blockchain_tied_message_cache::find_message_by_contents(
+                    const fc::uint160_t &hash_of_message_contents_to_lookup) {
+                auto &idx = _message_cache.get<message_contents_hash_index>();
+                auto iter = idx.find(hash_of_message_contents_to_lookup);
+                if (iter != idx.end()) {
+                    ++_stats.hits;
+                    return touch(iter);
+                }
+                ++_stats.misses;
+                return nullptr;
+            }
+
+            const blockchain_tied_message_cache::message_info *blockchain_tied_message_cache::find_transaction_by_short_id(
+                    short_transaction_id_type short_id) {
+                // short id is a prefix of the transaction id, so all candidates follow the id padded by zeros
+                fc::uint160_t lower_bound;
+                memcpy(lower_bound._hash, &short_id, sizeof(short_id));
+
+                auto &idx = _message_cache.get<message_contents_hash_index>();
+                auto result = idx.end();
+                for (auto iter = idx.lower_bound(lower_bound);
+                     iter != idx.end() && short_transaction_id(iter->message_contents_hash) == short_id; ++iter) {
+                    if (iter->message_body->msg_type != trx_message_type ||
+                        (result != idx.end() && result->message_contents_hash == iter->message_contents_hash)) {
+                        continue;
+                    }
+                    if (result != idx.end()) {
+                        ++_stats.misses;
+                        return nullptr;
+                    }
+                    result = iter;
+                }
+                if (result == idx.end()) {
+                    ++_stats.misses;
+                    return nullptr;
+                }
+                ++_stats.hits;
+                return touch(result);
             }
 
             message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(const fc::uint160_t &hash_of_message_contents_to_lookup) const {
@@ -216,6 +341,11 @@ namespace golos {
                 FC_THROW_EXCEPTION(fc::key_not_found_exception, "Requested message not in cache");
             }
 
+            void blockchain_tied_message_cache::set_max_size_in_bytes(uint64_t max_size_in_bytes) {
+                _stats.max_size_in_bytes = max_size_in_bytes;
+                evict_to_fit();
+            }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
             // This specifies configuration info for the local node.  It's stored as JSON
@@ -463,8 +593,8 @@ namespace golos {
                 typedef std::unordered_map<golos::network::block_id_type, fc::time_point> active_sync_requests_map;
 
                 active_sync_requests_map _active_sync_requests; /// list of sync blocks we've asked for from peers but have not yet received
-                std::list<golos::network::block_message> _new_received_sync_items; /// list of sync blocks we've just received but haven't yet tried to process
-                std::list<golos::network::block_message> _received_sync_items; /// list of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
+                /// reorder buffer of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
+                std::map<item_hash_t, golos::network::block_message> _received_sync_items;
                 // @}
 
                 fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -591,6 +721,8 @@ namespace golos {
                 unsigned _maximum_number_of_blocks_to_handle_at_one_time;
                 unsigned _maximum_number_of_sync_blocks_to_prefetch;
                 unsigned _maximum_blocks_per_peer_during_syncing;
+                unsigned _sync_reorder_window; /// how far from the next block to apply sync blocks can be requested
+                bool _compact_block_relay; /// send recently relayed blocks as compact blocks to peers which support them
 
                 std::list<fc::future<void>> _handle_message_calls_in_progress;
                 std::set<message_hash_type> _message_ids_currently_being_processed;
@@ -611,6 +743,8 @@ namespace golos {
 
                 void request_sync_items_from_peer(const peer_connection_ptr &peer, const std::vector<item_hash_t> &items_to_request);
 
+                bool can_request_sync_items_from_peer(const peer_connection_ptr &peer);
+
                 void fetch_sync_items_loop();
 
                 void trigger_fetch_sync_items_loop();
@@ -660,7 +794,7 @@ namespace golos {
                 void parse_hello_user_data_for_peer(peer_connection *originating_peer, const fc::variant_object &user_data);
 
                 void on_message(peer_connection *originating_peer,
-                        const message &received_message) override;
+                        const shared_message_ptr &received_message) override;
 
                 void on_hello_message(peer_connection *originating_peer,
                         const hello_message &hello_message_received);
@@ -723,13 +857,24 @@ namespace golos {
 
                 void trigger_process_backlog_of_sync_blocks();
 
-                void process_block_during_sync(peer_connection *originating_peer, const golos::network::block_message &block_message, const message_hash_type &message_hash);
+                void process_block_during_sync(peer_connection *originating_peer, golos::network::block_message block_message, const message_hash_type &message_hash);
 
-                void process_block_during_normal_operation(peer_connection *originating_peer, const golos::network::block_message &block_message, const message_hash_type &message_hash);
+                void process_block_during_normal_operation(peer_connection *originating_peer, const golos::network::block_message &block_message, const shared_message_ptr &received_message, const message_hash_type &message_hash);
 
-                void process_block_message(peer_connection *originating_peer, const message &message_to_process, const message_hash_type &message_hash);
+                void process_block_message(peer_connection *originating_peer, const shared_message_ptr &message_to_process, const message_hash_type &message_hash);
 
-                void process_ordinary_message(peer_connection *originating_peer, const message &message_to_process, const message_hash_type &message_hash);
+                void on_compact_block_message(peer_connection *originating_peer,
+                        const compact_block_message &compact_block_message_received);
+
+                void on_fetch_compact_block_transactions_message(peer_connection *originating_peer,
+                        const fetch_compact_block_transactions_message &fetch_compact_block_transactions_message_received);
+
+                void on_compact_block_transactions_message(peer_connection *originating_peer,
+                        const compact_block_transactions_message &compact_block_transactions_message_received);
+
+                void process_compact_block(peer_connection *originating_peer, const block_id_type &block_id);
+
+                void process_ordinary_message(peer_connection *originating_peer, const shared_message_ptr &message_to_process, const message_hash_type &message_hash);
 
                 void start_synchronizing();
 
@@ -797,6 +942,9 @@ namespace golos {
 
                 void broadcast(const message &item_to_broadcast, const message_propagation_data &propagation_data);
 
+                void broadcast(const shared_message_ptr &item_to_broadcast, const message_hash_type &hash_of_item_to_broadcast,
+                        const fc::uint160_t &hash_of_message_contents, const message_propagation_data &propagation_data);
+
                 void broadcast(const message &item_to_broadcast);
 
                 void sync_from(const item_id &current_head_block, const std::vector<uint32_t> &hard_fork_block_numbers);
@@ -825,12 +973,14 @@ namespace golos {
 
                 fc::variant_object get_call_statistics() const;
 
-                message get_message_for_item(const item_id &item) override;
+                shared_message_ptr get_message_for_item(const item_id &item) override;
 
                 fc::variant_object network_get_info() const;
 
                 fc::variant_object network_get_usage_stats() const;
 
+                message_cache_stats get_message_cache_stats() const;
+
                 bool is_hard_fork_block(uint32_t block_number) const;
 
                 uint32_t get_next_known_hard_fork_block_number(uint32_t block_number) const;
@@ -899,7 +1049,9 @@ namespace golos {
                     _node_is_shutting_down(false),
                     _maximum_number_of_blocks_to_handle_at_one_time(MAXIMUM_NUMBER_OF_BLOCKS_TO_HANDLE_AT_ONE_TIME),
                     _maximum_number_of_sync_blocks_to_prefetch(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH),
-                    _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING) {
+                    _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING),
+                    _sync_reorder_window(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH),
+                    _compact_block_relay(true) {
                 _rate_limiter.set_actual_rate_time_constant(fc::seconds(2));
                 fc::rand_pseudo_bytes(&_node_id.data[0], (int)_node_id.size());
             }
@@ -1056,14 +1208,7 @@ namespace golos {
 
             bool node_impl::have_already_received_sync_item(const item_hash_t &item_hash) {
                 VERIFY_CORRECT_THREAD();
-                return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                        [&item_hash](const golos::network::block_message &message) {
-                            return message.block_id == item_hash;
-                        }) != _received_sync_items.end() ||
-                       std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                               [&item_hash](const golos::network::block_message &message) {
-                                   return message.block_id == item_hash;
-                               }) != _new_received_sync_items.end();;
+                return _received_sync_items.find(item_hash) != _received_sync_items.end();
             }
 
             void node_impl::request_sync_item_from_peer(const peer_connection_ptr &peer, const item_hash_t &item_to_request) {
@@ -1090,6 +1235,13 @@ namespace golos {
                 peer->send_message(fetch_items_message(golos::network::block_message_type, items_to_request));
             }
 
+            bool node_impl::can_request_sync_items_from_peer(const peer_connection_ptr &peer) {
+                VERIFY_CORRECT_THREAD();
+                return peer->items_requested_from_peer.empty() &&
+                       !peer->item_ids_requested_from_peer &&
+                       peer->sync_items_requested_from_peer.size() <= _maximum_blocks_per_peer_during_syncing / 2;
+            }
+
             void node_impl::fetch_sync_items_loop() {
                 VERIFY_CORRECT_THREAD();
                 while (!_fetch_sync_items_loop_done.canceled()) {
@@ -1103,18 +1255,31 @@ namespace golos {
                             ASSERT_TASK_NOT_PREEMPTED();
                             std::set<item_hash_t> sync_items_to_request;
 
-                            // for each idle peer that we're syncing with
+                            // for each peer that we're syncing with, which has received at least a half of requested blocks,
+                            // so requests are pipelined and the peer doesn't wait for the next request after each batch
                             for (const peer_connection_ptr &peer : _active_connections) {
                                 if (peer->we_need_sync_items_from_peer &&
                                     sync_item_requests_to_send.find(peer) ==
                                     sync_item_requests_to_send.end() &&
                                     // if we've already scheduled a request for this peer, don't consider scheduling another
-                                    peer->idle()) {
-                                    if (!peer->inhibit_fetching_sync_blocks) {
+                                    can_request_sync_items_from_peer(peer)) {
+                                    if (!peer->inhibit_fetching_sync_blocks && !peer->ids_of_items_to_get.empty()) {
+                                        // peers get disjoint ranges of blocks, which are limited by the reorder window
+                                        // from the next block to apply, so buffered out-of-order blocks are bounded
+                                        uint32_t last_block_num_in_window =
+                                            golos::protocol::block_header::num_from_id(peer->ids_of_items_to_get.front()) +
+                                            _sync_reorder_window;
+                                        auto items_to_request =
+                                            _maximum_blocks_per_peer_during_syncing - peer->sync_items_requested_from_peer.size();
+
                                         // loop through the items it has that we don't yet have on our blockchain
                                         for (unsigned i = 0; i <
                                                              peer->ids_of_items_to_get.size(); ++i) {
                                             item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
+                                            if (golos::protocol::block_header::num_from_id(item_to_potentially_request) >
+                                                last_block_num_in_window) {
+                                                break;
+                                            }
                                             // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
                                             if (!have_already_received_sync_item(item_to_potentially_request) &&
                                                 // already got it, but for some reson it's still in our list of items to fetch
@@ -1127,8 +1292,7 @@ namespace golos {
                                                 // then schedule a request from this peer
                                                 sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
                                                 sync_items_to_request.insert(item_to_potentially_request);
-                                                if (sync_item_requests_to_send[peer].size() >=
-                                                    _maximum_blocks_per_peer_during_syncing) {
+                                                if (sync_item_requests_to_send[peer].size() >= items_to_request) {
                                                         break;
                                                 }
                                             }
@@ -1881,8 +2045,9 @@ namespace golos {
                 }
             }
 
-            void node_impl::on_message(peer_connection *originating_peer, const message &received_message) {
+            void node_impl::on_message(peer_connection *originating_peer, const shared_message_ptr &received_message_ptr) {
                 VERIFY_CORRECT_THREAD();
+                const message &received_message = *received_message_ptr;
                 message_hash_type message_hash = received_message.id();
                 dlog("handling message ${type} ${hash} size ${size} from peer ${endpoint}",
                         ("type", golos::network::core_message_type_enum(received_message.msg_type))("hash", message_hash)
@@ -1923,7 +2088,7 @@ namespace golos {
                         on_closing_connection_message(originating_peer, received_message.as<closing_connection_message>());
                         break;
                     case core_message_type_enum::block_message_type:
-                        process_block_message(originating_peer, received_message, message_hash);
+                        process_block_message(originating_peer, received_message_ptr, message_hash);
                         break;
                     case core_message_type_enum::current_time_request_message_type:
                         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
@@ -1943,6 +2108,15 @@ namespace golos {
                     case core_message_type_enum::get_current_connections_reply_message_type:
                         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
                         break;
+                    case core_message_type_enum::compact_block_message_type:
+                        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+                        break;
+                    case core_message_type_enum::fetch_compact_block_transactions_message_type:
+                        on_fetch_compact_block_transactions_message(originating_peer, received_message.as<fetch_compact_block_transactions_message>());
+                        break;
+                    case core_message_type_enum::compact_block_transactions_message_type:
+                        on_compact_block_transactions_message(originating_peer, received_message.as<compact_block_transactions_message>());
+                        break;
 
                     default:
                         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1951,7 +2125,7 @@ namespace golos {
                             core_message_type_enum::core_message_type_first ||
                             received_message.msg_type >
                             core_message_type_enum::core_message_type_last) {
-                                process_ordinary_message(originating_peer, received_message, message_hash);
+                                process_ordinary_message(originating_peer, received_message_ptr, message_hash);
                         }
                         break;
                 }
@@ -2813,18 +2987,21 @@ namespace golos {
                 }
             }
 
-            message node_impl::get_message_for_item(const item_id &item) {
-                try {
-                    return _message_cache.get_message(item.item_hash);
+            shared_message_ptr node_impl::get_message_for_item(const item_id &item) {
+                const auto *cached = _message_cache.find_message(item.item_hash);
+                if (!cached && item.item_type == block_message_type) {
+                    // blocks are sent by their ids, relayed ones are in the cache as they were received
+                    cached = _message_cache.find_message_by_contents(item.item_hash);
                 }
-                catch (fc::key_not_found_exception &) {
+                if (cached && cached->message_body->msg_type == item.item_type) {
+                    return cached->message_body;
                 }
                 try {
-                    return _delegate->get_item(item);
+                    return std::make_shared<message>(_delegate->get_item(item));
                 }
                 catch (fc::key_not_found_exception &) {
                 }
-                return item_not_available_message(item);
+                return std::make_shared<message>(item_not_available_message(item));
             }
 
             void node_impl::on_fetch_items_message(peer_connection *originating_peer, const fetch_items_message &fetch_items_message_received) {
@@ -2834,59 +3011,68 @@ namespace golos {
                                 ("type", fetch_items_message_received.item_type)
                                 ("endpoint", originating_peer->get_remote_endpoint()));
 
-                fc::optional<message> last_block_message_sent;
+                fc::optional<item_hash_t> last_block_id_sent;
 
-                std::list<message> reply_messages;
+                // blocks from the message cache are recently relayed ones, so the peer likely has their transactions
+                bool send_compact_blocks = _compact_block_relay &&
+                        originating_peer->core_protocol_version >= GRAPHENE_NET_COMPACT_BLOCKS_PROTOCOL_VERSION;
+
+                // replies with ids of blocks, which are sent by the ids from the message cache
+                std::list<std::pair<shared_message_ptr, item_hash_t>> reply_messages;
                 for (const item_hash_t &item_hash : fetch_items_message_received.items_to_fetch) {
-                    try {
-                        message requested_message = _message_cache.get_message(item_hash);
+                    const auto *cached = _message_cache.find_message(item_hash);
+                    if (cached) {
                         dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                                 ("endpoint", originating_peer->get_remote_endpoint())
-                                        ("id", requested_message.id()));
-                        reply_messages.push_back(requested_message);
-                        if (fetch_items_message_received.item_type ==
-                            block_message_type) {
-                                last_block_message_sent = requested_message;
+                                        ("id", item_hash));
+                        if (cached->message_body->msg_type == block_message_type) {
+                            last_block_id_sent = cached->message_contents_hash;
+                            if (send_compact_blocks) {
+                                reply_messages.emplace_back(std::make_shared<message>(make_compact_block_message(
+                                        cached->message_body->as<golos::network::block_message>().block,
+                                        cached->message_contents_hash, item_hash)), item_hash_t());
+                                continue;
+                            }
                         }
+                        reply_messages.emplace_back(cached->message_body, cached->message_contents_hash);
                         continue;
                     }
-                    catch (fc::key_not_found_exception &) {
-                        // it wasn't in our local cache, that's ok ask the client
-                    }
+                    // it wasn't in our local cache, that's ok ask the client
 
                     item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
                     try {
-                        message requested_message = _delegate->get_item(item_to_fetch);
+                        auto requested_message = std::make_shared<message>(_delegate->get_item(item_to_fetch));
                         dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-                                ("id", requested_message.id())
-                                        ("size", requested_message.size)
+                                ("id", requested_message->id())
+                                        ("size", requested_message->size)
                                         ("endpoint", originating_peer->get_remote_endpoint()));
-                        reply_messages.push_back(requested_message);
+                        item_hash_t block_id;
                         if (fetch_items_message_received.item_type ==
                             block_message_type) {
-                                last_block_message_sent = requested_message;
+                                block_id = requested_message->as<golos::network::block_message>().block_id;
+                                last_block_id_sent = block_id;
                         }
+                        reply_messages.emplace_back(std::move(requested_message), block_id);
                         continue;
                     }
                     catch (fc::key_not_found_exception &) {
-                        reply_messages.push_back(item_not_available_message(item_to_fetch));
+                        reply_messages.emplace_back(std::make_shared<message>(item_not_available_message(item_to_fetch)), item_hash_t());
                         dlog("received item request from peer ${endpoint} but we don't have it",
                                 ("endpoint", originating_peer->get_remote_endpoint()));
                     }
                 }
 
                 // if we sent them a block, update our record of the last block they've seen accordingly
-                if (last_block_message_sent) {
-                    golos::network::block_message block = last_block_message_sent->as<golos::network::block_message>();
-                    originating_peer->last_block_delegate_has_seen = block.block_id;
-                    originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+                if (last_block_id_sent) {
+                    originating_peer->last_block_delegate_has_seen = *last_block_id_sent;
+                    originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(*last_block_id_sent);
                 }
 
-                for (const message &reply : reply_messages) {
-                    if (reply.msg_type == block_message_type) {
-                        originating_peer->send_item(item_id(block_message_type, reply.as<golos::network::block_message>().block_id));
+                for (const auto &reply : reply_messages) {
+                    if (reply.first->msg_type == block_message_type) {
+                        originating_peer->send_item(item_id(block_message_type, reply.second));
                     } else {
-                        originating_peer->send_message(reply);
+                        originating_peer->send_message(reply.first);
                     }
                 }
             }
@@ -3331,54 +3517,54 @@ namespace golos {
                 std::map<peer_connection_ptr, fc::oexception> peers_with_rejected_block;
 
                 do {
-                    std::copy(std::make_move_iterator(_new_received_sync_items.begin()),
-                            std::make_move_iterator(_new_received_sync_items.end()),
-                            std::front_inserter(_received_sync_items));
-                    _new_received_sync_items.clear();
                     dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
 
                     block_processed_this_iteration = false;
-                    for (auto received_block_iter = _received_sync_items.begin();
-                         received_block_iter != _received_sync_items.end();
-                         ++received_block_iter) {
+                    // the next block on the active chain or one of the forks is the first item of some sync peer,
+                    // so blocks are fed to the client strictly in order, whatever order they are received in
+                    auto received_block_iter = _received_sync_items.end();
+                    for (const peer_connection_ptr &peer : _active_connections) {
+                        ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+                        if (!peer->ids_of_items_to_get.empty()) {
+                            received_block_iter = _received_sync_items.find(peer->ids_of_items_to_get.front());
+                            if (received_block_iter != _received_sync_items.end()) {
+                                break;
+                            }
+                        }
+                    }
 
-                        // find out if this block is the next block on the active chain or one of the forks
-                        bool potential_first_block = false;
+                    if (received_block_iter != _received_sync_items.end()) {
+                        // remove it from all sync peers lists
                         for (const peer_connection_ptr &peer : _active_connections) {
                             ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
                             if (!peer->ids_of_items_to_get.empty() &&
                                 peer->ids_of_items_to_get.front() ==
-                                received_block_iter->block_id) {
-                                potential_first_block = true;
+                                received_block_iter->first) {
                                 peer->ids_of_items_to_get.pop_front();
-                                peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+                                peer->ids_of_items_being_processed.insert(received_block_iter->first);
                             }
                         }
 
-                        // if it is, process it, remove it from all sync peers lists
-                        if (potential_first_block) {
-                            // we can get into an interesting situation near the end of synchronization.  We can be in
-                            // sync with one peer who is sending us the last block on the chain via a regular inventory
-                            // message, while at the same time still be synchronizing with a peer who is sending us the
-                            // block through the sync mechanism.  Further, we must request both blocks because
-                            // we don't know they're the same (for the peer in normal operation, it has only told us the
-                            // message id, for the peer in the sync case we only known the block_id).
-                            if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
-                                    received_block_iter->block_id) ==
-                                _most_recent_blocks_accepted.end()) {
-                                golos::network::block_message block_message_to_process = *received_block_iter;
-                                _received_sync_items.erase(received_block_iter);
-                                _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process]() {
-                                    send_sync_block_to_node_delegate(block_message_to_process);
-                                }, "send_sync_block_to_node_delegate"));
-                                ++blocks_processed;
-                                block_processed_this_iteration = true;
-                            } else
-                                dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
-
-                            break; // start iterating _received_sync_items from the beginning
-                        } // end if potential_first_block
-                    } // end for each block in _received_sync_items
+                        // we can get into an interesting situation near the end of synchronization.  We can be in
+                        // sync with one peer who is sending us the last block on the chain via a regular inventory
+                        // message, while at the same time still be synchronizing with a peer who is sending us the
+                        // block through the sync mechanism.  Further, we must request both blocks because
+                        // we don't know they're the same (for the peer in normal operation, it has only told us the
+                        // message id, for the peer in the sync case we only known the block_id).
+                        golos::network::block_message block_message_to_process = std::move(received_block_iter->second);
+                        _received_sync_items.erase(received_block_iter);
+                        if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                                block_message_to_process.block_id) ==
+                            _most_recent_blocks_accepted.end()) {
+                            _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process]() {
+                                send_sync_block_to_node_delegate(block_message_to_process);
+                            }, "send_sync_block_to_node_delegate"));
+                            ++blocks_processed;
+                        } else
+                            dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
+
+                        block_processed_this_iteration = true;
+                    }
 
                     if (_handle_message_calls_in_progress.size() >=
                         _maximum_number_of_blocks_to_handle_at_one_time) {
@@ -3410,18 +3596,20 @@ namespace golos {
             }
 
             void node_impl::process_block_during_sync(peer_connection *originating_peer,
-                    const golos::network::block_message &block_message_to_process, const message_hash_type &message_hash) {
+                    golos::network::block_message block_message_to_process, const message_hash_type &message_hash) {
                 VERIFY_CORRECT_THREAD();
                 dlog("received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint()));
 
-                // add it to the front of _received_sync_items, then process _received_sync_items to try to
+                // add it to the reorder buffer, then process _received_sync_items to try to
                 // pass as many messages as possible to the client.
-                _new_received_sync_items.push_front(block_message_to_process);
+                auto block_id = block_message_to_process.block_id;
+                _received_sync_items.emplace(block_id, std::move(block_message_to_process));
                 trigger_process_backlog_of_sync_blocks();
             }
 
             void node_impl::process_block_during_normal_operation(peer_connection *originating_peer,
                     const golos::network::block_message &block_message_to_process,
+                    const shared_message_ptr &received_message,
                     const message_hash_type &message_hash) {
                 fc::time_point message_receive_time = fc::time_point::now();
 
@@ -3507,7 +3695,8 @@ namespace golos {
                             message_receive_time, message_validated_time,
                             originating_peer->node_id
                     };
-                    broadcast(block_message_to_process, propagation_data);
+                    // relay the block as it was received without packing of it again
+                    broadcast(received_message, message_hash, block_message_to_process.block_id, propagation_data);
                     _message_cache.block_accepted();
 
                     if (is_hard_fork_block(block_number)) {
@@ -3576,19 +3765,19 @@ namespace golos {
             }
 
             void node_impl::process_block_message(peer_connection *originating_peer,
-                    const message &message_to_process,
+                    const shared_message_ptr &message_to_process,
                     const message_hash_type &message_hash) {
                 VERIFY_CORRECT_THREAD();
                 // find out whether we requested this item while we were synchronizing or during normal operation
                 // (it's possible that we request an item during normal operation and then get kicked into sync
                 // mode before we receive and process the item.  In that case, we should process the item as a normal
                 // item to avoid confusing the sync code)
-                golos::network::block_message block_message_to_process(message_to_process.as<golos::network::block_message>());
+                golos::network::block_message block_message_to_process(message_to_process->as<golos::network::block_message>());
                 auto item_iter = originating_peer->items_requested_from_peer.find(item_id(golos::network::block_message_type, message_hash));
                 if (item_iter !=
                     originating_peer->items_requested_from_peer.end()) {
                     originating_peer->items_requested_from_peer.erase(item_iter);
-                    process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
+                    process_block_during_normal_operation(originating_peer, block_message_to_process, message_to_process, message_hash);
                     if (originating_peer->idle()) {
                         trigger_fetch_items_loop();
                     }
@@ -3601,7 +3790,7 @@ namespace golos {
                         originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
                         originating_peer->last_sync_item_received_time = fc::time_point::now();
                         _active_sync_requests.erase(block_message_to_process.block_id);
-                        process_block_during_sync(originating_peer, block_message_to_process, message_hash);
+                        process_block_during_sync(originating_peer, std::move(block_message_to_process), message_hash);
                         if (originating_peer->idle()) {
                             // we have finished fetching a batch of items, so we either need to grab another batch of items
                             // or we need to get another list of item ids.
@@ -3613,6 +3802,10 @@ namespace golos {
                             } else {
                                     trigger_fetch_sync_items_loop();
                             }
+                        } else if (originating_peer->sync_items_requested_from_peer.size() ==
+                                   _maximum_blocks_per_peer_during_syncing / 2) {
+                            // a half of the batch is received, request the next one while the peer sends the rest
+                            trigger_fetch_sync_items_loop();
                         }
                         return;
                     }
@@ -3897,6 +4090,153 @@ namespace golos {
                 VERIFY_CORRECT_THREAD();
             }
 
+            void node_impl::on_compact_block_message(peer_connection *originating_peer,
+                    const compact_block_message &compact_block_message_received) {
+                VERIFY_CORRECT_THREAD();
+                const auto &block_id = compact_block_message_received.block_id;
+                if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, compact_block_message_received.item_hash)) ==
+                    originating_peer->items_requested_from_peer.end() &&
+                    originating_peer->sync_items_requested_from_peer.find(block_id) ==
+                    originating_peer->sync_items_requested_from_peer.end()) {
+                        wlog("received a compact block ${id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+                                ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true,
+                                fc::exception(FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for",
+                                        ("block_id", block_id))));
+                        return;
+                }
+
+                dlog("received compact block ${id} with ${count} transactions from peer ${endpoint}",
+                        ("id", block_id)("count", compact_block_message_received.short_ids.size())
+                                ("endpoint", originating_peer->get_remote_endpoint()));
+                originating_peer->compact_blocks_in_progress[block_id] = partial_compact_block(compact_block_message_received,
+                        [this](short_transaction_id_type short_id) {
+                            fc::optional<signed_transaction> result;
+                            const auto *cached = _message_cache.find_transaction_by_short_id(short_id);
+                            if (cached) {
+                                result = cached->message_body->as<trx_message>().trx;
+                            }
+                            return result;
+                        });
+                process_compact_block(originating_peer, block_id);
+            }
+
+            void node_impl::on_fetch_compact_block_transactions_message(peer_connection *originating_peer,
+                    const fetch_compact_block_transactions_message &fetch_compact_block_transactions_message_received) {
+                VERIFY_CORRECT_THREAD();
+                const auto &block_id = fetch_compact_block_transactions_message_received.block_id;
+                compact_block_transactions_message reply;
+                reply.block_id = block_id;
+                try {
+                    const auto *cached = _message_cache.find_message_by_contents(block_id);
+                    if (cached && cached->message_body->msg_type == block_message_type) {
+                        reply = make_compact_block_transactions_message(
+                                cached->message_body->as<golos::network::block_message>().block,
+                                fetch_compact_block_transactions_message_received);
+                    } else {
+                        reply = make_compact_block_transactions_message(
+                                _delegate->get_item(item_id(block_message_type, block_id)).as<golos::network::block_message>().block,
+                                fetch_compact_block_transactions_message_received);
+                    }
+                    dlog("sending ${count} transactions of compact block ${id} to peer ${endpoint}",
+                            ("count", reply.transactions.size())("id", block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                } catch (const fc::key_not_found_exception &) {
+                    dlog("peer ${endpoint} requested transactions of block ${id} which I don't have",
+                            ("endpoint", originating_peer->get_remote_endpoint())("id", block_id));
+                } catch (const fc::assert_exception &) {
+                    dlog("peer ${endpoint} requested transactions which aren't in block ${id}",
+                            ("endpoint", originating_peer->get_remote_endpoint())("id", block_id));
+                }
+                originating_peer->send_message(message(reply));
+            }
+
+            void node_impl::on_compact_block_transactions_message(peer_connection *originating_peer,
+                    const compact_block_transactions_message &compact_block_transactions_message_received) {
+                VERIFY_CORRECT_THREAD();
+                const auto &block_id = compact_block_transactions_message_received.block_id;
+                auto iter = originating_peer->compact_blocks_in_progress.find(block_id);
+                if (iter == originating_peer->compact_blocks_in_progress.end()) {
+                    dlog("received transactions of compact block ${id} I'm not waiting for from peer ${endpoint}",
+                            ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                    return;
+                }
+
+                if (compact_block_transactions_message_received.indexes.empty()) {
+                    // the peer doesn't have the block anymore, treat it as it is not available
+                    item_id requested_item(block_message_type, iter->second.compact_block().item_hash);
+                    if (originating_peer->items_requested_from_peer.find(requested_item) ==
+                        originating_peer->items_requested_from_peer.end()) {
+                            requested_item.item_hash = block_id;
+                    }
+                    originating_peer->compact_blocks_in_progress.erase(iter);
+                    on_item_not_available_message(originating_peer, item_not_available_message(requested_item));
+                    return;
+                }
+
+                if (!iter->second.add_transactions(compact_block_transactions_message_received)) {
+                    originating_peer->compact_blocks_in_progress.erase(iter);
+                    wlog("received transactions which don't match compact block ${id} from peer ${endpoint}, disconnecting from peer",
+                            ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                    disconnect_from_peer(originating_peer, "You sent me transactions which don't match the compact block", true,
+                            fc::exception(FC_LOG_MESSAGE(error, "You sent me transactions which don't match the compact block",
+                                    ("block_id", block_id))));
+                    return;
+                }
+                process_compact_block(originating_peer, block_id);
+            }
+
+            // requests missing transactions of the compact block, or processes it as a block when all of them are known
+            void node_impl::process_compact_block(peer_connection *originating_peer, const block_id_type &block_id) {
+                VERIFY_CORRECT_THREAD();
+                auto iter = originating_peer->compact_blocks_in_progress.find(block_id);
+                if (iter == originating_peer->compact_blocks_in_progress.end()) {
+                    return;
+                }
+                auto &partial_block = iter->second;
+
+                auto missing_indexes = partial_block.missing_indexes();
+                if (!missing_indexes.empty()) {
+                    dlog("requesting ${count} missing transactions of compact block ${id} from peer ${endpoint}",
+                            ("count", missing_indexes.size())("id", block_id)
+                                    ("endpoint", originating_peer->get_remote_endpoint()));
+                    originating_peer->send_message(message(fetch_compact_block_transactions_message(block_id, std::move(missing_indexes))));
+                    return;
+                }
+
+                auto block = partial_block.build_block();
+                if (!block) {
+                    // some known transaction has the same id but other signatures, so request all of them
+                    if (partial_block.drop_known_transactions()) {
+                        dlog("compact block ${id} doesn't match known transactions, requesting all of them from peer ${endpoint}",
+                                ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                        originating_peer->send_message(message(fetch_compact_block_transactions_message(block_id, partial_block.missing_indexes())));
+                        return;
+                    }
+                    originating_peer->compact_blocks_in_progress.erase(iter);
+                    wlog("compact block ${id} from peer ${endpoint} doesn't match its header, disconnecting from peer",
+                            ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                    disconnect_from_peer(originating_peer, "You sent me a compact block which doesn't match its header", true,
+                            fc::exception(FC_LOG_MESSAGE(error, "You sent me a compact block which doesn't match its header",
+                                    ("block_id", block_id))));
+                    return;
+                }
+
+                message_hash_type item_hash = partial_block.compact_block().item_hash;
+                originating_peer->compact_blocks_in_progress.erase(iter);
+
+                auto block_message_ptr = std::make_shared<message>(golos::network::block_message(*block));
+                if (block_message_ptr->id() != item_hash) {
+                    wlog("compact block ${id} from peer ${endpoint} doesn't match the requested item, disconnecting from peer",
+                            ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+                    disconnect_from_peer(originating_peer, "You sent me a compact block which doesn't match the requested item", true,
+                            fc::exception(FC_LOG_MESSAGE(error, "You sent me a compact block which doesn't match the requested item",
+                                    ("block_id", block_id)("item_hash", item_hash))));
+                    return;
+                }
+                process_block_message(originating_peer, block_message_ptr, item_hash);
+            }
+
 
             // this handles any message we get that doesn't require any special processing.
             // currently, this is any message other than block messages and p2p-specific
@@ -3904,8 +4244,9 @@ namespace golos {
             // this just passes the message to the client, and does the bookkeeping
             // related to requesting and rebroadcasting the message.
             void node_impl::process_ordinary_message(peer_connection *originating_peer,
-                    const message &message_to_process, const message_hash_type &message_hash) {
+                    const shared_message_ptr &message_to_process_ptr, const message_hash_type &message_hash) {
                 VERIFY_CORRECT_THREAD();
+                const message &message_to_process = *message_to_process_ptr;
                 fc::time_point message_receive_time = fc::time_point::now();
 
                 // only process it if we asked for it
@@ -3925,10 +4266,12 @@ namespace golos {
 
                     // Next: have the delegate process the message
                     fc::time_point message_validated_time;
+                    fc::uint160_t hash_of_message_contents;
                     try {
                         if (message_to_process.msg_type == trx_message_type) {
                             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
-                            dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
+                            hash_of_message_contents = transaction_message_to_process.trx.id();
+                            dlog("passing message containing transaction ${trx} to client", ("trx", hash_of_message_contents));
                             _delegate->handle_transaction(transaction_message_to_process);
                         } else {
                             _delegate->handle_message(message_to_process);
@@ -3950,7 +4293,7 @@ namespace golos {
                             message_receive_time, message_validated_time,
                             originating_peer->node_id
                     };
-                    broadcast(message_to_process, propagation_data);
+                    broadcast(message_to_process_ptr, message_hash, hash_of_message_contents, propagation_data);
                 }
             }
 
@@ -4734,10 +5077,9 @@ namespace golos {
                 ilog("--------- MEMORY USAGE ------------");
                 ilog("node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size()));
                 ilog("node._received_sync_items size: ${size}", ("size", _received_sync_items.size()));
-                ilog("node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size()));
                 ilog("node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size()));
                 ilog("node._new_inventory size: ${size}", ("size", _new_inventory.size()));
-                ilog("node._message_cache size: ${size}", ("size", _message_cache.size()));
+                ilog("node._message_cache: ${stats}", ("stats", _message_cache.get_stats()));
                 for (const peer_connection_ptr &peer : _active_connections) {
                     ilog("  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint()));
                     ilog("    peer.ids_of_items_to_get size: ${size}", ("size", peer->ids_of_items_to_get.size()));
@@ -4909,8 +5251,7 @@ namespace golos {
                 if (item_to_broadcast.msg_type ==
                     golos::network::block_message_type) {
                     golos::network::block_message block_message_to_broadcast = item_to_broadcast.as<golos::network::block_message>();
-                    hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-                    _most_recent_blocks_accepted.push_back(block_message_to_broadcast.block_id);
+                    hash_of_message_contents = block_message_to_broadcast.block_id;
                 } else if (item_to_broadcast.msg_type ==
                            golos::network::trx_message_type) {
                     golos::network::trx_message transaction_message_to_broadcast = item_to_broadcast.as<golos::network::trx_message>();
@@ -4919,8 +5260,19 @@ namespace golos {
                 }
                 message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
+                broadcast(std::make_shared<message>(item_to_broadcast), hash_of_item_to_broadcast,
+                        hash_of_message_contents, propagation_data);
+            }
+
+            void node_impl::broadcast(const shared_message_ptr &item_to_broadcast, const message_hash_type &hash_of_item_to_broadcast,
+                    const fc::uint160_t &hash_of_message_contents, const message_propagation_data &propagation_data) {
+                VERIFY_CORRECT_THREAD();
+                if (item_to_broadcast->msg_type ==
+                    golos::network::block_message_type) {
+                    _most_recent_blocks_accepted.push_back(hash_of_message_contents);
+                }
                 _message_cache.cache_message(item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents);
-                _new_inventory.insert(item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast));
+                _new_inventory.insert(item_id(item_to_broadcast->msg_type, hash_of_item_to_broadcast));
                 trigger_advertise_inventory_loop();
             }
 
@@ -4978,6 +5330,15 @@ namespace golos {
                 if (params.contains("maximum_blocks_per_peer_during_syncing")) {
                     _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>();
                 }
+                if (params.contains("sync_reorder_window")) {
+                    _sync_reorder_window = params["sync_reorder_window"].as<uint32_t>();
+                }
+                if (params.contains("compact_block_relay")) {
+                    _compact_block_relay = params["compact_block_relay"].as<bool>();
+                }
+                if (params.contains("message_cache_max_bytes")) {
+                    _message_cache.set_max_size_in_bytes(params["message_cache_max_bytes"].as<uint64_t>());
+                }
 
                 _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -4998,6 +5359,9 @@ namespace golos {
                 result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
                 result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
                 result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+                result["sync_reorder_window"] = _sync_reorder_window;
+                result["compact_block_relay"] = _compact_block_relay;
+                result["message_cache_max_bytes"] = _message_cache.get_stats().max_size_in_bytes;
                 return result;
             }
 
@@ -5064,9 +5428,15 @@ namespace golos {
                 info["node_public_key"] = _node_public_key;
                 info["node_id"] = _node_id;
                 info["firewalled"] = _is_firewalled;
+                info["message_cache"] = _message_cache.get_stats();
                 return info;
             }
 
+            message_cache_stats node_impl::get_message_cache_stats() const {
+                VERIFY_CORRECT_THREAD();
+                return _message_cache.get_stats();
+            }
+
             fc::variant_object node_impl::network_get_usage_stats() const {
                 VERIFY_CORRECT_THREAD();
                 std::vector<uint32_t> network_usage_by_second;
@@ -5243,6 +5613,10 @@ namespace golos {
             INVOKE_IN_IMPL(network_get_usage_stats);
         }
 
+        message_cache_stats node::get_message_cache_stats() const {
+            INVOKE_IN_IMPL(get_message_cache_stats);
+        }
+
         void node::close() {
             INVOKE_IN_IMPL(close);
         }
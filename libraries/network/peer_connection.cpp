@@ -38,15 +38,15 @@
 
 namespace golos {
     namespace network {
-        message peer_connection::real_queued_message::get_message(peer_connection_delegate *) {
+        shared_message_ptr peer_connection::real_queued_message::get_message(peer_connection_delegate *) {
             if (message_send_time_field_offset != (size_t)-1) {
                 // patch the current time into the message.  Since this operates on the packed version of the structure,
                 // it won't work for anything after a variable-length field
                 std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
                 assert(message_send_time_field_offset +
                        packed_current_time.size() <=
-                       message_to_send.data.size());
-                memcpy(message_to_send.data.data() +
+                       message_to_send->data.size());
+                memcpy(message_to_send->data.data() +
                        message_send_time_field_offset,
                         packed_current_time.data(), packed_current_time.size());
             }
@@ -54,10 +54,18 @@ namespace golos {
         }
 
         size_t peer_connection::real_queued_message::get_size_in_queue() {
-            return message_to_send.data.size();
+            return message_to_send->data.size();
         }
 
-        message peer_connection::virtual_queued_message::get_message(peer_connection_delegate *node) {
+        shared_message_ptr peer_connection::shared_queued_message::get_message(peer_connection_delegate *) {
+            return message_to_send;
+        }
+
+        size_t peer_connection::shared_queued_message::get_size_in_queue() {
+            return message_to_send->data.size();
+        }
+
+        shared_message_ptr peer_connection::virtual_queued_message::get_message(peer_connection_delegate *node) {
             return node->get_message_for_item(item_to_send);
         }
 
@@ -241,7 +249,7 @@ namespace golos {
             }
         } // connect_to()
 
-        void peer_connection::on_message(message_oriented_connection *originating_connection, const message &received_message) {
+        void peer_connection::on_message(message_oriented_connection *originating_connection, const shared_message_ptr &received_message) {
             VERIFY_CORRECT_THREAD();
             _node->on_message(this, received_message);
         }
@@ -271,12 +279,12 @@ namespace golos {
 #endif
             while (!_queued_messages.empty()) {
                 _queued_messages.front()->transmission_start_time = fc::time_point::now();
-                message message_to_send = _queued_messages.front()->get_message(_node);
+                shared_message_ptr message_to_send = _queued_messages.front()->get_message(_node);
                 try {
                     //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
                     //     "to send message of type ${type} for peer ${endpoint}",
                     //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-                    _message_connection.send_message(message_to_send);
+                    _message_connection.send_message(*message_to_send);
                     //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
                     //     ("endpoint", get_remote_endpoint()));
                 }
@@ -345,6 +353,12 @@ namespace golos {
             send_queueable_message(std::move(message_to_enqueue));
         }
 
+        void peer_connection::send_message(const shared_message_ptr &message_to_send) {
+            VERIFY_CORRECT_THREAD();
+            std::unique_ptr<queued_message> message_to_enqueue(new shared_queued_message(message_to_send));
+            send_queueable_message(std::move(message_to_enqueue));
+        }
+
         void peer_connection::send_item(const item_id &item_to_send) {
             VERIFY_CORRECT_THREAD();
             //dlog("peer_connection::send_item() enqueueing message of type ${type} for peer ${endpoint}",
@@ -37,8 +37,7 @@ namespace golos {
         stcp_socket::stcp_socket()
 //:_buf_len(0)
 #ifndef NDEBUG
-                : _read_buffer_in_use(false),
-                  _write_buffer_in_use(false)
+                : _write_buffer_in_use(false)
 #endif
         {
         }
@@ -77,46 +76,21 @@ namespace golos {
 
 /**
  *   This method must read at least 16 bytes at a time from
- *   the underlying TCP socket so that it can decrypt them. It
- *   will buffer any left-over.
+ *   the underlying TCP socket so that it can decrypt them.
+ *   Ciphertext is read straight into the buffer and is decrypted
+ *   in place, so a large message is read and decrypted by a few big
+ *   batches instead of copying of it through a small intermediate buffer.
  */
         size_t stcp_socket::readsome(char *buffer, size_t len) {
             try {
                 assert(len > 0 && (len % 16) == 0);
 
-#ifndef NDEBUG
-                // This code was written with the assumption that you'd only be making one call to readsome
-                // at a time so it reuses _read_buffer.  If you really need to make concurrent calls to
-                // readsome(), you'll need to prevent reusing _read_buffer here
-                struct check_buffer_in_use {
-                    bool &_buffer_in_use;
-
-                    check_buffer_in_use(bool &buffer_in_use)
-                            : _buffer_in_use(buffer_in_use) {
-                        assert(!_buffer_in_use);
-                        _buffer_in_use = true;
-                    }
-
-                    ~check_buffer_in_use() {
-                        assert(_buffer_in_use);
-                        _buffer_in_use = false;
-                    }
-                } buffer_in_use_checker(_read_buffer_in_use);
-#endif
-
-                const size_t read_buffer_length = 4096;
-                if (!_read_buffer) {
-                    _read_buffer.reset(new char[read_buffer_length], [](char *p) { delete[] p; });
-                }
-
-                len = std::min<size_t>(read_buffer_length, len);
-
-                size_t s = _sock.readsome(_read_buffer, len, 0);
+                size_t s = _sock.readsome(buffer, len);
                 if (s % 16) {
-                    _sock.read(_read_buffer, 16 - (s % 16), s);
+                    _sock.read(buffer + s, 16 - (s % 16));
                     s += 16 - (s % 16);
                 }
-                _recv_aes.decode(_read_buffer.get(), s, buffer);
+                _recv_aes.decode(buffer, s, buffer);
                 return s;
             } FC_RETHROW_EXCEPTIONS(warn, "", ("len", len))
         }
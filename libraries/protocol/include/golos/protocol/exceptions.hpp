@@ -387,6 +387,9 @@ namespace golos {
             wrong_position_marker_was_read,
             append_index_file_at_wrong_position,
             reading_data_beyond_end_of_file,
+            unknown_file_format,
+            decompression_failed,
+            checksum_mismatch,
         };
     };
 
@@ -654,4 +657,7 @@ FC_REFLECT_ENUM(golos::database_corrupted::error_types,
         (wrong_position_marker_was_read)
         (append_index_file_at_wrong_position)
         (reading_data_beyond_end_of_file)
+        (unknown_file_format)
+        (decompression_failed)
+        (checksum_mismatch)
 );
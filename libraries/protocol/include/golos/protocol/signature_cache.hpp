@@ -0,0 +1,85 @@
+#pragma once
+
+#include <golos/protocol/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+#include <atomic>
+#include <mutex>
+
+namespace golos { namespace protocol {
+
+    struct signature_cache_stats {
+        uint64_t size = 0;
+        uint64_t max_size = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    /**
+     * Cache of public keys recovered from transaction signatures.
+     *
+     * The same transaction is recovered when it is received from p2p or api, when it is included to a block,
+     * and when a block is generated. A recovered key depends only on the signature and the signed digest,
+     * so items are shared by all threads and database instances. Items live until the transaction expiration.
+     */
+    class signature_cache final {
+    public:
+        static signature_cache& instance();
+
+        /// @param max_size maximum number of cached keys, 0 disables the cache
+        void set_max_size(std::size_t max_size);
+
+        bool is_enabled() const {
+            return _max_size != 0;
+        }
+
+        /// @return recovered key for the signature, or recover it and put into the cache
+        public_key_type get_key(const digest_type& digest, const signature_type& signature, fc::time_point_sec expiration);
+
+        void remove_expired(fc::time_point_sec now);
+
+        signature_cache_stats get_stats() const;
+
+    private:
+        struct item {
+            digest_type digest;
+            signature_type signature;
+            public_key_type key;
+            fc::time_point_sec expiration;
+        };
+
+        struct by_signature;
+        struct by_expiration;
+
+        using item_index = boost::multi_index_container<
+            item,
+            boost::multi_index::indexed_by<
+                boost::multi_index::hashed_unique<
+                    boost::multi_index::tag<by_signature>,
+                    boost::multi_index::composite_key<
+                        item,
+                        boost::multi_index::member<item, digest_type, &item::digest>,
+                        boost::multi_index::member<item, signature_type, &item::signature>>,
+                    boost::multi_index::composite_key_hash<
+                        std::hash<digest_type>,
+                        std::hash<signature_type>>>,
+                boost::multi_index::ordered_non_unique<
+                    boost::multi_index::tag<by_expiration>,
+                    boost::multi_index::member<item, fc::time_point_sec, &item::expiration>>>>;
+
+        std::atomic<std::size_t> _max_size{0};
+        mutable std::mutex _mutex;
+        item_index _items;
+
+        std::atomic<uint64_t> _hits{0};
+        std::atomic<uint64_t> _misses{0};
+    };
+
+} } // golos::protocol
+
+FC_REFLECT((golos::protocol::signature_cache_stats), (size)(max_size)(hits)(misses))
@@ -0,0 +1,77 @@
+#include <golos/protocol/signature_cache.hpp>
+
+namespace golos { namespace protocol {
+
+    signature_cache& signature_cache::instance() {
+        static signature_cache cache;
+        return cache;
+    }
+
+    void signature_cache::set_max_size(std::size_t max_size) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _max_size = max_size;
+
+        auto& idx = _items.get<by_expiration>();
+        while (_items.size() > max_size) {
+            idx.erase(idx.begin());
+        }
+    }
+
+    public_key_type signature_cache::get_key(
+        const digest_type& digest, const signature_type& signature, fc::time_point_sec expiration
+    ) {
+        if (!is_enabled()) {
+            return fc::ecc::public_key(signature, digest);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& idx = _items.get<by_signature>();
+            auto itr = idx.find(boost::make_tuple(digest, signature));
+            if (itr != idx.end()) {
+                ++_hits;
+                return itr->key;
+            }
+        }
+
+        // recover without lock, it is the most expensive part
+        ++_misses;
+        public_key_type key = fc::ecc::public_key(signature, digest);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_max_size == 0) {
+            return key;
+        }
+
+        auto& idx = _items.get<by_expiration>();
+        while (_items.size() >= _max_size) {
+            idx.erase(idx.begin());
+        }
+        _items.insert(item{digest, signature, key, expiration});
+
+        return key;
+    }
+
+    void signature_cache::remove_expired(fc::time_point_sec now) {
+        if (!is_enabled()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& idx = _items.get<by_expiration>();
+        idx.erase(idx.begin(), idx.lower_bound(now));
+    }
+
+    signature_cache_stats signature_cache::get_stats() const {
+        signature_cache_stats stats;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            stats.size = _items.size();
+        }
+        stats.max_size = _max_size;
+        stats.hits = _hits;
+        stats.misses = _misses;
+        return stats;
+    }
+
+} } // golos::protocol
@@ -1,6 +1,7 @@
 
 #include <golos/protocol/transaction.hpp>
 #include <golos/protocol/exceptions.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -238,10 +239,11 @@ namespace golos {
         flat_set<public_key_type> signed_transaction::get_signature_keys(const chain_id_type &chain_id) const {
             try {
                 auto d = sig_digest(chain_id);
+                auto& cache = signature_cache::instance();
                 flat_set<public_key_type> result;
                 for (const auto &sig : signatures) {
                     GOLOS_ASSERT(
-                        result.insert(fc::ecc::public_key(sig, d)).second,
+                        result.insert(cache.get_key(d, sig, expiration)).second,
                         tx_duplicate_sig,
                         "Duplicate Signature detected");
                 }
@@ -3,6 +3,10 @@
 #include <golos/chain/account_object.hpp>
 #include <golos/chain/index.hpp>
 #include <golos/chain/operation_notification.hpp>
+#include <golos/chain/state_snapshot.hpp>
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::account_by_key::key_lookup_object,
+    (key)(account))
 
 namespace golos { namespace plugins { namespace account_by_key {
 
@@ -264,6 +268,7 @@ namespace golos { namespace plugins { namespace account_by_key {
                     db.post_apply_operation.connect([&](const operation_notification &o) { my->post_operation(o); });
 
                     add_plugin_index<key_lookup_index>(db);
+                    add_plugin_snapshot_index<key_lookup_index>(db, "key_lookup_index");
                     JSON_RPC_REGISTER_API ( name() ) ;
                 }
                 FC_CAPTURE_AND_RETHROW()
@@ -1,5 +1,6 @@
 #include <golos/chain/database.hpp>
 #include <golos/chain/operation_notification.hpp>
+#include <golos/chain/state_snapshot.hpp>
 #include <golos/protocol/exceptions.hpp>
 #include <golos/plugins/account_history/plugin.hpp>
 #include <golos/plugins/account_history/history_object.hpp>
@@ -44,18 +45,24 @@ if (options.count(name)) { \
         }
     };
 
+    using golos::plugins::operation_history::account_operation_filter;
     using golos::plugins::operation_history::donate_meta;
+    using golos::plugins::operation_history::history_store;
+    using golos::plugins::operation_history::stored_account_operation;
+    using golos::plugins::operation_history::stored_operation_positions;
 
     struct operation_visitor final {
         operation_visitor(
             golos::chain::database& db,
             const golos::chain::operation_notification& op_note,
             std::string op_account,
-            operation_direction dir)
+            operation_direction dir,
+            const history_store* store)
             : db(db),
               note(op_note),
               account(op_account),
-              dir(dir) {
+              dir(dir),
+              store(store) {
         }
 
         using result_type = void;
@@ -64,6 +71,7 @@ if (options.count(name)) { \
         const golos::chain::operation_notification& note;
         std::string account;
         operation_direction dir;
+        const history_store* store;
 
         void write_operation(std::string json_metadata = "{}") const {
             const auto& idx = db.get_index<account_history_index>().indices().get<by_account>();
@@ -73,6 +81,10 @@ if (options.count(name)) { \
             if (itr != idx.end() && itr->account == account) {
                 sequence = itr->sequence + 1;
             }
+            if (store) {
+                // older operations of the account can be moved to the history store
+                sequence = std::max(sequence, store->account_operations_count(account));
+            }
 
             db.create<account_history_object>([&](account_history_object& history) {
                 history.block = note.block;
@@ -110,18 +122,33 @@ if (options.count(name)) { \
 
         ~plugin_impl() = default;
 
+        // removes history of old irreversible blocks once per history-prune-interval blocks
         void erase_old_blocks() {
-            uint32_t head_block = db.head_block_num();
-            if (history_blocks <= head_block) {
-                uint32_t need_block = head_block - history_blocks;
-                const auto& idx = db.get_index<account_history_index>().indices().get<by_location>();
-                auto it = idx.begin();
-                while (it != idx.end() && it->block <= need_block) {
-                    auto next_it = it;
-                    ++next_it;
-                    db.remove(*it);
-                    it = next_it;
-                }
+            const uint32_t head_block = db.head_block_num();
+            if (history_blocks > head_block) {
+                return;
+            }
+            uint32_t need_block = std::min(head_block - history_blocks, db.last_non_undoable_block_num());
+            if (store) {
+                // objects leave for the store with operations of their blocks, unstored ones wait for that
+                need_block = std::min(need_block, store->head_block());
+            }
+            if (need_block < last_pruned_block + prune_interval) {
+                return;
+            }
+
+            const auto start = fc::time_point::now();
+            const auto removed = db.remove_irreversible<account_history_index, by_location>(
+                [&](const account_history_object& obj) {
+                    return obj.block <= need_block;
+                });
+            last_pruned_block = need_block;
+            pruned_objects += removed;
+
+            if (removed) {
+                dlog("account_history: pruned ${n} objects up to block ${b} in ${t} ms, ${total} in total",
+                    ("n", removed)("b", need_block)("t", (fc::time_point::now() - start).count() / 1000)
+                    ("total", pruned_objects));
             }
         }
 
@@ -138,22 +165,89 @@ if (options.count(name)) { \
                 if (!tracked_accounts.size() ||
                     (itr != tracked_accounts.end() && itr->first <= item.first && item.first <= itr->second)
                 ) {
-                    note.op.visit(operation_visitor(db, note, item.first, item.second));
+                    note.op.visit(operation_visitor(db, note, item.first, item.second, store));
+                }
+            }
+        }
+
+        void on_stored_block(uint32_t block_num, const stored_operation_positions& positions) {
+            const auto& idx = db.get_index<account_history_index>().indices().get<by_location>();
+            // objects of previous blocks can be restored by the undo of a block, they are already in the store
+            for (auto itr = idx.begin(); itr != idx.end() && itr->block <= block_num;) {
+                const auto& obj = *itr;
+                ++itr;
+                auto pos = positions.find(obj.op._id);
+                if (obj.block == block_num && pos != positions.end()) {
+                    stored_account_operation op;
+                    op.sequence = obj.sequence;
+                    op.op_tag = obj.op_tag;
+                    op.dir = obj.dir;
+                    op.op_pos = pos->second;
+                    op.json_metadata = to_string(obj.json_metadata);
+                    store->append_account_operation(obj.account, op);
                 }
+                db.remove(obj);
             }
         }
 
         ///////////////////////////////////////////////////////
         // API
+
+        // adds older operations from the history store, until the result contains limit + 1 operations
+        void fetch_stored(
+            const std::string& account, uint32_t from, uint32_t limit, history_operations& result,
+            const account_operation_filter* filter = nullptr
+        ) {
+            if (!store || result.size() > limit) {
+                return;
+            }
+
+            std::vector<stored_account_operation> ops;
+            auto visitor = [&](const stored_account_operation& op) {
+                if (!result.count(op.sequence)) {
+                    ops.push_back(op);
+                }
+                return result.size() + ops.size() <= limit;
+            };
+            if (filter) {
+                store->walk_account_history(account, from, *filter, visitor);
+            } else {
+                store->walk_account_history(account, from, visitor);
+            }
+
+            for (auto& op: ops) {
+                auto& item = result[op.sequence];
+                item = store->get_operation(op.op_pos);
+                item.json_metadata = std::move(op.json_metadata);
+            }
+        }
+
+        // history of blocks out of history-blocks is dropped from results before its objects are pruned
+        void erase_expired(history_operations& result) const {
+            const uint32_t head_block = db.head_block_num();
+            if (history_blocks > head_block) {
+                return;
+            }
+            // sequences of the account grow with blocks, so the expired operations are the first ones
+            auto itr = result.begin();
+            while (itr != result.end() && itr->second.block <= head_block - history_blocks) {
+                itr = result.erase(itr);
+            }
+        }
+
         history_operations fetch_unfiltered(string account, uint32_t from, uint32_t limit) {
             history_operations result;
             const auto& idx = db.get_index<account_history_index>().indices().get<by_account>();
             auto itr = idx.lower_bound(std::make_tuple(account, from));
-            auto end = idx.upper_bound(std::make_tuple(account, std::max(int64_t(0), int64_t(itr->sequence) - limit)));
-            for (; itr != end; ++itr) {
-                result[itr->sequence] = db.get(itr->op);
-                result[itr->sequence].json_metadata = to_string(itr->json_metadata);
+            if (itr != idx.end() && itr->account == account) {
+                auto end = idx.upper_bound(std::make_tuple(account, std::max(int64_t(0), int64_t(itr->sequence) - limit)));
+                for (; itr != end; ++itr) {
+                    result[itr->sequence] = db.get(itr->op);
+                    result[itr->sequence].json_metadata = to_string(itr->json_metadata);
+                }
             }
+            fetch_stored(account, from, limit, result);
+            erase_expired(result);
             return result;
         }
 
@@ -256,6 +350,20 @@ if (options.count(name)) { \
                 if (next.itr != end && next.itr->op_tag == o && next.itr->dir == d)
                     itrs.push(next);
             }
+            if (store) {
+                account_operation_filter filter;
+                for (const auto o: select_ops) {
+                    for (auto d: {operation_direction::sender, operation_direction::receiver, operation_direction::dual}) {
+                        if (dir == operation_direction::any || d == dir ||
+                            (d == operation_direction::dual && (dir == sender || dir == receiver))
+                        ) {
+                            filter.accept(uint8_t(o), d);
+                        }
+                    }
+                }
+                fetch_stored(account, from, limit, result, &filter);
+            }
+            erase_expired(result);
             return result;
         }
 
@@ -264,6 +372,10 @@ if (options.count(name)) { \
         fc::flat_map<std::string, std::string> tracked_accounts;
         golos::chain::database& db;
         uint32_t history_blocks = UINT32_MAX;
+        uint32_t prune_interval = 1;
+        uint32_t last_pruned_block = 0;
+        uint64_t pruned_objects = 0;
+        history_store* store = nullptr;
     };
 
     static plugin::plugin_impl* myimpl;
@@ -659,6 +771,8 @@ if (options.count(name)) { \
         if (options.count("history-blocks")) {
             uint32_t history_blocks = options.at("history-blocks").as<uint32_t>();
             pimpl->history_blocks = history_blocks;
+            // the option is declared and checked by the operation_history plugin, which is initialized first
+            pimpl->prune_interval = options.at("history-prune-interval").as<uint32_t>();
             pimpl->db.applied_block.connect([&](const signed_block& block){
                 pimpl->erase_old_blocks();
             });
@@ -673,6 +787,16 @@ if (options.count(name)) { \
         });
 
         add_plugin_index<account_history_index>(pimpl->db);
+        // history starts from the block of a loaded snapshot
+        add_plugin_empty_snapshot_index<account_history_index>(pimpl->db, "account_history_index");
+
+        auto& oh_plugin = appbase::app().get_plugin<operation_history::plugin>();
+        pimpl->store = oh_plugin.store();
+        if (pimpl->store) {
+            oh_plugin.stored_block.connect([&](uint32_t block_num, const stored_operation_positions& positions) {
+                pimpl->on_stored_block(block_num, positions);
+            });
+        }
 
         using pairstring = std::pair<std::string, std::string>;
         fc::flat_map<std::string, std::string> ranges;
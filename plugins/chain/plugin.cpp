@@ -4,12 +4,16 @@
 #include <golos/chain/worker_objects.hpp>
 #include <golos/protocol/protocol.hpp>
 #include <golos/protocol/types.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/string.hpp>
 
+#include <condition_variable>
 #include <iostream>
 #include <future>
+#include <mutex>
+#include <thread>
 
 namespace golos { namespace plugins { namespace chain {
 
@@ -54,12 +58,43 @@ namespace golos { namespace plugins { namespace chain {
 
         uint32_t block_num_check_free_size = 0;
 
+        uint32_t replay_pipeline_size = 0;
+
+        uint32_t signature_recovery_threads = 0;
+
+        uint32_t signature_cache_size = 0;
+
+        uint32_t block_log_chunk_cache_size = 0;
+
+        bool profile_operations = false;
+        uint32_t profile_dump_interval = 0;
+
+        bfs::path snapshot_dir;
+        uint32_t snapshot_at_block = 0;
+        uint32_t snapshot_threads = 1;
+        bool create_snapshot = false;
+        bfs::path load_snapshot_dir;
+
+        bool read_epoch_mode = false;
+        bool lock_wait_metrics = false;
+
         bool skip_virtual_ops = false;
 
         golos::chain::database db;
 
         bool single_write_thread = false;
 
+        bool checkpoint_bulk_sync = false;
+        uint32_t bulk_sync_batch_size = 100;
+        uint32_t bulk_sync_buffer_size = 10000;
+        std::thread bulk_sync_thread;
+        std::mutex bulk_sync_mutex;
+        std::condition_variable bulk_sync_cond;
+        bool bulk_sync_stopped = false;
+        uint64_t bulk_synced_blocks = 0;   ///< number of blocks written to the block log by bulk sync
+        uint64_t bulk_replayed_blocks = 0; ///< value of bulk_synced_blocks when the state caught up the block log
+        bool bulk_sync_failed = false;     ///< a block of the block log can't be applied, the node should be replayed
+
         golos::chain::database::store_metadata_modes store_account_metadata;
         std::vector<std::string> accounts_to_store_metadata;
         bool store_asset_metadata = true;
@@ -92,10 +127,16 @@ namespace golos { namespace plugins { namespace chain {
         void check_time_in_block(const protocol::signed_block& block);
         bool accept_block(const protocol::signed_block& block, bool currently_syncing, uint32_t skip);
         void accept_transaction(const protocol::signed_transaction& trx);
+        bool bulk_sync_block(const protocol::signed_block& block);
+        bool replay_bulk_synced_blocks();
+        void start_bulk_sync();
+        void stop_bulk_sync();
         void wipe_db(const bfs::path& data_dir, bool wipe_block_log);
         void replay_db(const bfs::path& data_dir, bool force_replay);
 
         void on_block (const protocol::signed_block& b);
+        void on_snapshot_block(const protocol::signed_block& b);
+        void write_snapshot();
         void transit_to_cyberway();
         void start_transit_to_cyberway(uint32_t, uint32_t);
     };
@@ -116,6 +157,30 @@ namespace golos { namespace plugins { namespace chain {
         }
     }
 
+    void plugin::impl::on_snapshot_block(const protocol::signed_block& b) {
+        if (b.block_num() != snapshot_at_block) {
+            return;
+        }
+
+        // only blocks from the block log are irreversible on applying
+        auto head_block_log = db.get_block_log().head();
+        if (!head_block_log || head_block_log->block_num() < snapshot_at_block) {
+            wlog("Block ${n} is reversible, skipping snapshot of state. Replay blockchain to write it.",
+                ("n", snapshot_at_block));
+            return;
+        }
+        write_snapshot();
+    }
+
+    void plugin::impl::write_snapshot() {
+        try {
+            fc::create_directories(snapshot_dir);
+            db.write_snapshot(snapshot_dir, snapshot_threads);
+        } catch (const fc::exception& e) {
+            elog("Failed to write snapshot of state: ${e}", ("e", e.to_detail_string()));
+        }
+    }
+
     void plugin::impl::start_transit_to_cyberway(uint32_t n, uint32_t skip) {
         if (!serialize_state || db._fixed_irreversible_block_num != UINT32_MAX) {
             return;
@@ -172,8 +237,14 @@ namespace golos { namespace plugins { namespace chain {
 
         check_time_in_block(block);
 
+        if (checkpoint_bulk_sync && bulk_sync_block(block)) {
+            return false;
+        }
+
         skip = db.validate_block(block, skip);
 
+        db.recover_signature_keys(block, skip);
+
         if (single_write_thread) {
             std::promise<bool> promise;
             auto result = promise.get_future();
@@ -210,12 +281,102 @@ namespace golos { namespace plugins { namespace chain {
             wipe_db(data_dir, false);
         }
 
-        auto from_block_num = force_replay ? 1 : db.head_block_num() + 1;
+        // after wipe the state starts from the genesis or from the loaded snapshot
+        auto from_block_num = db.head_block_num() + 1;
 
         ilog("Replaying blockchain from block num ${from}.", ("from", from_block_num));
         db.reindex(data_dir, shared_memory_dir, from_block_num, shared_memory_size);
     };
 
+    bool plugin::impl::bulk_sync_block(const protocol::signed_block& block) {
+        {
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            FC_ASSERT(!bulk_sync_failed, "Bulk synced blocks can't be applied, replay the blockchain");
+        }
+
+        if (db.bulk_sync_block(block)) {
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            ++bulk_synced_blocks;
+            bulk_sync_cond.notify_one();
+            return true;
+        }
+
+        // the block is after the last checkpoint, so the state should catch up the block log before pushing,
+        //   it is compared with the block log, because blocks can be written before a restart
+        while (db.apply_bulk_synced_blocks(bulk_sync_batch_size));
+        return false;
+    }
+
+    bool plugin::impl::replay_bulk_synced_blocks() {
+        uint64_t synced_blocks;
+        {
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            if (bulk_synced_blocks == bulk_replayed_blocks) {
+                return false;
+            }
+            synced_blocks = bulk_synced_blocks;
+        }
+
+        uint32_t applied = 0;
+        try {
+            applied = db.apply_bulk_synced_blocks(bulk_sync_batch_size);
+        } catch (...) {
+            // blocks are written only after the checkpoint confirms them, so the next try fails too
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            bulk_replayed_blocks = synced_blocks;
+            bulk_sync_failed = true;
+            throw;
+        }
+
+        if (!applied) {
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            bulk_replayed_blocks = synced_blocks;
+        }
+        return applied != 0;
+    }
+
+    void plugin::impl::start_bulk_sync() {
+        bulk_sync_thread = std::thread([this]() {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(bulk_sync_mutex);
+                    bulk_sync_cond.wait(lock, [this]() {
+                        return bulk_sync_stopped || bulk_synced_blocks != bulk_replayed_blocks;
+                    });
+                    if (bulk_sync_stopped) {
+                        return;
+                    }
+                }
+
+                try {
+                    replay_bulk_synced_blocks();
+                    continue;
+                } catch (const fc::exception& e) {
+                    elog("Error on applying of bulk synced blocks: ${e}", ("e", e.to_detail_string()));
+                } catch (const std::exception& e) {
+                    elog("Error on applying of bulk synced blocks: ${e}", ("e", e.what()));
+                }
+
+                // the block log contains a block, which can't be applied to the state, so retries don't help
+                elog("Bulk synced blocks can't be applied, replay the blockchain. Stopping...");
+                appbase::app().quit();
+                return;
+            }
+        });
+    }
+
+    void plugin::impl::stop_bulk_sync() {
+        if (!bulk_sync_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(bulk_sync_mutex);
+            bulk_sync_stopped = true;
+            bulk_sync_cond.notify_one();
+        }
+        bulk_sync_thread.join();
+    }
+
     void plugin::impl::accept_transaction(const protocol::signed_transaction& trx) {
         uint32_t skip = db.validate_transaction(trx, db.skip_apply_transaction);
 
@@ -268,9 +429,52 @@ namespace golos { namespace plugins { namespace chain {
             ) (
                 "block-num-check-free-size", bpo::value<uint32_t>()->default_value(1000),
                 "Check free space in shared memory each N blocks. Default: 1000 (each 3000 seconds)."
+            ) (
+                "replay-pipeline-size", bpo::value<uint32_t>()->default_value(0),
+                "Number of blocks which are read and prepared by separate threads ahead of applying on replay. "
+                "Default: 0 (pipelined replay is disabled)."
+            ) (
+                "signature-recovery-threads", bpo::value<uint32_t>()->default_value(0),
+                "Number of threads to recover public keys from signatures of incoming blocks before applying. "
+                "Default: 0 (keys are recovered on applying of the block)."
+            ) (
+                "signature-cache-size", bpo::value<uint32_t>()->default_value(65536),
+                "Maximum number of public keys recovered from transaction signatures which are kept until "
+                "transaction expiration to skip the repeated recovery. Default: 65536 (0 disables the cache)."
+            ) (
+                "block-log-chunk-cache-size", bpo::value<uint32_t>()->default_value(16),
+                "Number of decompressed chunks of the compressed block log which are kept in memory. Default: 16."
+            ) (
+                "profile-operations", bpo::value<bool>()->default_value(false),
+                "Profile operation evaluators and phases of block applying (see debug_node.debug_get_profile). "
+                "Default: false."
+            ) (
+                "profile-dump-interval", bpo::value<uint32_t>()->default_value(100000),
+                "Write the profile to the log each N blocks on replay. Default: 100000 (0 disables it)."
+            ) (
+                "snapshot-dir", bpo::value<bfs::path>()->default_value("snapshots"),
+                "the location of state snapshots (absolute path or relative to application data dir)"
+            ) (
+                "snapshot-at-block", bpo::value<uint32_t>()->default_value(0),
+                "Write a snapshot of state when the block is applied from the block log, e.g. on replay. "
+                "Default: 0 (disabled)."
+            ) (
+                "snapshot-threads", bpo::value<uint32_t>()->default_value(4),
+                "Number of threads to write indexes of state snapshots and to verify chunks on loading. Default: 4."
             ) (
                 "checkpoint", bpo::value<std::vector<std::string>>()->composing(),
                 "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints."
+            ) (
+                "checkpoint-bulk-sync", bpo::value<bool>()->default_value(false),
+                "Write received blocks up to the last checkpoint straight to the block log, "
+                "and apply them by a separate thread in parallel with downloading. Default: false."
+            ) (
+                "checkpoint-bulk-sync-batch", bpo::value<uint32_t>()->default_value(100),
+                "Number of bulk synced blocks which are applied under one write lock. Default: 100."
+            ) (
+                "checkpoint-bulk-sync-buffer", bpo::value<uint32_t>()->default_value(10000),
+                "Maximum number of bulk synced blocks kept in memory until the block of their checkpoint is received. "
+                "Blocks farther from the next checkpoint are pushed as usual. Default: 10000."
             ) (
                 "flush-state-interval", bpo::value<uint32_t>(),
                 "flush shared memory changes to disk every N blocks"
@@ -280,6 +484,12 @@ namespace golos { namespace plugins { namespace chain {
             ) (
                 "max-read-wait-retries", bpo::value<uint32_t>(),
                 "maximum number of retries to get read lock"
+            ) (
+                "read-epoch-mode", bpo::value<bool>()->default_value(false),
+                "new readers wait for a pushed block, and the block waits only for readers which came before it"
+            ) (
+                "lock-wait-metrics", bpo::value<bool>()->default_value(false),
+                "collect wait time of database locks per API method (see database_api.get_database_info)"
             ) (
                 "write-wait-micro", bpo::value<uint64_t>(),
                 "maximum microseconds for trying to get write lock"
@@ -340,6 +550,12 @@ namespace golos { namespace plugins { namespace chain {
             ) (
                 "resync-blockchain", bpo::bool_switch()->default_value(false),
                 "clear chain database and block log"
+            ) (
+                "create-snapshot", bpo::bool_switch()->default_value(false),
+                "write a snapshot of the irreversible state on startup to snapshot-dir"
+            ) (
+                "load-snapshot", bpo::value<bfs::path>(),
+                "clear chain database and load state from the snapshot directory, then replay the rest of block log"
             ) (
                 "check-locks", bpo::bool_switch()->default_value(false),
                 "Check correctness of chainbase locking"
@@ -385,6 +601,11 @@ namespace golos { namespace plugins { namespace chain {
 
         my->single_write_thread = options.at("single-write-thread").as<bool>();
 
+        my->checkpoint_bulk_sync = options.at("checkpoint-bulk-sync").as<bool>();
+        my->bulk_sync_batch_size = options.at("checkpoint-bulk-sync-batch").as<uint32_t>();
+        FC_ASSERT(my->bulk_sync_batch_size > 0, "checkpoint-bulk-sync-batch should be greater than 0");
+        my->bulk_sync_buffer_size = options.at("checkpoint-bulk-sync-buffer").as<uint32_t>();
+
         my->enable_plugins_on_push_transaction = options.at("enable-plugins-on-push-transaction").as<bool>();
 
         my->shared_memory_size = fc::parse_size(options.at("shared-file-size").as<std::string>());
@@ -398,6 +619,30 @@ namespace golos { namespace plugins { namespace chain {
             my->block_num_check_free_size = options.at("block-num-check-free-size").as<uint32_t>();
         }
 
+        my->replay_pipeline_size = options.at("replay-pipeline-size").as<uint32_t>();
+
+        my->signature_recovery_threads = options.at("signature-recovery-threads").as<uint32_t>();
+
+        my->signature_cache_size = options.at("signature-cache-size").as<uint32_t>();
+
+        my->block_log_chunk_cache_size = options.at("block-log-chunk-cache-size").as<uint32_t>();
+
+        my->profile_operations = options.at("profile-operations").as<bool>();
+        my->profile_dump_interval = options.at("profile-dump-interval").as<uint32_t>();
+
+        auto snapshot_dir = options.at("snapshot-dir").as<bfs::path>();
+        my->snapshot_dir = snapshot_dir.is_relative() ? appbase::app().data_dir() / snapshot_dir : snapshot_dir;
+        my->snapshot_at_block = options.at("snapshot-at-block").as<uint32_t>();
+        my->snapshot_threads = std::max<uint32_t>(options.at("snapshot-threads").as<uint32_t>(), 1);
+        my->create_snapshot = options.at("create-snapshot").as<bool>();
+        if (options.count("load-snapshot")) {
+            auto p = options.at("load-snapshot").as<bfs::path>();
+            my->load_snapshot_dir = p.is_relative() ? appbase::app().data_dir() / p : p;
+        }
+
+        my->read_epoch_mode = options.at("read-epoch-mode").as<bool>();
+        my->lock_wait_metrics = options.at("lock-wait-metrics").as<bool>();
+
         my->replay = options.at("replay-blockchain").as<bool>();
         my->replay_if_corrupted = options.at("replay-if-corrupted").as<bool>();
         my->force_replay = options.at("force-replay-blockchain").as<bool>();
@@ -471,12 +716,32 @@ namespace golos { namespace plugins { namespace chain {
             my->db.wipe(data_dir, my->shared_memory_dir, true);
         }
 
+        if (!my->load_snapshot_dir.empty()) {
+            wlog("loading of snapshot requested: deleting shared memory");
+            my->db.wipe(data_dir, my->shared_memory_dir, false);
+            my->db.set_snapshot_to_load(my->load_snapshot_dir, my->snapshot_threads);
+        }
+
+        // cached API responses are valid only for the head block
+        auto& rpc = appbase::app().get_plugin<json_rpc::plugin>();
+        my->db.applied_block.connect([&rpc](const protocol::signed_block& b) {
+            rpc.clear_cache(b.block_num());
+        });
+
+        if (my->snapshot_at_block) {
+            // connected after handlers of other plugins, so the snapshot contains their changes of the block
+            my->db.applied_block.connect([&](const protocol::signed_block& b) {
+                my->on_snapshot_block(b);
+            });
+        }
+
         my->db.set_flush_interval(my->flush_interval);
         my->db.add_checkpoints(my->loaded_checkpoints);
         my->db.set_require_locking(my->check_locks);
 
         my->db.set_read_wait_micro(my->read_wait_micro);
         my->db.set_max_read_wait_retries(my->max_read_wait_retries);
+        my->db.set_read_epoch_mode(my->read_epoch_mode);
         my->db.set_write_wait_micro(my->write_wait_micro);
         my->db.set_max_write_wait_retries(my->max_write_wait_retries);
 
@@ -504,9 +769,24 @@ namespace golos { namespace plugins { namespace chain {
 
         my->db.enable_plugins_on_push_transaction(my->enable_plugins_on_push_transaction);
 
+        my->db.set_replay_pipeline_size(my->replay_pipeline_size);
+
+        my->db.set_signature_recovery_threads(my->signature_recovery_threads);
+
+        golos::protocol::signature_cache::instance().set_max_size(my->signature_cache_size);
+
+        my->db.set_block_log_chunk_cache_size(my->block_log_chunk_cache_size);
+
+        my->db.set_bulk_sync_buffer_size(my->bulk_sync_buffer_size);
+
+        my->db.set_operation_profiling(my->profile_operations, my->profile_dump_interval);
+
+        my->db.set_lock_metrics(my->lock_wait_metrics);
+
         try {
             ilog("Opening shared memory from ${path}", ("path", my->shared_memory_dir.generic_string()));
             my->db.open(data_dir, my->shared_memory_dir, STEEMIT_INIT_SUPPLY, my->shared_memory_size, chainbase::database::read_write/*, my->validate_invariants*/);
+            // the state is behind the block log after a crash, e.g. during bulk sync, so it catches up the block log
             auto head_block_log = my->db.get_block_log().head();
             my->replay |= head_block_log && my->db.revision() != head_block_log->block_num();
 
@@ -545,10 +825,27 @@ namespace golos { namespace plugins { namespace chain {
         }
 
         ilog("Started on blockchain with ${n} blocks", ("n", my->db.head_block_num()));
+
+        if (my->checkpoint_bulk_sync) {
+            if (my->loaded_checkpoints.empty()) {
+                wlog("checkpoint-bulk-sync is enabled, but there are no checkpoints");
+            }
+            my->start_bulk_sync();
+        }
+
+        if (my->create_snapshot) {
+            // state on startup is irreversible: open() rewinds it to the last irreversible block
+            my->db.with_strong_read_lock([&]() {
+                my->write_snapshot();
+            });
+        }
+
         on_sync();
     }
 
     void plugin::plugin_shutdown() {
+        my->stop_bulk_sync();
+
         ilog("closing chain database");
         my->db.close();
         ilog("database closed successfully");
@@ -828,6 +828,12 @@ DEFINE_API(plugin, get_database_info) {
         info.index_list.push_back({(*it)->name(), (*it)->size()});
     }
 
+    info.signature_cache = signature_cache::instance().get_stats();
+
+    info.locks = db.get_lock_stats();
+
+    info.async_subscriptions = db.get_async_subscription_stats();
+
     return info;
 }
 
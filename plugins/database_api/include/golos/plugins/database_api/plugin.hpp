@@ -16,6 +16,7 @@
 #include <golos/plugins/database_api/api_objects/proposal_api_object.hpp>
 #include <golos/plugins/database_api/api_objects/asset_api_object.hpp>
 #include <golos/plugins/chain/plugin.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <golos/api/block_objects.hpp>
 #include <golos/api/chain_api_properties.hpp>
@@ -46,6 +47,12 @@ struct database_info {
     std::size_t used_size;
 
     std::vector<database_index_info> index_list;
+
+    signature_cache_stats signature_cache;
+
+    golos::chain::database_lock_stats locks;
+
+    std::vector<golos::chain::async_subscription_stats> async_subscriptions;
 };
 
 struct scheduled_hardfork {
@@ -337,4 +344,4 @@ FC_REFLECT((golos::plugins::database_api::tag_count_object), (tag)(count))
 FC_REFLECT((golos::plugins::database_api::get_tags_used_by_author), (tags))
 
 FC_REFLECT((golos::plugins::database_api::database_index_info), (name)(record_count))
-FC_REFLECT((golos::plugins::database_api::database_info), (total_size)(free_size)(reserved_size)(used_size)(index_list))
+FC_REFLECT((golos::plugins::database_api::database_info), (total_size)(free_size)(reserved_size)(used_size)(index_list)(signature_cache)(locks)(async_subscriptions))
@@ -22,6 +22,7 @@ namespace golos { namespace plugins { namespace debug_node {
 using golos::plugins::json_rpc::void_type;
 using golos::plugins::json_rpc::msg_pack;
 using golos::chain::witness_schedule_object;
+using golos::chain::profile_stats;
 
 // DEFINE API ARGS
 DEFINE_API_ARGS ( debug_generate_blocks,              msg_pack,   uint32_t                                      )
@@ -33,6 +34,8 @@ DEFINE_API_ARGS ( debug_get_witness_schedule,         msg_pack,   witness_schedu
 // DEFINE_API_ARGS ( debug_get_hardfork_property_object, msg_pack,   debug_get_hardfork_property_object_r  )
 DEFINE_API_ARGS ( debug_set_hardfork,                 msg_pack,   void_type                                     )
 DEFINE_API_ARGS ( debug_has_hardfork,                 msg_pack,   bool                                          );
+DEFINE_API_ARGS ( debug_get_profile,                  msg_pack,   profile_stats                                 )
+DEFINE_API_ARGS ( debug_reset_profile,                msg_pack,   void_type                                     )
 // 
 
 
@@ -88,6 +91,12 @@ public:
 
         (debug_set_hardfork)
         (debug_has_hardfork)
+
+        /**
+        * Get the profile of operation evaluators and phases of block applying (see profile-operations option)
+        */
+        (debug_get_profile)
+        (debug_reset_profile)
     )
 
     // golos::chain::database& database();
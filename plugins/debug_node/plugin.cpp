@@ -58,6 +58,10 @@ public:
 
     fc::optional< protocol::signed_block > debug_pop_block();
     witness_schedule_object debug_get_witness_schedule();
+
+    profile_stats debug_get_profile();
+
+    void debug_reset_profile();
     void debug_set_hardfork( uint32_t hardfork_id );
     bool debug_has_hardfork( uint32_t hardfork_id );
     //
@@ -347,28 +351,27 @@ uint32_t plugin::plugin_impl::debug_push_blocks(
         }
 
         for( uint32_t i=0; i<count; i++ ) {
-            //fc::optional< chain::signed_block > block = log.read_block( log.get_block_pos( first_block + i ) );
-            uint64_t block_pos = log.get_block_pos( first_block + i );
-            if( block_pos == golos::chain::block_log::npos ) {
-                wlog( "Block database ${fn} only contained ${i} of ${n} requested blocks", ("i", i)("n", count)("fn", src_filename) );
-                return i ;
-            }
-
-            decltype( log.read_block(0) ) result;
+            // read by number, old blocks can be in the compressed archive without positions
+            fc::optional< golos::chain::signed_block > result;
 
             try {
-                result = log.read_block( block_pos );
+                result = log.read_block_by_num( first_block + i );
             }
             catch( const fc::exception& e ) {
                 elog( "Could not read block ${i} of ${n}", ("i", i)("n", count) );
                 continue;
             }
 
+            if( !result.valid() ) {
+                wlog( "Block database ${fn} only contained ${i} of ${n} requested blocks", ("i", i)("n", count)("fn", src_filename) );
+                return i ;
+            }
+
             try{
-                database().push_block( result.first, skip_flags );
+                database().push_block( *result, skip_flags );
             }
             catch( const fc::exception& e ) {
-                elog( "Got exception pushing block ${bn} : ${bid} (${i} of ${n})", ("bn", result.first.block_num())("bid", result.first.id())("i", i)("n", count) );
+                elog( "Got exception pushing block ${bn} : ${bid} (${i} of ${n})", ("bn", result->block_num())("bid", result->id())("i", i)("n", count) );
                 elog( "Exception backtrace: ${bt}", ("bt", e.to_detail_string()) );
             }
         }
@@ -436,6 +439,22 @@ witness_schedule_object plugin::plugin_impl::debug_get_witness_schedule( ) {
     return db.get( golos::chain::witness_schedule_id_type() );
 }
 
+profile_stats plugin::plugin_impl::debug_get_profile() {
+    auto & db = database();
+    GOLOS_CHECK_OPTION(db.profiler(), "Profiling of operations is disabled, set profile-operations option");
+    return db.with_weak_read_lock([&]() {
+        return db.profiler()->get_stats();
+    });
+}
+
+void plugin::plugin_impl::debug_reset_profile() {
+    auto & db = database();
+    GOLOS_CHECK_OPTION(db.profiler(), "Profiling of operations is disabled, set profile-operations option");
+    db.with_weak_write_lock([&]() {
+        db.profiler()->reset();
+    });
+}
+
 // TODO: Figure out does debug_nod need this method or not.
 // Now it's commented because there is no api_hardfork_property_object in golos, as it is in steem.
 // The only similar thing we have: hardfork_property_object.
@@ -554,6 +573,15 @@ DEFINE_PLUGIN_API ( debug_set_hardfork ) {
     return void_type();
 }
 
+DEFINE_PLUGIN_API ( debug_get_profile ) {
+    return my->debug_get_profile();
+}
+
+DEFINE_PLUGIN_API ( debug_reset_profile ) {
+    my->debug_reset_profile();
+    return void_type();
+}
+
 DEFINE_PLUGIN_API ( debug_has_hardfork ) {
     PLUGIN_API_VALIDATE_ARGS(
         (uint32_t, hardfork_id)
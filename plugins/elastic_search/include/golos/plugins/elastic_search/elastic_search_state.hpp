@@ -140,8 +140,9 @@ public:
             doc["category"] = root_cmt.parent_permlink;
             doc["root_author"] = root_cmt.author;
             doc["root_permlink"] = to_string(root_cmt.permlink);
-            const auto* root_cnt = appbase::app().get_plugin<golos::plugins::social_network::social_network>().find_comment_content(root_cmt.id);
-            doc["root_title"] = root_cnt ? to_string(root_cnt->title) : "";
+            const auto& social_network = appbase::app().get_plugin<golos::plugins::social_network::social_network>();
+            const auto* root_cnt = social_network.find_comment_content(root_cmt.id);
+            doc["root_title"] = root_cnt ? social_network.get_comment_text(*root_cnt).title : "";
         }
         doc["depth"] = cmt.depth;
 
@@ -12,9 +12,28 @@
 #include <golos/plugins/json_rpc/plugin.hpp>
 #include <golos/plugins/json_rpc/api_helper.hpp>
 #include <golos/chain/index.hpp>
+#include <golos/chain/state_snapshot.hpp>
 #include <golos/api/discussion_helper.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::follow_object,
+    (follower)(following)(what))
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::feed_object,
+    (account)(reblogged_by)(first_reblogged_by)(first_reblogged_on)(comment)(reblogs)(account_feed_id))
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::blog_object,
+    (account)(comment)(reblogged_on)(blog_feed_id)(reblog_title)(reblog_body)(reblog_json_metadata))
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::reputation_object,
+    (account)(reputation))
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::follow_count_object,
+    (account)(follower_count)(following_count))
+
+GOLOS_SNAPSHOT_OBJECT(golos::plugins::follow::blog_author_stats_object,
+    (blogger)(guest)(count))
+
 namespace golos {
 
 template<>
@@ -429,6 +448,13 @@ namespace golos {
                     golos::chain::add_plugin_index<follow_count_index>(db);
                     golos::chain::add_plugin_index<blog_author_stats_index>(db);
 
+                    golos::chain::add_plugin_snapshot_index<follow_index>(db, "follow_index");
+                    golos::chain::add_plugin_snapshot_index<feed_index>(db, "feed_index");
+                    golos::chain::add_plugin_snapshot_index<blog_index>(db, "blog_index");
+                    golos::chain::add_plugin_snapshot_index<reputation_index>(db, "reputation_index");
+                    golos::chain::add_plugin_snapshot_index<follow_count_index>(db, "follow_count_index");
+                    golos::chain::add_plugin_snapshot_index<blog_author_stats_index>(db, "blog_author_stats_index");
+
                     if (options.count("follow-max-feed-size")) {
                         uint32_t feed_size = options["follow-max-feed-size"].as<uint32_t>();
                         pimpl->max_feed_size_ = feed_size;
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <golos/protocol/asset.hpp>
+#include <golos/protocol/types.hpp>
+#include <golos/protocol/version.hpp>
+#include <golos/protocol/uint128lh_t.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/fixed_string.hpp>
+#include <fc/optional.hpp>
+#include <fc/safe.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace golos { namespace plugins { namespace json_rpc {
+
+    /**
+     * Reflected types, which have own to_variant() and are serialized not as objects of their members.
+     * Values of such types are written through fc::variant.
+     */
+    template<typename T>
+    struct has_custom_variant: std::false_type {};
+
+    template<typename T>
+    struct has_custom_variant<fc::safe<T>>: std::true_type {};
+
+    template<>
+    struct has_custom_variant<fc::uint128lh_t>: std::true_type {};
+
+    template<>
+    struct has_custom_variant<golos::protocol::version>: std::true_type {};
+
+    template<>
+    struct has_custom_variant<golos::protocol::hardfork_version>: std::true_type {};
+
+    template<>
+    struct has_custom_variant<golos::protocol::extended_public_key_type>: std::true_type {};
+
+    template<>
+    struct has_custom_variant<golos::protocol::extended_private_key_type>: std::true_type {};
+
+    class json_writer;
+
+    template<typename T, typename Enable = void>
+    struct json_serializer;
+
+    /**
+     * Writer of JSON directly to a string buffer.
+     *
+     * Values are written by json_serializer, which walks FC_REFLECT members of structures without
+     * building of fc::variant. Output is the same as fc::json::to_string(fc::variant(value)):
+     * large integers are quoted, optional members without values are skipped. Types without own serializer
+     * (static variants, enums, times, hashes, doubles) are written through fc::variant.
+     */
+    class json_writer final {
+    public:
+        explicit json_writer(std::string& out): _out(out) {
+        }
+
+        template<typename T>
+        void write(const T& value) {
+            json_serializer<T>::write(*this, value);
+        }
+
+        void begin_object() {
+            separate();
+            _out.push_back('{');
+            _need_comma = false;
+        }
+
+        void end_object() {
+            _out.push_back('}');
+            _need_comma = true;
+        }
+
+        void begin_array() {
+            separate();
+            _out.push_back('[');
+            _need_comma = false;
+        }
+
+        void end_array() {
+            _out.push_back(']');
+            _need_comma = true;
+        }
+
+        void key(const char* name) {
+            separate();
+            write_escaped(name, std::strlen(name));
+            _out.push_back(':');
+            _need_comma = false;
+        }
+
+        void null_value() {
+            raw_value("null", 4);
+        }
+
+        void bool_value(bool value) {
+            if (value) {
+                raw_value("true", 4);
+            } else {
+                raw_value("false", 5);
+            }
+        }
+
+        void int64_value(int64_t value) {
+            separate();
+            if (value > int64_t(0xffffffff) || value < -int64_t(0xffffffff)) {
+                _out.push_back('"');
+                _out.append(std::to_string(value));
+                _out.push_back('"');
+            } else {
+                _out.append(std::to_string(value));
+            }
+            _need_comma = true;
+        }
+
+        void uint64_value(uint64_t value) {
+            separate();
+            if (value > 0xffffffff) {
+                _out.push_back('"');
+                _out.append(std::to_string(value));
+                _out.push_back('"');
+            } else {
+                _out.append(std::to_string(value));
+            }
+            _need_comma = true;
+        }
+
+        void string_value(const char* value, std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) {
+                // fc escapes control characters in its own way, leave them to it
+                if (static_cast<unsigned char>(value[i]) < 0x20) {
+                    variant_value(fc::variant(std::string(value, size)));
+                    return;
+                }
+            }
+            separate();
+            write_escaped(value, size);
+            _need_comma = true;
+        }
+
+        void string_value(const std::string& value) {
+            string_value(value.data(), value.size());
+        }
+
+        void variant_value(const fc::variant& value) {
+            raw_value(fc::json::to_string(value));
+        }
+
+        /// Writes already serialized JSON
+        void raw_value(const char* json, std::size_t size) {
+            separate();
+            _out.append(json, size);
+            _need_comma = true;
+        }
+
+        void raw_value(const std::string& json) {
+            raw_value(json.data(), json.size());
+        }
+
+    private:
+        void separate() {
+            if (_need_comma) {
+                _out.push_back(',');
+            }
+        }
+
+        void write_escaped(const char* value, std::size_t size) {
+            _out.push_back('"');
+            for (std::size_t i = 0; i < size; ++i) {
+                if (value[i] == '"' || value[i] == '\\') {
+                    _out.push_back('\\');
+                }
+                _out.push_back(value[i]);
+            }
+            _out.push_back('"');
+        }
+
+        std::string& _out;
+        bool _need_comma = false;
+    };
+
+    template<typename T>
+    struct json_member_visitor final {
+        json_writer& writer;
+        const T& object;
+
+        template<typename Member, class Class, Member (Class::*member)>
+        void operator()(const char* name) const {
+            add(name, object.*member);
+        }
+
+    private:
+        template<typename M>
+        void add(const char* name, const fc::optional<M>& value) const {
+            if (value.valid()) {
+                add(name, *value);
+            }
+        }
+
+        template<typename M>
+        void add(const char* name, const M& value) const {
+            writer.key(name);
+            writer.write(value);
+        }
+    };
+
+    template<typename T>
+    using is_streamed_reflected = std::integral_constant<bool,
+        fc::reflector<T>::is_defined::value && !std::is_enum<T>::value && !has_custom_variant<T>::value>;
+
+    /// Structures are written by their FC_REFLECT members, other types through fc::variant
+    template<typename T, typename Enable>
+    struct json_serializer final {
+        static void write(json_writer& writer, const T& value) {
+            write(writer, value, is_streamed_reflected<T>());
+        }
+
+    private:
+        static void write(json_writer& writer, const T& value, std::true_type) {
+            writer.begin_object();
+            fc::reflector<T>::visit(json_member_visitor<T>{writer, value});
+            writer.end_object();
+        }
+
+        static void write(json_writer& writer, const T& value, std::false_type) {
+            writer.variant_value(fc::variant(value));
+        }
+    };
+
+    template<>
+    struct json_serializer<bool> final {
+        static void write(json_writer& writer, bool value) {
+            writer.bool_value(value);
+        }
+    };
+
+    template<typename T>
+    struct json_serializer<T, std::enable_if_t<
+        std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, char>::value>> final {
+        static void write(json_writer& writer, T value) {
+            writer.int64_value(value);
+        }
+    };
+
+    template<typename T>
+    struct json_serializer<T, std::enable_if_t<
+        std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>> final {
+        static void write(json_writer& writer, T value) {
+            writer.uint64_value(value);
+        }
+    };
+
+    template<>
+    struct json_serializer<std::string> final {
+        static void write(json_writer& writer, const std::string& value) {
+            writer.string_value(value);
+        }
+    };
+
+    template<typename Storage>
+    struct json_serializer<fc::fixed_string<Storage>> final {
+        static void write(json_writer& writer, const fc::fixed_string<Storage>& value) {
+            writer.string_value(std::string(value));
+        }
+    };
+
+    template<>
+    struct json_serializer<golos::protocol::asset> final {
+        static void write(json_writer& writer, const golos::protocol::asset& value) {
+            writer.string_value(value.to_string());
+        }
+    };
+
+    template<>
+    struct json_serializer<golos::protocol::public_key_type> final {
+        static void write(json_writer& writer, const golos::protocol::public_key_type& value) {
+            writer.string_value(std::string(value));
+        }
+    };
+
+    template<>
+    struct json_serializer<fc::variant> final {
+        static void write(json_writer& writer, const fc::variant& value) {
+            writer.variant_value(value);
+        }
+    };
+
+    template<typename T>
+    struct json_serializer<fc::optional<T>> final {
+        static void write(json_writer& writer, const fc::optional<T>& value) {
+            if (value.valid()) {
+                writer.write(*value);
+            } else {
+                writer.null_value();
+            }
+        }
+    };
+
+    template<typename A, typename B>
+    struct json_serializer<std::pair<A, B>> final {
+        static void write(json_writer& writer, const std::pair<A, B>& value) {
+            writer.begin_array();
+            writer.write(value.first);
+            writer.write(value.second);
+            writer.end_array();
+        }
+    };
+
+    template<typename Container>
+    struct json_array_serializer {
+        static void write(json_writer& writer, const Container& value) {
+            writer.begin_array();
+            for (const auto& item: value) {
+                writer.write(item);
+            }
+            writer.end_array();
+        }
+    };
+
+    // vector<char> is written as a hex string by fc::variant
+    template<typename T, typename A>
+    struct json_serializer<std::vector<T, A>, std::enable_if_t<!std::is_same<T, char>::value>> final
+        : json_array_serializer<std::vector<T, A>> {};
+
+    template<typename T, typename A>
+    struct json_serializer<std::deque<T, A>> final
+        : json_array_serializer<std::deque<T, A>> {};
+
+    template<typename T, typename C, typename A>
+    struct json_serializer<std::set<T, C, A>> final
+        : json_array_serializer<std::set<T, C, A>> {};
+
+    template<typename T, typename C, typename A>
+    struct json_serializer<boost::container::flat_set<T, C, A>> final
+        : json_array_serializer<boost::container::flat_set<T, C, A>> {};
+
+    // maps are written as arrays of [key, value] pairs like fc::variant does
+    template<typename K, typename V, typename C, typename A>
+    struct json_serializer<std::map<K, V, C, A>> final
+        : json_array_serializer<std::map<K, V, C, A>> {};
+
+    template<typename K, typename V, typename C, typename A>
+    struct json_serializer<boost::container::flat_map<K, V, C, A>> final
+        : json_array_serializer<boost::container::flat_map<K, V, C, A>> {};
+
+    /// @return JSON of the value, it is the same as fc::json::to_string(fc::variant(value))
+    template<typename T>
+    std::string to_json(const T& value) {
+        std::string result;
+        json_writer writer(result);
+        writer.write(value);
+        return result;
+    }
+
+} } } // golos::plugins::json_rpc
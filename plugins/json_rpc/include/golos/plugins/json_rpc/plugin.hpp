@@ -2,6 +2,7 @@
 
 #include <appbase/application.hpp>
 #include <golos/plugins/json_rpc/utility.hpp>
+#include <golos/plugins/json_rpc/json_writer.hpp>
 #include <fc/variant.hpp>
 #include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
@@ -56,6 +57,7 @@
 #define SERVER_MISSING_AUTHORITY     (-32004)   // tx_missing_authority
 #define SERVER_INVALID_OPERATION     (-32005)   // tx_invalid_operation (client must check inner exception)
 #define SERVER_INVALID_TRANSACTION   (-32006)   // transaction_exception
+#define SERVER_OVERLOADED            (-32007)   // request is rejected by admission control of webserver
 
 namespace golos {
     namespace plugins {
@@ -68,8 +70,9 @@ namespace golos {
              * to names.
              *
              * Arguments: Variant object of propert arg type
+             * Returns: JSON of the result, which is written by json_writer without building of fc::variant
              */
-            using api_method = std::function<fc::variant(msg_pack &)>;
+            using api_method = std::function<std::string(msg_pack &)>;
 
             /**
              * @brief An API, containing APIs and Methods
@@ -85,9 +88,46 @@ namespace golos {
                 fc::variant ret;
             };
 
+            struct method_cache_stats {
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+                double hit_ratio = 0;
+            };
+
+            /**
+             * @brief Metrics of the response cache
+             *
+             * Responses are cached until the next applied block, so hit ratio shows how many calls are repeated within a block.
+             */
+            struct cache_stats {
+                uint32_t block_num = 0;
+                uint64_t entries = 0;
+                std::map<std::string, method_cache_stats> methods;
+            };
+
+            /**
+             * @brief Metrics of batch requests
+             *
+             * Latencies are measured from receiving of a batch to sending of its response, in microseconds.
+             * Percentiles are upper bounds of buckets of the power-of-two histogram.
+             */
+            struct batch_stats {
+                uint64_t batches = 0;
+                uint64_t requests = 0;
+                uint32_t max_size = 0;
+                uint32_t concurrency = 0;
+                uint64_t latency_p50 = 0;
+                uint64_t latency_p90 = 0;
+                uint64_t latency_p99 = 0;
+                uint64_t latency_max = 0;
+            };
+
             class plugin final : public appbase::plugin<plugin> {
             public:
                 using response_handler_type = std::function<void (const std::string &)>;
+                /// Executes an element of batch by the task, or answers with the error response by the reject
+                using executor_type = std::function<void (
+                    const fc::variant &request, std::function<void()> task, response_handler_type reject)>;
 
                 plugin();
 
@@ -114,6 +154,27 @@ namespace golos {
 
                 void call(const string &body, response_handler_type);
 
+                /// Calls already parsed request or batch
+                void call(const fc::variant &request, response_handler_type);
+
+                /// @return "api.method" of the registered method, "batch" for batches, or "unknown"
+                std::string get_method_name(const fc::variant &request) const;
+
+                /**
+                 * Sets the executor of batch elements, e.g. the thread pool of the webserver.
+                 * Each element is admitted by the executor as a separate request, at most rpc-batch-concurrency
+                 * elements of a batch are admitted at once.
+                 * Without the executor elements of batches are executed sequentially in the calling thread.
+                 */
+                void set_batch_executor(executor_type executor);
+
+                batch_stats get_batch_stats() const;
+
+                /// Drops cached responses, because the state of the database is changed by the block
+                void clear_cache(uint32_t block_num);
+
+                cache_stats get_cache_stats() const;
+
             private:
                 class impl;
 
@@ -131,8 +192,8 @@ namespace golos {
                     void operator()(Plugin &plugin, const std::string &method_name, Method method, Args *args,
                                     Ret *ret) {
                         _json_rpc_plugin.add_api_method(_api_name, method_name,
-                                                        [&plugin, method](msg_pack &args) -> fc::variant {
-                                                            return fc::variant((plugin.*method)(args));
+                                                        [&plugin, method](msg_pack &args) -> std::string {
+                                                            return json_rpc::to_json((plugin.*method)(args));
                                                         });
                         /*api_method_signature{ fc::variant( Args() ), fc::variant( Ret() ) }*/ //);
                     }
@@ -147,3 +208,10 @@ namespace golos {
 } // steem::plugins::json_rpc
 
 FC_REFLECT((golos::plugins::json_rpc::api_method_signature), (args)(ret))
+
+FC_REFLECT((golos::plugins::json_rpc::method_cache_stats), (hits)(misses)(hit_ratio))
+
+FC_REFLECT((golos::plugins::json_rpc::cache_stats), (block_num)(entries)(methods))
+
+FC_REFLECT((golos::plugins::json_rpc::batch_stats),
+    (batches)(requests)(max_size)(concurrency)(latency_p50)(latency_p90)(latency_p99)(latency_max))
@@ -74,6 +74,11 @@ namespace golos { namespace plugins { namespace json_rpc {
 
                 void unsafe_result(fc::optional<fc::variant> result);
 
+                // Pass already serialized JSON of result to remote connection
+                void json_result(std::string result);
+
+                void unsafe_json_result(std::string result);
+
                 fc::optional<fc::variant> result() const;
 
                 // Pass error to remote connection
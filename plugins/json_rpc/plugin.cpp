@@ -1,10 +1,17 @@
 #include <golos/plugins/json_rpc/plugin.hpp>
 #include <golos/plugins/json_rpc/utility.hpp>
+#include <golos/plugins/json_rpc/json_writer.hpp>
 
 #include <golos/protocol/exceptions.hpp>
+#include <golos/chain/read_epoch.hpp>
 
 #include <boost/algorithm/string.hpp>
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
 #include <fc/log/logger_config.hpp>
 #include <fc/exception/exception.hpp>
 #include <thirdparty/fc/vendor/websocketpp/websocketpp/error.hpp>
@@ -34,8 +41,45 @@ namespace golos {
                 fc::optional<fc::variant> result;
                 fc::optional<json_rpc_error> error;
                 fc::variant id;
+
+                std::string json_result; ///< serialized result, it replaces result if isn't empty
             };
 
+            /// Writes the response in order of its FC_REFLECT, the serialized result is appended without parsing
+            std::string to_json(const json_rpc_response& response) {
+                std::string out;
+                out.reserve(response.json_result.size() + 64);
+
+                json_writer writer(out);
+                writer.begin_object();
+                writer.key("jsonrpc");
+                writer.write(response.jsonrpc);
+                if (!response.json_result.empty()) {
+                    writer.key("result");
+                    writer.raw_value(response.json_result);
+                } else if (response.result.valid()) {
+                    writer.key("result");
+                    writer.write(*response.result);
+                }
+                if (response.error.valid()) {
+                    writer.key("error");
+                    writer.begin_object();
+                    writer.key("code");
+                    writer.write(response.error->code);
+                    writer.key("message");
+                    writer.write(response.error->message);
+                    if (response.error->data.valid()) {
+                        writer.key("data");
+                        writer.write(*response.error->data);
+                    }
+                    writer.end_object();
+                }
+                writer.key("id");
+                writer.write(response.id);
+                writer.end_object();
+                return out;
+            }
+
             struct msg_pack::impl final {
                 using handler_type = std::function<void (json_rpc_response &)>;
 
@@ -98,6 +142,22 @@ namespace golos {
                 pimpl->handler(pimpl->response);
             }
 
+            void msg_pack::unsafe_json_result(std::string result) {
+                // Pimpl can absent in case if msg_pack delegated its handlers to other msg_pack (see move constructor)
+                FC_ASSERT(valid(), "The msg_pack delegated its handlers");
+                pimpl->response.json_result = std::move(result);
+                pimpl->handler(pimpl->response);
+            }
+
+            void msg_pack::json_result(std::string result) {
+                try {
+                    unsafe_json_result(std::move(result));
+                } catch (const websocketpp::exception &) {
+                    // Can't send data via socket -
+                    //    don't pass exception to upper level, because it doesn't have handler for exception
+                }
+            }
+
             void msg_pack::result(fc::optional<fc::variant> result) {
                 // Pimpl can absent in case if msg_pack delegated its handlers to other msg_pack (see move constructor)
                 try {
@@ -248,9 +308,18 @@ namespace golos {
                     }
 
                     try {
+                        if (!_cache_stats.empty()) {
+                            auto method_name = msg.plugin + '.' + msg.method;
+                            auto cache_itr = _cache_stats.find(method_name);
+                            if (cache_itr != _cache_stats.end()) {
+                                return call_cached(*call, method_name, cache_itr->second, msg);
+                            }
+                        }
+
+                        golos::chain::api_method_scope method_scope(msg.plugin, msg.method);
                         auto result = (*call)(msg);
                         if (msg.valid()) {
-                            msg.result(std::move(result));
+                            msg.json_result(std::move(result));
                         }
                     } catch (const golos::unsupported_operation& e) {
                         msg.error(SERVER_UNSUPPORTED_OPERATION, e);
@@ -275,11 +344,66 @@ namespace golos {
                     }
                 }
 
+                // Responses of cached methods are kept until the next block, because they depend only on the head state
+                void call_cached(api_method& call, const std::string& method_name, method_cache_stats& stats, msg_pack& msg) {
+                    auto key = method_name + fc::json::to_string(msg.args);
+                    std::string result;
+                    uint64_t generation;
+                    {
+                        std::lock_guard<std::mutex> lock(_cache_mutex);
+                        auto itr = _cache.find(key);
+                        if (itr != _cache.end()) {
+                            ++stats.hits;
+                            result = itr->second;
+                        } else {
+                            ++stats.misses;
+                        }
+                        generation = _cache_generation;
+                    }
+
+                    if (result.empty()) {
+                        golos::chain::api_method_scope method_scope(msg.plugin, msg.method);
+                        result = call(msg);
+                        if (!msg.valid()) {
+                            return;
+                        }
+
+                        std::lock_guard<std::mutex> lock(_cache_mutex);
+                        // the result can be read before the block, which has cleared the cache
+                        if (generation == _cache_generation && _cache.size() < max_cache_entries) {
+                            _cache.emplace(std::move(key), result);
+                        }
+                    }
+
+                    msg.json_result(std::move(result));
+                }
+
+                void clear_cache(uint32_t block_num) {
+                    std::lock_guard<std::mutex> lock(_cache_mutex);
+                    _cache.clear();
+                    _cache_block_num = block_num;
+                    ++_cache_generation;
+                }
+
+                cache_stats get_cache_stats() const {
+                    std::lock_guard<std::mutex> lock(_cache_mutex);
+                    cache_stats result;
+                    result.block_num = _cache_block_num;
+                    result.entries = _cache.size();
+                    for (const auto& item: _cache_stats) {
+                        auto& stats = result.methods[item.first];
+                        stats = item.second;
+                        auto calls = stats.hits + stats.misses;
+                        stats.hit_ratio = calls ? double(stats.hits) / calls : 0;
+                    }
+                    return result;
+                }
+
                 struct dump_rpc_time {
                     dump_rpc_time(const fc::variant& data, uint64_t log_rpc_calls_slower_msec)
                         : data_(data), log_rpc_calls_slower_msec_(log_rpc_calls_slower_msec) {
 
-                        dlog("data: ${data}", ("data", fc::json::to_string(data_)));
+                        dlog("data: ${data}", ("data", data_string()));
                     }
 
                     ~dump_rpc_time() {
@@ -288,12 +412,12 @@ namespace golos {
                         if (error_.empty()) {
                             dlog(
                                 "elapsed: ${time} msec, data: ${data}",
-                                ("data", fc::json::to_string(data_))
+                                ("data", data_string())
                                 ("time", msecs));
                         } else {
                             dlog(
                                 "elapsed: ${time} msec, error: '${error}', data: ${data}",
-                                ("data", fc::json::to_string(data_))
+                                ("data", data_string())
                                 ("error", error_)
                                 ("time", msecs));
                         }
@@ -302,12 +426,12 @@ namespace golos {
                             if (error_.empty()) {
                                 wlog(
                                     "Too slow RPC call: ${time} msec, data: ${data}",
-                                    ("data", fc::json::to_string(data_))
+                                    ("data", data_string())
                                     ("time", msecs));
                             } else {
                                 wlog(
                                     "Too slow RPC call: ${time} msec, error: '${error}', data: ${data}",
-                                    ("data", fc::json::to_string(data_))
+                                    ("data", data_string())
                                     ("error", error_)
                                     ("time", msecs));
                             }
@@ -319,9 +443,18 @@ namespace golos {
                     }
 
                 private:
+                    // The request is serialized only if it is logged, and only once
+                    const std::string& data_string() {
+                        if (!data_string_.valid()) {
+                            data_string_ = fc::json::to_string(data_);
+                        }
+                        return *data_string_;
+                    }
+
                     fc::time_point start_ = fc::time_point::now();
                     std::string error_;
                     const fc::variant& data_;
+                    fc::optional<std::string> data_string_;
                     uint64_t log_rpc_calls_slower_msec_;
                 };
 
@@ -343,64 +476,209 @@ namespace golos {
                     }
                 }
 
-                void rpc(vector<fc::variant> messages, response_handler_type response_handler) {
-                    auto responses = std::make_shared<vector<json_rpc_response>>();
+                /// Batch, which elements are executed by several workers, responses are kept in order of requests
+                struct batch_state final {
+                    batch_state(vector<fc::variant> m, response_handler_type handler)
+                        : messages(std::move(m)),
+                          responses(messages.size()),
+                          completed(messages.size(), false),
+                          remaining(messages.size()),
+                          response_handler(std::move(handler)) {
+                    }
 
-                    responses->reserve(messages.size());
+                    const vector<fc::variant> messages;
+                    vector<std::string> responses;
+                    vector<bool> completed;
+                    std::mutex mutex;
+                    std::size_t next = 0;
+                    std::size_t remaining;
+                    const response_handler_type response_handler;
+                    const fc::time_point start = fc::time_point::now();
+                };
 
-                    std::function<void()> next_handler = [response_handler, responses]{
-                        response_handler(fc::json::to_string(*responses.get()));
-                    };
+                void run_batch_element(const std::shared_ptr<batch_state>& batch, std::size_t index) {
+                    msg_pack msg([this, batch, index](json_rpc_response &response){
+                        complete_batch_element(batch, index, to_json(response));
+                    });
 
-                    for (auto it = messages.rbegin(); messages.rend() != it; ++it) {
-                        auto v = *it;
+                    this->rpc(batch->messages[index], msg);
+                }
 
-                        next_handler = [next_handler, responses, v, this]{
-                            msg_pack msg([next_handler, responses](json_rpc_response &response){
-                                responses->push_back(response);
-                                next_handler();
-                            });
+                // Worker takes elements of the batch one by one, until all of them are taken.
+                // With the executor the worker admits the next element and continues after its execution.
+                void run_batch(const std::shared_ptr<batch_state>& batch) {
+                    for (;;) {
+                        std::size_t index;
+                        {
+                            std::lock_guard<std::mutex> lock(batch->mutex);
+                            if (batch->next == batch->messages.size()) {
+                                return;
+                            }
+                            index = batch->next++;
+                        }
 
-                            this->rpc(v, msg);
-                        };
+                        if (!_batch_executor) {
+                            run_batch_element(batch, index);
+                            continue;
+                        }
+
+                        // the reject can be called by the executor right away, then this loop continues the batch
+                        auto posted = std::make_shared<std::atomic<bool>>(false);
+                        _batch_executor(batch->messages[index], [this, batch, index]{
+                            run_batch_element(batch, index);
+                            run_batch(batch);
+                        }, [this, batch, index, posted](const std::string &response){
+                            complete_batch_element(batch, index, response);
+                            if (posted->exchange(true)) {
+                                run_batch(batch);
+                            }
+                        });
+                        if (!posted->exchange(true)) {
+                            return;
+                        }
                     }
+                }
 
-                    next_handler();
+                void complete_batch_element(const std::shared_ptr<batch_state>& batch, std::size_t index, std::string response) {
+                    {
+                        std::lock_guard<std::mutex> lock(batch->mutex);
+                        // subscriptions answer many times, only the first answer is a part of the batch
+                        if (batch->completed[index]) {
+                            return;
+                        }
+                        batch->completed[index] = true;
+                        batch->responses[index] = std::move(response);
+                        if (--batch->remaining != 0) {
+                            return;
+                        }
+                    }
+
+                    std::size_t size = 2;
+                    for (const auto& r: batch->responses) {
+                        size += r.size() + 1;
+                    }
+
+                    std::string result;
+                    result.reserve(size);
+                    json_writer writer(result);
+                    writer.begin_array();
+                    for (const auto& r: batch->responses) {
+                        writer.raw_value(r);
+                    }
+                    writer.end_array();
+
+                    add_batch_stats(batch->messages.size(), fc::time_point::now() - batch->start);
+                    batch->response_handler(result);
                 }
 
-                void call(const string &message, response_handler_type response_handler) {
-                    auto send_error = [response_handler](int32_t code, const std::string& msg, fc::optional<fc::variant> d = fc::optional<fc::variant>()) {
-                        json_rpc_response response;
-                        response.error = json_rpc_error(code, msg, d);
-                        response_handler(fc::json::to_string(response));
+                void rpc(vector<fc::variant> messages, response_handler_type response_handler) {
+                    auto batch = std::make_shared<batch_state>(std::move(messages), std::move(response_handler));
+                    auto workers = _batch_executor ? std::min<std::size_t>(_batch_concurrency, batch->messages.size()) : 1;
+
+                    for (std::size_t i = 0; i < workers; ++i) {
+                        run_batch(batch);
+                    }
+                }
+
+                void add_batch_stats(std::size_t size, const fc::microseconds& latency) {
+                    auto usecs = uint64_t(std::max<int64_t>(latency.count(), 0));
+                    std::size_t bucket = 0;
+                    while ((uint64_t(1) << bucket) < usecs && bucket + 1 < _batch_latency.size()) {
+                        ++bucket;
+                    }
+
+                    std::lock_guard<std::mutex> lock(_batch_stats_mutex);
+                    ++_batch_stats.batches;
+                    _batch_stats.requests += size;
+                    _batch_stats.max_size = std::max(_batch_stats.max_size, uint32_t(size));
+                    _batch_stats.latency_max = std::max(_batch_stats.latency_max, usecs);
+                    ++_batch_latency[bucket];
+                }
+
+                batch_stats get_batch_stats() const {
+                    std::lock_guard<std::mutex> lock(_batch_stats_mutex);
+                    auto result = _batch_stats;
+                    result.concurrency = _batch_concurrency;
+
+                    auto percentile = [&](uint64_t percent) -> uint64_t {
+                        auto rank = (result.batches * percent + 99) / 100;
+                        uint64_t count = 0;
+                        for (std::size_t i = 0; i < _batch_latency.size() && rank; ++i) {
+                            count += _batch_latency[i];
+                            if (count >= rank) {
+                                return std::min(uint64_t(1) << i, result.latency_max);
+                            }
+                        }
+                        return result.latency_max;
                     };
 
+                    result.latency_p50 = percentile(50);
+                    result.latency_p90 = percentile(90);
+                    result.latency_p99 = percentile(99);
+                    return result;
+                }
+
+                static void send_error(const response_handler_type& response_handler, int32_t code, const std::string& msg,
+                                       fc::optional<fc::variant> d = fc::optional<fc::variant>()) {
+                    json_rpc_response response;
+                    response.error = json_rpc_error(code, msg, d);
+                    response_handler(to_json(response));
+                }
+
+                void call(const string &message, response_handler_type response_handler) {
+                    fc::variant v;
+
                     try {
-                        fc::variant v;
+                        v = fc::json::from_string(message);
+                    } catch (const fc::exception& e) {
+                        return send_error(response_handler, JSON_RPC_PARSE_ERROR, "Invalid JSON-structure", e);
+                    }
 
-                        try {
-                            v = fc::json::from_string(message);
-                        } catch (const fc::exception& e) {
-                            return send_error(JSON_RPC_PARSE_ERROR, "Invalid JSON-structure", e);
-                        }
+                    call(v, std::move(response_handler));
+                }
 
+                void call(const fc::variant &v, response_handler_type response_handler) {
+                    try {
                         if (v.is_array()) {
                             vector<fc::variant> messages = v.as<vector<fc::variant>>();
 
                             if(messages.size() == 0) {
-                                return send_error(JSON_RPC_INVALID_REQUEST, "Array of requests must be non-empty");
+                                return send_error(response_handler, JSON_RPC_INVALID_REQUEST, "Array of requests must be non-empty");
                             }
                             rpc(messages, response_handler);
                         } else {
                             msg_pack msg([response_handler](json_rpc_response &response){
-                                    response_handler(fc::json::to_string(response));
+                                    response_handler(to_json(response));
                                     });
 
                             rpc(v, msg);
                         }
                     } catch (const fc::exception &e) {
-                        return send_error(JSON_RPC_INTERNAL_ERROR, e.to_string(), e);
+                        return send_error(response_handler, JSON_RPC_INTERNAL_ERROR, e.to_string(), e);
+                    }
+                }
+
+                std::string get_method_name(const fc::variant &request) const {
+                    if (request.is_array()) {
+                        return "batch";
+                    }
+
+                    try {
+                        if (request.is_object()) {
+                            const auto& params = request.get_object()["params"].get_array();
+                            if (params.size() >= 2 && params[0].is_string() && params[1].is_string()) {
+                                const auto& api = params[0].get_string();
+                                const auto& method = params[1].get_string();
+                                auto api_itr = _registered_apis.find(api);
+                                if (api_itr != _registered_apis.end() && api_itr->second.count(method)) {
+                                    return api + '.' + method;
+                                }
+                            }
+                        }
+                    } catch (const fc::exception&) {
+                        // invalid request is answered with the error by call()
                     }
+                    return "unknown";
                 }
 
                 void initialize() {
@@ -428,7 +706,20 @@ namespace golos {
                 vector<string> _methods;
                 map<string, map<string, api_method_signature> > _method_sigs;
                 uint64_t _log_rpc_calls_slower_msec = UINT64_MAX;
+                uint32_t _batch_concurrency = 8;
+                executor_type _batch_executor;
+                std::map<std::string, method_cache_stats> _cache_stats; // it is also the list of cached methods
             private:
+                static constexpr std::size_t max_cache_entries = 10000;
+                mutable std::mutex _cache_mutex;
+                std::unordered_map<std::string, std::string> _cache;
+                uint64_t _cache_generation = 0;
+                uint32_t _cache_block_num = 0;
+
+                mutable std::mutex _batch_stats_mutex;
+                batch_stats _batch_stats;
+                std::array<uint64_t, 40> _batch_latency = {}; // bucket i counts latencies up to 2^i microseconds
+
                 // This is a reindex which allows to get parent plugin by method
                 // unordered_map[method] -> plugin
                 // For example:
@@ -448,6 +739,15 @@ namespace golos {
                 cfg.add_options() (
                     "log-rpc-calls-slower-msec", bpo::value<uint64_t>()->default_value(UINT64_MAX),
                     "Maximal milliseconds of RPC call or dump it as too slow. If not set, do not dump"
+                ) (
+                    "rpc-batch-concurrency", bpo::value<uint32_t>()->default_value(8),
+                    "Maximal number of concurrently executed requests of one batch. If 1, requests are executed sequentially"
+                ) (
+                    "rpc-response-cache", bpo::value<bool>()->default_value(false),
+                    "Cache responses of methods from rpc-cache-method until the next block"
+                ) (
+                    "rpc-cache-method", bpo::value<std::vector<std::string>>()->composing()->multitoken(),
+                    "Method (api.method) which responses are cached. By default methods, which are polled by clients"
                 );
             }
 
@@ -456,6 +756,32 @@ namespace golos {
                 pimpl = std::make_unique<impl>();
                 pimpl->initialize();
                 pimpl->_log_rpc_calls_slower_msec = options.at("log-rpc-calls-slower-msec").as<uint64_t>();
+                pimpl->_batch_concurrency = options.at("rpc-batch-concurrency").as<uint32_t>();
+                FC_ASSERT(pimpl->_batch_concurrency > 0, "rpc-batch-concurrency must be greater than 0");
+
+                pimpl->add_api_method(name(), "get_batch_stats", [this](msg_pack&) -> std::string {
+                    return json_rpc::to_json(get_batch_stats());
+                });
+
+                if (options.at("rpc-response-cache").as<bool>()) {
+                    std::vector<std::string> methods = {
+                        "database_api.get_dynamic_global_properties",
+                        "database_api.get_chain_properties",
+                        "witness_api.get_witness_schedule",
+                        "witness_api.get_active_witnesses",
+                        "witness_api.get_current_median_history_price",
+                        "market_history.get_ticker",
+                        "market_history.get_order_book"};
+                    if (options.count("rpc-cache-method")) {
+                        methods = options.at("rpc-cache-method").as<std::vector<std::string>>();
+                    }
+                    for (const auto& method: methods) {
+                        pimpl->_cache_stats[method];
+                    }
+                }
+                pimpl->add_api_method(name(), "get_cache_stats", [this](msg_pack&) -> std::string {
+                    return json_rpc::to_json(get_cache_stats());
+                });
                 ilog("json_rpc plugin: plugin_initialize() end");
             }
 
@@ -479,6 +805,30 @@ namespace golos {
             void plugin::call(const string &message, response_handler_type response_handler) {
                 pimpl->call(message, response_handler);
             }
+
+            void plugin::call(const fc::variant &request, response_handler_type response_handler) {
+                pimpl->call(request, response_handler);
+            }
+
+            std::string plugin::get_method_name(const fc::variant &request) const {
+                return pimpl->get_method_name(request);
+            }
+
+            void plugin::set_batch_executor(executor_type executor) {
+                pimpl->_batch_executor = std::move(executor);
+            }
+
+            batch_stats plugin::get_batch_stats() const {
+                return pimpl->get_batch_stats();
+            }
+
+            void plugin::clear_cache(uint32_t block_num) {
+                pimpl->clear_cache(block_num);
+            }
+
+            cache_stats plugin::get_cache_stats() const {
+                return pimpl->get_cache_stats();
+            }
         }
     }
 } // golos::plugins::json_rpc
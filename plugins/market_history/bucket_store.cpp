@@ -0,0 +1,263 @@
+#include <golos/plugins/market_history/bucket_store.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/filesystem.hpp>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+namespace golos {
+    namespace plugins {
+        namespace market_history {
+
+            static constexpr uint32_t bucket_store_version = 2;
+
+            // Columns are written as they are kept in memory
+            struct bucket_store_file {
+                uint32_t version = bucket_store_version;
+                std::vector<uint32_t> sizes;
+                uint32_t capacity = 0;
+                int64_t next_trade_id = 0;
+                std::vector<bucket_series> series;
+            };
+
+        }
+    }
+} // golos::plugins::market_history
+
+FC_REFLECT((golos::plugins::market_history::bucket_store_file),
+           (version)(sizes)(capacity)(next_trade_id)(series))
+
+namespace golos {
+    namespace plugins {
+        namespace market_history {
+
+            namespace bfs = boost::filesystem;
+
+            bucket_object make_bucket(asset_symbol_type sym1, asset_symbol_type sym2, uint32_t seconds,
+                    fc::time_point_sec open, share_type amount1, share_type amount2) {
+                bucket_object b;
+                b.sym1 = sym1;
+                b.sym2 = sym2;
+                b.seconds = seconds;
+                b.open = open;
+                b.high_asset1 = amount1;
+                b.high_asset2 = amount2;
+                b.low_asset1 = amount1;
+                b.low_asset2 = amount2;
+                b.open_asset1 = amount1;
+                b.open_asset2 = amount2;
+                b.close_asset1 = amount1;
+                b.close_asset2 = amount2;
+                b.asset1_volume = amount1;
+                b.asset2_volume = amount2;
+                return b;
+            }
+
+            void add_trade_to_bucket(bucket_object &b, share_type amount1, share_type amount2) {
+                b.asset1_volume += amount1;
+                b.asset2_volume += amount2;
+                b.close_asset1 = amount1;
+                b.close_asset2 = amount2;
+
+                auto trade_price = asset(amount2, b.sym2) / asset(amount1, b.sym1);
+                if (b.high() < trade_price) {
+                    b.high_asset1 = amount1;
+                    b.high_asset2 = amount2;
+                }
+                if (b.low() > trade_price) {
+                    b.low_asset1 = amount1;
+                    b.low_asset2 = amount2;
+                }
+            }
+
+            uint64_t bucket_series::lower_bound(fc::time_point_sec time) const {
+                auto lo = first();
+                auto hi = pushed;
+                while (lo < hi) {
+                    auto mid = lo + (hi - lo) / 2;
+                    if (open[mid % max_buckets] < time.sec_since_epoch()) {
+                        lo = mid + 1;
+                    } else {
+                        hi = mid;
+                    }
+                }
+                return lo;
+            }
+
+            bucket_object bucket_series::get(uint64_t index) const {
+                auto i = index % max_buckets;
+                bucket_object b;
+                b.id = bucket_id_type(index);
+                b.sym1 = sym1;
+                b.sym2 = sym2;
+                b.seconds = seconds;
+                b.open = fc::time_point_sec(open[i]);
+                b.high_asset1 = high_asset1[i];
+                b.high_asset2 = high_asset2[i];
+                b.low_asset1 = low_asset1[i];
+                b.low_asset2 = low_asset2[i];
+                b.open_asset1 = open_asset1[i];
+                b.open_asset2 = open_asset2[i];
+                b.close_asset1 = close_asset1[i];
+                b.close_asset2 = close_asset2[i];
+                b.asset1_volume = asset1_volume[i];
+                b.asset2_volume = asset2_volume[i];
+                return b;
+            }
+
+            void bucket_series::set(uint64_t index, const bucket_object &b) {
+                auto i = index % max_buckets;
+                open[i] = b.open.sec_since_epoch();
+                high_asset1[i] = b.high_asset1.value;
+                high_asset2[i] = b.high_asset2.value;
+                low_asset1[i] = b.low_asset1.value;
+                low_asset2[i] = b.low_asset2.value;
+                open_asset1[i] = b.open_asset1.value;
+                open_asset2[i] = b.open_asset2.value;
+                close_asset1[i] = b.close_asset1.value;
+                close_asset2[i] = b.close_asset2.value;
+                asset1_volume[i] = b.asset1_volume.value;
+                asset2_volume[i] = b.asset2_volume.value;
+            }
+
+            void bucket_series::push(const bucket_object &b) {
+                if (size() < max_buckets) {
+                    auto n = size() + 1;
+                    open.resize(n);
+                    high_asset1.resize(n);
+                    high_asset2.resize(n);
+                    low_asset1.resize(n);
+                    low_asset2.resize(n);
+                    open_asset1.resize(n);
+                    open_asset2.resize(n);
+                    close_asset1.resize(n);
+                    close_asset2.resize(n);
+                    asset1_volume.resize(n);
+                    asset2_volume.resize(n);
+                }
+                set(pushed, b);
+                ++pushed;
+            }
+
+            void bucket_series::add_trade(fc::time_point_sec time, share_type amount1, share_type amount2) {
+                auto open_time = (time.sec_since_epoch() / seconds) * seconds;
+
+                if (pushed == 0 || open[(pushed - 1) % max_buckets] < open_time) {
+                    push(make_bucket(sym1, sym2, seconds, fc::time_point_sec(open_time), amount1, amount2));
+                    return;
+                }
+
+                // trades come in order of time, so it is the latest bucket except the trades of the same time
+                auto index = lower_bound(fc::time_point_sec(open_time));
+                if (index == pushed || open[index % max_buckets] != open_time) {
+                    return; // bucket is already overwritten
+                }
+                auto b = get(index);
+                add_trade_to_bucket(b, amount1, amount2);
+                set(index, b);
+            }
+
+            bucket_store::bucket_store(boost::container::flat_set<uint32_t> sizes, uint32_t capacity)
+                    : _sizes(std::move(sizes)),
+                      _capacity(std::max<uint32_t>(capacity, 1)) {
+            }
+
+            void bucket_store::clear() {
+                _series.clear();
+                _next_trade_id = 0;
+            }
+
+            void bucket_store::add_trade(asset_symbol_type sym1, asset_symbol_type sym2, fc::time_point_sec time,
+                    share_type amount1, share_type amount2) {
+                for (auto seconds : _sizes) {
+                    auto itr = _series.find(series_key(sym1, sym2, seconds));
+                    if (itr == _series.end()) {
+                        bucket_series series;
+                        series.sym1 = sym1;
+                        series.sym2 = sym2;
+                        series.seconds = seconds;
+                        series.max_buckets = _capacity;
+                        itr = _series.emplace(series_key(sym1, sym2, seconds), std::move(series)).first;
+                    }
+                    itr->second.add_trade(time, amount1, amount2);
+                }
+            }
+
+            std::vector<bucket_object> bucket_store::get_buckets(asset_symbol_type sym1, asset_symbol_type sym2,
+                    uint32_t seconds, fc::time_point_sec start, fc::time_point_sec end) const {
+                std::vector<bucket_object> result;
+
+                auto itr = _series.find(series_key(sym1, sym2, seconds));
+                if (itr == _series.end()) {
+                    return result;
+                }
+
+                const auto &series = itr->second;
+                auto from = series.lower_bound(start);
+                auto to = series.lower_bound(end);
+                result.reserve(to - from);
+                for (auto index = from; index < to; ++index) {
+                    result.push_back(series.get(index));
+                }
+                return result;
+            }
+
+            bool bucket_store::load(const bfs::path &path) {
+                if (!bfs::exists(path)) {
+                    return false;
+                }
+
+                std::vector<char> data(bfs::file_size(path));
+                {
+                    bfs::ifstream in(path, std::ios_base::binary);
+                    in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+                    in.read(data.data(), data.size());
+                }
+
+                bucket_store_file file;
+                fc::raw::unpack(data, file);
+                if (file.version != bucket_store_version || file.capacity != _capacity ||
+                    file.sizes != std::vector<uint32_t>(_sizes.begin(), _sizes.end())
+                ) {
+                    return false;
+                }
+
+                _series.clear();
+                for (auto &series : file.series) {
+                    FC_ASSERT(series.capacity() == _capacity && series.size() == std::min<uint64_t>(series.pushed, _capacity),
+                        "Wrong size of bucket series in ${p}", ("p", path.string()));
+                    auto key = series_key(series.sym1, series.sym2, series.seconds);
+                    _series.emplace(key, std::move(series));
+                }
+                _next_trade_id = file.next_trade_id;
+                return true;
+            }
+
+            void bucket_store::save(const bfs::path &path) const {
+                bucket_store_file file;
+                file.sizes.assign(_sizes.begin(), _sizes.end());
+                file.capacity = _capacity;
+                file.next_trade_id = _next_trade_id;
+                file.series.reserve(_series.size());
+                for (const auto &itr : _series) {
+                    file.series.push_back(itr.second);
+                }
+                auto data = fc::raw::pack(file);
+
+                if (path.has_parent_path()) {
+                    bfs::create_directories(path.parent_path());
+                }
+                auto tmp_path = path;
+                tmp_path += ".tmp";
+                {
+                    bfs::ofstream out(tmp_path, std::ios_base::binary);
+                    out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                    out.write(data.data(), data.size());
+                }
+                bfs::rename(tmp_path, path);
+            }
+
+        }
+    }
+} // golos::plugins::market_history
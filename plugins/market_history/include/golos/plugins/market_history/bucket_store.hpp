@@ -0,0 +1,122 @@
+#pragma once
+
+#include <golos/plugins/market_history/market_history_objects.hpp>
+
+#include <boost/container/flat_set.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace golos {
+    namespace plugins {
+        namespace market_history {
+
+            /// starts a bucket with one trade of amount1 of sym1 for amount2 of sym2
+            bucket_object make_bucket(asset_symbol_type sym1, asset_symbol_type sym2, uint32_t seconds,
+                    fc::time_point_sec open, share_type amount1, share_type amount2);
+
+            /// adds the trade to the bucket, it is the latest trade of the bucket
+            void add_trade_to_bucket(bucket_object &bucket, share_type amount1, share_type amount2);
+
+            /**
+             *  Buckets of one market and one size in columns of a ring buffer.
+             *  Buckets are sorted by open time, the oldest one is overwritten by a new one when the buffer is full.
+             *  Columns grow with buckets up to the capacity, so markets with few trades take little memory.
+             */
+            struct bucket_series {
+                asset_symbol_type sym1 = 0;
+                asset_symbol_type sym2 = 0;
+                uint32_t seconds = 0;
+                uint32_t max_buckets = 0; ///< capacity of the ring buffer
+                uint64_t pushed = 0; ///< number of buckets ever started, the latest one has index pushed - 1
+
+                std::vector<uint32_t> open; ///< seconds since epoch
+                std::vector<int64_t> high_asset1;
+                std::vector<int64_t> high_asset2;
+                std::vector<int64_t> low_asset1;
+                std::vector<int64_t> low_asset2;
+                std::vector<int64_t> open_asset1;
+                std::vector<int64_t> open_asset2;
+                std::vector<int64_t> close_asset1;
+                std::vector<int64_t> close_asset2;
+                std::vector<int64_t> asset1_volume;
+                std::vector<int64_t> asset2_volume;
+
+                uint32_t capacity() const {
+                    return max_buckets;
+                }
+
+                /// number of buckets kept in the buffer
+                uint32_t size() const {
+                    return open.size();
+                }
+
+                /// index of the oldest bucket kept in the buffer
+                uint64_t first() const {
+                    return pushed - size();
+                }
+
+                /// @return index of the first bucket opened at the time or later
+                uint64_t lower_bound(fc::time_point_sec time) const;
+
+                bucket_object get(uint64_t index) const;
+
+                void set(uint64_t index, const bucket_object &bucket);
+
+                /// starts the latest bucket, it overwrites the oldest one when the buffer is full
+                void push(const bucket_object &bucket);
+
+                void add_trade(fc::time_point_sec time, share_type amount1, share_type amount2);
+            };
+
+            /**
+             *  Buckets of trades of irreversible blocks, they are kept in the plugin memory and in the file
+             *  instead of the shared memory. A trade updates the latest bucket of each size in O(1),
+             *  and a range of buckets is a contiguous slice of the columns.
+             */
+            class bucket_store final {
+            public:
+                bucket_store(boost::container::flat_set<uint32_t> sizes, uint32_t capacity);
+
+                void clear();
+
+                void add_trade(asset_symbol_type sym1, asset_symbol_type sym2, fc::time_point_sec time,
+                        share_type amount1, share_type amount2);
+
+                /// @return buckets of the size which are opened in [start, end)
+                std::vector<bucket_object> get_buckets(asset_symbol_type sym1, asset_symbol_type sym2, uint32_t seconds,
+                        fc::time_point_sec start, fc::time_point_sec end) const;
+
+                /// id of the first order_history_object which isn't added to the store
+                int64_t next_trade_id() const {
+                    return _next_trade_id;
+                }
+
+                void set_next_trade_id(int64_t id) {
+                    _next_trade_id = id;
+                }
+
+                /// @return false if there is no file or it is written for other bucket sizes
+                bool load(const boost::filesystem::path &path);
+
+                void save(const boost::filesystem::path &path) const;
+
+            private:
+                using series_key = std::tuple<asset_symbol_type, asset_symbol_type, uint32_t>;
+
+                boost::container::flat_set<uint32_t> _sizes;
+                uint32_t _capacity;
+                int64_t _next_trade_id = 0;
+                std::map<series_key, bucket_series> _series;
+            };
+
+        }
+    }
+} // golos::plugins::market_history
+
+FC_REFLECT((golos::plugins::market_history::bucket_series),
+           (sym1)(sym2)(seconds)(max_buckets)(pushed)(open)
+           (high_asset1)(high_asset2)(low_asset1)(low_asset2)(open_asset1)(open_asset2)
+           (close_asset1)(close_asset2)(asset1_volume)(asset2_volume))
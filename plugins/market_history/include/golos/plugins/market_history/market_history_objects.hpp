@@ -173,23 +173,18 @@ namespace golos {
                 asset open_pays;
             };
 
-            struct by_id;
-            struct by_bucket;
-
-            using bucket_index = multi_index_container<
-                bucket_object,
-                indexed_by<
-                    ordered_unique<tag<by_id>,
-                        member<bucket_object, bucket_id_type, &bucket_object::id>
-                    >,
-                    ordered_unique<tag<by_bucket>, composite_key<bucket_object,
-                        member<bucket_object, asset_symbol_type, &bucket_object::sym1>,
-                        member<bucket_object, asset_symbol_type, &bucket_object::sym2>,
-                        member<bucket_object, uint32_t, &bucket_object::seconds>,
-                        member<bucket_object, fc::time_point_sec, &bucket_object::open>
-                    >>
-                >, allocator<bucket_object>>;
+            // Changes of a market made by an applied block, which are sent to subscribers
+            struct market_update {
+                uint32_t block_num = 0;
+                time_point_sec time;
+                bool reset = false; // order book was rebuilt, bids and asks contain all its levels
+                vector <order> bids; // changed price levels, removed levels have zero amounts
+                vector <order> asks;
+                vector <market_trade> trades;
+                vector <bucket_object> buckets;
+            };
 
+            struct by_id;
             struct by_time;
 
             using order_history_index = multi_index_container<
@@ -218,6 +213,8 @@ FC_REFLECT((golos::plugins::market_history::order_book),
            (bids)(asks));
 FC_REFLECT((golos::plugins::market_history::market_trade),
            (id)(date)(current_pays)(open_pays));
+FC_REFLECT((golos::plugins::market_history::market_update),
+           (block_num)(time)(reset)(bids)(asks)(trades)(buckets));
 
 FC_REFLECT_DERIVED((golos::plugins::market_history::limit_order),((golos::plugins::market_history::limit_order_api_object)) ,(real_price)(rewarded)(asset1)(asset2));
 
@@ -233,7 +230,6 @@ FC_REFLECT((golos::plugins::market_history::bucket_object),
                    (open_asset1)(open_asset2)
                    (close_asset1)(close_asset2)
                    (asset1_volume)(asset2_volume))
-CHAINBASE_SET_INDEX_TYPE(golos::plugins::market_history::bucket_object, golos::plugins::market_history::bucket_index)
 
 FC_REFLECT((golos::plugins::market_history::order_history_object),(id)(time)(op))
 CHAINBASE_SET_INDEX_TYPE(golos::plugins::market_history::order_history_object, golos::plugins::market_history::order_history_index)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <golos/plugins/market_history/market_history_objects.hpp>
+#include <golos/plugins/market_history/order_book.hpp>
 
 #include <appbase/plugin.hpp>
 
@@ -43,6 +44,7 @@ namespace golos {
             DEFINE_API_ARGS(get_market_history_buckets, json_rpc::msg_pack, flat_set<uint32_t>)
             DEFINE_API_ARGS(get_open_orders,            json_rpc::msg_pack, std::vector<limit_order>)
             DEFINE_API_ARGS(get_fillable_orders,        json_rpc::msg_pack, std::vector<limit_order>)
+            DEFINE_API_ARGS(set_market_callback,        json_rpc::msg_pack, json_rpc::void_type)
 
             class market_history_plugin : public appbase::plugin<market_history_plugin> {
             public:
@@ -67,6 +69,8 @@ namespace golos {
 
                 uint32_t get_max_history_per_bucket() const;
 
+                const order_book_cache &get_order_book_cache() const;
+
                 DECLARE_API((get_ticker)
                                 (get_volume)
                                 (get_depth)
@@ -77,7 +81,8 @@ namespace golos {
                                 (get_market_history)
                                 (get_market_history_buckets)
                                 (get_open_orders)
-                                (get_fillable_orders))
+                                (get_fillable_orders)
+                                (set_market_callback))
 
                 constexpr const static char *plugin_name = "market_history";
 
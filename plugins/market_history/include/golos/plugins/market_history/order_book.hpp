@@ -0,0 +1,145 @@
+#pragma once
+
+#include <golos/chain/steem_objects.hpp>
+#include <golos/protocol/asset.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include <functional>
+#include <map>
+#include <set>
+
+namespace golos {
+    namespace plugins {
+        namespace market_history {
+
+            using golos::chain::limit_order_object;
+            using golos::chain::limit_order_id_type;
+            using golos::protocol::account_name_type;
+            using golos::protocol::asset;
+            using golos::protocol::asset_symbol_type;
+            using golos::protocol::price;
+            using golos::protocol::share_type;
+
+            /**
+             *  Copy of limit_order_object kept by the plugin in its memory.
+             */
+            struct book_order {
+                book_order() = default;
+
+                book_order(const limit_order_object &o)
+                        : id(o.id), created(o.created), expiration(o.expiration), seller(o.seller),
+                          orderid(o.orderid), for_sale(o.for_sale), sell_price(o.sell_price) {
+                }
+
+                limit_order_id_type id;
+                fc::time_point_sec created;
+                fc::time_point_sec expiration;
+                account_name_type seller;
+                uint32_t orderid = 0;
+                share_type for_sale; ///< asset id is sell_price.base.symbol
+                price sell_price;
+
+                asset amount_for_sale() const {
+                    return asset(for_sale, sell_price.base.symbol);
+                }
+            };
+
+            struct by_book_order;
+            struct by_book_price;
+            struct by_book_expiration;
+
+            using book_order_index = boost::multi_index_container<
+                book_order,
+                boost::multi_index::indexed_by<
+                    boost::multi_index::ordered_unique<boost::multi_index::tag<by_book_order>,
+                        boost::multi_index::composite_key<book_order,
+                            boost::multi_index::member<book_order, account_name_type, &book_order::seller>,
+                            boost::multi_index::member<book_order, uint32_t, &book_order::orderid>
+                        >
+                    >,
+                    // the same order as limit_order_index::by_price has
+                    boost::multi_index::ordered_unique<boost::multi_index::tag<by_book_price>,
+                        boost::multi_index::composite_key<book_order,
+                            boost::multi_index::member<book_order, price, &book_order::sell_price>,
+                            boost::multi_index::member<book_order, limit_order_id_type, &book_order::id>
+                        >,
+                        boost::multi_index::composite_key_compare<std::greater<price>, std::less<limit_order_id_type>>
+                    >,
+                    boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_book_expiration>,
+                        boost::multi_index::member<book_order, fc::time_point_sec, &book_order::expiration>
+                    >
+                >
+            >;
+
+            /**
+             *  Orders which sell base symbol for quote symbol, aggregated by price levels.
+             *  Levels are sorted from the best (highest) price.
+             */
+            struct book_side {
+                std::map<price, share_type, std::greater<price>> levels;
+                share_type for_sale; ///< total of all levels
+            };
+
+            /**
+             *  L2 order book of all markets. It mirrors limit_order_index of the chain,
+             *  so market queries don't walk the chain index and keep levels and depths ready.
+             */
+            class order_book_cache final {
+            public:
+                using changed_prices = std::set<price, std::greater<price>>;
+
+                /// removes all orders, the book is marked as reset until clear_changes()
+                void clear();
+
+                /// inserts the order or replaces its previous state
+                void update(const limit_order_object &order);
+
+                void remove(const account_name_type &seller, uint32_t orderid);
+
+                /// removes orders which are expired at the time, as the chain removes them
+                void remove_expired(fc::time_point_sec now);
+
+                /// @return nullptr if there are no orders selling base for quote
+                const book_side *find_side(asset_symbol_type base, asset_symbol_type quote) const;
+
+                /// @return total amount for sale of the side
+                asset depth(asset_symbol_type base, asset_symbol_type quote) const;
+
+                const book_order_index &orders() const {
+                    return _orders;
+                }
+
+                std::size_t size() const {
+                    return _orders.size();
+                }
+
+                /// @return prices of the side levels which are changed since the last clear_changes()
+                const changed_prices *find_changed_levels(asset_symbol_type base, asset_symbol_type quote) const;
+
+                /// @return true if the book was cleared since the last clear_changes(), so all its levels are new
+                bool is_reset() const {
+                    return _reset;
+                }
+
+                void clear_changes();
+
+            private:
+                using side_key = std::pair<asset_symbol_type, asset_symbol_type>;
+
+                void add_to_level(const book_order &order);
+
+                void remove_from_level(const book_order &order);
+
+                book_order_index _orders;
+                std::map<side_key, book_side> _sides;
+                std::map<side_key, changed_prices> _changed_levels;
+                bool _reset = false;
+            };
+
+        }
+    }
+} // golos::plugins::market_history
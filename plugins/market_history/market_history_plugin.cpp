@@ -1,8 +1,11 @@
 #include <golos/plugins/market_history/market_history_plugin.hpp>
 #include <golos/plugins/json_rpc/api_helper.hpp>
+#include <golos/plugins/json_rpc/json_writer.hpp>
+#include <golos/plugins/market_history/bucket_store.hpp>
 
 #include <golos/chain/index.hpp>
 #include <golos/chain/operation_notification.hpp>
+#include <golos/chain/state_snapshot.hpp>
 #include <golos/chain/steem_objects.hpp>
 #include <golos/chain/account_object.hpp>
 
@@ -10,6 +13,13 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
 
 namespace golos {
     namespace plugins {
@@ -18,6 +28,58 @@ namespace golos {
             using golos::protocol::fill_order_operation;
             using golos::chain::operation_notification;
 
+            using order_key = std::pair<account_name_type, uint32_t>;
+
+            /**
+             *  Collects orders which are changed by an operation, to update them in the order book after the block.
+             */
+            struct order_touch_visitor {
+                using result_type = void;
+
+                order_touch_visitor(std::set<order_key>& orders)
+                        : _orders(orders) {
+                }
+
+                std::set<order_key>& _orders;
+
+                template<typename T>
+                void operator()(const T&) const {
+                }
+
+                void operator()(const limit_order_create_operation& op) const {
+                    _orders.emplace(op.owner, op.orderid);
+                }
+
+                void operator()(const limit_order_create2_operation& op) const {
+                    _orders.emplace(op.owner, op.orderid);
+                }
+
+                void operator()(const limit_order_cancel_operation& op) const {
+                    _orders.emplace(op.owner, op.orderid);
+                }
+
+                void operator()(const limit_order_cancel_ex_operation& op) const {
+                    _orders.emplace(op.owner, op.orderid);
+                }
+
+                void operator()(const fill_order_operation& op) const {
+                    _orders.emplace(op.current_owner, op.current_orderid);
+                    _orders.emplace(op.open_owner, op.open_orderid);
+                }
+            };
+
+            /**
+             *  Subscriber of a market, which receives serialized market_update after each block.
+             */
+            struct market_subscription {
+                using callback_type = std::function<void(const std::string&)>;
+
+                symbol_type_pair pair;
+                bool reversed = false;
+                callback_type callback;
+            };
+
+            using market_subscription_ptr = std::shared_ptr<market_subscription>;
 
             class market_history_plugin::market_history_plugin_impl {
             public:
@@ -47,6 +109,23 @@ namespace golos {
 
 
                 void update_market_histories(const golos::chain::operation_notification &o);
+                int64_t next_trade_id() const;
+                void collect_block_trades(const signed_block &block);
+
+                void get_trade_amounts(const order_history_object &trade, symbol_type_pair &pair, share_type &amount1, share_type &amount2) const;
+                void open_buckets();
+                void close_buckets();
+                void move_trades(int64_t end_id);
+                void move_irreversible_trades();
+                std::vector<bucket_object> get_buckets(const symbol_type_pair& pair, uint32_t seconds, time_point_sec start, time_point_sec end) const;
+
+                void touch_orders(const golos::chain::operation_notification &o);
+                void update_order_book(const signed_block &block);
+                void rebuild_order_book();
+
+                void add_market_callback(const symbol_type_pair& pair, bool reversed, market_subscription::callback_type callback);
+                market_update get_market_update(const symbol_type_pair& pair, bool reversed, const signed_block &block);
+                void publish_market_updates(const signed_block &block);
 
                 golos::chain::database &database() const {
                     return _db;
@@ -57,6 +136,22 @@ namespace golos {
 
                 int32_t _maximum_history_per_bucket_size = 1000;
 
+                order_book_cache _order_book;
+                std::set<order_key> _touched_orders;
+                block_id_type _order_book_block_id;
+
+                std::mutex _subscriptions_mutex;
+                std::list<market_subscription_ptr> _subscriptions;
+
+                // changes of markets by the applied block
+                std::map<symbol_type_pair, std::vector<market_trade>> _block_trades;
+                // next id of order_history_object after each reversible block and the last irreversible one
+                std::map<uint32_t, int64_t> _trade_id_boundaries;
+
+                std::unique_ptr<bucket_store> _buckets;
+                boost::filesystem::path _buckets_path;
+                bool _buckets_opened = false;
+
                 golos::chain::database &_db;
             };
 
@@ -66,120 +161,349 @@ namespace golos {
                     fill_order_operation op = o.op.get<fill_order_operation>();
 
                     auto &db = database();
-                    const auto& bucket_idx = db.get_index<bucket_index, by_bucket>();
 
+                    // buckets are updated from these objects when the block becomes irreversible
                     db.create<order_history_object>([&](auto& ho) {
                         ho.time = db.head_block_time();
                         ho.op = op;
                     });
+                }
+            }
 
-                    if (!_maximum_history_per_bucket_size) {
-                        return;
+            int64_t market_history_plugin::market_history_plugin_impl::next_trade_id() const {
+                const auto &idx = _db.get_index<order_history_index, by_id>();
+                return idx.empty() ? 0 : idx.rbegin()->id._id + 1;
+            }
+
+            // Pending transactions are undone before the block is applied, so the trades created after the boundary
+            // of the previous block are the trades of the block, and trades of pending transactions aren't sent
+            void market_history_plugin::market_history_plugin_impl::collect_block_trades(const signed_block &block) {
+                auto &db = database();
+                const auto block_num = block.block_num();
+
+                auto first_id = next_trade_id();
+                auto boundary = _trade_id_boundaries.find(block_num - 1);
+                if (boundary != _trade_id_boundaries.end()) {
+                    first_id = boundary->second;
+                } else {
+                    // the first block applied by the plugin, trades of a block have the time of the previous block
+                    auto previous = db.fetch_block_by_id(block.previous);
+                    if (previous.valid()) {
+                        const auto &time_idx = db.get_index<order_history_index, by_time>();
+                        auto trade = time_idx.lower_bound(previous->timestamp);
+                        if (trade != time_idx.end()) {
+                            first_id = trade->id._id;
+                        }
                     }
-                    if (!_tracked_buckets.size()) {
+                }
+
+                // boundaries of popped blocks are replaced by the blocks of the fork
+                _trade_id_boundaries.erase(_trade_id_boundaries.lower_bound(block_num), _trade_id_boundaries.end());
+                _trade_id_boundaries.emplace(block_num, next_trade_id());
+                _trade_id_boundaries.erase(_trade_id_boundaries.begin(),
+                    _trade_id_boundaries.lower_bound(db.last_non_undoable_block_num()));
+
+                const auto &idx = db.get_index<order_history_index, by_id>();
+                for (auto itr = idx.lower_bound(order_history_id_type(first_id)); itr != idx.end(); ++itr) {
+                    market_trade trade;
+                    trade.id = itr->id;
+                    trade.date = itr->time;
+                    trade.current_pays = itr->op.current_pays;
+                    trade.open_pays = itr->op.open_pays;
+                    _block_trades[get_symbol_type_pair(trade.open_pays, trade.current_pays)].push_back(trade);
+                }
+            }
+
+            void market_history_plugin::market_history_plugin_impl::get_trade_amounts(const order_history_object &trade,
+                    symbol_type_pair &pair, share_type &amount1, share_type &amount2) const {
+                const auto &op = trade.op;
+                pair = get_symbol_type_pair(op.open_pays, op.current_pays);
+                if (op.open_pays.symbol == pair.first) {
+                    amount1 = op.open_pays.amount;
+                    amount2 = op.current_pays.amount;
+                } else {
+                    amount1 = op.current_pays.amount;
+                    amount2 = op.open_pays.amount;
+                }
+            }
+
+            // Called at the start, trades of irreversible blocks which aren't in the loaded file are added to the buckets
+            void market_history_plugin::market_history_plugin_impl::open_buckets() {
+                auto &db = database();
+                _buckets_opened = true;
+
+                if (_buckets_path.empty() || !_buckets->load(_buckets_path) || _buckets->next_trade_id() > next_trade_id()) {
+                    // the file can be written by a later state, e.g. before a replay, then it is built again
+                    ilog("market_history: building buckets from the trade history");
+                    _buckets->clear();
+                } else {
+                    ilog("market_history: loaded buckets from ${p}", ("p", _buckets_path.string()));
+                }
+
+                auto lib = db.last_non_undoable_block_num();
+                if (!_trade_id_boundaries.count(lib)) {
+                    auto lib_block = db.fetch_block_by_number(lib);
+                    if (!lib_block.valid()) {
                         return;
                     }
+                    // trades of a block have the time of the previous block, so the first reversible trades have the time of lib
+                    const auto &time_idx = db.get_index<order_history_index, by_time>();
+                    auto trade = time_idx.lower_bound(lib_block->timestamp);
+                    _trade_id_boundaries.emplace(lib, trade != time_idx.end() ? trade->id._id : next_trade_id());
+                }
+                move_trades(_trade_id_boundaries[lib]);
+            }
 
-                    asset_symbol_type sym1;
-                    asset_symbol_type sym2;
-                    std::tie(sym1, sym2) = get_symbol_type_pair(op.open_pays, op.current_pays);
-
-                    for (auto bucket : _tracked_buckets) {
-                        auto cutoff = db.head_block_time() - fc::seconds(
-                                bucket * _maximum_history_per_bucket_size);
-
-                        auto open = fc::time_point_sec(
-                                (db.head_block_time().sec_since_epoch() /
-                                 bucket) * bucket);
-                        auto seconds = bucket;
-
-                        auto itr = bucket_idx.find(std::make_tuple(sym1, sym2, seconds, open));
-                        if (itr == bucket_idx.end()) {
-                            db.create<bucket_object>([&](auto& b) {
-                                b.sym1 = sym1;
-                                b.sym2 = sym2;
-
-                                b.open = open;
-                                b.seconds = bucket;
-
-                                if (op.open_pays.symbol == sym1) {
-                                    b.high_asset1 = op.open_pays.amount;
-                                    b.high_asset2 = op.current_pays.amount;
-                                    b.low_asset1 = op.open_pays.amount;
-                                    b.low_asset2 = op.current_pays.amount;
-                                    b.open_asset1 = op.open_pays.amount;
-                                    b.open_asset2 = op.current_pays.amount;
-                                    b.close_asset1 = op.open_pays.amount;
-                                    b.close_asset2 = op.current_pays.amount;
-                                    b.asset1_volume = op.open_pays.amount;
-                                    b.asset2_volume = op.current_pays.amount;
-                                } else {
-                                    b.high_asset1 = op.current_pays.amount;
-                                    b.high_asset2 = op.open_pays.amount;
-                                    b.low_asset1 = op.current_pays.amount;
-                                    b.low_asset2 = op.open_pays.amount;
-                                    b.open_asset1 = op.current_pays.amount;
-                                    b.open_asset2 = op.open_pays.amount;
-                                    b.close_asset1 = op.current_pays.amount;
-                                    b.close_asset2 = op.open_pays.amount;
-                                    b.asset1_volume = op.current_pays.amount;
-                                    b.asset2_volume = op.open_pays.amount;
-                                }
-                            });
+            void market_history_plugin::market_history_plugin_impl::close_buckets() {
+                if (!_buckets_opened || _buckets_path.empty()) {
+                    return;
+                }
+                try {
+                    _buckets->save(_buckets_path);
+                    ilog("market_history: saved buckets to ${p}", ("p", _buckets_path.string()));
+                } FC_CAPTURE_LOG_AND_RETHROW((_buckets_path.string()))
+            }
+
+            void market_history_plugin::market_history_plugin_impl::move_trades(int64_t end_id) {
+                const auto &idx = database().get_index<order_history_index, by_id>();
+                auto trade = idx.lower_bound(order_history_id_type(_buckets->next_trade_id()));
+                for (; trade != idx.end() && trade->id._id < end_id; ++trade) {
+                    symbol_type_pair pair;
+                    share_type amount1;
+                    share_type amount2;
+                    get_trade_amounts(*trade, pair, amount1, amount2);
+                    _buckets->add_trade(pair.first, pair.second, trade->time, amount1, amount2);
+                    _buckets->set_next_trade_id(trade->id._id + 1);
+                }
+            }
+
+            // Trades of irreversible blocks can't be undone, so they are moved into the columns of the bucket store.
+            // Chainbase reuses ids of undone objects, so trades are moved up to the id boundary of the irreversible block.
+            void market_history_plugin::market_history_plugin_impl::move_irreversible_trades() {
+                if (!_buckets_opened) {
+                    return; // blocks are applied before the start
+                }
+
+                auto boundary = _trade_id_boundaries.find(database().last_non_undoable_block_num());
+                if (boundary == _trade_id_boundaries.end()) {
+                    return; // the irreversible block is applied before the start
+                }
+                move_trades(boundary->second);
+            }
+
+            std::vector<bucket_object> market_history_plugin::market_history_plugin_impl::get_buckets(
+                    const symbol_type_pair& pair, uint32_t seconds, time_point_sec start, time_point_sec end) const {
+                if (!_maximum_history_per_bucket_size || !_tracked_buckets.count(seconds)) {
+                    return {};
+                }
+
+                auto result = _buckets->get_buckets(pair.first, pair.second, seconds, start, end);
+
+                // trades of reversible blocks are newer than the stored ones, so they can change only the last buckets
+                const auto &idx = _db.get_index<order_history_index, by_id>();
+                auto trade = idx.lower_bound(order_history_id_type(_buckets->next_trade_id()));
+                for (; trade != idx.end(); ++trade) {
+                    symbol_type_pair trade_pair;
+                    share_type amount1;
+                    share_type amount2;
+                    get_trade_amounts(*trade, trade_pair, amount1, amount2);
+                    if (trade_pair != pair) {
+                        continue;
+                    }
+
+                    auto open = fc::time_point_sec((trade->time.sec_since_epoch() / seconds) * seconds);
+                    if (open < start || open >= end) {
+                        continue;
+                    }
+                    if (!result.empty() && result.back().open == open) {
+                        add_trade_to_bucket(result.back(), amount1, amount2);
+                    } else {
+                        result.push_back(make_bucket(pair.first, pair.second, seconds, open, amount1, amount2));
+                    }
+                }
+                return result;
+            }
+
+            void market_history_plugin::market_history_plugin_impl::touch_orders(const operation_notification &o) {
+                o.op.visit(order_touch_visitor(_touched_orders));
+            }
+
+            // Called after each block under the write lock, so api readers never see the book in the middle of update
+            void market_history_plugin::market_history_plugin_impl::update_order_book(const signed_block &block) {
+                auto &db = database();
+
+                // blocks are applied before the start (e.g. by the replay), or popped blocks were undone after a fork
+                if (block.previous != _order_book_block_id) {
+                    rebuild_order_book();
+                    return;
+                }
+
+                for (const auto &key : _touched_orders) {
+                    auto order = db.find_limit_order(key.first, key.second);
+                    if (order) {
+                        _order_book.update(*order);
+                    } else {
+                        _order_book.remove(key.first, key.second);
+                    }
+                }
+                _touched_orders.clear();
+
+                _order_book.remove_expired(db.head_block_time());
+
+                // orders are cancelled by the chain itself without operations (e.g. on the debt conversion)
+                if (_order_book.size() != db.get_index<golos::chain::limit_order_index>().indices().size()) {
+                    rebuild_order_book();
+                    return;
+                }
+
+                _order_book_block_id = db.head_block_id();
+            }
+
+            void market_history_plugin::market_history_plugin_impl::rebuild_order_book() {
+                auto &db = database();
+
+                _order_book.clear();
+                _touched_orders.clear();
+
+                const auto &order_idx = db.get_index<golos::chain::limit_order_index>().indices();
+                for (const auto &order : order_idx) {
+                    _order_book.update(order);
+                }
+                _order_book_block_id = db.head_block_id();
+            }
+
+            void market_history_plugin::market_history_plugin_impl::add_market_callback(
+                    const symbol_type_pair& pair, bool reversed, market_subscription::callback_type callback) {
+                auto subscription = std::make_shared<market_subscription>();
+                subscription->pair = pair;
+                subscription->reversed = reversed;
+                subscription->callback = std::move(callback);
+
+                std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+                _subscriptions.push_back(std::move(subscription));
+            }
+
+            market_update market_history_plugin::market_history_plugin_impl::get_market_update(
+                    const symbol_type_pair& pair, bool reversed, const signed_block &block) {
+                market_update result;
+                result.block_num = block.block_num();
+                result.time = block.timestamp;
+                result.reset = _order_book.is_reset();
+
+                auto add_levels = [&](std::vector<order>& levels, asset_symbol_type base, asset_symbol_type quote) {
+                    auto side = _order_book.find_side(base, quote);
+                    auto make_level = [&](const price& level_price, share_type for_sale) {
+                        order cur;
+                        if (base == pair.second) {
+                            cur.price = level_price.base.to_real() / level_price.quote.to_real();
+                            cur.asset1 = (asset(for_sale, base) * level_price).amount;
+                            cur.asset2 = for_sale;
                         } else {
-                            db.modify(*itr, [&](auto& b) {
-                                if (op.open_pays.symbol == sym1) {
-                                    b.asset1_volume += op.open_pays.amount;
-                                    b.asset2_volume += op.current_pays.amount;
-                                    b.close_asset1 = op.open_pays.amount;
-                                    b.close_asset2 = op.current_pays.amount;
-
-                                    if (b.high() <
-                                        price(op.current_pays, op.open_pays)) {
-                                        b.high_asset1 = op.open_pays.amount;
-                                        b.high_asset2 = op.current_pays.amount;
-                                    }
-
-                                    if (b.low() >
-                                        price(op.current_pays, op.open_pays)) {
-                                        b.low_asset1 = op.open_pays.amount;
-                                        b.low_asset2 = op.current_pays.amount;
-                                    }
-                                } else {
-                                    b.asset1_volume += op.current_pays.amount;
-                                    b.asset2_volume += op.open_pays.amount;
-                                    b.close_asset1 = op.current_pays.amount;
-                                    b.close_asset2 = op.open_pays.amount;
-
-                                    if (b.high() <
-                                        price(op.open_pays, op.current_pays)) {
-                                        b.high_asset1 = op.current_pays.amount;
-                                        b.high_asset2 = op.open_pays.amount;
-                                    }
-
-                                    if (b.low() >
-                                        price(op.open_pays, op.current_pays)) {
-                                        b.low_asset1 = op.current_pays.amount;
-                                        b.low_asset2 = op.open_pays.amount;
-                                    }
-                                }
-                            });
+                            cur.price = level_price.quote.to_real() / level_price.base.to_real();
+                            cur.asset1 = for_sale;
+                            cur.asset2 = (asset(for_sale, base) * level_price).amount;
+                        }
+                        return cur;
+                    };
 
-                            if (_maximum_history_per_bucket_size > 0) {
-                                open = fc::time_point_sec();
-                                itr = bucket_idx.lower_bound(std::make_tuple(sym1, sym2, seconds, open));
-
-                                while (itr->sym1 == sym1 && itr->sym2 == sym2 &&
-                                       itr->seconds == seconds &&
-                                       itr->open < cutoff) {
-                                    auto old_itr = itr;
-                                    ++itr;
-                                    db.remove(*old_itr);
-                                }
+                    if (result.reset) {
+                        if (side) {
+                            for (const auto& level : side->levels) {
+                                levels.push_back(make_level(level.first, level.second));
                             }
                         }
+                        return;
+                    }
+
+                    auto changed = _order_book.find_changed_levels(base, quote);
+                    if (!changed) {
+                        return;
+                    }
+                    for (const auto& level_price : *changed) {
+                        share_type for_sale = 0;
+                        if (side) {
+                            auto itr = side->levels.find(level_price);
+                            if (itr != side->levels.end()) {
+                                for_sale = itr->second;
+                            }
+                        }
+                        levels.push_back(make_level(level_price, for_sale));
+                    }
+                };
+                add_levels(result.bids, pair.second, pair.first);
+                add_levels(result.asks, pair.first, pair.second);
+
+                auto trades = _block_trades.find(pair);
+                if (trades != _block_trades.end()) {
+                    result.trades = trades->second;
+
+                    // trades of a block have the time of the previous block, so their buckets can be opened before the block
+                    const auto time = trades->second.back().date;
+                    for (auto seconds : _tracked_buckets) {
+                        auto open = time_point_sec((time.sec_since_epoch() / seconds) * seconds);
+                        auto buckets = get_buckets(pair, seconds, open, open + seconds);
+                        result.buckets.insert(result.buckets.end(), buckets.begin(), buckets.end());
+                    }
+                }
+
+                if (reversed) {
+                    std::swap(result.bids, result.asks);
+                    for (auto& order : result.bids) {
+                        std::swap(order.asset1, order.asset2);
+                        reverse_price(order.price);
+                    }
+                    for (auto& order : result.asks) {
+                        std::swap(order.asset1, order.asset2);
+                        reverse_price(order.price);
+                    }
+                }
+
+                return result;
+            }
+
+            // Called after update of the order book, each update is computed and serialized once for all its subscribers
+            void market_history_plugin::market_history_plugin_impl::publish_market_updates(const signed_block &block) {
+                std::vector<market_subscription_ptr> subscriptions;
+                {
+                    std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+                    subscriptions.assign(_subscriptions.begin(), _subscriptions.end());
+                }
+
+                std::map<std::pair<symbol_type_pair, bool>, std::string> updates;
+                std::vector<market_subscription_ptr> failed;
+                for (const auto& subscription : subscriptions) {
+                    auto key = std::make_pair(subscription->pair, subscription->reversed);
+                    auto itr = updates.find(key);
+                    if (itr == updates.end()) {
+                        auto update = get_market_update(subscription->pair, subscription->reversed, block);
+                        std::string json;
+                        // markets without changes aren't sent
+                        if (update.reset || !update.bids.empty() || !update.asks.empty() ||
+                            !update.trades.empty() || !update.buckets.empty()
+                        ) {
+                            json = json_rpc::to_json(update);
+                        }
+                        itr = updates.emplace(key, std::move(json)).first;
+                    }
+                    if (itr->second.empty()) {
+                        continue;
+                    }
+                    try {
+                        subscription->callback(itr->second);
+                    } catch (...) {
+                        failed.push_back(subscription);
                     }
                 }
+
+                if (!failed.empty()) {
+                    std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+                    for (const auto& subscription : failed) {
+                        _subscriptions.remove(subscription);
+                    }
+                }
+
+                _order_book.clear_changes();
+                _block_trades.clear();
             }
 
             symbol_type_pair market_history_plugin::market_history_plugin_impl::get_symbol_type_pair(asset asset1, asset asset2, bool* pair_reversed) const {
@@ -223,12 +547,12 @@ namespace golos {
             }
 
             market_ticker market_history_plugin::market_history_plugin_impl::get_ticker(const symbol_type_pair& pair) const {
-                const auto& bucket_idx = _db.get_index<bucket_index, by_bucket>();
-                auto itr = bucket_idx.lower_bound(std::make_tuple(pair.first, pair.second, 86400, database().head_block_time() - 86400));
+                auto buckets = get_buckets(pair, 86400, database().head_block_time() - 86400, time_point_sec::maximum());
+                auto itr = buckets.begin();
 
                 market_ticker result;
 
-                if (itr != bucket_idx.end() && itr->seconds == 86400) {
+                if (itr != buckets.end()) {
                     auto open1 = (asset(itr->open_asset2, pair.second) /
                                  asset(itr->open_asset1, pair.first)).to_real();
                     result.latest1 = (asset(itr->close_asset2, pair.second) /
@@ -249,12 +573,15 @@ namespace golos {
                     result.percent_change2 = 0;
                 }
 
-                auto orders = get_order_book(pair, 1);
-                if (orders.bids.size()) {
-                    result.highest_bid = orders.bids[0].price;
+                auto bids = _order_book.find_side(pair.second, pair.first);
+                if (bids) {
+                    const auto &best = bids->levels.begin()->first;
+                    result.highest_bid = best.base.to_real() / best.quote.to_real();
                 }
-                if (orders.asks.size()) {
-                    result.lowest_ask = orders.asks[0].price;
+                auto asks = _order_book.find_side(pair.first, pair.second);
+                if (asks) {
+                    const auto &best = asks->levels.begin()->first;
+                    result.lowest_ask = best.quote.to_real() / best.base.to_real();
                 }
 
                 auto volume = get_volume(pair);
@@ -271,18 +598,13 @@ namespace golos {
             market_volume market_history_plugin::market_history_plugin_impl::get_volume(const symbol_type_pair& pair) const {
                 market_volume result;
 
-                const auto& bucket_idx = _db.get_index<bucket_index, by_bucket>();
-                auto itr = bucket_idx.lower_bound(std::make_tuple(pair.first, pair.second, 86400, database().head_block_time() - 86400));
                 result.asset1_volume = asset(0, pair.first);
                 result.asset2_volume = asset(0, pair.second);
 
-                while (itr != bucket_idx.end() &&
-                        itr->sym1 == pair.first && itr->sym2 == pair.second &&
-                        itr->seconds == 86400) {
-                    result.asset1_volume.amount += itr->asset1_volume;
-                    result.asset2_volume.amount += itr->asset2_volume;
-
-                    ++itr;
+                auto buckets = get_buckets(pair, 86400, database().head_block_time() - 86400, time_point_sec::maximum());
+                for (const auto& bucket : buckets) {
+                    result.asset1_volume.amount += bucket.asset1_volume;
+                    result.asset2_volume.amount += bucket.asset2_volume;
                 }
 
                 return result;
@@ -290,32 +612,13 @@ namespace golos {
 
             market_depth market_history_plugin::market_history_plugin_impl::get_depth(const symbol_type_pair& pair) const {
                 market_depth result;
-                result.asset1_depth = asset(0, pair.first);
-                result.asset2_depth = asset(0, pair.second);
-
-                const auto& order_idx = _db.get_index<golos::chain::limit_order_index, golos::chain::by_price>();
-                auto itr = order_idx.lower_bound(price::max(pair.second, pair.first));
-
-                while (itr != order_idx.end() &&
-                       itr->sell_price.base.symbol == pair.second &&
-                       itr->sell_price.quote.symbol == pair.first) {
-                    result.asset2_depth += itr->amount_for_sale();
-                    ++itr;
-                }
-
-                itr = order_idx.lower_bound(price::max(pair.first, pair.second));
-
-                while (itr != order_idx.end() &&
-                       itr->sell_price.base.symbol == pair.first &&
-                       itr->sell_price.quote.symbol == pair.second) {
-                    result.asset1_depth += itr->amount_for_sale();
-                    ++itr;
-                }
+                result.asset1_depth = _order_book.depth(pair.first, pair.second);
+                result.asset2_depth = _order_book.depth(pair.second, pair.first);
                 return result;
             }
 
             order_book market_history_plugin::market_history_plugin_impl::get_order_book(const symbol_type_pair& pair, uint32_t limit) const {
-                const auto& order_idx = _db.get_index<golos::chain::limit_order_index, golos::chain::by_price>();
+                const auto& order_idx = _order_book.orders().get<by_book_price>();
                 auto itr = order_idx.lower_bound(price::max(pair.second, pair.first));
 
                 order_book result;
@@ -354,7 +657,7 @@ namespace golos {
 
                 auto max_sell = price::max(pair.second, pair.first);
                 auto max_buy = price::max(pair.first, pair.second);
-                const auto& limit_price_idx = _db.get_index<golos::chain::limit_order_index, golos::chain::by_price>();
+                const auto& limit_price_idx = _order_book.orders().get<by_book_price>();
                 auto sell_itr = limit_price_idx.lower_bound(max_sell);
                 auto buy_itr = limit_price_idx.lower_bound(max_buy);
                 auto end = limit_price_idx.end();
@@ -448,20 +751,7 @@ namespace golos {
 
             vector<bucket_object> market_history_plugin::market_history_plugin_impl::get_market_history(
                     const symbol_type_pair& pair, uint32_t bucket_seconds, time_point_sec start, time_point_sec end) const {
-                const auto& bucket_idx = _db.get_index<bucket_index, by_bucket>();
-                auto itr = bucket_idx.lower_bound(std::make_tuple(pair.first, pair.second, bucket_seconds, start));
-
-                std::vector<bucket_object> result;
-
-                while (itr != bucket_idx.end() &&
-                       itr->sym1 == pair.first && itr->sym2 == pair.second &&
-                       itr->seconds == bucket_seconds && itr->open < end) {
-                    result.push_back(*itr);
-
-                    ++itr;
-                }
-
-                return result;
+                return get_buckets(pair, bucket_seconds, start, end);
             }
 
             flat_set<uint32_t> market_history_plugin::market_history_plugin_impl::get_market_history_buckets() const {
@@ -544,7 +834,10 @@ namespace golos {
                          "Track market history by grouping orders into buckets of equal size measured in seconds specified as a JSON array of numbers")
                         ("market-history-buckets-per-size",
                          boost::program_options::value<uint32_t>()->default_value(5760),
-                         "How far back in time to track history for each bucket size, measured in the number of buckets (default: 5760)");
+                         "How far back in time to track history for each bucket size, measured in the number of buckets (default: 5760)")
+                        ("market-history-buckets-file",
+                         boost::program_options::value<boost::filesystem::path>()->default_value("market_history/buckets.bin"),
+                         "File where buckets of irreversible trades are saved on shutdown (relative to data-dir)");
             }
 
             void market_history_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
@@ -554,9 +847,19 @@ namespace golos {
                     golos::chain::database& db = _my->database();
 
                     db.post_apply_operation.connect(
-                            [&](const golos::chain::operation_notification &o) { _my->update_market_histories(o); });
-                    golos::chain::add_plugin_index<bucket_index>(db);
+                            [&](const golos::chain::operation_notification &o) {
+                                _my->update_market_histories(o);
+                                _my->touch_orders(o);
+                            });
+                    db.applied_block.connect([&](const signed_block &block) {
+                        _my->collect_block_trades(block);
+                        _my->update_order_book(block);
+                        _my->move_irreversible_trades();
+                        _my->publish_market_updates(block);
+                    });
                     golos::chain::add_plugin_index<order_history_index>(db);
+                    // history of trades starts from the block of a loaded snapshot
+                    golos::chain::add_plugin_empty_snapshot_index<order_history_index>(db, "order_history_index");
 
                     if (options.count("bucket-size")) {
                         std::string buckets = options["bucket-size"].as<string>();
@@ -569,6 +872,16 @@ namespace golos {
                     wlog("bucket-size ${b}", ("b", _my->_tracked_buckets));
                     wlog("history-per-size ${h}", ("h", _my->_maximum_history_per_bucket_size));
 
+                    GOLOS_CHECK_OPTION(_my->_tracked_buckets.find(0) == _my->_tracked_buckets.end(),
+                        "bucket-size should contain only positive numbers of seconds");
+                    _my->_buckets = std::make_unique<bucket_store>(
+                        _my->_tracked_buckets, _my->_maximum_history_per_bucket_size);
+
+                    _my->_buckets_path = options.at("market-history-buckets-file").as<boost::filesystem::path>();
+                    if (_my->_buckets_path.is_relative()) {
+                        _my->_buckets_path = appbase::app().data_dir() / _my->_buckets_path;
+                    }
+
                     ilog("market_history plugin: plugin_initialize() end");
                     JSON_RPC_REGISTER_API ( name() ) ;
                 } FC_CAPTURE_AND_RETHROW()
@@ -577,12 +890,22 @@ namespace golos {
             void market_history_plugin::plugin_startup() {
                 ilog("market_history plugin: plugin_startup() begin");
 
+                // api readers can come before the first applied block, so the book and the buckets are built from the state
+                auto &db = _my->database();
+                db.with_weak_read_lock([&]() {
+                    _my->rebuild_order_book();
+                    _my->_trade_id_boundaries.emplace(db.head_block_num(), _my->next_trade_id());
+                    _my->open_buckets();
+                });
+
                 ilog("market_history plugin: plugin_startup() end");
             }
 
             void market_history_plugin::plugin_shutdown() {
                 ilog("market_history plugin: plugin_shutdown() begin");
 
+                _my->close_buckets();
+
                 ilog("market_history plugin: plugin_shutdown() end");
             }
 
@@ -594,6 +917,10 @@ namespace golos {
                 return _my->_maximum_history_per_bucket_size;
             }
 
+            const order_book_cache &market_history_plugin::get_order_book_cache() const {
+                return _my->_order_book;
+            }
+
 
             // Api Defines
 
@@ -787,6 +1114,28 @@ namespace golos {
                 });
             }
 
+            DEFINE_API(market_history_plugin, set_market_callback) {
+                PLUGIN_API_VALIDATE_ARGS(
+                    (symbol_name_pair, pair, symbol_name_pair("GOLOS", "GBG"))
+                );
+
+                // Delegate connection handlers to callback
+                json_rpc::msg_pack_transfer transfer(args);
+
+                auto &db = _my->database();
+                db.with_weak_read_lock([&]() {
+                    bool reversed;
+                    auto type_pair = _my->get_symbol_type_pair(pair, &reversed);
+                    _my->add_market_callback(type_pair, reversed, [msg = transfer.msg()](const std::string &update) {
+                        msg->unsafe_json_result(update);
+                    });
+                });
+
+                transfer.complete();
+
+                return {};
+            }
+
         }
     }
 } // golos::plugins::market_history
@@ -0,0 +1,103 @@
+#include <golos/plugins/market_history/order_book.hpp>
+
+namespace golos {
+    namespace plugins {
+        namespace market_history {
+
+            void order_book_cache::clear() {
+                _orders.clear();
+                _sides.clear();
+                _changed_levels.clear();
+                _reset = true;
+            }
+
+            void order_book_cache::update(const limit_order_object &order) {
+                auto &idx = _orders.get<by_book_order>();
+                auto itr = idx.find(std::make_tuple(order.seller, order.orderid));
+                if (itr != idx.end()) {
+                    remove_from_level(*itr);
+                    idx.replace(itr, book_order(order));
+                } else {
+                    itr = idx.insert(book_order(order)).first;
+                }
+                add_to_level(*itr);
+            }
+
+            void order_book_cache::remove(const account_name_type &seller, uint32_t orderid) {
+                auto &idx = _orders.get<by_book_order>();
+                auto itr = idx.find(std::make_tuple(seller, orderid));
+                if (itr != idx.end()) {
+                    remove_from_level(*itr);
+                    idx.erase(itr);
+                }
+            }
+
+            void order_book_cache::remove_expired(fc::time_point_sec now) {
+                auto &idx = _orders.get<by_book_expiration>();
+                auto itr = idx.begin();
+                while (itr != idx.end() && itr->expiration < now) {
+                    remove_from_level(*itr);
+                    itr = idx.erase(itr);
+                }
+            }
+
+            const book_side *order_book_cache::find_side(asset_symbol_type base, asset_symbol_type quote) const {
+                auto itr = _sides.find(side_key(base, quote));
+                if (itr == _sides.end()) {
+                    return nullptr;
+                }
+                return &itr->second;
+            }
+
+            asset order_book_cache::depth(asset_symbol_type base, asset_symbol_type quote) const {
+                auto side = find_side(base, quote);
+                return asset(side ? side->for_sale : share_type(0), base);
+            }
+
+            const order_book_cache::changed_prices *order_book_cache::find_changed_levels(
+                    asset_symbol_type base, asset_symbol_type quote) const {
+                auto itr = _changed_levels.find(side_key(base, quote));
+                if (itr == _changed_levels.end()) {
+                    return nullptr;
+                }
+                return &itr->second;
+            }
+
+            void order_book_cache::clear_changes() {
+                _changed_levels.clear();
+                _reset = false;
+            }
+
+            void order_book_cache::add_to_level(const book_order &order) {
+                side_key key(order.sell_price.base.symbol, order.sell_price.quote.symbol);
+                auto &side = _sides[key];
+                side.levels[order.sell_price] += order.for_sale;
+                side.for_sale += order.for_sale;
+                _changed_levels[key].insert(order.sell_price);
+            }
+
+            void order_book_cache::remove_from_level(const book_order &order) {
+                side_key key(order.sell_price.base.symbol, order.sell_price.quote.symbol);
+                _changed_levels[key].insert(order.sell_price);
+
+                auto side_itr = _sides.find(key);
+                if (side_itr == _sides.end()) {
+                    return;
+                }
+                auto &side = side_itr->second;
+                auto level_itr = side.levels.find(order.sell_price);
+                if (level_itr != side.levels.end()) {
+                    level_itr->second -= order.for_sale;
+                    if (level_itr->second <= 0) {
+                        side.levels.erase(level_itr);
+                    }
+                }
+                side.for_sale -= order.for_sale;
+                if (side.levels.empty()) {
+                    _sides.erase(side_itr);
+                }
+            }
+
+        }
+    }
+} // golos::plugins::market_history
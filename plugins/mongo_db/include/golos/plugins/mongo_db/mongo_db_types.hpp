@@ -144,15 +144,18 @@ namespace mongo_db {
         doc << name << to_string(value);
     }
 
-    inline void format_json(document& doc, const std::string& name, const shared_string& value) {
-        auto str_value = to_string(value);
+    inline void format_json(document& doc, const std::string& name, const std::string& value) {
         try {
-            doc << name << bsoncxx::from_json(str_value);
+            doc << name << bsoncxx::from_json(value);
         } catch (...) {
-            doc << name << str_value;
+            doc << name << value;
         }
     }
 
+    inline void format_json(document& doc, const std::string& name, const shared_string& value) {
+        format_json(doc, name, to_string(value));
+    }
+
     template <typename T>
     inline void format_value(document& doc, const std::string& name, const fc::fixed_string<T>& value) {
         doc << name << static_cast<std::string>(value);
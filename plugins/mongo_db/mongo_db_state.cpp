@@ -126,9 +126,10 @@ namespace mongo_db {
                 const auto& con_idx = db_.get_index<golos::plugins::social_network::comment_content_index>().indices().get<golos::plugins::social_network::by_comment>();
                 auto con_itr = con_idx.find(comment.id);
                 if (con_itr != con_idx.end()) {
-                    format_value(body, "title", con_itr->title);
-                    format_value(body, "body", con_itr->body);
-                    format_json(body, "json_metadata", con_itr->json_metadata);
+                    auto text = appbase::app().get_plugin<golos::plugins::social_network::social_network>().get_comment_text(*con_itr);
+                    format_value(body, "title", text.title);
+                    format_value(body, "body", text.body);
+                    format_json(body, "json_metadata", text.json_metadata);
                 }
             }
 
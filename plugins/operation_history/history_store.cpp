@@ -0,0 +1,842 @@
+#include <golos/plugins/operation_history/history_store.hpp>
+#include <golos/protocol/exceptions.hpp>
+
+#include <fc/crypto/city.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+#include <cstring>
+
+namespace golos { namespace plugins { namespace operation_history {
+
+    namespace bfs = boost::filesystem;
+
+    namespace detail {
+        using read_write_mutex = boost::shared_mutex;
+        using read_lock = boost::shared_lock<read_write_mutex>;
+        using write_lock = boost::unique_lock<read_write_mutex>;
+
+        static constexpr uint64_t storage_magic = 0x32534f5453484f47; // "GOHSTOS2"
+        static constexpr uint64_t min_storage_growth = 1024 * 1024;
+        static constexpr uint32_t segment_offset_bits = 40;
+        static constexpr uint64_t segment_offset_mask = (uint64_t(1) << segment_offset_bits) - 1;
+
+        struct storage_header final {
+            uint64_t magic = storage_magic;
+            uint64_t size = 0;
+            uint64_t value = 0;
+            uint64_t reserved = 0;
+        };
+
+        /**
+         * Memory-mapped file with a header and a payload, which grows by appending.
+         * The file is resized with reserve, so its size is larger than the used size of the payload.
+         */
+        class mapped_storage final {
+        public:
+            void open(const bfs::path& path, uint64_t initial_capacity) {
+                _path = path;
+                const bool created = !bfs::exists(path) || bfs::file_size(path) < sizeof(storage_header);
+                if (created) {
+                    bfs::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                    stream.close();
+                    bfs::resize_file(path, sizeof(storage_header) + std::max(initial_capacity, min_storage_growth));
+                }
+
+                _file.open(path.string(), boost::iostreams::mapped_file::readwrite);
+                if (created) {
+                    *reinterpret_cast<storage_header*>(_file.data()) = storage_header();
+                }
+
+                GOLOS_CHECK_DATABASE(header().magic == storage_magic,
+                    golos::database_corrupted::unknown_file_format,
+                    "Unknown format of the history store file ${path}",
+                    ("path", path.string()));
+                GOLOS_CHECK_DATABASE(header().size <= capacity(),
+                    golos::database_corrupted::reading_data_beyond_end_of_file,
+                    "History store file ${path} is truncated",
+                    ("path", path.string())("size", header().size)("capacity", capacity()));
+            }
+
+            void close() {
+                if (_file.is_open()) {
+                    _file.close();
+                }
+            }
+
+            bool is_open() const {
+                return _file.is_open();
+            }
+
+            const bfs::path& path() const {
+                return _path;
+            }
+
+            uint64_t size() const {
+                return header().size;
+            }
+
+            uint64_t capacity() const {
+                return _file.size() - sizeof(storage_header);
+            }
+
+            uint64_t value() const {
+                return header().value;
+            }
+
+            void set_value(uint64_t value) {
+                header().value = value;
+            }
+
+            const char* data() const {
+                return _file.const_data() + sizeof(storage_header);
+            }
+
+            char* data() {
+                return _file.data() + sizeof(storage_header);
+            }
+
+            void reserve(uint64_t new_capacity) {
+                if (new_capacity <= capacity()) {
+                    return;
+                }
+                new_capacity = std::max(new_capacity, capacity() + std::max(capacity() / 2, min_storage_growth));
+                _file.resize(sizeof(storage_header) + new_capacity);
+            }
+
+            /// @return offset of the appended data
+            uint64_t append(const char* src, uint64_t src_size) {
+                const auto offset = size();
+                reserve(offset + src_size);
+                std::memcpy(data() + offset, src, src_size);
+                // the size is changed last, so a partially written data is ignored after a crash
+                header().size = offset + src_size;
+                return offset;
+            }
+
+            void resize(uint64_t new_size) {
+                reserve(new_size);
+                header().size = new_size;
+            }
+
+        private:
+            storage_header& header() {
+                return *reinterpret_cast<storage_header*>(_file.data());
+            }
+
+            const storage_header& header() const {
+                return *reinterpret_cast<const storage_header*>(_file.const_data());
+            }
+
+            bfs::path _path;
+            boost::iostreams::mapped_file _file;
+        };
+
+        /**
+         * Log of variable-size records in segment files with the limited size.
+         * A position of a record contains the number of its segment and the offset in the segment.
+         */
+        class segment_log final {
+        public:
+            void open(const bfs::path& dir, const std::string& prefix, uint64_t segment_size) {
+                _dir = dir;
+                _prefix = prefix;
+                _segment_size = segment_size;
+                for (uint32_t n = 0; n == 0 || bfs::exists(segment_path(n)); ++n) {
+                    add_segment(n);
+                }
+            }
+
+            void close() {
+                _segments.clear();
+            }
+
+            uint64_t append(const std::vector<char>& record) {
+                const uint32_t record_size = record.size();
+                const uint64_t full_size = sizeof(record_size) + record_size;
+                if (_segments.back()->size() > 0 && _segments.back()->size() + full_size > _segment_size) {
+                    add_segment(_segments.size());
+                }
+
+                auto& segment = *_segments.back();
+                segment.reserve(segment.size() + full_size);
+                const auto offset = segment.size();
+                std::memcpy(segment.data() + offset, &record_size, sizeof(record_size));
+                std::memcpy(segment.data() + offset + sizeof(record_size), record.data(), record_size);
+                segment.resize(offset + full_size);
+
+                return (uint64_t(_segments.size() - 1) << segment_offset_bits) | offset;
+            }
+
+            /// @return pointer to the record in the mapped file and its size
+            std::pair<const char*, uint32_t> read(uint64_t pos) const {
+                const auto segment_num = pos >> segment_offset_bits;
+                const auto offset = pos & segment_offset_mask;
+                GOLOS_CHECK_DATABASE(segment_num < _segments.size(),
+                    golos::database_corrupted::reading_data_beyond_end_of_file,
+                    "Reading of the history record from the missing segment",
+                    ("segment", segment_num)("segments", _segments.size()));
+
+                const auto& segment = *_segments[segment_num];
+                uint32_t record_size = 0;
+                GOLOS_CHECK_DATABASE(offset + sizeof(record_size) <= segment.size(),
+                    golos::database_corrupted::reading_data_beyond_end_of_file,
+                    "Reading data beyond end of file",
+                    ("path", segment.path().string())("pos", offset)("file_size", segment.size()));
+
+                std::memcpy(&record_size, segment.data() + offset, sizeof(record_size));
+                GOLOS_CHECK_DATABASE(offset + sizeof(record_size) + record_size <= segment.size(),
+                    golos::database_corrupted::reading_data_beyond_end_of_file,
+                    "Reading data beyond end of file",
+                    ("path", segment.path().string())("pos", offset)("size", record_size)("file_size", segment.size()));
+
+                return {segment.data() + offset + sizeof(record_size), record_size};
+            }
+
+            /// @return position of the record, which follows the record at pos
+            uint64_t next(uint64_t pos, uint32_t record_size) const {
+                const auto segment_num = pos >> segment_offset_bits;
+                const auto offset = (pos & segment_offset_mask) + sizeof(record_size) + record_size;
+                // record never crosses the segment boundary, so the next one can be at the start of the next segment
+                if (offset >= _segments[segment_num]->size()) {
+                    return (segment_num + 1) << segment_offset_bits;
+                }
+                return (segment_num << segment_offset_bits) | offset;
+            }
+
+            template <typename T>
+            T read_value(uint64_t pos) const {
+                auto record = read(pos);
+                fc::datastream<const char*> ds(record.first, record.second);
+                T value;
+                fc::raw::unpack(ds, value);
+                return value;
+            }
+
+        private:
+            bfs::path segment_path(uint32_t n) const {
+                char name[16];
+                std::snprintf(name, sizeof(name), "%06u", n);
+                return _dir / (_prefix + "-" + name + ".seg");
+            }
+
+            void add_segment(uint32_t n) {
+                FC_ASSERT(n <= (uint64_t(-1) >> segment_offset_bits), "Too many segments in the history store");
+                _segments.emplace_back(std::make_unique<mapped_storage>());
+                _segments.back()->open(segment_path(n), std::min(_segment_size, uint64_t(64) << 20));
+            }
+
+            bfs::path _dir;
+            std::string _prefix;
+            uint64_t _segment_size = 0;
+            std::vector<std::unique_ptr<mapped_storage>> _segments;
+        };
+
+        /**
+         * Open-addressing hash table in the mapped file. Slot is empty if its key is empty.
+         * The table is rebuilt with the double capacity, when it becomes half-full.
+         */
+        template <typename Entry>
+        class mapped_hash_table final {
+        public:
+            void open(const bfs::path& path) {
+                _path = path;
+                _storage.open(path, initial_slots * sizeof(Entry));
+                if (_storage.size() == 0) {
+                    _storage.resize(initial_slots * sizeof(Entry));
+                    std::memset(_storage.data(), 0, _storage.size());
+                }
+            }
+
+            void close() {
+                _storage.close();
+            }
+
+            uint64_t slots() const {
+                return _storage.size() / sizeof(Entry);
+            }
+
+            /// Visits entries with the key until the visitor returns false
+            template <typename Key, typename Visitor>
+            void find(const Key& key, Visitor&& visitor) const {
+                const auto* entries = reinterpret_cast<const Entry*>(_storage.data());
+                const auto mask = slots() - 1;
+                for (auto i = Entry::hash(key) & mask; !entries[i].empty(); i = (i + 1) & mask) {
+                    if (entries[i].has_key(key) && !visitor(entries[i])) {
+                        return;
+                    }
+                }
+            }
+
+            template <typename Key>
+            Entry* find_one(const Key& key) {
+                auto* entries = reinterpret_cast<Entry*>(_storage.data());
+                const auto mask = slots() - 1;
+                for (auto i = Entry::hash(key) & mask; !entries[i].empty(); i = (i + 1) & mask) {
+                    if (entries[i].has_key(key)) {
+                        return &entries[i];
+                    }
+                }
+                return nullptr;
+            }
+
+            template <typename Key>
+            const Entry* find_one(const Key& key) const {
+                return const_cast<mapped_hash_table*>(this)->find_one(key);
+            }
+
+            template <typename Visitor>
+            void for_each(Visitor&& visitor) {
+                auto* entries = reinterpret_cast<Entry*>(_storage.data());
+                for (uint64_t i = 0, end = slots(); i < end; ++i) {
+                    if (!entries[i].empty()) {
+                        visitor(entries[i]);
+                    }
+                }
+            }
+
+            void insert(const Entry& entry) {
+                if ((_storage.value() + 1) * 2 > slots()) {
+                    grow();
+                }
+                insert(reinterpret_cast<Entry*>(_storage.data()), slots(), entry);
+                _storage.set_value(_storage.value() + 1);
+            }
+
+        private:
+            static constexpr uint64_t initial_slots = 1 << 16;
+
+            static void insert(Entry* entries, uint64_t slots, const Entry& entry) {
+                const auto mask = slots - 1;
+                auto i = Entry::hash(entry.key()) & mask;
+                while (!entries[i].empty()) {
+                    i = (i + 1) & mask;
+                }
+                entries[i] = entry;
+            }
+
+            void grow() {
+                const auto tmp_path = bfs::path(_path.string() + ".tmp");
+                bfs::remove(tmp_path);
+
+                mapped_storage next;
+                next.open(tmp_path, slots() * 2 * sizeof(Entry));
+                next.resize(slots() * 2 * sizeof(Entry));
+                std::memset(next.data(), 0, next.size());
+
+                const auto* entries = reinterpret_cast<const Entry*>(_storage.data());
+                auto* next_entries = reinterpret_cast<Entry*>(next.data());
+                for (uint64_t i = 0, end = slots(); i < end; ++i) {
+                    if (!entries[i].empty()) {
+                        insert(next_entries, end * 2, entries[i]);
+                    }
+                }
+                next.set_value(_storage.value());
+
+                next.close();
+                _storage.close();
+                bfs::rename(tmp_path, _path);
+                _storage.open(_path, 0);
+            }
+
+            bfs::path _path;
+            mapped_storage _storage;
+        };
+
+        struct block_entry final {
+            uint64_t pos = 0;
+            uint32_t count = 0;
+            uint32_t reserved = 0;
+        };
+
+        struct transaction_entry final {
+            uint64_t id_key = 0;
+            uint32_t block = 0;
+            uint32_t trx_in_block = 0;
+
+            static uint64_t to_key(const transaction_id_type& id) {
+                const uint64_t key = (uint64_t(id._hash[0]) << 32) | id._hash[1];
+                return key ? key : 1;
+            }
+
+            static uint64_t hash(uint64_t key) {
+                return key;
+            }
+
+            uint64_t key() const {
+                return id_key;
+            }
+
+            bool has_key(uint64_t key) const {
+                return id_key == key;
+            }
+
+            bool empty() const {
+                return id_key == 0;
+            }
+        };
+
+        struct account_entry final {
+            char name[16];
+            uint64_t head_pos = history_store::npos;
+            uint32_t count = 0;
+            uint32_t tags_block = 0; ///< offset of the last block of op tags in 8-byte units plus 1, or 0
+
+            static std::string to_key(const account_name_type& account) {
+                return std::string(account);
+            }
+
+            // the table is persisted, so the hash shouldn't depend on the standard library
+            static uint64_t hash(const std::string& key) {
+                return fc::city_hash64(key.data(), key.size());
+            }
+
+            std::string key() const {
+                return std::string(name, strnlen(name, sizeof(name)));
+            }
+
+            bool has_key(const std::string& key) const {
+                return key.size() <= sizeof(name) &&
+                    std::memcmp(name, key.data(), key.size()) == 0 &&
+                    (key.size() == sizeof(name) || name[key.size()] == '\0');
+            }
+
+            bool empty() const {
+                return name[0] == '\0';
+            }
+        };
+
+        /**
+         * Block of op tags, directions and positions of account records for consecutive sequences of an account.
+         * It is followed by arrays of capacity size. Capacity of blocks of an account grows from the minimal
+         * to the maximal, so accounts with few operations take little space.
+         */
+        struct account_tags_block final {
+            static constexpr uint16_t min_capacity = 8;
+            static constexpr uint16_t max_capacity = 256;
+
+            uint64_t prev_offset = history_store::npos;
+            uint32_t first_sequence = 0;
+            uint16_t count = 0;
+            uint16_t capacity = 0;
+
+            static uint64_t size_of(uint16_t capacity) {
+                return sizeof(account_tags_block) + uint64_t(capacity) * (2 * sizeof(uint8_t) + sizeof(uint64_t));
+            }
+
+            uint8_t* op_tags() {
+                return reinterpret_cast<uint8_t*>(this + 1);
+            }
+
+            const uint8_t* op_tags() const {
+                return reinterpret_cast<const uint8_t*>(this + 1);
+            }
+
+            uint8_t* dirs() {
+                return op_tags() + capacity;
+            }
+
+            const uint8_t* dirs() const {
+                return op_tags() + capacity;
+            }
+
+            uint64_t* record_positions() {
+                return reinterpret_cast<uint64_t*>(dirs() + capacity);
+            }
+
+            const uint64_t* record_positions() const {
+                return reinterpret_cast<const uint64_t*>(dirs() + capacity);
+            }
+        };
+
+        static_assert(sizeof(account_tags_block) == 16, "Unexpected size of account_tags_block");
+        static_assert(account_tags_block::min_capacity % 8 == 0, "Arrays of account_tags_block must be aligned");
+
+        struct account_record final {
+            uint64_t prev_pos = history_store::npos;
+            uint64_t skip_pos = history_store::npos;
+            uint32_t skip_sequence = 0;
+            stored_account_operation op;
+        };
+    }
+
+} } } // golos::plugins::operation_history
+
+FC_REFLECT(
+    (golos::plugins::operation_history::detail::account_record),
+    (prev_pos)(skip_pos)(skip_sequence)(op))
+
+namespace golos { namespace plugins { namespace operation_history {
+
+    namespace detail {
+        class history_store_impl final {
+        public:
+            void open(const bfs::path& dir, uint64_t segment_size) {
+                bfs::create_directories(dir);
+                this->dir = dir;
+                this->segment_size = segment_size;
+                operations.open(dir, "operations", segment_size);
+                account_operations.open(dir, "accounts", segment_size);
+                blocks.open(dir / "blocks.index", min_storage_growth);
+                transactions.open(dir / "transactions.index");
+                accounts.open(dir / "accounts.index");
+
+                const bool build_tags = !bfs::exists(dir / "account_tags.index");
+                account_tags.open(dir / "account_tags.index", min_storage_growth);
+                if (build_tags) {
+                    build_account_tags();
+                }
+            }
+
+            void close() {
+                operations.close();
+                account_operations.close();
+                blocks.close();
+                transactions.close();
+                accounts.close();
+                account_tags.close();
+            }
+
+            uint32_t first_block() const {
+                return blocks.size() ? blocks.value() : 0;
+            }
+
+            uint32_t head_block() const {
+                const auto count = blocks.size() / sizeof(block_entry);
+                return count ? blocks.value() + count - 1 : 0;
+            }
+
+            const block_entry& get_block_entry(uint32_t block_num) const {
+                return reinterpret_cast<const block_entry*>(blocks.data())[block_num - first_block()];
+            }
+
+            std::vector<stored_operation> get_block(uint32_t block_num) const {
+                std::vector<stored_operation> result;
+                if (!first_block() || block_num < first_block() || block_num > head_block()) {
+                    return result;
+                }
+
+                const auto& entry = get_block_entry(block_num);
+                result.reserve(entry.count);
+                auto pos = entry.pos;
+                for (uint32_t i = 0; i < entry.count; ++i) {
+                    // operations of a block are written together, so the next one follows the previous
+                    auto record = operations.read(pos);
+                    fc::datastream<const char*> ds(record.first, record.second);
+                    result.emplace_back();
+                    fc::raw::unpack(ds, result.back());
+
+                    pos = operations.next(pos, record.second);
+                }
+                return result;
+            }
+
+            /// @return position of the newest record with the sequence not greater than the target
+            uint64_t seek_account_record(uint64_t pos, uint32_t target) const {
+                while (pos != history_store::npos) {
+                    auto record = account_operations.read_value<account_record>(pos);
+                    if (record.op.sequence <= target) {
+                        return pos;
+                    }
+                    if (record.skip_pos != history_store::npos && record.skip_sequence >= target) {
+                        pos = record.skip_pos;
+                    } else {
+                        pos = record.prev_pos;
+                    }
+                }
+                return pos;
+            }
+
+            account_tags_block* get_tags_block(uint64_t offset) {
+                return reinterpret_cast<account_tags_block*>(account_tags.data() + offset);
+            }
+
+            const account_tags_block* get_tags_block(uint64_t offset) const {
+                return reinterpret_cast<const account_tags_block*>(account_tags.data() + offset);
+            }
+
+            static uint64_t tags_block_offset(const account_entry& entry) {
+                return entry.tags_block ? uint64_t(entry.tags_block - 1) * 8 : history_store::npos;
+            }
+
+            void append_account_tag(account_entry& entry, const stored_account_operation& op, uint64_t record_pos) {
+                auto offset = tags_block_offset(entry);
+                auto* block = offset != history_store::npos ? get_tags_block(offset) : nullptr;
+
+                // the sequence can rewrite the last ones, if they were written before a crash without the account entry
+                if (!block || op.sequence < block->first_sequence ||
+                    op.sequence - block->first_sequence > std::min<uint32_t>(block->count, block->capacity - 1)
+                ) {
+                    account_tags_block header;
+                    header.prev_offset = offset;
+                    header.first_sequence = op.sequence;
+                    header.capacity = block
+                        ? std::min<uint16_t>(block->capacity * 2, uint16_t(account_tags_block::max_capacity))
+                        : account_tags_block::min_capacity;
+
+                    offset = account_tags.size();
+                    FC_ASSERT(offset / 8 < uint32_t(-1), "Too large index of account operation tags");
+                    account_tags.resize(offset + account_tags_block::size_of(header.capacity));
+                    block = get_tags_block(offset);
+                    *block = header;
+                    entry.tags_block = uint32_t(offset / 8 + 1);
+                }
+
+                const auto i = op.sequence - block->first_sequence;
+                block->op_tags()[i] = op.op_tag;
+                block->dirs()[i] = op.dir;
+                block->record_positions()[i] = record_pos;
+                block->count = i + 1;
+            }
+
+            // fills the index of op tags for a store, which was created without it
+            void build_account_tags() {
+                uint32_t accounts_count = 0;
+                accounts.for_each([&](account_entry& entry) {
+                    entry.tags_block = 0;
+                    std::vector<std::pair<uint64_t, account_record>> records;
+                    for (auto pos = entry.head_pos; pos != history_store::npos; pos = records.back().second.prev_pos) {
+                        records.emplace_back(pos, account_operations.read_value<account_record>(pos));
+                    }
+                    for (auto itr = records.rbegin(); itr != records.rend(); ++itr) {
+                        append_account_tag(entry, itr->second.op, itr->first);
+                    }
+                    ++accounts_count;
+                });
+                if (accounts_count) {
+                    ilog("Built index of operation tags for ${n} accounts of the history store", ("n", accounts_count));
+                }
+            }
+
+            bfs::path dir;
+            uint64_t segment_size = 0;
+
+            segment_log operations;
+            segment_log account_operations;
+            mapped_storage blocks;
+            mapped_hash_table<transaction_entry> transactions;
+            mapped_hash_table<account_entry> accounts;
+            mapped_storage account_tags;
+
+            mutable read_write_mutex mutex;
+        };
+    }
+
+    using namespace detail;
+
+    history_store::history_store()
+        : _impl(std::make_unique<history_store_impl>()) {
+    }
+
+    history_store::~history_store() {
+        close();
+    }
+
+    void history_store::open(const fc::path& dir, uint64_t segment_size) {
+        write_lock lock(_impl->mutex);
+        _impl->open(dir, segment_size);
+    }
+
+    void history_store::close() {
+        write_lock lock(_impl->mutex);
+        _impl->close();
+    }
+
+    bool history_store::is_open() const {
+        read_lock lock(_impl->mutex);
+        return _impl->blocks.is_open();
+    }
+
+    void history_store::wipe() {
+        write_lock lock(_impl->mutex);
+        const auto dir = _impl->dir;
+        const auto segment_size = _impl->segment_size;
+        _impl->close();
+        for (bfs::directory_iterator itr(dir), end; itr != end; ++itr) {
+            const auto ext = itr->path().extension();
+            if (ext == ".seg" || ext == ".index") {
+                bfs::remove(itr->path());
+            }
+        }
+        _impl->open(dir, segment_size);
+    }
+
+    uint32_t history_store::first_block() const {
+        read_lock lock(_impl->mutex);
+        return _impl->first_block();
+    }
+
+    uint32_t history_store::head_block() const {
+        read_lock lock(_impl->mutex);
+        return _impl->head_block();
+    }
+
+    bool history_store::contains_block(uint32_t block_num) const {
+        read_lock lock(_impl->mutex);
+        return _impl->first_block() && _impl->first_block() <= block_num && block_num <= _impl->head_block();
+    }
+
+    std::vector<uint64_t> history_store::append_block(uint32_t block_num, const std::vector<stored_operation>& ops) {
+        write_lock lock(_impl->mutex);
+        auto& my = *_impl;
+
+        if (!my.first_block()) {
+            my.blocks.set_value(block_num);
+        } else {
+            FC_ASSERT(block_num == my.head_block() + 1,
+                "Block ${n} doesn't follow the head block ${h} of the history store",
+                ("n", block_num)("h", my.head_block()));
+        }
+
+        std::vector<uint64_t> positions;
+        positions.reserve(ops.size());
+        for (const auto& op: ops) {
+            positions.push_back(my.operations.append(fc::raw::pack(op)));
+        }
+
+        uint32_t trx_in_block = uint32_t(-1);
+        for (const auto& op: ops) {
+            if (op.trx_id != transaction_id_type() && op.trx_in_block != trx_in_block) {
+                trx_in_block = op.trx_in_block;
+                transaction_entry entry;
+                entry.id_key = transaction_entry::to_key(op.trx_id);
+                entry.block = block_num;
+                entry.trx_in_block = trx_in_block;
+                my.transactions.insert(entry);
+            }
+        }
+
+        // the block entry is written last, it commits the block
+        block_entry entry;
+        entry.pos = positions.empty() ? 0 : positions.front();
+        entry.count = positions.size();
+        my.blocks.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+
+        return positions;
+    }
+
+    void history_store::append_account_operation(const account_name_type& account, const stored_account_operation& op) {
+        write_lock lock(_impl->mutex);
+        auto& my = *_impl;
+
+        const auto key = account_entry::to_key(account);
+        auto* entry = my.accounts.find_one(key);
+        if (!entry) {
+            account_entry new_entry;
+            std::memset(new_entry.name, 0, sizeof(new_entry.name));
+            std::memcpy(new_entry.name, key.data(), std::min(key.size(), sizeof(new_entry.name)));
+            my.accounts.insert(new_entry);
+            entry = my.accounts.find_one(key);
+        }
+
+        if (op.sequence < entry->count) {
+            return;
+        }
+
+        account_record record;
+        record.op = op;
+        record.prev_pos = entry->head_pos;
+        if (op.sequence > 0) {
+            const uint32_t skip_sequence = op.sequence & (op.sequence - 1);
+            record.skip_pos = my.seek_account_record(entry->head_pos, skip_sequence);
+            if (record.skip_pos != npos) {
+                record.skip_sequence = my.account_operations.read_value<account_record>(record.skip_pos).op.sequence;
+            }
+        }
+
+        const auto pos = my.account_operations.append(fc::raw::pack(record));
+        my.append_account_tag(*entry, op, pos);
+        entry->head_pos = pos;
+        entry->count = op.sequence + 1;
+    }
+
+    uint32_t history_store::account_operations_count(const account_name_type& account) const {
+        read_lock lock(_impl->mutex);
+        const auto* entry = _impl->accounts.find_one(account_entry::to_key(account));
+        return entry ? entry->count : 0;
+    }
+
+    stored_operation history_store::get_operation(uint64_t pos) const {
+        read_lock lock(_impl->mutex);
+        return _impl->operations.read_value<stored_operation>(pos);
+    }
+
+    std::vector<stored_operation> history_store::get_block(uint32_t block_num) const {
+        read_lock lock(_impl->mutex);
+        return _impl->get_block(block_num);
+    }
+
+    std::vector<stored_operation> history_store::find_transaction(const transaction_id_type& id) const {
+        read_lock lock(_impl->mutex);
+        std::vector<stored_operation> result;
+
+        // the key is only a part of the id, so the id is checked by operations of candidate blocks
+        _impl->transactions.find(transaction_entry::to_key(id), [&](const transaction_entry& entry) {
+            for (auto& op: _impl->get_block(entry.block)) {
+                if (op.trx_in_block == entry.trx_in_block && op.trx_id == id) {
+                    result.push_back(std::move(op));
+                }
+            }
+            return result.empty();
+        });
+        return result;
+    }
+
+    void history_store::walk_account_history(
+        const account_name_type& account, uint32_t from,
+        const std::function<bool(const stored_account_operation&)>& visitor
+    ) const {
+        read_lock lock(_impl->mutex);
+        const auto* entry = _impl->accounts.find_one(account_entry::to_key(account));
+        if (!entry) {
+            return;
+        }
+
+        auto pos = _impl->seek_account_record(entry->head_pos, from);
+        while (pos != npos) {
+            auto record = _impl->account_operations.read_value<account_record>(pos);
+            if (!visitor(record.op)) {
+                return;
+            }
+            pos = record.prev_pos;
+        }
+    }
+
+    void history_store::walk_account_history(
+        const account_name_type& account, uint32_t from, const account_operation_filter& filter,
+        const std::function<bool(const stored_account_operation&)>& visitor
+    ) const {
+        read_lock lock(_impl->mutex);
+        const auto* entry = _impl->accounts.find_one(account_entry::to_key(account));
+        if (!entry) {
+            return;
+        }
+
+        for (auto offset = history_store_impl::tags_block_offset(*entry); offset != npos;) {
+            const auto* block = _impl->get_tags_block(offset);
+            offset = block->prev_offset;
+            if (block->first_sequence > from || !block->count) {
+                continue;
+            }
+
+            const auto* op_tags = block->op_tags();
+            const auto* dirs = block->dirs();
+            const auto* positions = block->record_positions();
+            for (int32_t i = std::min<uint32_t>(from - block->first_sequence, block->count - 1); i >= 0; --i) {
+                if (!filter.matches(op_tags[i], dirs[i])) {
+                    continue;
+                }
+                auto record = _impl->account_operations.read_value<account_record>(positions[i]);
+                if (!visitor(record.op)) {
+                    return;
+                }
+            }
+        }
+    }
+
+} } } // golos::plugins::operation_history
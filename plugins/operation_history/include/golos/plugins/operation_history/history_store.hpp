@@ -0,0 +1,149 @@
+#pragma once
+
+#include <golos/protocol/operations.hpp>
+#include <golos/protocol/types.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/optional.hpp>
+#include <fc/time.hpp>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace golos { namespace plugins { namespace operation_history {
+
+    using golos::protocol::account_name_type;
+    using golos::protocol::transaction_id_type;
+
+    /// Operation of an irreversible block in the history store
+    struct stored_operation final {
+        transaction_id_type trx_id;
+        uint32_t block = 0;
+        uint32_t trx_in_block = 0;
+        uint16_t op_in_trx = 0;
+        uint32_t virtual_op = 0;
+        fc::time_point_sec timestamp;
+        std::vector<char> serialized_op;
+    };
+
+    /// Reference from the account history to an operation in the history store
+    struct stored_account_operation final {
+        uint32_t sequence = 0;
+        uint8_t op_tag = 0;
+        uint8_t dir = 0;
+        uint64_t op_pos = 0;
+        std::string json_metadata;
+    };
+
+    /// Directions of account operations accepted for each operation tag
+    class account_operation_filter final {
+    public:
+        void accept(uint8_t op_tag, uint8_t dir) {
+            _dirs[op_tag] |= uint8_t(1) << dir;
+        }
+
+        bool matches(uint8_t op_tag, uint8_t dir) const {
+            return (_dirs[op_tag] >> dir) & 1;
+        }
+
+    private:
+        std::array<uint8_t, 256> _dirs{};
+    };
+
+    namespace detail {
+        class history_store_impl;
+    }
+
+    /**
+     * Append-only store of operations from irreversible blocks, which are moved out of the shared memory.
+     *
+     * Operations are packed into memory-mapped segment files in the order of blocks, and they are read without
+     * copying to the shared memory. The store has four indexes:
+     *  - by block: the position of the first operation of each block and the number of its operations
+     *  - by transaction id: an open-addressing hash table of (block, trx_in_block)
+     *  - by account sequence: a backward list of account operations with skip links to sequences with cleared
+     *    lowest bits, so the search of a sequence takes O(log^2(n)) reads
+     *  - by account operation tags: backward linked blocks of packed op tags and directions of account operations,
+     *    filtered history is found by scanning of them, and only matching account records are read
+     *
+     * The store is filled only with irreversible blocks, so it is never rolled back.
+     */
+    class history_store final {
+    public:
+        static constexpr uint64_t npos = uint64_t(-1);
+
+        history_store();
+
+        ~history_store();
+
+        /**
+         * @param dir directory for files of the store
+         * @param segment_size maximum size of one segment file in bytes
+         */
+        void open(const fc::path& dir, uint64_t segment_size);
+
+        void close();
+
+        bool is_open() const;
+
+        /// Removes all files of the store and opens it empty
+        void wipe();
+
+        /// @return the first block in the store, or 0 if it is empty
+        uint32_t first_block() const;
+
+        /// @return the last block in the store, or 0 if it is empty
+        uint32_t head_block() const;
+
+        bool contains_block(uint32_t block_num) const;
+
+        /**
+         * Appends operations of the next block, the block can have no operations.
+         * @return positions of operations in the store
+         */
+        std::vector<uint64_t> append_block(uint32_t block_num, const std::vector<stored_operation>& ops);
+
+        /// Appends the next operation of the account, operations with already stored sequences are skipped
+        void append_account_operation(const account_name_type& account, const stored_account_operation& op);
+
+        /// @return number of stored operations of the account, it is the next sequence of the account
+        uint32_t account_operations_count(const account_name_type& account) const;
+
+        stored_operation get_operation(uint64_t pos) const;
+
+        std::vector<stored_operation> get_block(uint32_t block_num) const;
+
+        /// @return operations of the transaction, or empty vector if it isn't found
+        std::vector<stored_operation> find_transaction(const transaction_id_type& id) const;
+
+        /**
+         * Visits operations of the account from the sequence `from` to the oldest one,
+         * until the visitor returns false.
+         */
+        void walk_account_history(
+            const account_name_type& account, uint32_t from,
+            const std::function<bool(const stored_account_operation&)>& visitor) const;
+
+        /**
+         * Visits operations of the account, which match the filter, from the sequence `from` to the oldest one,
+         * until the visitor returns false.
+         */
+        void walk_account_history(
+            const account_name_type& account, uint32_t from, const account_operation_filter& filter,
+            const std::function<bool(const stored_account_operation&)>& visitor) const;
+
+    private:
+        std::unique_ptr<detail::history_store_impl> _impl;
+    };
+
+} } } // golos::plugins::operation_history
+
+FC_REFLECT(
+    (golos::plugins::operation_history::stored_operation),
+    (trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(serialized_op))
+
+FC_REFLECT(
+    (golos::plugins::operation_history::stored_account_operation),
+    (sequence)(op_tag)(dir)(op_pos)(json_metadata))
@@ -34,6 +34,9 @@
 #include <golos/plugins/json_rpc/plugin.hpp>
 #include <golos/plugins/operation_history/applied_operation.hpp>
 #include <golos/plugins/operation_history/history_object.hpp>
+#include <golos/plugins/operation_history/history_store.hpp>
+
+#include <unordered_map>
 
 
 namespace golos { namespace plugins { namespace operation_history {
@@ -51,6 +54,9 @@ namespace golos { namespace plugins { namespace operation_history {
     DEFINE_API_ARGS(get_ops_in_block, msg_pack, std::vector<applied_operation>)
     DEFINE_API_ARGS(get_transaction,  msg_pack, annotated_signed_transaction)
 
+    /// Positions of operations in the history store by ids of their operation_object
+    using stored_operation_positions = std::unordered_map<int64_t, uint64_t>;
+
     /**
      *  This plugin is designed to track operations so that one node
      *  doesn't need to hold the full operation history in memory.
@@ -75,6 +81,15 @@ namespace golos { namespace plugins { namespace operation_history {
         void plugin_startup() override;
         void plugin_shutdown() override;
 
+        /// @return store of irreversible operations, or nullptr if history is kept only in the shared memory
+        history_store* store() const;
+
+        /**
+         * Is emitted after operations of the irreversible block are written to the store,
+         * and before they are removed from the shared memory.
+         */
+        fc::signal<void(uint32_t, const stored_operation_positions&)> stored_block;
+
         DECLARE_API(
             (get_block_with_virtual_ops)
 
@@ -4,12 +4,17 @@
 #include <golos/plugins/json_rpc/api_helper.hpp>
 #include <golos/protocol/exceptions.hpp>
 #include <golos/chain/operation_notification.hpp>
+#include <golos/chain/state_snapshot.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 
 #define STEEM_NAMESPACE_PREFIX "golos::protocol::"
 #define OPERATION_POSTFIX "_operation"
 
+// blocks are moved to the history store in portions, so a long history from the shared memory doesn't stop the node
+#define MAX_STORED_BLOCKS_PER_APPLY 1000
+
 
 namespace golos { namespace plugins { namespace operation_history {
 
@@ -92,24 +97,142 @@ namespace golos { namespace plugins { namespace operation_history {
 
     struct plugin::plugin_impl final {
     public:
-        plugin_impl(): database(appbase::app().get_plugin<chain::plugin>().db()) {
+        plugin_impl(plugin& self)
+            : self(self),
+              database(appbase::app().get_plugin<chain::plugin>().db()) {
         }
 
         ~plugin_impl() = default;
 
+        // removes operations of old irreversible blocks once per history-prune-interval blocks
         void erase_old_blocks() {
-            uint32_t head_block = database.head_block_num();
-            if (history_blocks <= head_block) {
-                uint32_t need_block = head_block - history_blocks;
-                const auto& idx = database.get_index<operation_index>().indices().get<by_location>();
-                auto it = idx.begin();
-                while (it != idx.end() && it->block <= need_block) {
-                    auto next_it = it;
-                    ++next_it;
-                    database.remove(*it);
-                    it = next_it;
+            const uint32_t head_block = database.head_block_num();
+            if (history_blocks > head_block) {
+                return;
+            }
+            uint32_t need_block = std::min(head_block - history_blocks, database.last_non_undoable_block_num());
+            if (store) {
+                // operations are moved to the store in portions, the rest of them must stay till their turn
+                need_block = std::min(need_block, store->head_block());
+            }
+            if (need_block < last_pruned_block + prune_interval) {
+                return;
+            }
+
+            const auto start = fc::time_point::now();
+            // operations of irreversible blocks are never modified, so they are removed bypassing the undo states
+            const auto removed = database.remove_irreversible<operation_index, by_location>(
+                [&](const operation_object& obj) {
+                    return obj.block <= need_block;
+                });
+            last_pruned_block = need_block;
+            pruned_operations += removed;
+
+            if (removed) {
+                dlog("operation_history: pruned ${n} operations up to block ${b} in ${t} ms, ${total} in total",
+                    ("n", removed)("b", need_block)("t", (fc::time_point::now() - start).count() / 1000)
+                    ("total", pruned_operations));
+            }
+        }
+
+        void open_store(uint32_t head_block_num) {
+            if (store_opened) {
+                return;
+            }
+            store->open(store_dir, store_segment_size);
+            store_opened = true;
+
+            if (head_block_num == 0) {
+                // the state is replayed from the genesis block, so the store is filled again
+                store->wipe();
+            }
+            GOLOS_CHECK_DATABASE(store->head_block() <= head_block_num,
+                golos::database_corrupted::unknown_file_format,
+                "History store is ahead of the state, replay the blockchain or remove ${dir}",
+                ("dir", store_dir.string())("store_head", store->head_block())("head", head_block_num));
+
+            ilog("operation_history: store ${dir} contains blocks from ${first} to ${head}",
+                ("dir", store_dir.string())("first", store->first_block())("head", store->head_block()));
+        }
+
+        void move_irreversible_blocks(const signed_block& block) {
+            open_store(block.block_num() - 1);
+
+            const auto& idx = database.get_index<operation_index>().indices().get<by_location>();
+            const auto lib = database.last_non_undoable_block_num();
+            auto block_num = store->head_block() + 1;
+
+            // objects of stored blocks can be restored by the undo of a block, which has moved them
+            for (auto itr = idx.begin(); itr != idx.end() && itr->block < block_num;) {
+                const auto& obj = *itr;
+                ++itr;
+                database.remove(obj);
+            }
+
+            if (block_num == 1) {
+                if (idx.empty()) {
+                    return;
+                }
+                block_num = idx.begin()->block;
+            }
+
+            for (uint32_t i = 0; i < MAX_STORED_BLOCKS_PER_APPLY && block_num <= lib; ++i, ++block_num) {
+                std::vector<const operation_object*> objects;
+                std::vector<stored_operation> ops;
+                for (auto itr = idx.lower_bound(block_num); itr != idx.end() && itr->block == block_num; ++itr) {
+                    objects.push_back(&*itr);
+                    ops.emplace_back();
+                    auto& op = ops.back();
+                    op.trx_id = itr->trx_id;
+                    op.block = itr->block;
+                    op.trx_in_block = itr->trx_in_block;
+                    op.op_in_trx = itr->op_in_trx;
+                    op.virtual_op = itr->virtual_op;
+                    op.timestamp = itr->timestamp;
+                    op.serialized_op.assign(itr->serialized_op.begin(), itr->serialized_op.end());
+                }
+
+                auto positions = store->append_block(block_num, ops);
+
+                stored_operation_positions ids;
+                for (size_t k = 0; k < objects.size(); ++k) {
+                    ids[objects[k]->id._id] = positions[k];
+                }
+                self.stored_block(block_num, ids);
+
+                for (const auto* obj: objects) {
+                    database.remove(*obj);
+                }
+            }
+        }
+
+        bool is_stored(uint32_t block_num) const {
+            return store && store->contains_block(block_num);
+        }
+
+        // operations out of history-blocks are hidden at once, though they are removed only by the next pruning
+        bool is_expired(uint32_t block_num) const {
+            const uint32_t head_block = database.head_block_num();
+            return history_blocks <= head_block && block_num <= head_block - history_blocks;
+        }
+
+        std::vector<applied_operation> get_block_operations(uint32_t block_num) {
+            std::vector<applied_operation> result;
+            if (is_expired(block_num)) {
+                return result;
+            }
+            if (is_stored(block_num)) {
+                for (const auto& op: store->get_block(block_num)) {
+                    result.emplace_back(op);
                 }
+                return result;
             }
+
+            const auto& idx = database.get_index<operation_index>().indices().get<by_location>();
+            for (auto itr = idx.lower_bound(block_num); itr != idx.end() && itr->block == block_num; ++itr) {
+                result.emplace_back(*itr);
+            }
+            return result;
         }
 
         void on_operation(golos::chain::operation_notification& note) {
@@ -130,16 +253,14 @@ namespace golos { namespace plugins { namespace operation_history {
             }
             result = annotated_signed_block(*sb);
 
-            const auto& idx = database.get_index<operation_index>().indices().get<by_location>();
-            auto itr = idx.lower_bound(block_num);
             result._virtual_operations = block_operations();
-            for (; itr != idx.end() && itr->block == block_num; ++itr) {
-                if (itr->virtual_op != 0) {
+            for (auto& itr: get_block_operations(block_num)) {
+                if (itr.virtual_op != 0) {
                     block_operation op;
-                    op.trx_in_block = itr->trx_in_block;
-                    op.op_in_trx = itr->op_in_trx;
-                    op.virtual_op = itr->virtual_op;
-                    op.op = fc::raw::unpack<protocol::operation>(itr->serialized_op);
+                    op.trx_in_block = itr.trx_in_block;
+                    op.op_in_trx = itr.op_in_trx;
+                    op.virtual_op = itr.virtual_op;
+                    op.op = std::move(itr.op);
                     (*result._virtual_operations).push_back(op);
                 }
             }
@@ -151,11 +272,8 @@ namespace golos { namespace plugins { namespace operation_history {
             uint32_t block_num,
             bool only_virtual
         ) {
-            const auto& idx = database.get_index<operation_index>().indices().get<by_location>();
-            auto itr = idx.lower_bound(block_num);
             std::vector<applied_operation> result;
-            for (; itr != idx.end() && itr->block == block_num; ++itr) {
-                applied_operation operation(*itr);
+            for (auto& operation: get_block_operations(block_num)) {
                 if (!only_virtual || operation.virtual_op != 0) {
                     result.push_back(std::move(operation));
                 }
@@ -163,17 +281,27 @@ namespace golos { namespace plugins { namespace operation_history {
             return result;
         }
 
+        annotated_signed_transaction get_transaction(uint32_t block_num, uint32_t trx_in_block) {
+            auto blk = database.fetch_block_by_number(block_num);
+            FC_ASSERT(blk.valid());
+            FC_ASSERT(blk->transactions.size() > trx_in_block);
+            annotated_signed_transaction result = blk->transactions[trx_in_block];
+            result.block_num = block_num;
+            result.transaction_num = trx_in_block;
+            return result;
+        }
+
         annotated_signed_transaction get_transaction(transaction_id_type id) {
             const auto &idx = database.get_index<operation_index>().indices().get<by_transaction_id>();
             auto itr = idx.lower_bound(id);
-            if (itr != idx.end() && itr->trx_id == id) {
-                auto blk = database.fetch_block_by_number(itr->block);
-                FC_ASSERT(blk.valid());
-                FC_ASSERT(blk->transactions.size() > itr->trx_in_block);
-                annotated_signed_transaction result = blk->transactions[itr->trx_in_block];
-                result.block_num = itr->block;
-                result.transaction_num = itr->trx_in_block;
-                return result;
+            if (itr != idx.end() && itr->trx_id == id && !is_expired(itr->block)) {
+                return get_transaction(itr->block, itr->trx_in_block);
+            }
+            if (store) {
+                auto ops = store->find_transaction(id);
+                if (!ops.empty() && !is_expired(ops.front().block)) {
+                    return get_transaction(ops.front().block, ops.front().trx_in_block);
+                }
             }
             GOLOS_THROW_MISSING_OBJECT("transaction", id);
         }
@@ -181,8 +309,18 @@ namespace golos { namespace plugins { namespace operation_history {
         bool filter_content = false;
         uint32_t start_block = 0;
         uint32_t history_blocks = UINT32_MAX;
+        uint32_t prune_interval = 1;
+        uint32_t last_pruned_block = 0;
+        uint64_t pruned_operations = 0;
         bool blacklist = true;
         fc::flat_set<std::string> ops_list;
+
+        std::unique_ptr<history_store> store;
+        fc::path store_dir;
+        uint64_t store_segment_size = 0;
+        bool store_opened = false;
+
+        plugin& self;
         golos::chain::database& database;
     };
 
@@ -234,19 +372,35 @@ namespace golos { namespace plugins { namespace operation_history {
             "history-blocks",
             boost::program_options::value<uint32_t>(),
             "Defines depth of history for recording stats."
+        ) (
+            "history-prune-interval",
+            boost::program_options::value<uint32_t>()->default_value(100),
+            "Number of blocks between removals of history older than history-blocks. "
+            "APIs hide such history at once, and only irreversible blocks are removed, all at once."
+        ) (
+            "history-store-dir",
+            boost::program_options::value<boost::filesystem::path>(),
+            "Directory of the store for operations of irreversible blocks (absolute path or relative to application data dir). "
+            "If it is set, these operations are moved out of the shared memory."
+        ) (
+            "history-store-segment-size",
+            boost::program_options::value<uint64_t>()->default_value(1024),
+            "Maximum size of one segment file of the history store in megabytes."
         );
     }
 
     void plugin::plugin_initialize(const boost::program_options::variables_map& options) {
         ilog("operation_history plugin: plugin_initialize() begin");
 
-        pimpl = std::make_unique<plugin_impl>();
+        pimpl = std::make_unique<plugin_impl>(*this);
 
         pimpl->database.pre_apply_operation.connect([&](golos::chain::operation_notification& note){
             pimpl->on_operation(note);
         });
 
         golos::chain::add_plugin_index<operation_index>(pimpl->database);
+        // history starts from the block of a loaded snapshot
+        golos::chain::add_plugin_empty_snapshot_index<operation_index>(pimpl->database, "operation_index");
 
         auto split_list = [&](const std::vector<std::string>& ops_list) {
             for (const auto& raw: ops_list) {
@@ -289,16 +443,38 @@ namespace golos { namespace plugins { namespace operation_history {
         }
         ilog("operation_history: start_block ${s}", ("s", pimpl->start_block));
 
+        if (options.count("history-store-dir")) {
+            auto dir = options.at("history-store-dir").as<boost::filesystem::path>();
+            if (dir.is_relative()) {
+                dir = appbase::app().data_dir() / dir;
+            }
+            const auto segment_size = options.at("history-store-segment-size").as<uint64_t>();
+            GOLOS_CHECK_OPTION(segment_size > 0 && segment_size < (uint64_t(1) << 20),
+                "history-store-segment-size should be from 1 to 1048575 megabytes");
+
+            pimpl->store = std::make_unique<history_store>();
+            pimpl->store_dir = dir;
+            pimpl->store_segment_size = segment_size << 20;
+            pimpl->database.applied_block.connect([&](const signed_block& block){
+                pimpl->move_irreversible_blocks(block);
+            });
+            ilog("operation_history: history-store-dir ${d}", ("d", dir.string()));
+        }
+
         if (options.count("history-blocks")) {
             uint32_t history_blocks = options.at("history-blocks").as<uint32_t>();
             pimpl->history_blocks = history_blocks;
+            pimpl->prune_interval = options.at("history-prune-interval").as<uint32_t>();
+            GOLOS_CHECK_OPTION(pimpl->prune_interval > 0, "history-prune-interval should be greater than 0");
+            // connected after the move to the history store, so pruning sees the store head of this block
             pimpl->database.applied_block.connect([&](const signed_block& block){
                 pimpl->erase_old_blocks();
             });
         } else {
             pimpl->history_blocks = UINT32_MAX;
         }
-        ilog("operation_history: history-blocks ${s}", ("s", pimpl->history_blocks));
+        ilog("operation_history: history-blocks ${s}, history-prune-interval ${i}",
+            ("s", pimpl->history_blocks)("i", pimpl->prune_interval));
 
         JSON_RPC_REGISTER_API(name());
         ilog("operation_history plugin: plugin_initialize() end");
@@ -315,10 +491,22 @@ namespace golos { namespace plugins { namespace operation_history {
 
     void plugin::plugin_startup() {
         ilog("operation_history plugin: plugin_startup() begin");
+        if (pimpl->store) {
+            pimpl->database.with_weak_read_lock([&]() {
+                pimpl->open_store(pimpl->database.head_block_num());
+            });
+        }
         ilog("operation_history plugin: plugin_startup() end");
     }
 
     void plugin::plugin_shutdown() {
+        if (pimpl->store) {
+            pimpl->store->close();
+        }
+    }
+
+    history_store* plugin::store() const {
+        return pimpl->store.get();
     }
 
 } } } // golos::plugins::operation_history
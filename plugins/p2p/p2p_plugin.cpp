@@ -88,6 +88,10 @@ namespace golos {
                     vector<fc::ip::endpoint> seeds;
                     string user_agent;
                     uint32_t max_connections = 0;
+                    uint32_t sync_blocks_per_peer = 0;
+                    uint32_t sync_reorder_window = 0;
+                    bool compact_block_relay = true;
+                    uint64_t message_cache_size = 0;
                     bool force_validate = false;
                     bool block_producer = false;
 
@@ -443,7 +447,19 @@ namespace golos {
                     ("seed-node", boost::program_options::value<vector<string>>()->composing(),
                         "The IP address and port of a remote peer to sync with. Deprecated in favor of p2p-seed-node.")
                     ("p2p-seed-node", boost::program_options::value<vector<string>>()->composing(),
-                        "The IP address and port of a remote peer to sync with.");
+                        "The IP address and port of a remote peer to sync with.")
+                    ("p2p-sync-blocks-per-peer", boost::program_options::value<uint32_t>(),
+                        "Maximum number of blocks requested from one peer during syncing. "
+                        "A new request is sent when a half of them is received.")
+                    ("p2p-sync-reorder-window", boost::program_options::value<uint32_t>(),
+                        "Maximum distance in blocks from the next block to apply to the blocks requested during syncing. "
+                        "Blocks from many peers are received out of order and buffered within this window.")
+                    ("p2p-compact-block-relay", boost::program_options::value<bool>()->default_value(true),
+                        "Relay new blocks to peers which support it as headers with short ids of transactions. "
+                        "Peers take known transactions from their caches and request only missing ones.")
+                    ("p2p-message-cache-size", boost::program_options::value<uint64_t>(),
+                        "Maximum size in megabytes of the cache of recently received blocks and transactions, "
+                        "which are provided to peers. Least recently used messages are removed when it is full.");
                 cli.add_options()
                     ("force-validate", boost::program_options::bool_switch()->default_value(false),
                         "Force validation of all transactions. Deprecated in favor of p2p-force-validate")
@@ -490,6 +506,23 @@ namespace golos {
                     }
                 }
 
+                if (options.count("p2p-sync-blocks-per-peer")) {
+                    my->sync_blocks_per_peer = options.at("p2p-sync-blocks-per-peer").as<uint32_t>();
+                    FC_ASSERT(my->sync_blocks_per_peer > 1, "p2p-sync-blocks-per-peer must be greater than 1");
+                }
+
+                if (options.count("p2p-sync-reorder-window")) {
+                    my->sync_reorder_window = options.at("p2p-sync-reorder-window").as<uint32_t>();
+                    FC_ASSERT(my->sync_reorder_window > 0, "p2p-sync-reorder-window must be greater than 0");
+                }
+
+                my->compact_block_relay = options.at("p2p-compact-block-relay").as<bool>();
+
+                if (options.count("p2p-message-cache-size")) {
+                    my->message_cache_size = options.at("p2p-message-cache-size").as<uint64_t>() * 1024 * 1024;
+                    FC_ASSERT(my->message_cache_size > 0, "p2p-message-cache-size must be greater than 0");
+                }
+
                 my->force_validate = options.at("p2p-force-validate").as<bool>();
 
                 if (!my->force_validate && options.at("force-validate").as<bool>()) {
@@ -522,6 +555,29 @@ namespace golos {
                         my->node->set_advanced_node_parameters(node_param);
                     }
 
+                    if (my->sync_blocks_per_peer || my->sync_reorder_window) {
+                        fc::mutable_variant_object node_param;
+                        if (my->sync_blocks_per_peer) {
+                            node_param["maximum_blocks_per_peer_during_syncing"] = my->sync_blocks_per_peer;
+                        }
+                        if (my->sync_reorder_window) {
+                            node_param["sync_reorder_window"] = my->sync_reorder_window;
+                        }
+                        ilog("Setting p2p sync parameters ${p}", ("p", node_param));
+                        my->node->set_advanced_node_parameters(node_param);
+                    }
+
+                    if (!my->compact_block_relay) {
+                        ilog("Disabling p2p compact block relay");
+                        my->node->set_advanced_node_parameters(fc::variant_object("compact_block_relay", fc::variant(false)));
+                    }
+
+                    if (my->message_cache_size) {
+                        ilog("Setting p2p message cache size to ${n} bytes", ("n", my->message_cache_size));
+                        my->node->set_advanced_node_parameters(
+                            fc::variant_object("message_cache_max_bytes", fc::variant(my->message_cache_size)));
+                    }
+
                     my->node->listen_to_p2p_network();
                     my->node->connect_to_p2p_network();
                     block_id_type block_id;
@@ -0,0 +1,463 @@
+#include <golos/plugins/social_network/content_store.hpp>
+#include <golos/protocol/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+#include <zstd.h>
+#endif
+
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace golos { namespace plugins { namespace social_network {
+
+    namespace bfs = boost::filesystem;
+
+    namespace detail {
+        using read_write_mutex = boost::shared_mutex;
+        using read_lock = boost::shared_lock<read_write_mutex>;
+        using write_lock = boost::unique_lock<read_write_mutex>;
+
+        static constexpr uint64_t storage_magic = 0x31534e4f43534f47; // "GOSCONS1"
+        static constexpr uint64_t min_storage_growth = 1024 * 1024;
+
+        // short contents are stored without compression, because zstd frame has own overhead
+        static constexpr uint32_t min_compressed_size = 128;
+        static constexpr int compression_level = 3;
+
+        enum content_codec: uint32_t {
+            raw_codec = 0,
+            zstd_codec = 1
+        };
+
+        struct storage_header final {
+            uint64_t magic = storage_magic;
+            uint64_t size = 0;
+            uint64_t value = 0;
+            uint64_t reserved = 0;
+        };
+
+        struct content_record_header final {
+            int64_t comment = 0;
+            uint32_t codec = raw_codec;
+            uint32_t raw_size = 0;
+            uint32_t size = 0;
+            uint32_t reserved = 0;
+        };
+
+        /**
+         * Memory-mapped file with a header and a payload, which grows by appending.
+         * The file is resized with reserve, so its size is larger than the used size of the payload.
+         */
+        class mapped_storage final {
+        public:
+            void open(const bfs::path& path) {
+                _path = path;
+                const bool created = !bfs::exists(path) || bfs::file_size(path) < sizeof(storage_header);
+                if (created) {
+                    bfs::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                    stream.close();
+                    bfs::resize_file(path, sizeof(storage_header) + min_storage_growth);
+                }
+
+                _file.open(path.string(), boost::iostreams::mapped_file::readwrite);
+                if (created) {
+                    *reinterpret_cast<storage_header*>(_file.data()) = storage_header();
+                }
+
+                GOLOS_CHECK_DATABASE(header().magic == storage_magic,
+                    golos::database_corrupted::unknown_file_format,
+                    "Unknown format of the content store file ${path}",
+                    ("path", path.string()));
+                GOLOS_CHECK_DATABASE(header().size <= capacity(),
+                    golos::database_corrupted::reading_data_beyond_end_of_file,
+                    "Content store file ${path} is truncated",
+                    ("path", path.string())("size", header().size)("capacity", capacity()));
+            }
+
+            void close() {
+                if (_file.is_open()) {
+                    _file.close();
+                }
+            }
+
+            bool is_open() const {
+                return _file.is_open();
+            }
+
+            const bfs::path& path() const {
+                return _path;
+            }
+
+            uint64_t size() const {
+                return header().size;
+            }
+
+            uint64_t capacity() const {
+                return _file.size() - sizeof(storage_header);
+            }
+
+            uint64_t value() const {
+                return header().value;
+            }
+
+            void set_value(uint64_t value) {
+                header().value = value;
+            }
+
+            const char* data() const {
+                return _file.const_data() + sizeof(storage_header);
+            }
+
+            char* data() {
+                return _file.data() + sizeof(storage_header);
+            }
+
+            void reserve(uint64_t new_capacity) {
+                if (new_capacity <= capacity()) {
+                    return;
+                }
+                new_capacity = std::max(new_capacity, capacity() + std::max(capacity() / 2, min_storage_growth));
+                _file.resize(sizeof(storage_header) + new_capacity);
+            }
+
+            /// @return offset of the appended data
+            uint64_t append(const char* src, uint64_t src_size) {
+                const auto offset = size();
+                reserve(offset + src_size);
+                std::memcpy(data() + offset, src, src_size);
+                // the size is changed last, so a partially written data is ignored after a crash
+                header().size = offset + src_size;
+                return offset;
+            }
+
+            /// Grows the used size, the new part of the payload is filled with zeros by the file system
+            void grow(uint64_t new_size) {
+                if (new_size > size()) {
+                    reserve(new_size);
+                    header().size = new_size;
+                }
+            }
+
+        private:
+            storage_header& header() {
+                return *reinterpret_cast<storage_header*>(_file.data());
+            }
+
+            const storage_header& header() const {
+                return *reinterpret_cast<const storage_header*>(_file.const_data());
+            }
+
+            bfs::path _path;
+            boost::iostreams::mapped_file _file;
+        };
+
+        class content_store_impl final {
+        public:
+            ~content_store_impl() {
+                close();
+            }
+
+            void open(const bfs::path& dir, std::size_t cache_size) {
+                _dir = dir;
+                _cache_size = cache_size;
+                bfs::create_directories(dir);
+
+                write_lock lock(_mutex);
+                _data.open(data_path());
+                _index.open(index_path());
+            }
+
+            void close() {
+                write_lock lock(_mutex);
+                _data.close();
+                _index.close();
+                clear_cache();
+            }
+
+            bool is_open() const {
+                return _index.is_open();
+            }
+
+            void wipe() {
+                close();
+                bfs::remove(data_path());
+                bfs::remove(index_path());
+                open(_dir, _cache_size);
+            }
+
+            uint32_t head_block() const {
+                read_lock lock(_mutex);
+                return static_cast<uint32_t>(_index.value());
+            }
+
+            void set_head_block(uint32_t block_num) {
+                write_lock lock(_mutex);
+                _index.set_value(block_num);
+            }
+
+            void put(int64_t comment, const comment_content_text& content) {
+                auto packed = fc::raw::pack(content);
+
+                content_record_header record;
+                record.comment = comment;
+                record.raw_size = packed.size();
+
+                std::vector<char> buffer(sizeof(record));
+                compress(packed, record, buffer);
+                std::memcpy(buffer.data(), &record, sizeof(record));
+
+                {
+                    write_lock lock(_mutex);
+                    const auto offset = _data.append(buffer.data(), buffer.size());
+                    set_position(comment, offset + 1);
+                }
+                invalidate(comment);
+            }
+
+            void remove(int64_t comment) {
+                {
+                    write_lock lock(_mutex);
+                    if (position(comment)) {
+                        set_position(comment, 0);
+                    }
+                }
+                invalidate(comment);
+            }
+
+            comment_content_text_ptr find(int64_t comment) const {
+                uint64_t writes = 0;
+                {
+                    std::lock_guard<std::mutex> lock(_cache_mutex);
+                    auto itr = _cache_index.find(comment);
+                    if (itr != _cache_index.end()) {
+                        _cache.splice(_cache.begin(), _cache, itr->second);
+                        return itr->second->second;
+                    }
+                    writes = _writes;
+                }
+
+                content_record_header record;
+                std::vector<char> data;
+                {
+                    read_lock lock(_mutex);
+                    if (!_index.is_open()) {
+                        return nullptr;
+                    }
+                    const auto pos = position(comment);
+                    if (!pos) {
+                        return nullptr;
+                    }
+                    const auto offset = pos - 1;
+                    GOLOS_CHECK_DATABASE(offset + sizeof(record) <= _data.size(),
+                        golos::database_corrupted::reading_data_beyond_end_of_file,
+                        "Reading data beyond end of file",
+                        ("path", _data.path().string())("pos", offset)("file_size", _data.size()));
+
+                    std::memcpy(&record, _data.data() + offset, sizeof(record));
+                    GOLOS_CHECK_DATABASE(record.comment == comment &&
+                        offset + sizeof(record) + record.size <= _data.size(),
+                        golos::database_corrupted::reading_data_beyond_end_of_file,
+                        "Wrong record of the comment content",
+                        ("path", _data.path().string())("pos", offset)("comment", comment)
+                        ("record_comment", record.comment)("size", record.size)("file_size", _data.size()));
+
+                    const auto* src = _data.data() + offset + sizeof(record);
+                    data.assign(src, src + record.size);
+                }
+
+                // decompress without lock, so different contents can be read in parallel
+                auto result = std::make_shared<comment_content_text>(
+                    fc::raw::unpack<comment_content_text>(decompress(comment, record, data)));
+
+                std::lock_guard<std::mutex> lock(_cache_mutex);
+                // the content was replaced while it was read
+                if (!_cache_size || writes != _writes || _cache_index.count(comment)) {
+                    return result;
+                }
+
+                _cache.emplace_front(comment, result);
+                _cache_index.emplace(comment, _cache.begin());
+                while (_cache.size() > _cache_size) {
+                    _cache_index.erase(_cache.back().first);
+                    _cache.pop_back();
+                }
+                return result;
+            }
+
+            uint64_t data_size() const {
+                read_lock lock(_mutex);
+                return _data.size();
+            }
+
+            uint64_t garbage_size() const {
+                read_lock lock(_mutex);
+                return _data.value();
+            }
+
+        private:
+            bfs::path data_path() const {
+                return _dir / "content.data";
+            }
+
+            bfs::path index_path() const {
+                return _dir / "content.index";
+            }
+
+            uint64_t position(int64_t comment) const {
+                const auto offset = uint64_t(comment) * sizeof(uint64_t);
+                if (comment < 0 || offset + sizeof(uint64_t) > _index.size()) {
+                    return 0;
+                }
+                uint64_t pos = 0;
+                std::memcpy(&pos, _index.data() + offset, sizeof(pos));
+                return pos;
+            }
+
+            void set_position(int64_t comment, uint64_t pos) {
+                const auto prev = position(comment);
+                if (prev) {
+                    content_record_header record;
+                    std::memcpy(&record, _data.data() + prev - 1, sizeof(record));
+                    _data.set_value(_data.value() + sizeof(record) + record.size);
+                }
+
+                const auto offset = uint64_t(comment) * sizeof(uint64_t);
+                _index.grow(offset + sizeof(uint64_t));
+                std::memcpy(_index.data() + offset, &pos, sizeof(pos));
+            }
+
+            void invalidate(int64_t comment) {
+                std::lock_guard<std::mutex> lock(_cache_mutex);
+                ++_writes;
+                auto itr = _cache_index.find(comment);
+                if (itr != _cache_index.end()) {
+                    _cache.erase(itr->second);
+                    _cache_index.erase(itr);
+                }
+            }
+
+            void clear_cache() {
+                std::lock_guard<std::mutex> lock(_cache_mutex);
+                ++_writes;
+                _cache.clear();
+                _cache_index.clear();
+            }
+
+            static void compress(const std::vector<char>& packed, content_record_header& record, std::vector<char>& buffer) {
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+                if (packed.size() >= min_compressed_size) {
+                    buffer.resize(sizeof(record) + ZSTD_compressBound(packed.size()));
+                    auto size = ZSTD_compress(
+                        buffer.data() + sizeof(record), buffer.size() - sizeof(record),
+                        packed.data(), packed.size(), compression_level);
+                    if (!ZSTD_isError(size) && size < packed.size()) {
+                        buffer.resize(sizeof(record) + size);
+                        record.codec = zstd_codec;
+                        record.size = size;
+                        return;
+                    }
+                }
+#endif
+                buffer.resize(sizeof(record));
+                buffer.insert(buffer.end(), packed.begin(), packed.end());
+                record.codec = raw_codec;
+                record.size = packed.size();
+            }
+
+            static std::vector<char> decompress(
+                int64_t comment, const content_record_header& record, std::vector<char>& data
+            ) {
+                if (record.codec == raw_codec) {
+                    return std::move(data);
+                }
+
+                std::vector<char> result(record.raw_size);
+                std::size_t size = 0;
+                bool decompressed = false;
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+                if (record.codec == zstd_codec) {
+                    size = ZSTD_decompress(result.data(), result.size(), data.data(), data.size());
+                    decompressed = !ZSTD_isError(size) && size == record.raw_size;
+                }
+#endif
+                GOLOS_CHECK_DATABASE(decompressed,
+                    golos::database_corrupted::decompression_failed,
+                    "Can't decompress content of comment ${comment}",
+                    ("comment", comment)("codec", record.codec)("size", size)("expected", record.raw_size));
+                return result;
+            }
+
+            bfs::path _dir;
+            mapped_storage _data;
+            mapped_storage _index;
+            mutable read_write_mutex _mutex;
+
+            mutable std::mutex _cache_mutex;
+            std::size_t _cache_size = 0;
+            uint64_t _writes = 0;
+            mutable std::list<std::pair<int64_t, comment_content_text_ptr>> _cache;
+            mutable std::unordered_map<int64_t, decltype(_cache)::iterator> _cache_index;
+        };
+
+    } // namespace detail
+
+    content_store::content_store()
+        : _impl(std::make_unique<detail::content_store_impl>()) {
+    }
+
+    content_store::~content_store() = default;
+
+    void content_store::open(const fc::path& dir, std::size_t cache_size) {
+        _impl->open(dir, cache_size);
+    }
+
+    void content_store::close() {
+        _impl->close();
+    }
+
+    bool content_store::is_open() const {
+        return _impl->is_open();
+    }
+
+    void content_store::wipe() {
+        _impl->wipe();
+    }
+
+    uint32_t content_store::head_block() const {
+        return _impl->head_block();
+    }
+
+    void content_store::set_head_block(uint32_t block_num) {
+        _impl->set_head_block(block_num);
+    }
+
+    void content_store::put(int64_t comment, const comment_content_text& content) {
+        _impl->put(comment, content);
+    }
+
+    void content_store::remove(int64_t comment) {
+        _impl->remove(comment);
+    }
+
+    comment_content_text_ptr content_store::find(int64_t comment) const {
+        return _impl->find(comment);
+    }
+
+    uint64_t content_store::data_size() const {
+        return _impl->data_size();
+    }
+
+    uint64_t content_store::garbage_size() const {
+        return _impl->garbage_size();
+    }
+
+} } } // golos::plugins::social_network
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+#include <string>
+
+namespace golos { namespace plugins { namespace social_network {
+
+    /// Title, body and json_metadata of a comment
+    struct comment_content_text final {
+        std::string title;
+        std::string body;
+        std::string json_metadata;
+    };
+
+    using comment_content_text_ptr = std::shared_ptr<const comment_content_text>;
+
+    namespace detail {
+        class content_store_impl;
+    }
+
+    /**
+     * Store of comment contents, which are moved out of the shared memory.
+     *
+     * Contents are appended to a memory-mapped data file, and they are compressed with zstd if the node is built
+     * with ENABLE_BLOCK_LOG_COMPRESSION. The index file is a memory-mapped array of positions in the data file,
+     * which is addressed by the comment id. Only contents of irreversible changes are put into the store,
+     * so it is never rolled back. Reads don't need the lock of the database, recently read contents
+     * are kept in the cache.
+     */
+    class content_store final {
+    public:
+        content_store();
+
+        ~content_store();
+
+        /**
+         * @param dir directory for files of the store
+         * @param cache_size maximum number of contents in the read cache
+         */
+        void open(const fc::path& dir, std::size_t cache_size);
+
+        void close();
+
+        bool is_open() const;
+
+        /// Removes all files of the store and opens it empty
+        void wipe();
+
+        /// @return the last irreversible block, which contents are moved to the store
+        uint32_t head_block() const;
+
+        void set_head_block(uint32_t block_num);
+
+        /// Replaces the content of the comment, the previous content is left in the data file as a garbage
+        void put(int64_t comment, const comment_content_text& content);
+
+        void remove(int64_t comment);
+
+        /// @return content of the comment, or nullptr if it isn't in the store
+        comment_content_text_ptr find(int64_t comment) const;
+
+        /// @return size of the data file, which is used by contents
+        uint64_t data_size() const;
+
+        /// @return size of replaced and removed contents in the data file
+        uint64_t garbage_size() const;
+
+    private:
+        std::unique_ptr<detail::content_store_impl> _impl;
+    };
+
+} } } // golos::plugins::social_network
+
+FC_REFLECT(
+    (golos::plugins::social_network::comment_content_text),
+    (title)(body)(json_metadata))
@@ -8,6 +8,7 @@
 #include <golos/api/vote_state.hpp>
 #include <golos/api/discussion_helper.hpp>
 #include <golos/plugins/social_network/social_network_types.hpp>
+#include <golos/plugins/social_network/content_store.hpp>
 
 namespace golos { namespace plugins { namespace social_network {
     using plugins::json_rpc::msg_pack;
@@ -70,6 +71,19 @@ namespace golos { namespace plugins { namespace social_network {
         const comment_content_object& get_comment_content(const comment_id_type& comment) const ;
         const comment_content_object* find_comment_content(const comment_id_type& comment) const ;
 
+        /// @return title, body and json_metadata from the shared memory or from the content store
+        comment_content_text get_comment_text(const comment_content_object& content) const;
+
+        /**
+         * Fills title, body and root_title, which are left by fill_comment_info_deferred() for contents in the store.
+         * It is called after the release of the database lock.
+         * @return true if something is read from the store
+         */
+        bool fill_stored_content(comment_api_object& d) const;
+        void fill_stored_content(std::vector<discussion>& discussions) const;
+
+        /// @return store of comment contents, or nullptr if contents are kept in the shared memory
+        const content_store* store() const;
 
     private:
         struct impl;
@@ -78,6 +92,8 @@ namespace golos { namespace plugins { namespace social_network {
 
 // Callback which is needed for correct work of discussion_helper
     void fill_comment_info(const golos::chain::database& db, const comment_object& co, comment_api_object& cao);
+    // Doesn't read title, body and root_title from the content store, they are filled by social_network::fill_stored_content()
+    void fill_comment_info_deferred(const golos::chain::database& db, const comment_object& co, comment_api_object& cao);
     std::string get_json_metadata(const golos::chain::database& db, const comment_object&);
 
 } } } // golos::plugins::social_network
@@ -13,7 +13,8 @@ namespace golos { namespace plugins { namespace social_network {
         comment_content_object_type = (SOCIAL_NETWORK_SPACE_ID << 8),
         comment_last_update_object_type = (SOCIAL_NETWORK_SPACE_ID << 8) + 1,
         comment_reward_object_type = (SOCIAL_NETWORK_SPACE_ID << 8) + 2,
-        donate_data_object_type = (SOCIAL_NETWORK_SPACE_ID << 8) + 3
+        donate_data_object_type = (SOCIAL_NETWORK_SPACE_ID << 8) + 3,
+        comment_content_removal_object_type = (SOCIAL_NETWORK_SPACE_ID << 8) + 4
     };
 
 
@@ -40,22 +41,69 @@ namespace golos { namespace plugins { namespace social_network {
         share_type donates_uia = 0;
 
         uint32_t block_number;
+
+        /// title, body and json_metadata are in the content store, and they are empty here
+        bool in_store = false;
+
+        /// block of the last change of content, which isn't moved to the content store yet, or 0
+        uint32_t store_block = 0;
+
+        /// parts of content, which are cleared by their depths, see comment_content_part
+        uint8_t cleared = 0;
+    };
+
+    enum comment_content_part: uint8_t {
+        content_title = 1,
+        content_body = 2,
+        content_json_metadata = 4
     };
 
     using comment_content_id_type = object_id<comment_content_object>;
 
     struct by_comment;
     struct by_block_number;
+    struct by_store_block;
 
     using comment_content_index = multi_index_container<
           comment_content_object,
           indexed_by<
              ordered_unique<tag<by_id>, member<comment_content_object, comment_content_id_type, &comment_content_object::id>>,
              ordered_unique<tag<by_comment>, member<comment_content_object, comment_id_type, &comment_content_object::comment>>,
-             ordered_non_unique<tag<by_block_number>, member<comment_content_object, uint32_t, &comment_content_object::block_number>>>,
+             ordered_non_unique<tag<by_block_number>, member<comment_content_object, uint32_t, &comment_content_object::block_number>>,
+             ordered_non_unique<tag<by_store_block>, member<comment_content_object, uint32_t, &comment_content_object::store_block>>>,
         allocator<comment_content_object>
     >;
 
+    /**
+     * Content of the comment, which is removed from the shared memory, but is still in the content store.
+     * It is removed from the store when the block of removal becomes irreversible.
+     */
+    class comment_content_removal_object
+            : public object<comment_content_removal_object_type, comment_content_removal_object> {
+    public:
+        comment_content_removal_object() = delete;
+
+        template<typename Constructor, typename Allocator>
+        comment_content_removal_object(Constructor&& c, allocator <Allocator> a) {
+            c(*this);
+        }
+
+        id_type id;
+
+        comment_id_type comment;
+        uint32_t block_number = 0;
+    };
+
+    using comment_content_removal_id_type = object_id<comment_content_removal_object>;
+
+    using comment_content_removal_index = multi_index_container<
+        comment_content_removal_object,
+        indexed_by<
+            ordered_unique<tag<by_id>, member<comment_content_removal_object, comment_content_removal_id_type, &comment_content_removal_object::id>>,
+            ordered_non_unique<tag<by_block_number>, member<comment_content_removal_object, uint32_t, &comment_content_removal_object::block_number>>>,
+        allocator<comment_content_removal_object>
+    >;
+
     class comment_last_update_object: public object<comment_last_update_object_type, comment_last_update_object> {
     public:
         comment_last_update_object() = delete;
@@ -247,6 +295,10 @@ CHAINBASE_SET_INDEX_TYPE(
     golos::plugins::social_network::comment_content_index
 )
 
+CHAINBASE_SET_INDEX_TYPE(
+    golos::plugins::social_network::comment_content_removal_object,
+    golos::plugins::social_network::comment_content_removal_index)
+
 CHAINBASE_SET_INDEX_TYPE(
     golos::plugins::social_network::comment_last_update_object,
     golos::plugins::social_network::comment_last_update_index)
@@ -1,5 +1,6 @@
 #include <boost/program_options/options_description.hpp>
 #include <golos/plugins/social_network/social_network.hpp>
+#include <golos/plugins/social_network/content_store.hpp>
 #include <golos/chain/index.hpp>
 #include <golos/api/vote_state.hpp>
 #include <golos/chain/steem_objects.hpp>
@@ -15,6 +16,7 @@
 
 #include <diff_match_patch.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem/path.hpp>
 #include <boost/locale/encoding_utf.hpp>
 
 
@@ -86,7 +88,7 @@ namespace golos { namespace plugins { namespace social_network {
 
     struct social_network::impl final {
         impl(): db(appbase::app().get_plugin<chain::plugin>().db()) {
-            helper = std::make_unique<discussion_helper>(db, follow::fill_account_reputation, fill_promoted, fill_comment_info);
+            helper = std::make_unique<discussion_helper>(db, follow::fill_account_reputation, fill_promoted, fill_comment_info_deferred);
         }
 
         ~impl() = default;
@@ -154,6 +156,20 @@ namespace golos { namespace plugins { namespace social_network {
 
         void activate_parent_comments(const comment_object& comment) const;
 
+        comment_content_text get_comment_text(const comment_content_object& content) const;
+
+        bool fill_stored_content(comment_api_object& d) const;
+
+        void fill_stored_content(std::vector<discussion>& discussions) const;
+
+        void open_store(uint32_t head_block_num);
+
+        // Moves contents of irreversible changes from the shared memory to the content store.
+        void move_irreversible_contents();
+
+        // Removes the content object, its stored content is removed when the block_num becomes irreversible.
+        void remove_content(const comment_content_object& content, uint32_t block_num);
+
     private:
         void select_content_replies(std::vector<discussion>& result, const std::string& author, const std::string& permlink, uint32_t vote_limit, uint32_t vote_offset,
             const std::set<comment_object::id_type>& filter_ids,
@@ -171,6 +187,11 @@ namespace golos { namespace plugins { namespace social_network {
         std::unique_ptr<discussion_helper> helper;
         comment_depth_params depth_parameters;
 
+        std::unique_ptr<content_store> store;
+        fc::path store_dir;
+        std::size_t store_cache_size = 0;
+        bool store_opened = false;
+
         // variables to temporarily store values through states of operation visitor
         asset author_gbg_payout_value{0, SBD_SYMBOL}; // part of author payout
         asset author_golos_payout_value{0, STEEM_SYMBOL}; // part of author payout
@@ -199,6 +220,129 @@ namespace golos { namespace plugins { namespace social_network {
         return pimpl->find_comment_content(comment);
     }
 
+    comment_content_text social_network::impl::get_comment_text(const comment_content_object& content) const {
+        if (content.in_store) {
+            auto text = store ? store->find(content.comment._id) : comment_content_text_ptr();
+            return text ? *text : comment_content_text();
+        }
+        return {to_string(content.title), to_string(content.body), to_string(content.json_metadata)};
+    }
+
+    comment_content_text social_network::get_comment_text(const comment_content_object& content) const {
+        return pimpl->get_comment_text(content);
+    }
+
+    bool social_network::impl::fill_stored_content(comment_api_object& d) const {
+        if (!store) {
+            return false;
+        }
+
+        bool filled = false;
+        if (d.content_in_store) {
+            if (auto text = store->find(d.id._id)) {
+                d.title = text->title;
+                d.body = text->body;
+                filled = true;
+            }
+            d.content_in_store = false;
+        }
+        if (d.root_content_in_store) {
+            if (auto root_text = store->find(d.root_comment._id)) {
+                d.root_title = root_text->title;
+                filled = true;
+            }
+            d.root_content_in_store = false;
+        }
+        return filled;
+    }
+
+    void social_network::impl::fill_stored_content(std::vector<discussion>& discussions) const {
+        for (auto& d: discussions) {
+            fill_stored_content(d);
+            if (!!d.last_reply) {
+                fill_stored_content(*d.last_reply);
+            }
+        }
+    }
+
+    bool social_network::fill_stored_content(comment_api_object& d) const {
+        return pimpl->fill_stored_content(d);
+    }
+
+    void social_network::fill_stored_content(std::vector<discussion>& discussions) const {
+        pimpl->fill_stored_content(discussions);
+    }
+
+    const content_store* social_network::store() const {
+        return pimpl->store.get();
+    }
+
+    void social_network::impl::open_store(uint32_t head_block_num) {
+        if (store_opened) {
+            return;
+        }
+        store->open(store_dir, store_cache_size);
+        store_opened = true;
+
+        if (head_block_num == 0) {
+            // the state is replayed from the genesis block, so the store is filled again
+            store->wipe();
+        }
+        GOLOS_CHECK_DATABASE(store->head_block() <= head_block_num,
+            golos::database_corrupted::unknown_file_format,
+            "Content store is ahead of the state, replay the blockchain or remove ${dir}",
+            ("dir", store_dir.string())("store_head", store->head_block())("head", head_block_num));
+
+        ilog("social_network: content store ${dir} contains contents up to block ${head}",
+            ("dir", store_dir.string())("head", store->head_block()));
+    }
+
+    void social_network::impl::move_irreversible_contents() {
+        open_store(db.head_block_num() - 1);
+
+        const auto lib = db.last_non_undoable_block_num();
+        const auto& idx = db.get_index<comment_content_index>().indices().get<by_store_block>();
+
+        // objects are modified by the current block, so the undo of it returns them to the moving
+        for (auto itr = idx.lower_bound(1); itr != idx.end() && itr->store_block <= lib;) {
+            const auto& content = *itr;
+            ++itr;
+
+            store->put(content.comment._id, get_comment_text(content));
+            db.modify(content, [&](comment_content_object& con) {
+                con.title.clear();
+                con.body.clear();
+                con.json_metadata.clear();
+                con.in_store = true;
+                con.store_block = 0;
+            });
+        }
+
+        const auto& removal_idx = db.get_index<comment_content_removal_index>().indices().get<by_block_number>();
+        for (auto itr = removal_idx.begin(); itr != removal_idx.end() && itr->block_number <= lib;) {
+            const auto& removal = *itr;
+            ++itr;
+
+            store->remove(removal.comment._id);
+            db.remove(removal);
+        }
+
+        if (lib > store->head_block()) {
+            store->set_head_block(lib);
+        }
+    }
+
+    void social_network::impl::remove_content(const comment_content_object& content, uint32_t block_num) {
+        // the store keeps the content until the removal becomes irreversible, because the undo restores the object
+        if (store) {
+            db.create<comment_content_removal_object>([&](comment_content_removal_object& r) {
+                r.comment = content.comment;
+                r.block_number = block_num;
+            });
+        }
+        db.remove(content);
+    }
+
     discussion social_network::impl::get_discussion(const comment_object& c, uint32_t vote_limit, uint32_t vote_offset) const {
         return helper->get_discussion(c, vote_limit, vote_offset);
     }
@@ -362,9 +506,9 @@ namespace golos { namespace plugins { namespace social_network {
             }
 
             const auto content = impl.find_comment_content(comment->id);
-
             if (content != nullptr) {
-                impl.db.remove(*content);
+                // head block is the previous one while operations of a block are applied
+                impl.remove_content(*content, db.head_block_num() + 1);
             }
 
             if (db.has_index<comment_last_update_index>()) {
@@ -420,7 +564,20 @@ namespace golos { namespace plugins { namespace social_network {
                 const auto comment_content = impl.find_comment_content(comment->id);
                 if ( comment_content != nullptr) {
                     // Edit case
+                    if (comment_content->in_store) {
+                        // operations of the first block are applied before its applied_block, which opens the store
+                        impl.open_store(db.head_block_num());
+                    }
                     db.modify(*comment_content, [&]( comment_content_object& con ) {
+                        if (con.in_store) {
+                            // the changed content is kept in the shared memory until the change becomes irreversible
+                            auto text = impl.get_comment_text(con);
+                            from_string(con.title, text.title);
+                            from_string(con.body, text.body);
+                            from_string(con.json_metadata, text.json_metadata);
+                            con.in_store = false;
+                        }
+                        con.cleared = 0;
                         if (o.title.size() && (!dp.has_comment_title_depth || dp.comment_title_depth > 0)) {
                             from_string(con.title, o.title);
                         }
@@ -454,6 +611,9 @@ namespace golos { namespace plugins { namespace social_network {
                         if (dp.set_null_after_update) {
                             con.block_number = db.head_block_num();
                         }
+                        if (impl.store) {
+                            con.store_block = db.head_block_num() + 1;
+                        }
                     });
                 } else {
                     // Creation case
@@ -472,6 +632,10 @@ namespace golos { namespace plugins { namespace social_network {
                             from_string(con.json_metadata, o.json_metadata);
                         }
                         con.block_number = db.head_block_num();
+                        // head block is the previous one while operations of a block are applied
+                        if (impl.store) {
+                            con.store_block = db.head_block_num() + 1;
+                        }
                     });
                 }
             }
@@ -646,6 +810,10 @@ namespace golos { namespace plugins { namespace social_network {
     void social_network::impl::on_block(const signed_block& b) { try {
         const auto& dp = depth_parameters;
 
+        if (store) {
+            move_irreversible_contents();
+        }
+
         if (dp.need_clear_content()) {
             const auto& content_idx = db.get_index<comment_content_index>().indices().get<by_block_number>();
 
@@ -656,29 +824,52 @@ namespace golos { namespace plugins { namespace social_network {
 
                 auto* comment = db.find<comment_object, by_id>(content.comment);
                 if (nullptr == comment) {
-                    db.remove(content);
+                    remove_content(content, head_block_num);
                     continue;
                 }
 
                 auto delta = head_block_num - content.block_number;
                 if (comment->mode == archived && dp.should_delete_part_of_content_object(delta)) {
                     if (dp.should_delete_whole_content_object(delta)) {
-                        db.remove(content);
+                        remove_content(content, head_block_num);
+                        continue;
+                    }
+
+                    uint8_t parts = 0;
+                    if (dp.has_comment_title_depth && delta > dp.comment_title_depth) {
+                        parts |= content_title;
+                    }
+                    if (dp.has_comment_body_depth && delta > dp.comment_body_depth) {
+                        parts |= content_body;
+                    }
+                    if (dp.has_comment_json_metadata_depth && delta > dp.comment_json_metadata_depth) {
+                        parts |= content_json_metadata;
+                    }
+                    parts &= ~content.cleared;
+                    if (!parts) {
                         continue;
                     }
 
+                    // the stored content is loaded back and is moved to the store again when the block is irreversible
+                    auto text = content.in_store ? get_comment_text(content) : comment_content_text();
                     db.modify(content, [&](comment_content_object& con) {
-                        if (dp.has_comment_title_depth && delta > dp.comment_title_depth) {
+                        if (con.in_store) {
+                            from_string(con.title, text.title);
+                            from_string(con.body, text.body);
+                            from_string(con.json_metadata, text.json_metadata);
+                            con.in_store = false;
+                            con.store_block = head_block_num;
+                        }
+                        if (parts & content_title) {
                             con.title.clear();
                         }
-
-                        if (dp.has_comment_body_depth && delta > dp.comment_body_depth) {
+                        if (parts & content_body) {
                             con.body.clear();
                         }
-
-                        if (dp.has_comment_json_metadata_depth && delta > dp.comment_json_metadata_depth) {
+                        if (parts & content_json_metadata) {
                             con.json_metadata.clear();
                         }
+                        con.cleared |= parts;
                     });
 
                 } else {
@@ -713,10 +904,18 @@ namespace golos { namespace plugins { namespace social_network {
 
     void social_network::plugin_startup() {
         wlog("social_network plugin: plugin_startup()");
+        if (pimpl->store) {
+            pimpl->db.with_weak_read_lock([&]() {
+                pimpl->open_store(pimpl->db.head_block_num());
+            });
+        }
     }
 
     void social_network::plugin_shutdown() {
         wlog("social_network plugin: plugin_shutdown()");
+        if (pimpl->store) {
+            pimpl->store->close();
+        }
     }
 
     const std::string& social_network::name() {
@@ -749,6 +948,13 @@ namespace golos { namespace plugins { namespace social_network {
             ) (
                 "store-comment-rewards", boost::program_options::value<bool>()->default_value(true),
                 "store comment rewards"
+            ) (
+                "comment-content-store-dir", boost::program_options::value<boost::filesystem::path>(),
+                "Directory of the store for comment contents (absolute path or relative to application data dir). "
+                "If it is set, titles, bodies and json-metadatas of irreversible changes are moved out of the shared memory."
+            ) (
+                "comment-content-cache-size", boost::program_options::value<uint32_t>()->default_value(10000),
+                "Maximum number of comment contents in the read cache of the content store"
             );
         //  Do not use bool_switch() in cfg!
     }
@@ -760,6 +966,7 @@ namespace golos { namespace plugins { namespace social_network {
         auto& db = pimpl->db;
 
         add_plugin_index<comment_content_index>(db);
+        add_plugin_index<comment_content_removal_index>(db);
 
         comment_depth_params& params = pimpl->depth_parameters;
 
@@ -808,12 +1015,25 @@ namespace golos { namespace plugins { namespace social_network {
         if (options.count("set-content-storing-depth-null-after-update")) {
             params.set_null_after_update = options.at("set-content-storing-depth-null-after-update").as<bool>();
         }
+
+        if (options.count("comment-content-store-dir")) {
+            auto dir = options.at("comment-content-store-dir").as<boost::filesystem::path>();
+            if (dir.is_relative()) {
+                dir = appbase::app().data_dir() / dir;
+            }
+            pimpl->store = std::make_unique<content_store>();
+            pimpl->store_dir = dir;
+            pimpl->store_cache_size = options.at("comment-content-cache-size").as<uint32_t>();
+            ilog("social_network: comment-content-store-dir ${d}", ("d", dir.string()));
+        }
     }
 
     social_network::~social_network() = default;
 
     comment_api_object social_network::impl::create_comment_api_object(const comment_object& o) const {
-        return helper->create_comment_api_object(o);
+        auto result = helper->create_comment_api_object(o);
+        fill_stored_content(result);
+        return result;
     }
 
     comment_api_object social_network::create_comment_api_object(const comment_object& o) const {
@@ -830,9 +1050,11 @@ namespace golos { namespace plugins { namespace social_network {
             (std::set<account_name_type>, filter_authors, std::set<account_name_type>())
             (bool, filter_negative_rep_authors, true)
         );
-        return pimpl->db.with_weak_read_lock([&]() {
+        auto result = pimpl->db.with_weak_read_lock([&]() {
             return pimpl->get_content_replies(author, permlink, vote_limit, vote_offset, filter_ids, filter_authors, filter_negative_rep_authors);
         });
+        pimpl->fill_stored_content(result);
+        return result;
     }
 
     std::vector<discussion> social_network::impl::get_content_replies(
@@ -857,9 +1079,11 @@ namespace golos { namespace plugins { namespace social_network {
             (bool, filter_negative_rep_authors, false)
             (fc::optional<bool>, sort_by_created_desc, fc::optional<bool>())
         );
-        return pimpl->db.with_weak_read_lock([&]() {
+        auto result = pimpl->db.with_weak_read_lock([&]() {
             return pimpl->get_all_content_replies(author, permlink, vote_limit, vote_offset, filter_ids, filter_authors, filter_negative_rep_authors, sort_by_created_desc);
         });
+        pimpl->fill_stored_content(result);
+        return result;
     }
 
     std::vector<discussion> social_network::impl::get_all_content_replies(
@@ -900,7 +1124,7 @@ namespace golos { namespace plugins { namespace social_network {
         const std::set<account_name_type>& filter_authors,
         bool filter_negative_rep_authors
     ) const {
-        discussion_helper helper_no_rep(db, follow::fill_account_reputation, fill_promoted, fill_comment_info, false);
+        discussion_helper helper_no_rep(db, follow::fill_account_reputation, fill_promoted, fill_comment_info_deferred, false);
 
         account_name_type acc_name = account_name_type(author);
         const auto& by_permlink_idx = db.get_index<comment_index>().indices().get<by_parent>();
@@ -958,11 +1182,13 @@ namespace golos { namespace plugins { namespace social_network {
             (std::set<comment_object::id_type>, filter_ids, std::set<comment_object::id_type>())
             (std::set<account_name_type>, filter_authors, std::set<account_name_type>())
         );
-        return pimpl->db.with_weak_read_lock([&]() {
+        auto reply = pimpl->db.with_weak_read_lock([&]() {
             discussion reply;
             pimpl->get_last_reply(reply, author, permlink, vote_limit, vote_offset, filter_ids, filter_authors);
             return reply;
         });
+        pimpl->fill_stored_content(reply);
+        return reply;
     }
 
     DEFINE_API(social_network, get_account_votes) {
@@ -1020,9 +1246,12 @@ namespace golos { namespace plugins { namespace social_network {
             (uint32_t, vote_limit, DEFAULT_VOTE_LIMIT)
             (uint32_t, vote_offset, 0)
         );
-        return pimpl->db.with_weak_read_lock([&]() {
+        // content from the store is read after the release of the database lock
+        auto result = pimpl->db.with_weak_read_lock([&]() {
             return pimpl->get_content(author, permlink, vote_limit, vote_offset);
         });
+        pimpl->fill_stored_content(result);
+        return result;
     }
 
     DEFINE_API(social_network, get_active_votes) {
@@ -1281,9 +1510,11 @@ namespace golos { namespace plugins { namespace social_network {
             (std::set<std::string>, filter_tag_masks) 
         );
         GOLOS_CHECK_LIMIT_PARAM(limit, 100);
-        return pimpl->db.with_weak_read_lock([&]() {
+        auto result = pimpl->db.with_weak_read_lock([&]() {
             return pimpl->get_replies_by_last_update(start_parent_author, start_permlink, limit, vote_limit, vote_offset, &filter_tag_masks);
         });
+        pimpl->fill_stored_content(result);
+        return result;
     }
 
     /**
@@ -1307,18 +1538,38 @@ namespace golos { namespace plugins { namespace social_network {
             (std::set<account_name_type>, filter_authors, std::set<account_name_type>())
             (std::string, category_prefix, "")
         );
-        return pimpl->db.with_weak_read_lock([&]() {
+        auto result = pimpl->db.with_weak_read_lock([&]() {
             return pimpl->get_all_discussions_by_active(start_author, start_permlink, from, limit, categories, vote_limit, vote_offset, filter_ids, filter_authors, category_prefix);
         });
+        for (auto& category: result) {
+            pimpl->fill_stored_content(category.second);
+        }
+        return result;
     }
 
-    void fill_comment_info(const golos::chain::database& db, const comment_object& co, comment_api_object& con) {
+    static void fill_comment_info(
+        const golos::chain::database& db, const comment_object& co, comment_api_object& con, bool defer_stored
+    ) {
         if (db.has_index<comment_content_index>()) {
+            const auto& plugin = appbase::app().get_plugin<social_network>();
+
             const auto content = db.find<comment_content_object, by_comment>(co.id);
             if (content != nullptr) {
-                con.title = to_string(content->title);
-                con.body = to_string(content->body);
-                con.json_metadata = to_string(content->json_metadata);
+                if (content->in_store) {
+                    // json_metadata is filled at once, because it is used by filters of discussions
+                    auto text = plugin.get_comment_text(*content);
+                    if (!defer_stored) {
+                        con.title = std::move(text.title);
+                        con.body = std::move(text.body);
+                    } else {
+                        con.content_in_store = true;
+                    }
+                    con.json_metadata = std::move(text.json_metadata);
+                } else {
+                    con.title = to_string(content->title);
+                    con.body = to_string(content->body);
+                    con.json_metadata = to_string(content->json_metadata);
+                }
                 con.net_rshares = content->net_rshares;
                 con.donates = content->donates;
                 con.donates_uia = content->donates_uia;
@@ -1326,7 +1577,13 @@ namespace golos { namespace plugins { namespace social_network {
 
             const auto root_content = db.find<comment_content_object, by_comment>(co.root_comment);
             if (root_content != nullptr) {
-                con.root_title = to_string(root_content->title);
+                if (!root_content->in_store) {
+                    con.root_title = to_string(root_content->title);
+                } else if (!defer_stored) {
+                    con.root_title = plugin.get_comment_text(*root_content).title;
+                } else {
+                    con.root_content_in_store = true;
+                }
             }
         }
 
@@ -1368,12 +1625,23 @@ namespace golos { namespace plugins { namespace social_network {
         }
     }
 
+    void fill_comment_info(const golos::chain::database& db, const comment_object& co, comment_api_object& con) {
+        fill_comment_info(db, co, con, false);
+    }
+
+    void fill_comment_info_deferred(const golos::chain::database& db, const comment_object& co, comment_api_object& con) {
+        fill_comment_info(db, co, con, true);
+    }
+
     std::string get_json_metadata(const golos::chain::database& db, const comment_object& c) {
         if (!db.has_index<comment_content_index>()) {
             return std::string();
         }
         const auto content = db.find<comment_content_object, by_comment>(c.id);
         if (content != nullptr) {
+            if (content->in_store) {
+                return appbase::app().get_plugin<social_network>().get_comment_text(*content).json_metadata;
+            }
             return to_string(content->json_metadata);
         }
         return std::string();
@@ -27,7 +27,7 @@ namespace golos { namespace plugins { namespace tags {
                 database_,
                 follow::fill_account_reputation,
                 fill_promoted,
-                social_network::fill_comment_info);
+                social_network::fill_comment_info_deferred);
         }
 
         ~impl() {}
@@ -94,6 +94,8 @@ namespace golos { namespace plugins { namespace tags {
         discussion create_discussion(const comment_object& o) const;
         discussion create_discussion(const comment_object& o, const discussion_query& query) const;
         void fill_discussion(discussion& d, const discussion_query& query) const;
+        void truncate_discussion(discussion& d, const discussion_query& query) const;
+        void fill_stored_content(std::vector<discussion>& discussions, const discussion_query& query) const;
         void fill_comment_api_object(const comment_object& o, discussion& d) const;
 
         comment_api_object create_comment_api_object(const comment_object & o) const;
@@ -130,7 +132,10 @@ namespace golos { namespace plugins { namespace tags {
 
     void tags_plugin::impl::fill_discussion(discussion& d, const discussion_query& query) const {
         helper->fill_discussion(d, database_.get_comment(d.author, d.permlink),  query.vote_limit, query.vote_offset);
+        truncate_discussion(d, query);
+    }
 
+    void tags_plugin::impl::truncate_discussion(discussion& d, const discussion_query& query) const {
         d.body_length = static_cast<uint32_t>(d.body.size());
         if (query.truncate_body) {
             if (d.body.size() > query.truncate_body) {
@@ -151,6 +156,16 @@ namespace golos { namespace plugins { namespace tags {
         }
     }
 
+    // Contents from the store are read after the release of the database lock
+    void tags_plugin::impl::fill_stored_content(std::vector<discussion>& discussions, const discussion_query& query) const {
+        const auto& social_network = appbase::app().get_plugin<social_network::social_network>();
+        for (auto& d: discussions) {
+            if (social_network.fill_stored_content(d)) {
+                truncate_discussion(d, query);
+            }
+        }
+    }
+
     discussion tags_plugin::impl::create_discussion(const comment_object& o, const discussion_query& query) const {
 
         discussion d = create_discussion(o);
@@ -539,6 +554,7 @@ namespace golos { namespace plugins { namespace tags {
             result.push_back(std::move(*it));
         }
 
+        fill_stored_content(result, query);
         return result;
     }
 
@@ -556,7 +572,7 @@ namespace golos { namespace plugins { namespace tags {
         GOLOS_ASSERT(db.has_index<follow::feed_index>(), golos::unsupported_api_method, 
                 "Node is not running the follow plugin");
 
-        return db.with_weak_read_lock([&]() {
+        auto result = db.with_weak_read_lock([&]() {
             return pimpl->select_unordered_discussions<follow::blog_index, follow::by_blog>(
                 query,
                 [&](discussion& d, const follow::blog_object& b) {
@@ -567,6 +583,8 @@ namespace golos { namespace plugins { namespace tags {
                     d.reblog_json_metadata = to_string(b.reblog_json_metadata);
                 });
         });
+        pimpl->fill_stored_content(result, query);
+        return result;
     }
 
     DEFINE_API(tags_plugin, get_discussions_by_feed) {
@@ -582,7 +600,7 @@ namespace golos { namespace plugins { namespace tags {
         GOLOS_ASSERT(db.has_index<follow::feed_index>(), golos::unsupported_api_method,
                 "Node is not running the follow plugin");
 
-        return db.with_weak_read_lock([&]() {
+        auto result = db.with_weak_read_lock([&]() {
             return pimpl->select_unordered_discussions<follow::feed_index, follow::by_feed>(
                 query,
                 [&](discussion& d, const follow::feed_object& f) {
@@ -601,6 +619,8 @@ namespace golos { namespace plugins { namespace tags {
                     }
                 });
         });
+        pimpl->fill_stored_content(result, query);
+        return result;
     }
 
     DEFINE_API(tags_plugin, get_discussions_by_comments) {
@@ -619,7 +639,7 @@ namespace golos { namespace plugins { namespace tags {
             return result;
         }
 
-        return db.with_weak_read_lock([&]() {
+        result = db.with_weak_read_lock([&]() {
             const auto& clu_cmt_idx = db.get_index<comment_last_update_index>().indices().get<golos::plugins::social_network::by_comment>();
             const auto& clu_idx = db.get_index<comment_last_update_index>().indices().get<golos::plugins::social_network::by_author_last_update>();
 
@@ -664,8 +684,10 @@ namespace golos { namespace plugins { namespace tags {
                     pimpl->fill_discussion(result.back(), query);
                 }
             }
-            return result;
+            return std::move(result);
         });
+        pimpl->fill_stored_content(result, query);
+        return result;
     }
 
     DEFINE_API(tags_plugin, get_discussions_by_trending) {
@@ -938,7 +960,7 @@ namespace golos { namespace plugins { namespace tags {
             return result;
         }
 
-        return db.with_weak_read_lock([&]() {
+        result = db.with_weak_read_lock([&]() {
             try {
                 uint32_t count = 0;
                 const auto& clu_cmt_idx = db.get_index<comment_last_update_index>().indices().get<golos::plugins::social_network::by_comment>();
@@ -963,9 +985,11 @@ namespace golos { namespace plugins { namespace tags {
                     }
                 }
 
-                return result;
+                return std::move(result);
             } FC_CAPTURE_AND_RETHROW((author)(start_permlink)(before_date)(limit))
         });
+        appbase::app().get_plugin<social_network::social_network>().fill_stored_content(result);
+        return result;
     }
 
     // Needed for correct work of golos::api::discussion_helper::set_pending_payout and etc api methods
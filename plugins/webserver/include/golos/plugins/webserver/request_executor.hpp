@@ -0,0 +1,117 @@
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <boost/thread.hpp>
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace golos {
+    namespace plugins {
+        namespace webserver {
+
+            /// Requests of higher priority are executed first
+            enum class request_priority: uint8_t {
+                high,
+                normal,
+                low
+            };
+
+            struct method_queue_stats {
+                uint64_t queued = 0;         ///< number of requests in the queue now
+                uint64_t max_queued = 0;
+                uint64_t executed = 0;
+                uint64_t rejected = 0;       ///< rejected on full queue or on too long waiting
+                uint64_t wait_time = 0;      ///< total waiting of executed requests in microseconds
+                uint64_t max_wait_time = 0;  ///< in microseconds
+            };
+
+            struct request_queue_stats {
+                uint32_t threads = 0;
+                uint64_t high_queued = 0;
+                uint64_t normal_queued = 0;
+                uint64_t low_queued = 0;
+                uint64_t rejected = 0;
+                std::map<std::string, method_queue_stats> methods;
+            };
+
+            /**
+             * Executor of requests with admission control.
+             *
+             * Requests wait in queues of their priorities and are executed by a fixed number of threads.
+             * A request is rejected, if the total queue or the queue of its method is full,
+             * or if it waited longer than the allowed time. So an overloaded node answers fast with an error
+             * instead of growing of queues without limit.
+             */
+            class request_executor final {
+            public:
+                using task_type = std::function<void()>;
+
+                /**
+                 * @param threads number of worker threads
+                 * @param max_queue_size maximum number of waiting requests of all methods
+                 * @param max_method_queue_size maximum number of waiting requests of one method
+                 * @param max_wait maximum waiting of a request, it isn't limited if zero
+                 */
+                request_executor(
+                    uint32_t threads, std::size_t max_queue_size, std::size_t max_method_queue_size,
+                    fc::microseconds max_wait);
+
+                ~request_executor();
+
+                /**
+                 * Queues the request
+                 * @param method name of the method, which is used for limits and stats
+                 * @param task execution of the request
+                 * @param reject answer of the rejected request, it is called by this call or by a worker thread
+                 * @return false if the request is rejected right away
+                 */
+                bool post(const std::string& method, request_priority priority, task_type task, task_type reject);
+
+                /// Stops worker threads, waiting requests are dropped
+                void stop();
+
+                request_queue_stats get_stats() const;
+
+            private:
+                struct queued_request {
+                    task_type task;
+                    task_type reject;
+                    method_queue_stats* stats;
+                    fc::time_point time;
+                };
+
+                void run();
+
+                const uint32_t _threads;
+                const std::size_t _max_queue_size;
+                const std::size_t _max_method_queue_size;
+                const fc::microseconds _max_wait;
+
+                mutable std::mutex _mutex;
+                std::condition_variable _cond;
+                bool _stopped = false;
+                std::array<std::deque<queued_request>, 3> _queues;
+                std::size_t _queued = 0;
+                uint64_t _rejected = 0;
+                std::map<std::string, method_queue_stats> _methods;
+
+                boost::thread_group _thread_pool;
+            };
+
+        }
+    }
+} // golos::plugins::webserver
+
+FC_REFLECT((golos::plugins::webserver::method_queue_stats),
+    (queued)(max_queued)(executed)(rejected)(wait_time)(max_wait_time))
+
+FC_REFLECT((golos::plugins::webserver::request_queue_stats),
+    (threads)(high_queued)(normal_queued)(low_queued)(rejected)(methods))
@@ -0,0 +1,118 @@
+#include <golos/plugins/webserver/request_executor.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+namespace golos {
+    namespace plugins {
+        namespace webserver {
+
+            request_executor::request_executor(
+                uint32_t threads, std::size_t max_queue_size, std::size_t max_method_queue_size,
+                fc::microseconds max_wait
+            ) : _threads(threads),
+                _max_queue_size(max_queue_size),
+                _max_method_queue_size(max_method_queue_size),
+                _max_wait(max_wait) {
+                for (uint32_t i = 0; i < _threads; ++i) {
+                    _thread_pool.create_thread([this]{ run(); });
+                }
+            }
+
+            request_executor::~request_executor() {
+                stop();
+            }
+
+            bool request_executor::post(
+                const std::string& method, request_priority priority, task_type task, task_type reject
+            ) {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto& stats = _methods[method];
+                    if (!_stopped && _queued < _max_queue_size && stats.queued < _max_method_queue_size) {
+                        _queues[static_cast<std::size_t>(priority)].push_back(
+                            {std::move(task), std::move(reject), &stats, fc::time_point::now()});
+                        ++_queued;
+                        ++stats.queued;
+                        stats.max_queued = std::max(stats.max_queued, stats.queued);
+                        _cond.notify_one();
+                        return true;
+                    }
+                    ++stats.rejected;
+                    ++_rejected;
+                }
+
+                reject();
+                return false;
+            }
+
+            void request_executor::stop() {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_stopped) {
+                        return;
+                    }
+                    _stopped = true;
+                    _cond.notify_all();
+                }
+                _thread_pool.join_all();
+            }
+
+            void request_executor::run() {
+                for (;;) {
+                    task_type task;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _cond.wait(lock, [this]{ return _stopped || _queued != 0; });
+                        if (_stopped) {
+                            return;
+                        }
+
+                        auto queue = _queues.begin();
+                        for (; queue->empty(); ++queue);
+
+                        auto request = std::move(queue->front());
+                        queue->pop_front();
+                        --_queued;
+                        --request.stats->queued;
+
+                        auto wait = uint64_t((fc::time_point::now() - request.time).count());
+                        if (_max_wait.count() > 0 && wait > uint64_t(_max_wait.count())) {
+                            ++request.stats->rejected;
+                            ++_rejected;
+                            task = std::move(request.reject);
+                        } else {
+                            ++request.stats->executed;
+                            request.stats->wait_time += wait;
+                            request.stats->max_wait_time = std::max(request.stats->max_wait_time, wait);
+                            task = std::move(request.task);
+                        }
+                    }
+
+                    try {
+                        task();
+                    } catch (const fc::exception& e) {
+                        elog("Error in webserver request: ${e}", ("e", e.to_detail_string()));
+                    } catch (const std::exception& e) {
+                        elog("Error in webserver request: ${e}", ("e", e.what()));
+                    } catch (...) {
+                        elog("Unknown error in webserver request");
+                    }
+                }
+            }
+
+            request_queue_stats request_executor::get_stats() const {
+                std::lock_guard<std::mutex> lock(_mutex);
+                request_queue_stats result;
+                result.threads = _threads;
+                result.high_queued = _queues[static_cast<std::size_t>(request_priority::high)].size();
+                result.normal_queued = _queues[static_cast<std::size_t>(request_priority::normal)].size();
+                result.low_queued = _queues[static_cast<std::size_t>(request_priority::low)].size();
+                result.rejected = _rejected;
+                result.methods = _methods;
+                return result;
+            }
+
+        }
+    }
+} // golos::plugins::webserver
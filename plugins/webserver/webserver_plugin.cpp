@@ -1,4 +1,5 @@
 #include <golos/plugins/webserver/webserver_plugin.hpp>
+#include <golos/plugins/webserver/request_executor.hpp>
 
 #include <golos/plugins/chain/plugin.hpp>
 
@@ -76,13 +77,14 @@ namespace golos {
 
             using websocket_server_type = websocketpp::server<asio_with_stub_log>;
 
+            using response_handler_type = json_rpc::plugin::response_handler_type;
+
             struct webserver_plugin::webserver_plugin_impl final {
             public:
-                boost::thread_group& thread_pool = appbase::app().scheduler();
-                webserver_plugin_impl(thread_pool_size_t thread_pool_size) : thread_pool_work(this->thread_pool_ios) {
-                    for (uint32_t i = 0; i < thread_pool_size; ++i) {
-                        thread_pool.create_thread(boost::bind(&asio::io_service::run, &thread_pool_ios));
-                    }
+                webserver_plugin_impl(
+                    thread_pool_size_t thread_pool_size, std::size_t max_queue_size, std::size_t max_method_queue_size,
+                    fc::microseconds max_queue_wait
+                ) : executor(thread_pool_size, max_queue_size, max_method_queue_size, max_queue_wait) {
                 }
 
                 void start_webserver();
@@ -93,6 +95,12 @@ namespace golos {
 
                 void handle_http_message(websocket_server_type *, connection_hdl);
 
+                void dispatch(const std::string &body, response_handler_type handler, response_handler_type reject_handler);
+
+                void admit(const fc::variant &request, std::function<void()> task, response_handler_type reject_handler);
+
+                request_priority get_priority(const fc::variant &request) const;
+
                 shared_ptr<std::thread> http_thread;
                 asio::io_service http_ios;
                 optional<tcp::endpoint> http_endpoint;
@@ -102,8 +110,10 @@ namespace golos {
                 asio::io_service ws_ios;
                 optional<tcp::endpoint> ws_endpoint;
                 websocket_server_type ws_server;
-                asio::io_service thread_pool_ios;
-                asio::io_service::work thread_pool_work;
+
+                request_executor executor;
+                // names of methods or prefixes of names ended with '*'
+                std::vector<std::pair<std::string, request_priority>> method_priorities;
 
                 plugins::json_rpc::plugin *api;
                 boost::signals2::connection chain_sync_con;
@@ -173,8 +183,7 @@ namespace golos {
                     http_server.stop_listening();
                 }
 
-                thread_pool_ios.stop();
-                thread_pool.join_all();
+                executor.stop();
 
                 if (ws_thread) {
                     ws_ios.stop();
@@ -189,60 +198,139 @@ namespace golos {
                 }
             }
 
+            request_priority webserver_plugin::webserver_plugin_impl::get_priority(const fc::variant &request) const {
+                if (request.is_array()) {
+                    // batch has the lowest priority of its requests
+                    auto result = request_priority::high;
+                    for (const auto& item: request.get_array()) {
+                        result = std::max(result, get_priority(item));
+                    }
+                    return result;
+                }
+
+                auto method = api->get_method_name(request);
+                for (const auto& item: method_priorities) {
+                    const auto& pattern = item.first;
+                    if (!pattern.empty() && pattern.back() == '*') {
+                        if (method.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) {
+                            return item.second;
+                        }
+                    } else if (method == pattern) {
+                        return item.second;
+                    }
+                }
+                return request_priority::normal;
+            }
+
+            static std::string overloaded_response(const fc::variant &request) {
+                fc::variant id;
+                if (request.is_object() && request.get_object().contains("id")) {
+                    id = request.get_object()["id"];
+                }
+                return fc::json::to_string(fc::mutable_variant_object()
+                    ("jsonrpc", "2.0")
+                    ("error", fc::mutable_variant_object()
+                        ("code", SERVER_OVERLOADED)
+                        ("message", "Server is overloaded, try again later"))
+                    ("id", id));
+            }
+
+            void webserver_plugin::webserver_plugin_impl::admit(
+                const fc::variant &request, std::function<void()> task, response_handler_type reject_handler
+            ) {
+                executor.post(
+                    api->get_method_name(request), get_priority(request), std::move(task),
+                    [request, reject_handler]() {
+                        reject_handler(overloaded_response(request));
+                    });
+            }
+
+            void webserver_plugin::webserver_plugin_impl::dispatch(
+                const std::string &body, response_handler_type handler, response_handler_type reject_handler
+            ) {
+                // the body is parsed by a worker thread, so a large request doesn't stop the io thread,
+                //   then the request is admitted by its method
+                executor.post(
+                    "parse", request_priority::high,
+                    [this, body, handler, reject_handler]() {
+                        fc::variant request;
+                        try {
+                            request = fc::json::from_string(body);
+                        } catch (const fc::exception &) {
+                            // json_rpc answers with the parse error
+                            api->call(body, handler);
+                            return;
+                        }
+
+                        admit(request, [this, request, handler]() {
+                            api->call(request, handler);
+                        }, reject_handler);
+                    },
+                    [reject_handler]() {
+                        reject_handler(overloaded_response(fc::variant()));
+                    });
+            }
+
             void webserver_plugin::webserver_plugin_impl::handle_ws_message(
                 websocket_server_type *server,
                 connection_hdl hdl,
                 websocket_server_type::message_ptr msg
             ) {
                 auto con = server->get_con_from_hdl(hdl);
-                thread_pool_ios.post([con, msg, this]() {
-                    try {
-                        if (msg->get_opcode() == websocketpp::frame::opcode::text) {
-                            api->call(msg->get_payload(), [con](const std::string &data){
-                                auto ec = con->send(data);
-                                if (ec) {
-                                    throw websocketpp::exception(ec);
-                                }
-                            });
-                        } else {
-                            con->send("error: string payload expected");
-                        }
-                    } catch (const fc::exception &e) {
-                        con->send("error calling API " + e.to_string());
+                try {
+                    if (msg->get_opcode() == websocketpp::frame::opcode::text) {
+                        dispatch(msg->get_payload(), [con](const std::string &data){
+                            auto ec = con->send(data);
+                            if (ec) {
+                                throw websocketpp::exception(ec);
+                            }
+                        }, [con](const std::string &data){
+                            // the connection can be already closed, nothing to do with it
+                            con->send(data);
+                        });
+                    } else {
+                        con->send("error: string payload expected");
                     }
-                });
+                } catch (const fc::exception &e) {
+                    con->send("error calling API " + e.to_string());
+                } catch (const websocketpp::exception &) {
+                    // the connection is closed
+                }
             }
 
             void webserver_plugin::webserver_plugin_impl::handle_http_message(websocket_server_type *server, connection_hdl hdl) {
                 auto con = server->get_con_from_hdl(hdl);
                 con->defer_http_response();
 
-                thread_pool_ios.post([con, this]() {
-                    auto body = con->get_request_body();
+                auto send_response = [con](const std::string &data, websocketpp::http::status_code::value status) {
+                    // this lambda can be called from any thread in application
+                    //   for example, when task was delegated ( see msg_pack(msg_pack&&) )
+                    con->set_body(data);
+                    con->set_status(status);
+                    con->send_http_response();
+                };
 
-                    try {
-                        api->call(body, [con](const std::string &data){
-                            // this lambda can be called from any thread in application
-                            //   for example, when task was delegated ( see msg_pack(msg_pack&&) )
-                            con->set_body(data);
-                            con->set_status(websocketpp::http::status_code::ok);
-                            con->send_http_response();
-                        });
-                    } catch (fc::exception &e) {
-                        // this case happens if exception was thrown on parsing request
-                        edump((e));
-                        con->set_body("Could not call API");
-                        con->set_status(websocketpp::http::status_code::not_found);
-                        // this sending response can't be merged with sending response from try-block
-                        //   because try-block can work from other thread,
-                        //   when catch-block happens in current thread on parsing request
+                try {
+                    dispatch(con->get_request_body(), [send_response](const std::string &data){
+                        send_response(data, websocketpp::http::status_code::ok);
+                    }, [send_response](const std::string &data){
                         try {
-                            con->send_http_response();
+                            send_response(data, websocketpp::http::status_code::service_unavailable);
                         } catch (...) {
                             // disable segfault
                         }
+                    });
+                } catch (fc::exception &e) {
+                    // this case happens if exception was thrown on parsing request
+                    edump((e));
+                    con->set_body("Could not call API");
+                    con->set_status(websocketpp::http::status_code::not_found);
+                    try {
+                        con->send_http_response();
+                    } catch (...) {
+                        // disable segfault
                     }
-                });
+                }
             }
 
             webserver_plugin::webserver_plugin() {
@@ -259,15 +347,57 @@ namespace golos {
                         "Local websocket endpoint for webserver requests.")
                     ("rpc-endpoint", boost::program_options::value<string>(),
                         "Local http and websocket endpoint for webserver requests. Deprectaed in favor of webserver-http-endpoint and webserver-ws-endpoint")
-                    ("webserver-thread-pool-size", boost::program_options::value<thread_pool_size_t>()->default_value(256),
-                        "Number of threads used to handle queries. Default: 256.");
+                    ("webserver-thread-pool-size", boost::program_options::value<thread_pool_size_t>()->default_value(0),
+                        "Number of threads used to handle queries. Default: 0 - the number of CPU cores.")
+                    ("webserver-max-queue-size", boost::program_options::value<uint32_t>()->default_value(10000),
+                        "Maximum number of queries waiting for execution. Queries over the limit are rejected.")
+                    ("webserver-max-method-queue-size", boost::program_options::value<uint32_t>()->default_value(1000),
+                        "Maximum number of queries of one method waiting for execution. Queries over the limit are rejected.")
+                    ("webserver-max-queue-wait-msec", boost::program_options::value<uint32_t>()->default_value(10000),
+                        "Maximum milliseconds of waiting for execution, queries waiting longer are rejected. 0 means no limit.")
+                    ("webserver-high-priority-method", boost::program_options::value<std::vector<string>>()->composing()->multitoken(),
+                        "Method (api.method or prefix ended with *) executed before others. By default it is a set of cheap methods.")
+                    ("webserver-low-priority-method", boost::program_options::value<std::vector<string>>()->composing()->multitoken(),
+                        "Method (api.method or prefix ended with *) executed after others. By default it is a set of heavy methods.");
             }
 
             void webserver_plugin::plugin_initialize(const boost::program_options::variables_map &options) {
                 auto thread_pool_size = options.at("webserver-thread-pool-size").as<thread_pool_size_t>();
-                FC_ASSERT(thread_pool_size > 0, "webserver-thread-pool-size must be greater than 0");
-                ilog("configured with ${tps} thread pool size", ("tps", thread_pool_size));
-                my.reset(new webserver_plugin_impl(thread_pool_size));
+                if (thread_pool_size == 0) {
+                    thread_pool_size = std::max(std::thread::hardware_concurrency(), 1u);
+                }
+                auto max_queue_size = options.at("webserver-max-queue-size").as<uint32_t>();
+                auto max_method_queue_size = options.at("webserver-max-method-queue-size").as<uint32_t>();
+                auto max_queue_wait = fc::milliseconds(options.at("webserver-max-queue-wait-msec").as<uint32_t>());
+                FC_ASSERT(max_queue_size > 0, "webserver-max-queue-size must be greater than 0");
+                FC_ASSERT(max_method_queue_size > 0, "webserver-max-method-queue-size must be greater than 0");
+                ilog("configured with ${tps} thread pool size, ${qs} queue size", ("tps", thread_pool_size)("qs", max_queue_size));
+                my.reset(new webserver_plugin_impl(thread_pool_size, max_queue_size, max_method_queue_size, max_queue_wait));
+
+                auto add_priorities = [&](const char* option, request_priority priority, std::vector<string> defaults) {
+                    auto methods = options.count(option) ? options.at(option).as<std::vector<string>>() : defaults;
+                    for (auto& method: methods) {
+                        my->method_priorities.emplace_back(std::move(method), priority);
+                    }
+                };
+                add_priorities("webserver-high-priority-method", request_priority::high, {
+                    "database_api.get_dynamic_global_properties",
+                    "database_api.get_chain_properties",
+                    "database_api.get_config",
+                    "database_api.get_block",
+                    "database_api.get_block_header",
+                    "network_broadcast_api.*",
+                    "webserver.get_queue_stats"});
+                add_priorities("webserver-low-priority-method", request_priority::low, {
+                    "tags.get_discussions_by_*",
+                    "social_network.get_all_content_replies",
+                    "account_history.get_account_history",
+                    "operation_history.get_ops_in_block"});
+
+                appbase::app().get_plugin<json_rpc::plugin>().add_api_method(
+                    name(), "get_queue_stats", [this](json_rpc::msg_pack &) -> std::string {
+                        return json_rpc::to_json(my->executor.get_stats());
+                    });
 
                 if (options.count("webserver-http-endpoint")) {
                     auto http_endpoint = options.at("webserver-http-endpoint").as<string>();
@@ -314,6 +444,12 @@ namespace golos {
             void webserver_plugin::plugin_startup() {
                 my->api = appbase::app().find_plugin<plugins::json_rpc::plugin>();
                 FC_ASSERT(my->api != nullptr, "Could not find API Register Plugin");
+                // requests of batches are admitted by their methods and executed by the same thread pool as other requests
+                my->api->set_batch_executor([this](
+                    const fc::variant &request, std::function<void()> task, response_handler_type reject
+                ) {
+                    my->admit(request, std::move(task), std::move(reject));
+                });
 
                 chain::plugin *chain = appbase::app().find_plugin<chain::plugin>();
                 if (chain != nullptr && chain->get_state() != appbase::abstract_plugin::started) {
@@ -0,0 +1,96 @@
+#include <golos/chain/block_log.hpp>
+#include <golos/chain/compressed_block_log.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+namespace bpo = boost::program_options;
+
+using golos::chain::block_log;
+using golos::chain::compressed_block_log;
+using golos::chain::compressed_block_log_options;
+
+/**
+ * Converts block_log to the compressed archive of whole chunks and the uncompressed tail.
+ * The output block log can be used by the node in place of the original one.
+ */
+int main(int argc, char** argv) {
+    try {
+        compressed_block_log_options opts;
+        std::string input;
+        std::string output;
+
+        bpo::options_description desc("Usage: compress_block_log --input <block_log> --output <block_log> [options]");
+        desc.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("input,i", bpo::value<std::string>(&input)->required(), "Path to the source block_log.")
+            ("output,o", bpo::value<std::string>(&output)->required(), "Path to the new block_log.")
+            ("blocks-per-chunk", bpo::value<uint32_t>(&opts.blocks_per_chunk)->default_value(opts.blocks_per_chunk),
+                "Number of blocks in one compressed chunk.")
+            ("dictionary-size", bpo::value<uint32_t>(&opts.dictionary_size)->default_value(opts.dictionary_size),
+                "Size of the trained dictionary in bytes, 0 disables the dictionary.")
+            ("compression-level", bpo::value<int>(&opts.compression_level)->default_value(opts.compression_level),
+                "Level of zstd compression.")
+            ("verify", bpo::bool_switch()->default_value(false),
+                "Compare all blocks of the new block_log with the source one.");
+
+        bpo::variables_map options;
+        bpo::store(bpo::parse_command_line(argc, argv, desc), options);
+        if (options.count("help")) {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        bpo::notify(options);
+
+        if (!compressed_block_log::is_supported()) {
+            std::cerr << "compress_block_log is built without zstd, use -DENABLE_BLOCK_LOG_COMPRESSION=TRUE" << std::endl;
+            return 1;
+        }
+
+        FC_ASSERT(input != output, "Output block_log should differ from the input one");
+        FC_ASSERT(!fc::exists(output) && !compressed_block_log::exists(output),
+            "Output block_log ${f} already exists", ("f", output));
+
+        block_log src;
+        src.open(input);
+        FC_ASSERT(src.head(), "Input block_log ${f} is empty", ("f", input));
+
+        // only whole chunks are compressed, the rest of blocks stays in the uncompressed file
+        const uint32_t head_num = src.head()->block_num();
+        const uint32_t archive_num = head_num / opts.blocks_per_chunk * opts.blocks_per_chunk;
+
+        ilog("Compressing ${n} of ${head} blocks from ${src}", ("n", archive_num)("head", head_num)("src", input));
+        if (archive_num) {
+            compressed_block_log::write(src, archive_num, output, opts);
+        }
+
+        block_log dst;
+        dst.open(output);
+        for (auto block_num = archive_num + 1; block_num <= head_num; ++block_num) {
+            dst.append(*src.read_block_by_num(block_num));
+        }
+        dst.flush();
+
+        if (options.at("verify").as<bool>()) {
+            ilog("Verifying ${n} blocks", ("n", head_num));
+            for (uint32_t block_num = 1; block_num <= head_num; ++block_num) {
+                auto block = dst.read_block_by_num(block_num);
+                FC_ASSERT(block.valid() && block->id() == src.read_block_by_num(block_num)->id(),
+                    "Block ${n} differs from the source", ("n", block_num));
+            }
+        }
+
+        ilog("Done, head block ${n}", ("n", dst.head()->block_num()));
+    } catch (const fc::exception& e) {
+        edump((e.to_detail_string()));
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include <boost/test/unit_test.hpp>
+
+#include "database_fixture.hpp"
+
+#include <golos/plugins/follow/plugin.hpp>
+#include <golos/plugins/tags/plugin.hpp>
+#include <golos/plugins/market_history/market_history_plugin.hpp>
+#include <golos/plugins/operation_history/plugin.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+
+using namespace golos::chain;
+using namespace golos::protocol;
+
+namespace golos { namespace bench {
+
+    /// Throughput of one stage, it is written to the output as JSON
+    struct bench_result final {
+        std::string name;
+        bool plugins = false;
+        uint32_t blocks = 0;
+        uint64_t transactions = 0;
+        uint64_t operations = 0;
+        uint64_t rejected = 0;
+        double seconds = 0;
+        double blocks_per_second = 0;
+        double operations_per_second = 0;
+
+        void add_time(const fc::time_point& start) {
+            seconds += double((fc::time_point::now() - start).count()) / 1000000.0;
+        }
+
+        void finish() {
+            if (seconds > 0) {
+                blocks_per_second = blocks / seconds;
+                operations_per_second = operations / seconds;
+            }
+        }
+    };
+
+    static uint64_t get_env(const char* name, uint64_t default_value) {
+        const char* value = std::getenv(name);
+        return value ? std::stoull(value) : default_value;
+    }
+
+    /**
+     * Parameters of the benchmark, they are read from the environment,
+     * because the command line is passed to plugins of the fixture
+     */
+    struct bench_config final {
+        uint32_t accounts = get_env("GOLOS_BENCH_ACCOUNTS", 2000);
+        uint32_t blocks = get_env("GOLOS_BENCH_BLOCKS", 200);
+        uint32_t transactions_per_block = get_env("GOLOS_BENCH_TRANSACTIONS", 100);
+        uint32_t skip_flags = get_env("GOLOS_BENCH_SKIP_FLAGS", database::skip_nothing);
+        uint64_t shared_memory_size = get_env("GOLOS_BENCH_SHARED_MEMORY_MB", 1024) << 20;
+        std::string output = std::getenv("GOLOS_BENCH_OUTPUT") ? std::getenv("GOLOS_BENCH_OUTPUT") : "";
+    };
+
+    /**
+     * Generator of synthetic transactions: votes, comments, transfers, follows and limit orders.
+     * The random sequence is seeded with a constant, so results of different builds are comparable.
+     * Each account acts once per accounts/transactions_per_block blocks to pass the bandwidth limits.
+     */
+    class workload_generator final {
+    public:
+        workload_generator(database& db, const bench_config& config)
+                : _db(db), _config(config), _random(42) {
+        }
+
+        /// Creates and funds accounts, generates blocks until all of them are included
+        void create_accounts(const fc::ecc::private_key& init_key) {
+            const uint32_t accounts_per_transaction = 10;
+
+            for (uint32_t i = 0; i < _config.accounts; ++i) {
+                bench_account account;
+                account.name = "bench" + std::to_string(i);
+                account.key = database_fixture::generate_private_key(account.name);
+                _accounts.push_back(std::move(account));
+            }
+
+            signed_transaction tx;
+            auto push = [&]() {
+                tx.set_reference_block(_db.head_block_id());
+                tx.set_expiration(_db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                tx.sign(init_key, _db.get_chain_id());
+                _db.push_transaction(tx, 0);
+                tx = signed_transaction();
+            };
+
+            for (const auto& account: _accounts) {
+                const auto public_key = account.key.get_public_key();
+
+                account_create_operation create;
+                create.fee = asset(30000, STEEM_SYMBOL);
+                create.creator = STEEMIT_INIT_MINER_NAME;
+                create.new_account_name = account.name;
+                create.owner = authority(1, public_key, 1);
+                create.active = create.owner;
+                create.posting = create.owner;
+                create.memo_key = public_key;
+                tx.operations.push_back(create);
+
+                transfer_operation transfer;
+                transfer.from = STEEMIT_INIT_MINER_NAME;
+                transfer.to = account.name;
+                transfer.amount = asset(1000000, STEEM_SYMBOL);
+                tx.operations.push_back(transfer);
+
+                transfer_to_vesting_operation vest;
+                vest.from = STEEMIT_INIT_MINER_NAME;
+                vest.to = account.name;
+                vest.amount = asset(1000000, STEEM_SYMBOL);
+                tx.operations.push_back(vest);
+
+                if (tx.operations.size() == accounts_per_transaction * 3) {
+                    push();
+                }
+            }
+            if (!tx.operations.empty()) {
+                push();
+            }
+
+            for (uint32_t i = 0; i < 1000 && !_db.find_account(_accounts.back().name); ++i) {
+                generate_block(init_key);
+            }
+            BOOST_REQUIRE(_db.find_account(_accounts.back().name));
+        }
+
+        void generate_block(const fc::ecc::private_key& init_key) {
+            _db.generate_block(_db.get_slot_time(1), _db.get_scheduled_witness(1), init_key, database::skip_nothing);
+        }
+
+        /// @return transactions for the next block
+        std::vector<signed_transaction> next_transactions() {
+            std::vector<signed_transaction> result;
+            result.reserve(_config.transactions_per_block);
+
+            for (uint32_t i = 0; i < _config.transactions_per_block; ++i) {
+                auto& account = _accounts[_next_account];
+                _next_account = (_next_account + 1) % _accounts.size();
+                result.push_back(make_transaction(account, next_operation(account)));
+            }
+            return result;
+        }
+
+    private:
+        struct bench_account final {
+            std::string name;
+            fc::ecc::private_key key;
+            uint32_t last_post_block = 0;
+            uint32_t next_order = 0;
+            std::vector<uint32_t> orders;
+        };
+
+        enum operation_kind {
+            vote_kind,
+            comment_kind,
+            transfer_kind,
+            follow_kind,
+            market_kind
+        };
+
+        signed_transaction make_transaction(const bench_account& account, operation op) {
+            signed_transaction tx;
+            tx.operations.push_back(std::move(op));
+            tx.set_reference_block(_db.head_block_id());
+            tx.set_expiration(_db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            tx.sign(account.key, _db.get_chain_id());
+            return tx;
+        }
+
+        operation next_operation(bench_account& account) {
+            std::discrete_distribution<int> kinds({40, 20, 20, 10, 10});
+            switch (kinds(_random)) {
+                case vote_kind:
+                    if (!_posts.empty()) {
+                        return make_vote(account);
+                    }
+                    break;
+                case comment_kind:
+                    return make_comment(account);
+                case follow_kind:
+                    return make_follow(account);
+                case market_kind:
+                    return make_limit_order(account);
+                default:
+                    break;
+            }
+            return make_transfer(account);
+        }
+
+        const bench_account& random_account(const bench_account& except) {
+            std::uniform_int_distribution<std::size_t> index(0, _accounts.size() - 1);
+            const auto* result = &_accounts[index(_random)];
+            while (result == &except) {
+                result = &_accounts[index(_random)];
+            }
+            return *result;
+        }
+
+        std::string random_text(std::size_t min_size, std::size_t max_size) {
+            static const std::vector<std::string> words = {
+                "golos", "block", "vote", "post", "reward", "witness", "chain", "market", "order", "author",
+                "curator", "power", "steem", "follow", "comment", "tag", "feed", "blog", "transfer", "vesting"};
+            std::uniform_int_distribution<std::size_t> size(min_size, max_size);
+            std::uniform_int_distribution<std::size_t> word(0, words.size() - 1);
+            auto target = size(_random);
+            std::string result;
+            while (result.size() < target) {
+                result += words[word(_random)];
+                result += ' ';
+            }
+            return result;
+        }
+
+        operation make_vote(bench_account& account) {
+            const std::size_t recent_posts = 500;
+            std::uniform_int_distribution<std::size_t> index(
+                _posts.size() > recent_posts ? _posts.size() - recent_posts : 0, _posts.size() - 1);
+            auto post = index(_random);
+            if (!_votes.emplace(account.name, post).second) {
+                return make_transfer(account);
+            }
+
+            vote_operation op;
+            op.voter = account.name;
+            op.author = _posts[post].first;
+            op.permlink = _posts[post].second;
+            op.weight = std::uniform_int_distribution<int16_t>(1, 100)(_random) * STEEMIT_1_PERCENT;
+            return op;
+        }
+
+        operation make_comment(bench_account& account) {
+            const uint32_t block_num = _db.head_block_num() + 1;
+            const uint32_t post_interval = STEEMIT_MIN_ROOT_COMMENT_INTERVAL.to_seconds() / STEEMIT_BLOCK_INTERVAL;
+
+            comment_operation op;
+            op.author = account.name;
+            op.permlink = "bench-" + std::to_string(++_comments);
+            op.body = random_text(200, 2000);
+            if (_posts.empty() || !account.last_post_block || block_num - account.last_post_block > post_interval) {
+                op.parent_permlink = "bench";
+                op.title = random_text(10, 60);
+                op.json_metadata = "{\"tags\":[\"bench\"]}";
+                account.last_post_block = block_num;
+                _posts.emplace_back(op.author, op.permlink);
+            } else {
+                std::uniform_int_distribution<std::size_t> index(0, _posts.size() - 1);
+                const auto& parent = _posts[index(_random)];
+                op.parent_author = parent.first;
+                op.parent_permlink = parent.second;
+            }
+            return op;
+        }
+
+        operation make_transfer(bench_account& account) {
+            transfer_operation op;
+            op.from = account.name;
+            op.to = random_account(account).name;
+            op.amount = asset(std::uniform_int_distribution<int64_t>(1, 1000)(_random), STEEM_SYMBOL);
+            op.memo = "bench " + std::to_string(++_transfers);
+            return op;
+        }
+
+        operation make_follow(bench_account& account) {
+            custom_json_operation op;
+            op.id = "follow";
+            op.required_posting_auths.insert(account.name);
+            op.json = "[\"follow\",{\"follower\":\"" + account.name + "\",\"following\":\"" +
+                random_account(account).name + "\",\"what\":[\"blog\"]}]";
+            return op;
+        }
+
+        operation make_limit_order(bench_account& account) {
+            if (!account.orders.empty() && std::uniform_int_distribution<int>(0, 2)(_random) == 0) {
+                limit_order_cancel_operation op;
+                op.owner = account.name;
+                op.orderid = account.orders.back();
+                account.orders.pop_back();
+                return op;
+            }
+
+            limit_order_create_operation op;
+            op.owner = account.name;
+            op.orderid = account.next_order++;
+            op.amount_to_sell = asset(1000, STEEM_SYMBOL);
+            op.min_to_receive = asset(std::uniform_int_distribution<int64_t>(100, 2000)(_random), SBD_SYMBOL);
+            op.expiration = _db.head_block_time() + fc::hours(1);
+            account.orders.push_back(op.orderid);
+            return op;
+        }
+
+        database& _db;
+        const bench_config& _config;
+        std::mt19937 _random;
+
+        std::vector<bench_account> _accounts;
+        std::size_t _next_account = 0;
+        std::vector<std::pair<std::string, std::string>> _posts;
+        std::set<std::pair<std::string, std::size_t>> _votes;
+        uint64_t _comments = 0;
+        uint64_t _transfers = 0;
+    };
+
+    struct bench_fixture : public database_fixture {
+        void open_database(database& target, const fc::path& dir) {
+            target._log_hardforks = false;
+            target._is_testing = true;
+            target.open(dir, dir, INITIAL_TEST_SUPPLY, config.shared_memory_size, chainbase::database::read_write);
+        }
+
+        /// Pushes blocks up to the workload, hardforks are set after the first block as on the producer
+        void push_setup_blocks(database& target) {
+            for (uint32_t i = 0; i < first_workload_block; ++i) {
+                target.push_block(blocks[i], config.skip_flags);
+                if (i == 0) {
+                    target.set_hardfork(STEEMIT_NUM_HARDFORKS);
+                }
+            }
+        }
+
+        bench_result start_result(const std::string& name, bool plugins) {
+            bench_result result;
+            result.name = name;
+            result.plugins = plugins;
+            return result;
+        }
+
+        void write_results() {
+            for (auto& result: results) {
+                result.finish();
+            }
+
+            auto json = fc::json::to_pretty_string(results);
+            if (config.output.empty()) {
+                std::cout << json << std::endl;
+            } else {
+                std::ofstream out(config.output);
+                out << json << std::endl;
+            }
+        }
+
+        bench_config config;
+        std::vector<signed_block> blocks;
+        uint32_t first_workload_block = 0;
+        std::vector<bench_result> results;
+    };
+
+} } // golos::bench
+
+FC_REFLECT((golos::bench::bench_result),
+    (name)(plugins)(blocks)(transactions)(operations)(rejected)(seconds)(blocks_per_second)(operations_per_second))
+
+using namespace golos::bench;
+
+BOOST_FIXTURE_TEST_SUITE(block_application, bench_fixture)
+
+BOOST_AUTO_TEST_CASE(synthetic_workload) { try {
+    BOOST_TEST_MESSAGE("Benchmark: synthetic_workload");
+
+    BOOST_TEST_MESSAGE("--- Generate blocks without plugins");
+    fc::temp_directory producer_dir(golos::utilities::temp_directory_path());
+    database producer;
+    open_database(producer, producer_dir.path());
+
+    workload_generator generator(producer, config);
+    generator.generate_block(init_account_priv_key);
+    producer.set_hardfork(STEEMIT_NUM_HARDFORKS);
+    generator.generate_block(init_account_priv_key);
+    generator.create_accounts(init_account_priv_key);
+    first_workload_block = producer.head_block_num();
+
+    auto push_tx = start_result("push_transaction", false);
+    auto generate = start_result("generate_block", false);
+    for (uint32_t i = 0; i < config.blocks; ++i) {
+        for (const auto& tx: generator.next_transactions()) {
+            auto start = fc::time_point::now();
+            try {
+                producer.push_transaction(tx, 0);
+                ++push_tx.transactions;
+                push_tx.operations += tx.operations.size();
+            } catch (const fc::exception&) {
+                ++push_tx.rejected;
+            }
+            push_tx.add_time(start);
+        }
+
+        auto start = fc::time_point::now();
+        generator.generate_block(init_account_priv_key);
+        generate.add_time(start);
+    }
+
+    for (uint32_t num = 1; num <= producer.head_block_num(); ++num) {
+        blocks.push_back(*producer.fetch_block_by_number(num));
+        if (num > first_workload_block) {
+            ++generate.blocks;
+            generate.transactions += blocks.back().transactions.size();
+            for (const auto& tx: blocks.back().transactions) {
+                generate.operations += tx.operations.size();
+            }
+        }
+    }
+    results.push_back(push_tx);
+    results.push_back(generate);
+
+    BOOST_TEST_MESSAGE("--- Push blocks without plugins");
+    fc::temp_directory replica_dir(golos::utilities::temp_directory_path());
+    database replica;
+    open_database(replica, replica_dir.path());
+    push_setup_blocks(replica);
+
+    auto push_block = start_result("push_block", false);
+    for (uint32_t i = first_workload_block; i < blocks.size(); ++i) {
+        auto start = fc::time_point::now();
+        replica.push_block(blocks[i], config.skip_flags);
+        push_block.add_time(start);
+    }
+    push_block.blocks = generate.blocks;
+    push_block.transactions = generate.transactions;
+    push_block.operations = generate.operations;
+    results.push_back(push_block);
+    BOOST_CHECK(replica.head_block_id() == producer.head_block_id());
+
+    BOOST_TEST_MESSAGE("--- Push transactions and blocks with plugins");
+    initialize<
+        golos::plugins::follow::plugin,
+        golos::plugins::tags::tags_plugin,
+        golos::plugins::market_history::market_history_plugin,
+        golos::plugins::operation_history::plugin>();
+    data_dir = fc::temp_directory(golos::utilities::temp_directory_path());
+    open_database(*db, data_dir->path());
+    appbase::app().startup();
+    push_setup_blocks(*db);
+
+    auto plugins_push_tx = start_result("push_transaction", true);
+    auto plugins_push_block = start_result("push_block", true);
+    for (uint32_t i = first_workload_block; i < blocks.size(); ++i) {
+        for (const auto& tx: blocks[i].transactions) {
+            auto start = fc::time_point::now();
+            try {
+                db->push_transaction(tx, config.skip_flags);
+                ++plugins_push_tx.transactions;
+                plugins_push_tx.operations += tx.operations.size();
+            } catch (const fc::exception&) {
+                ++plugins_push_tx.rejected;
+            }
+            plugins_push_tx.add_time(start);
+        }
+        // pending transactions are dropped, so push_block applies the block as the run without plugins does
+        db->clear_pending();
+
+        auto start = fc::time_point::now();
+        db->push_block(blocks[i], config.skip_flags);
+        plugins_push_block.add_time(start);
+    }
+    plugins_push_block.blocks = generate.blocks;
+    plugins_push_block.transactions = generate.transactions;
+    plugins_push_block.operations = generate.operations;
+    results.push_back(plugins_push_tx);
+    results.push_back(plugins_push_block);
+    BOOST_CHECK(db->head_block_id() == producer.head_block_id());
+
+    write_results();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,11 @@
 
 #include "database_fixture.hpp"
 
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <future>
+
 using namespace golos::chain;
 using namespace golos::protocol;
 
@@ -19,7 +24,25 @@ namespace test_plugin {
 
     using golos::plugins::json_rpc::msg_pack;
 
+    struct writer_test_object {
+        uint64_t big_unsigned = 0;
+        int64_t big_signed = 0;
+        int32_t small = 0;
+        bool flag = false;
+        std::string text;
+        fc::optional<std::string> missing;
+        fc::optional<uint32_t> present;
+        std::vector<asset> amounts;
+        std::map<std::string, uint32_t> counters;
+        fc::flat_set<account_name_type> accounts;
+        fc::time_point_sec time;
+        public_key_type key;
+        double ratio = 0;
+        std::vector<operation> operations;
+    };
+
     DEFINE_API_ARGS(throw_exception, msg_pack, std::string)
+    DEFINE_API_ARGS(get_object,      msg_pack, writer_test_object)
 
     class testing_api final : public appbase::plugin<testing_api> {
     public:
@@ -47,9 +70,15 @@ namespace test_plugin {
 
         void plugin_shutdown() override { }
 
-        DECLARE_API((throw_exception))
+        DECLARE_API((throw_exception)(get_object))
+
+        writer_test_object object;
     };
 
+    DEFINE_API(testing_api, get_object) {
+        return object;
+    }
+
     DEFINE_API(testing_api, throw_exception) {
         auto error = args.args->at(0).get_string();
 
@@ -84,6 +113,10 @@ namespace test_plugin {
     }
 } // namespace test_plugin
 
+FC_REFLECT((test_plugin::writer_test_object),
+    (big_unsigned)(big_signed)(small)(flag)(text)(missing)(present)(amounts)(counters)(accounts)(time)(key)(ratio)
+    (operations))
+
 fc::variant call(json_rpc_plugin& plugin, const std::string& request) {
     fc::variant response;
     plugin.call(request, [&](const std::string& str) {response = fc::json::from_string(str);});
@@ -293,5 +326,241 @@ BOOST_FIXTURE_TEST_SUITE(json_rpc, database_fixture)
         FC_LOG_AND_RETHROW()
     }
 
+    BOOST_AUTO_TEST_CASE(json_writer_test) {
+        try {
+            using golos::plugins::json_rpc::to_json;
+
+            initialize();
+
+            auto &rpc_plugin  = appbase::app().register_plugin<json_rpc_plugin>();
+            auto &testing_api = appbase::app().register_plugin<test_plugin::testing_api>();
+
+            {
+                boost::program_options::options_description desc;
+                rpc_plugin.set_program_options(desc, desc);
+
+                boost::program_options::variables_map options;
+                boost::program_options::store(parse_command_line(0, (char**)NULL, desc), options);
+                rpc_plugin.plugin_initialize(options);
+            }
+            {
+                boost::program_options::variables_map options;
+                testing_api.plugin_initialize(options);
+            }
+
+            open_database();
+
+            startup();
+            rpc_plugin.plugin_startup();
+            testing_api.plugin_startup();
+
+            auto& object = testing_api.object;
+            object.big_unsigned = uint64_t(1) << 40;
+            object.big_signed = -(int64_t(1) << 40);
+            object.small = -5;
+            object.flag = true;
+            object.text = "Голос \"quoted\" back\\slash";
+            object.present = 7;
+            object.amounts = {ASSET("1.000 GOLOS"), ASSET("2.500 GBG")};
+            object.counters = {{"a", 1}, {"line\nbreak", 2}};
+            object.accounts = {"alice", "bob"};
+            object.time = db->head_block_time();
+            object.key = init_account_pub_key;
+            object.ratio = 0.25;
+            transfer_operation op;
+            op.from = "alice";
+            op.to = "bob";
+            op.amount = ASSET("1.000 GOLOS");
+            object.operations = {op};
+
+            BOOST_TEST_MESSAGE("--- json_writer writes the same JSON as fc::variant");
+            BOOST_CHECK_EQUAL(to_json(object), fc::json::to_string(fc::variant(object)));
+
+            auto block = db->fetch_block_by_number(db->head_block_num());
+            BOOST_REQUIRE(block.valid());
+            BOOST_CHECK_EQUAL(to_json(*block), fc::json::to_string(fc::variant(*block)));
+            BOOST_CHECK_EQUAL(to_json(db->get_dynamic_global_properties()),
+                fc::json::to_string(fc::variant(db->get_dynamic_global_properties())));
+
+            BOOST_TEST_MESSAGE("--- result of API method is written by json_writer");
+            auto response = call(rpc_plugin, "{\"id\":1, \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                "\"testing_api\",\"get_object\",[]]}");
+            BOOST_CHECK_EQUAL(fc::json::to_string(response["result"]), fc::json::to_string(fc::variant(object)));
+            BOOST_CHECK_EQUAL(response["id"].as_int64(), 1);
+
+            BOOST_TEST_MESSAGE("--- batch of requests");
+            response = call(rpc_plugin, "[{\"id\":1, \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                "\"testing_api\",\"get_object\",[]]},{\"id\":2, \"jsonrpc\":\"2.0\",\"method\":\"call\","
+                "\"params\":[\"testing_api\",\"throw_exception\",[\"business_exception\"]]}]");
+            BOOST_REQUIRE(response.is_array());
+            BOOST_REQUIRE_EQUAL(response.size(), 2);
+            BOOST_CHECK_EQUAL(fc::json::to_string(response[size_t(0)]["result"]), fc::json::to_string(fc::variant(object)));
+            check_error_response(response[size_t(1)], fc::variant(2u), SERVER_BUSINESS_LOGIC_ERROR, "business_exception");
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(parallel_batch_test) {
+        try {
+            initialize();
+
+            auto &rpc_plugin  = appbase::app().register_plugin<json_rpc_plugin>();
+            auto &testing_api = appbase::app().register_plugin<test_plugin::testing_api>();
+
+            {
+                boost::program_options::options_description desc;
+                rpc_plugin.set_program_options(desc, desc);
+
+                const char* argv[] = {"test", "--rpc-batch-concurrency=4"};
+                boost::program_options::variables_map options;
+                boost::program_options::store(parse_command_line(2, (char**)argv, desc), options);
+                rpc_plugin.plugin_initialize(options);
+            }
+            {
+                boost::program_options::variables_map options;
+                testing_api.plugin_initialize(options);
+            }
+
+            open_database();
+
+            startup();
+            rpc_plugin.plugin_startup();
+            testing_api.plugin_startup();
+
+            boost::asio::io_service ios;
+            auto work = std::make_unique<boost::asio::io_service::work>(ios);
+            boost::thread_group threads;
+            for (int i = 0; i < 4; ++i) {
+                threads.create_thread([&]{ ios.run(); });
+            }
+            rpc_plugin.set_batch_executor([&](const fc::variant&, std::function<void()> task, std::function<void(const std::string&)>) {
+                ios.post(std::move(task));
+            });
+
+            BOOST_TEST_MESSAGE("--- responses of parallel batch keep order of requests");
+            const std::size_t batch_size = 50;
+            std::string request = "[";
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                if (i) {
+                    request += ",";
+                }
+                auto id = std::to_string(i);
+                if (i % 2) {
+                    request += "{\"id\":" + id + ", \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                        "\"testing_api\",\"get_object\",[]]}";
+                } else {
+                    request += "{\"id\":" + id + ", \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                        "\"testing_api\",\"throw_exception\",[\"business_exception\"]]}";
+                }
+            }
+            request += "]";
+
+            std::promise<std::string> promise;
+            auto future = promise.get_future();
+            rpc_plugin.call(request, [&](const std::string& str) { promise.set_value(str); });
+            BOOST_REQUIRE(future.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+
+            auto response = fc::json::from_string(future.get());
+            BOOST_REQUIRE(response.is_array());
+            BOOST_REQUIRE_EQUAL(response.size(), batch_size);
+            for (std::size_t i = 0; i < batch_size; ++i) {
+                const auto& r = response[i];
+                BOOST_CHECK_EQUAL(r["id"].as_uint64(), i);
+                if (i % 2) {
+                    BOOST_CHECK(r.get_object().contains("result"));
+                } else {
+                    check_error_response(r, fc::variant(uint64_t(i)), SERVER_BUSINESS_LOGIC_ERROR, "business_exception");
+                }
+            }
+
+            BOOST_TEST_MESSAGE("--- batch stats");
+            auto stats = rpc_plugin.get_batch_stats();
+            BOOST_CHECK_EQUAL(stats.batches, 1);
+            BOOST_CHECK_EQUAL(stats.requests, batch_size);
+            BOOST_CHECK_EQUAL(stats.max_size, batch_size);
+            BOOST_CHECK_EQUAL(stats.concurrency, 4);
+            BOOST_CHECK_LE(stats.latency_p50, stats.latency_p99);
+            BOOST_CHECK_LE(stats.latency_p99, stats.latency_max);
+
+            response = call(rpc_plugin, "{\"id\":1, \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                "\"json_rpc\",\"get_batch_stats\",[]]}");
+            BOOST_CHECK_EQUAL(response["result"]["requests"].as_uint64(), batch_size);
+
+            work.reset();
+            threads.join_all();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(response_cache_test) {
+        try {
+            initialize();
+
+            auto &rpc_plugin  = appbase::app().register_plugin<json_rpc_plugin>();
+            auto &testing_api = appbase::app().register_plugin<test_plugin::testing_api>();
+
+            {
+                boost::program_options::options_description desc;
+                rpc_plugin.set_program_options(desc, desc);
+
+                const char* argv[] = {"test", "--rpc-response-cache=true", "--rpc-cache-method=testing_api.get_object"};
+                boost::program_options::variables_map options;
+                boost::program_options::store(parse_command_line(3, (char**)argv, desc), options);
+                rpc_plugin.plugin_initialize(options);
+            }
+            {
+                boost::program_options::variables_map options;
+                testing_api.plugin_initialize(options);
+            }
+
+            open_database();
+
+            startup();
+            rpc_plugin.plugin_startup();
+            testing_api.plugin_startup();
+
+            db->applied_block.connect([&](const signed_block& b) {
+                rpc_plugin.clear_cache(b.block_num());
+            });
+
+            const std::string request = "{\"id\":1, \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                "\"testing_api\",\"get_object\",[]]}";
+
+            BOOST_TEST_MESSAGE("--- repeated call within a block returns the cached response");
+            testing_api.object.small = 1;
+            auto response = call(rpc_plugin, request);
+            BOOST_CHECK_EQUAL(response["result"]["small"].as_int64(), 1);
+
+            testing_api.object.small = 2;
+            response = call(rpc_plugin, request);
+            BOOST_CHECK_EQUAL(response["result"]["small"].as_int64(), 1);
+            BOOST_CHECK_EQUAL(response["id"].as_int64(), 1);
+
+            BOOST_TEST_MESSAGE("--- errors aren't cached");
+            for (int i = 0; i < 2; ++i) {
+                response = call(rpc_plugin, "{\"id\":2, \"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+                    "\"testing_api\",\"throw_exception\",[\"business_exception\"]]}");
+                check_error_response(response, fc::variant(2u), SERVER_BUSINESS_LOGIC_ERROR, "business_exception");
+            }
+
+            auto stats = rpc_plugin.get_cache_stats();
+            BOOST_CHECK_EQUAL(stats.entries, 1);
+            BOOST_REQUIRE_EQUAL(stats.methods.size(), 1);
+            BOOST_CHECK_EQUAL(stats.methods["testing_api.get_object"].hits, 1);
+            BOOST_CHECK_EQUAL(stats.methods["testing_api.get_object"].misses, 1);
+            BOOST_CHECK_EQUAL(stats.methods["testing_api.get_object"].hit_ratio, 0.5);
+
+            BOOST_TEST_MESSAGE("--- applied block clears the cache");
+            generate_block();
+            response = call(rpc_plugin, request);
+            BOOST_CHECK_EQUAL(response["result"]["small"].as_int64(), 2);
+
+            stats = rpc_plugin.get_cache_stats();
+            BOOST_CHECK_EQUAL(stats.block_num, db->head_block_num());
+            BOOST_CHECK_EQUAL(stats.methods["testing_api.get_object"].misses, 2);
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
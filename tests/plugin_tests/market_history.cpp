@@ -3,324 +3,578 @@
 #include <boost/test/unit_test.hpp>
 
 #include <golos/chain/account_object.hpp>
-#include <golos/chain/comment_object.hpp>
 #include <golos/protocol/steem_operations.hpp>
 
 #include <golos/plugins/market_history/market_history_plugin.hpp>
+#include <golos/plugins/market_history/bucket_store.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
 
 #include "database_fixture.hpp"
 
 using namespace golos::chain;
 using namespace golos::protocol;
+using namespace golos::plugins::market_history;
+using golos::plugins::json_rpc::msg_pack;
+
+using bucket_sizes = boost::container::flat_set<uint32_t>;
+using trade_amounts = std::pair<asset, asset>;
+
+#define AMOUNTS(asset1, asset2) trade_amounts(ASSET(asset1), ASSET(asset2))
+
+static void check_bucket(const bucket_object& b, uint32_t seconds, fc::time_point_sec open,
+    const trade_amounts& high, const trade_amounts& low, const trade_amounts& first, const trade_amounts& last,
+    const trade_amounts& volume
+) {
+    BOOST_CHECK_EQUAL(b.seconds, seconds);
+    BOOST_CHECK_EQUAL(b.open.sec_since_epoch(), open.sec_since_epoch());
+    BOOST_CHECK_EQUAL(b.high_asset1.value, high.first.amount.value);
+    BOOST_CHECK_EQUAL(b.high_asset2.value, high.second.amount.value);
+    BOOST_CHECK_EQUAL(b.low_asset1.value, low.first.amount.value);
+    BOOST_CHECK_EQUAL(b.low_asset2.value, low.second.amount.value);
+    BOOST_CHECK_EQUAL(b.open_asset1.value, first.first.amount.value);
+    BOOST_CHECK_EQUAL(b.open_asset2.value, first.second.amount.value);
+    BOOST_CHECK_EQUAL(b.close_asset1.value, last.first.amount.value);
+    BOOST_CHECK_EQUAL(b.close_asset2.value, last.second.amount.value);
+    BOOST_CHECK_EQUAL(b.asset1_volume.value, volume.first.amount.value);
+    BOOST_CHECK_EQUAL(b.asset2_volume.value, volume.second.amount.value);
+}
+
+static fc::time_point_sec bucket_open(fc::time_point_sec time, uint32_t seconds) {
+    return fc::time_point_sec((time.sec_since_epoch() / seconds) * seconds);
+}
+
+BOOST_AUTO_TEST_SUITE(market_history_bucket_store)
+
+BOOST_AUTO_TEST_CASE(bucket_series_ring) {
+    BOOST_TEST_MESSAGE("Testing: bucket_series_ring");
+
+    const auto start = fc::time_point_sec(1476788400);
+    bucket_series series;
+    series.sym1 = STEEM_SYMBOL;
+    series.sym2 = SBD_SYMBOL;
+    series.seconds = 60;
+    series.max_buckets = 3;
+
+    BOOST_TEST_MESSAGE("--- Columns grow with buckets up to the capacity");
+    BOOST_CHECK_EQUAL(series.size(), 0);
+    series.add_trade(start, 1000, 500);
+    series.add_trade(start + 10, 2000, 1200);
+    BOOST_CHECK_EQUAL(series.size(), 1);
+    check_bucket(series.get(0), 60, start, AMOUNTS("2.000 GOLOS", "1.200 GBG"), AMOUNTS("1.000 GOLOS", "0.500 GBG"),
+        AMOUNTS("1.000 GOLOS", "0.500 GBG"), AMOUNTS("2.000 GOLOS", "1.200 GBG"), AMOUNTS("3.000 GOLOS", "1.700 GBG"));
+
+    series.add_trade(start + 60, 1000, 500);
+    series.add_trade(start + 180, 1000, 500);
+    BOOST_CHECK_EQUAL(series.size(), 3);
+    BOOST_CHECK_EQUAL(series.first(), 0);
+
+    BOOST_TEST_MESSAGE("--- The oldest bucket is overwritten when the buffer is full");
+    series.add_trade(start + 240, 4000, 1000);
+    BOOST_CHECK_EQUAL(series.size(), 3);
+    BOOST_CHECK_EQUAL(series.pushed, 4);
+    BOOST_CHECK_EQUAL(series.first(), 1);
+    BOOST_CHECK_EQUAL(series.get(1).open.sec_since_epoch(), (start + 60).sec_since_epoch());
+    check_bucket(series.get(3), 60, start + 240, AMOUNTS("4.000 GOLOS", "1.000 GBG"), AMOUNTS("4.000 GOLOS", "1.000 GBG"),
+        AMOUNTS("4.000 GOLOS", "1.000 GBG"), AMOUNTS("4.000 GOLOS", "1.000 GBG"), AMOUNTS("4.000 GOLOS", "1.000 GBG"));
+
+    BOOST_TEST_MESSAGE("--- Buckets are found by their open time");
+    BOOST_CHECK_EQUAL(series.lower_bound(start), 1);
+    BOOST_CHECK_EQUAL(series.lower_bound(start + 60), 1);
+    BOOST_CHECK_EQUAL(series.lower_bound(start + 61), 2);
+    BOOST_CHECK_EQUAL(series.lower_bound(start + 180), 2);
+    BOOST_CHECK_EQUAL(series.lower_bound(start + 240), 3);
+    BOOST_CHECK_EQUAL(series.lower_bound(start + 241), 4);
+
+    BOOST_TEST_MESSAGE("--- Trade of an overwritten bucket is ignored");
+    series.add_trade(start + 10, 1000, 500);
+    BOOST_CHECK_EQUAL(series.pushed, 4);
+    BOOST_CHECK_EQUAL(series.get(1).asset1_volume.value, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(bucket_store_buckets) {
+    BOOST_TEST_MESSAGE("Testing: bucket_store_buckets");
+
+    const auto start = fc::time_point_sec(1476788400);
+    bucket_store store(bucket_sizes{60, 300}, 2);
+
+    store.add_trade(STEEM_SYMBOL, SBD_SYMBOL, start, 1000, 500);
+    store.add_trade(STEEM_SYMBOL, SBD_SYMBOL, start + 60, 2000, 500);
+    store.add_trade(STEEM_SYMBOL, SBD_SYMBOL, start + 120, 3000, 500);
+    store.set_next_trade_id(3);
+
+    BOOST_TEST_MESSAGE("--- Buckets of each size are kept in their own ring");
+    auto minutes = store.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 60, fc::time_point_sec(), fc::time_point_sec::maximum());
+    BOOST_REQUIRE_EQUAL(minutes.size(), 2);
+    BOOST_CHECK_EQUAL(minutes[0].id._id, 1);
+    BOOST_CHECK_EQUAL(minutes[0].open.sec_since_epoch(), (start + 60).sec_since_epoch());
+    BOOST_CHECK_EQUAL(minutes[1].open.sec_since_epoch(), (start + 120).sec_since_epoch());
+
+    auto five_minutes = store.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 300, fc::time_point_sec(), fc::time_point_sec::maximum());
+    BOOST_REQUIRE_EQUAL(five_minutes.size(), 1);
+    check_bucket(five_minutes[0], 300, bucket_open(start, 300), AMOUNTS("1.000 GOLOS", "0.500 GBG"),
+        AMOUNTS("3.000 GOLOS", "0.500 GBG"), AMOUNTS("1.000 GOLOS", "0.500 GBG"), AMOUNTS("3.000 GOLOS", "0.500 GBG"),
+        AMOUNTS("6.000 GOLOS", "1.500 GBG"));
+
+    BOOST_TEST_MESSAGE("--- Range is [start, end)");
+    auto range = store.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 60, start + 60, start + 120);
+    BOOST_REQUIRE_EQUAL(range.size(), 1);
+    BOOST_CHECK_EQUAL(range[0].open.sec_since_epoch(), (start + 60).sec_since_epoch());
+    BOOST_CHECK(store.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 60, start + 121, start + 600).empty());
+    BOOST_CHECK(store.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 15, fc::time_point_sec(), fc::time_point_sec::maximum()).empty());
+    BOOST_CHECK(store.get_buckets(SBD_SYMBOL, STEEM_SYMBOL, 60, fc::time_point_sec(), fc::time_point_sec::maximum()).empty());
+
+    BOOST_TEST_MESSAGE("--- Buckets are saved and loaded");
+    fc::temp_directory dir(golos::utilities::temp_directory_path());
+    const auto path = dir.path() / "buckets.bin";
+    bucket_store loaded(bucket_sizes{60, 300}, 2);
+    BOOST_CHECK(!loaded.load(path));
+    store.save(path);
+    BOOST_REQUIRE(loaded.load(path));
+    BOOST_CHECK_EQUAL(loaded.next_trade_id(), 3);
+    auto loaded_minutes = loaded.get_buckets(STEEM_SYMBOL, SBD_SYMBOL, 60, fc::time_point_sec(), fc::time_point_sec::maximum());
+    BOOST_REQUIRE_EQUAL(loaded_minutes.size(), minutes.size());
+    for (size_t i = 0; i < minutes.size(); ++i) {
+        BOOST_CHECK_EQUAL(loaded_minutes[i].id._id, minutes[i].id._id);
+        BOOST_CHECK_EQUAL(loaded_minutes[i].open.sec_since_epoch(), minutes[i].open.sec_since_epoch());
+        BOOST_CHECK_EQUAL(loaded_minutes[i].asset1_volume.value, minutes[i].asset1_volume.value);
+    }
 
-BOOST_FIXTURE_TEST_SUITE(market_history, database_fixture)
-
-    BOOST_AUTO_TEST_CASE(mh_test) {
-        using namespace golos::plugins::market_history;
-        using by_id = golos::plugins::market_history::by_id;
+    BOOST_TEST_MESSAGE("--- File of other sizes or capacity isn't loaded");
+    bucket_store other_sizes(bucket_sizes{60}, 2);
+    BOOST_CHECK(!other_sizes.load(path));
+    bucket_store other_capacity(bucket_sizes{60, 300}, 3);
+    BOOST_CHECK(!other_capacity.load(path));
+}
 
-        try {
-            initialize();
+BOOST_AUTO_TEST_SUITE_END()
 
-            auto &mh_plugin = appbase::app().register_plugin<market_history_plugin>();
-            boost::program_options::variables_map options;
-            mh_plugin.plugin_initialize(options);
+// the directory outlives the plugin, which saves buckets when the fixture shuts the application down
+struct buckets_dir_holder {
+    fc::temp_directory buckets_dir{golos::utilities::temp_directory_path()};
+};
+
+struct market_history_fixture : public buckets_dir_holder, public database_fixture {
+    market_history_plugin* mh_plugin = nullptr;
+
+    void initialize_market_history() {
+        initialize<market_history_plugin>({
+            {"market-history-buckets-file", (buckets_dir.path() / "buckets.bin").string()}
+        });
+        mh_plugin = find_plugin<market_history_plugin>();
+        BOOST_REQUIRE(mh_plugin);
+        open_database();
+        startup();
+    }
 
-            open_database();
+    std::vector<bucket_object> get_market_history(uint32_t seconds) {
+        msg_pack mp;
+        mp.args = std::vector<fc::variant>({
+            fc::variant(seconds), fc::variant(fc::time_point_sec()), fc::variant(fc::time_point_sec::maximum())});
+        return mh_plugin->get_market_history(mp);
+    }
 
-            startup();
-            mh_plugin.plugin_startup();
+    void create_order(const std::string& owner, const fc::ecc::private_key& key,
+        const asset& amount_to_sell, const asset& min_to_receive, uint32_t orderid = 0
+    ) {
+        limit_order_create_operation op;
+        op.owner = owner;
+        op.orderid = orderid;
+        op.amount_to_sell = amount_to_sell;
+        op.min_to_receive = min_to_receive;
+        signed_transaction tx;
+        push_tx_with_ops(tx, key, op);
+    }
 
-            ACTORS((alice)(bob)(sam));
+    void generate_irreversible_blocks() {
+        const auto head_block_num = db->head_block_num();
+        while (db->last_non_undoable_block_num() < head_block_num) {
             generate_block();
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(market_history_plugin_tests, market_history_fixture)
+
+BOOST_AUTO_TEST_CASE(mh_test) {
+    BOOST_TEST_MESSAGE("Testing: mh_test");
+    initialize_market_history();
+
+    ACTORS((alice)(bob)(sam));
+    generate_block();
+
+    fund("alice", ASSET("1000.000 GOLOS"));
+    fund("alice", ASSET("1000.000 GBG"));
+    fund("bob", ASSET("1000.000 GOLOS"));
+    fund("sam", ASSET("1000.000 GOLOS"));
+
+    set_price_feed(price(ASSET("0.500 GBG"), ASSET("1.000 GOLOS")));
+
+    const auto &order_hist_idx = db->get_index<order_history_index>().indices().get<golos::plugins::market_history::by_id>();
+    BOOST_REQUIRE(order_hist_idx.empty());
+    BOOST_REQUIRE(get_market_history(15).empty());
+    validate_database();
+
+    // trades start at the hour, so they are grouped to buckets of each size the same way in each run
+    generate_blocks(bucket_open(db->head_block_time(), 3600) + 3600);
+    const auto time_a = db->head_block_time();
+    create_order("alice", alice_private_key, ASSET("1.000 GBG"), ASSET("2.000 GOLOS"));
+    create_order("bob", bob_private_key, ASSET("1.500 GOLOS"), ASSET("0.750 GBG"));
+    generate_block();
+
+    generate_blocks(time_a + 60 * 90);
+    const auto time_b = db->head_block_time();
+    create_order("sam", sam_private_key, ASSET("1.000 GOLOS"), ASSET("0.500 GBG"));
+    generate_block();
+
+    generate_blocks(time_b + 60);
+    const auto time_c = db->head_block_time();
+    create_order("alice", alice_private_key, ASSET("0.500 GBG"), ASSET("0.900 GOLOS"));
+    create_order("bob", bob_private_key, ASSET("0.450 GOLOS"), ASSET("0.250 GBG"));
+    generate_block();
+    validate_database();
+
+    auto check_buckets = [&]() {
+        for (uint32_t seconds : {15, 60}) {
+            auto buckets = get_market_history(seconds);
+            BOOST_REQUIRE_EQUAL(buckets.size(), 3);
+            check_bucket(buckets[0], seconds, time_a,
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"), AMOUNTS("1.500 GOLOS", "0.750 GBG"),
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"), AMOUNTS("1.500 GOLOS", "0.750 GBG"),
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"));
+            check_bucket(buckets[1], seconds, time_b,
+                AMOUNTS("0.500 GOLOS", "0.250 GBG"), AMOUNTS("0.500 GOLOS", "0.250 GBG"),
+                AMOUNTS("0.500 GOLOS", "0.250 GBG"), AMOUNTS("0.500 GOLOS", "0.250 GBG"),
+                AMOUNTS("0.500 GOLOS", "0.250 GBG"));
+            check_bucket(buckets[2], seconds, time_c,
+                AMOUNTS("0.450 GOLOS", "0.250 GBG"), AMOUNTS("0.500 GOLOS", "0.250 GBG"),
+                AMOUNTS("0.500 GOLOS", "0.250 GBG"), AMOUNTS("0.450 GOLOS", "0.250 GBG"),
+                AMOUNTS("0.950 GOLOS", "0.500 GBG"));
+        }
 
-            fund("alice", ASSET("1000.000 GOLOS"));
-            fund("alice", ASSET("1000.000 GBG"));
-            fund("bob", ASSET("1000.000 GOLOS"));
-            fund("sam", ASSET("1000.000 GOLOS"));
-
-            set_price_feed(price(ASSET("0.500 GBG"), ASSET("1.000 GOLOS")));
-
-            signed_transaction tx;
-
-            const auto &bucket_idx = db->get_index<bucket_index>().indices().get<by_bucket>();
-            const auto &order_hist_idx = db->get_index<order_history_index>().indices().get<by_id>();
-
-            BOOST_REQUIRE(bucket_idx.begin() == bucket_idx.end());
-            BOOST_REQUIRE(order_hist_idx.begin() == order_hist_idx.end());
-            validate_database();
-
-            auto fill_order_a_time = db->head_block_time();
-            auto time_a = fc::time_point_sec((fill_order_a_time.sec_since_epoch() / 15) * 15);
-
-            limit_order_create_operation op;
-            op.owner = "alice";
-            op.amount_to_sell = ASSET("1.000 GBG");
-            op.min_to_receive = ASSET("2.000 GOLOS");
-            tx.operations.push_back(op);
-            tx.set_expiration(
-                    db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
-            tx.sign(alice_private_key, db->get_chain_id());
-            db->push_transaction(tx, 0);
-
-            tx.operations.clear();
-            tx.signatures.clear();
-
-            op.owner = "bob";
-            op.amount_to_sell = ASSET("1.500 GOLOS");
-            op.min_to_receive = ASSET("0.750 GBG");
-            tx.operations.push_back(op);
-            tx.sign(bob_private_key, db->get_chain_id());
-            db->push_transaction(tx, 0);
-
-            generate_blocks(db->head_block_time() + (60 * 90));
-
-            auto fill_order_b_time = db->head_block_time();
-
-            tx.operations.clear();
-            tx.signatures.clear();
-
-            op.owner = "sam";
-            op.amount_to_sell = ASSET("1.000 GOLOS");
-            op.min_to_receive = ASSET("0.500 GBG");
-            tx.operations.push_back(op);
-            tx.set_expiration(
-                    db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
-            tx.sign(sam_private_key, db->get_chain_id());
-            db->push_transaction(tx, 0);
-
-            generate_blocks(db->head_block_time() + 60);
-
-            auto fill_order_c_time = db->head_block_time();
-
-            tx.operations.clear();
-            tx.signatures.clear();
-
-            op.owner = "alice";
-            op.amount_to_sell = ASSET("0.500 GBG");
-            op.min_to_receive = ASSET("0.900 GOLOS");
-            tx.operations.push_back(op);
-            tx.set_expiration(
-                    db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
-            tx.sign(alice_private_key, db->get_chain_id());
-            db->push_transaction(tx, 0);
-
-            tx.operations.clear();
-            tx.signatures.clear();
-
-            op.owner = "bob";
-            op.amount_to_sell = ASSET("0.450 GOLOS");
-            op.min_to_receive = ASSET("0.250 GBG");
-            tx.operations.push_back(op);
-            tx.set_expiration(
-                    db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
-            tx.sign(bob_private_key, db->get_chain_id());
-            db->push_transaction(tx, 0);
-            validate_database();
-
-            auto bucket = bucket_idx.begin();
-
-            BOOST_REQUIRE(bucket->seconds == 15);
-            BOOST_REQUIRE(bucket->open == time_a);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("1.500 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 15);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 90));
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.500 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.250 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 15);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 90) + 60);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.450 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("0.950 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.500 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 60);
-            BOOST_REQUIRE(bucket->open == time_a);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 60);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 90));
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.500 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.250 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 60);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 90) + 60);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.450 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("0.950 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.500 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 300);
-            BOOST_REQUIRE(bucket->open == time_a);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("1.500 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 300);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 90));
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.450 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 3600);
-            BOOST_REQUIRE(bucket->open == time_a);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("1.500 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket->seconds == 3600);
-            BOOST_REQUIRE(bucket->open == time_a + (60 * 60));
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.450 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("0.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("1.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("0.750 GBG").amount);
-            bucket++;
-
-            // In Steem GENESIS_TIME is rounded to seconds per day, that is why STEEMIT_GENESIS_TIME is used for validatation
-            // But in Golos GENESIS_TIME isn't rounded to seconds per day
-            const auto round_genesis_time = fc::time_point_sec((STEEMIT_GENESIS_TIME.sec_since_epoch() / 86400) * 86400);
-            BOOST_REQUIRE(bucket->seconds == 86400);
-            BOOST_REQUIRE(bucket->open == round_genesis_time);
-            BOOST_REQUIRE(bucket->high_steem == ASSET("0.450 GOLOS ").amount);
-            BOOST_REQUIRE(bucket->high_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->low_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->low_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->open_steem == ASSET("1.500 GOLOS").amount);
-            BOOST_REQUIRE(bucket->open_sbd == ASSET("0.750 GBG").amount);
-            BOOST_REQUIRE(bucket->close_steem == ASSET("0.450 GOLOS").amount);
-            BOOST_REQUIRE(bucket->close_sbd == ASSET("0.250 GBG").amount);
-            BOOST_REQUIRE(bucket->steem_volume == ASSET("2.950 GOLOS").amount);
-            BOOST_REQUIRE(bucket->sbd_volume == ASSET("1.500 GBG").amount);
-            bucket++;
-
-            BOOST_REQUIRE(bucket == bucket_idx.end());
-
-            auto order = order_hist_idx.begin();
-
-            BOOST_REQUIRE(order->time == fill_order_a_time);
-            BOOST_REQUIRE(order->op.current_owner == "bob");
-            BOOST_REQUIRE(order->op.current_orderid == 0);
-            BOOST_REQUIRE(order->op.current_pays == ASSET("1.500 GOLOS"));
-            BOOST_REQUIRE(order->op.open_owner == "alice");
-            BOOST_REQUIRE(order->op.open_orderid == 0);
-            BOOST_REQUIRE(order->op.open_pays == ASSET("0.750 GBG"));
-            order++;
-
-            BOOST_REQUIRE(order->time == fill_order_b_time);
-            BOOST_REQUIRE(order->op.current_owner == "sam");
-            BOOST_REQUIRE(order->op.current_orderid == 0);
-            BOOST_REQUIRE(order->op.current_pays == ASSET("0.500 GOLOS"));
-            BOOST_REQUIRE(order->op.open_owner == "alice");
-            BOOST_REQUIRE(order->op.open_orderid == 0);
-            BOOST_REQUIRE(order->op.open_pays == ASSET("0.250 GBG"));
-            order++;
-
-            BOOST_REQUIRE(order->time == fill_order_c_time);
-            BOOST_REQUIRE(order->op.current_owner == "alice");
-            BOOST_REQUIRE(order->op.current_orderid == 0);
-            BOOST_REQUIRE(order->op.current_pays == ASSET("0.250 GBG"));
-            BOOST_REQUIRE(order->op.open_owner == "sam");
-            BOOST_REQUIRE(order->op.open_orderid == 0);
-            BOOST_REQUIRE(order->op.open_pays == ASSET("0.500 GOLOS"));
-            order++;
-
-            BOOST_REQUIRE(order->time == fill_order_c_time);
-            BOOST_REQUIRE(order->op.current_owner == "bob");
-            BOOST_REQUIRE(order->op.current_orderid == 0);
-            BOOST_REQUIRE(order->op.current_pays == ASSET("0.450 GOLOS"));
-            BOOST_REQUIRE(order->op.open_owner == "alice");
-            BOOST_REQUIRE(order->op.open_orderid == 0);
-            BOOST_REQUIRE(order->op.open_pays == ASSET("0.250 GBG"));
-            order++;
-
-            BOOST_REQUIRE(order == order_hist_idx.end());
+        for (uint32_t seconds : {300, 3600}) {
+            auto buckets = get_market_history(seconds);
+            BOOST_REQUIRE_EQUAL(buckets.size(), 2);
+            check_bucket(buckets[0], seconds, time_a,
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"), AMOUNTS("1.500 GOLOS", "0.750 GBG"),
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"), AMOUNTS("1.500 GOLOS", "0.750 GBG"),
+                AMOUNTS("1.500 GOLOS", "0.750 GBG"));
+            check_bucket(buckets[1], seconds, bucket_open(time_b, seconds),
+                AMOUNTS("0.450 GOLOS", "0.250 GBG"), AMOUNTS("0.500 GOLOS", "0.250 GBG"),
+                AMOUNTS("0.500 GOLOS", "0.250 GBG"), AMOUNTS("0.450 GOLOS", "0.250 GBG"),
+                AMOUNTS("1.450 GOLOS", "0.750 GBG"));
         }
-        FC_LOG_AND_RETHROW()
+
+        auto days = get_market_history(86400);
+        BOOST_REQUIRE_EQUAL(days.size(), 1);
+        check_bucket(days[0], 86400, bucket_open(time_a, 86400),
+            AMOUNTS("0.450 GOLOS", "0.250 GBG"), AMOUNTS("1.500 GOLOS", "0.750 GBG"),
+            AMOUNTS("1.500 GOLOS", "0.750 GBG"), AMOUNTS("0.450 GOLOS", "0.250 GBG"),
+            AMOUNTS("2.950 GOLOS", "1.500 GBG"));
+    };
+
+    BOOST_TEST_MESSAGE("--- Buckets of trades in reversible blocks");
+    check_buckets();
+
+    BOOST_TEST_MESSAGE("--- Buckets of trades in irreversible blocks");
+    generate_irreversible_blocks();
+    check_buckets();
+
+    BOOST_TEST_MESSAGE("--- History of trades");
+    auto order = order_hist_idx.begin();
+
+    BOOST_REQUIRE(order->time == time_a);
+    BOOST_REQUIRE(order->op.current_owner == "bob");
+    BOOST_REQUIRE(order->op.current_orderid == 0);
+    BOOST_REQUIRE(order->op.current_pays == ASSET("1.500 GOLOS"));
+    BOOST_REQUIRE(order->op.open_owner == "alice");
+    BOOST_REQUIRE(order->op.open_orderid == 0);
+    BOOST_REQUIRE(order->op.open_pays == ASSET("0.750 GBG"));
+    order++;
+
+    BOOST_REQUIRE(order->time == time_b);
+    BOOST_REQUIRE(order->op.current_owner == "sam");
+    BOOST_REQUIRE(order->op.current_orderid == 0);
+    BOOST_REQUIRE(order->op.current_pays == ASSET("0.500 GOLOS"));
+    BOOST_REQUIRE(order->op.open_owner == "alice");
+    BOOST_REQUIRE(order->op.open_orderid == 0);
+    BOOST_REQUIRE(order->op.open_pays == ASSET("0.250 GBG"));
+    order++;
+
+    BOOST_REQUIRE(order->time == time_c);
+    BOOST_REQUIRE(order->op.current_owner == "alice");
+    BOOST_REQUIRE(order->op.current_orderid == 0);
+    BOOST_REQUIRE(order->op.current_pays == ASSET("0.250 GBG"));
+    BOOST_REQUIRE(order->op.open_owner == "sam");
+    BOOST_REQUIRE(order->op.open_orderid == 0);
+    BOOST_REQUIRE(order->op.open_pays == ASSET("0.500 GOLOS"));
+    order++;
+
+    BOOST_REQUIRE(order->time == time_c);
+    BOOST_REQUIRE(order->op.current_owner == "bob");
+    BOOST_REQUIRE(order->op.current_orderid == 0);
+    BOOST_REQUIRE(order->op.current_pays == ASSET("0.450 GOLOS"));
+    BOOST_REQUIRE(order->op.open_owner == "alice");
+    BOOST_REQUIRE(order->op.open_orderid == 0);
+    BOOST_REQUIRE(order->op.open_pays == ASSET("0.250 GBG"));
+    order++;
+
+    BOOST_REQUIRE(order == order_hist_idx.end());
+}
+
+BOOST_AUTO_TEST_CASE(mh_reversible_trades) {
+    BOOST_TEST_MESSAGE("Testing: mh_reversible_trades");
+    initialize_market_history();
+
+    ACTORS((alice)(bob)(sam));
+    generate_block();
+
+    fund("alice", ASSET("1000.000 GBG"));
+    fund("bob", ASSET("1000.000 GOLOS"));
+    fund("sam", ASSET("1000.000 GOLOS"));
+
+    set_price_feed(price(ASSET("0.500 GBG"), ASSET("1.000 GOLOS")));
+
+    auto get_volume = [&]() {
+        auto days = get_market_history(86400);
+        return days.empty() ? 0 : days.back().asset1_volume.value;
+    };
+
+    BOOST_TEST_MESSAGE("--- Trades of reversible blocks are added to the stored buckets");
+    create_order("alice", alice_private_key, ASSET("1.000 GBG"), ASSET("2.000 GOLOS"));
+    create_order("bob", bob_private_key, ASSET("1.500 GOLOS"), ASSET("0.750 GBG"));
+    generate_block();
+    generate_irreversible_blocks();
+    BOOST_CHECK_EQUAL(get_volume(), 1500);
+
+    create_order("sam", sam_private_key, ASSET("0.200 GOLOS"), ASSET("0.100 GBG"));
+    generate_block();
+    BOOST_CHECK_EQUAL(get_volume(), 1700);
+
+    BOOST_TEST_MESSAGE("--- Trades of popped block are removed");
+    db->pop_block();
+    db->clear_pending();
+    BOOST_CHECK_EQUAL(get_volume(), 1500);
+    generate_block();
+    // the popped transaction is pushed back as pending
+    db->clear_pending();
+    BOOST_CHECK_EQUAL(get_volume(), 1500);
+
+    BOOST_TEST_MESSAGE("--- Ids of undone trades are reused by the trades of the fork");
+    create_order("sam", sam_private_key, ASSET("0.300 GOLOS"), ASSET("0.150 GBG"), 1);
+    generate_block();
+    BOOST_CHECK_EQUAL(get_volume(), 1800);
+
+    BOOST_TEST_MESSAGE("--- Trades are moved to the store once");
+    generate_irreversible_blocks();
+    BOOST_CHECK_EQUAL(get_volume(), 1800);
+    generate_block();
+    BOOST_CHECK_EQUAL(get_volume(), 1800);
+}
+
+BOOST_AUTO_TEST_CASE(mh_market_callback) {
+    BOOST_TEST_MESSAGE("Testing: mh_market_callback");
+    initialize_market_history();
+
+    ACTORS((alice)(bob));
+    generate_block();
+
+    fund("alice", ASSET("1000.000 GBG"));
+    fund("bob", ASSET("1000.000 GOLOS"));
+
+    set_price_feed(price(ASSET("0.500 GBG"), ASSET("1.000 GOLOS")));
+    generate_block();
+
+    std::vector<market_update> updates;
+    auto &rpc = appbase::app().get_plugin<golos::plugins::json_rpc::plugin>();
+    rpc.call("{\"id\":1,\"jsonrpc\":\"2.0\",\"method\":\"call\",\"params\":["
+        "\"market_history\",\"set_market_callback\",[[\"GOLOS\",\"GBG\"]]]}",
+        [&](const std::string &response) {
+            auto v = fc::json::from_string(response);
+            BOOST_REQUIRE(v.get_object().contains("result"));
+            updates.push_back(v["result"].as<market_update>());
+        });
+
+    BOOST_TEST_MESSAGE("--- Blocks without changes of the market aren't sent");
+    generate_block();
+    BOOST_CHECK(updates.empty());
+
+    BOOST_TEST_MESSAGE("--- Changed levels are sent");
+    create_order("alice", alice_private_key, ASSET("1.000 GBG"), ASSET("2.000 GOLOS"));
+    generate_block();
+    BOOST_REQUIRE_EQUAL(updates.size(), 1);
+    BOOST_CHECK_EQUAL(updates[0].block_num, db->head_block_num());
+    BOOST_CHECK(!updates[0].reset);
+    BOOST_REQUIRE_EQUAL(updates[0].bids.size(), 1);
+    BOOST_CHECK_EQUAL(updates[0].bids[0].asset1.value, 2000);
+    BOOST_CHECK_EQUAL(updates[0].bids[0].asset2.value, 1000);
+    BOOST_CHECK(updates[0].asks.empty());
+    BOOST_CHECK(updates[0].trades.empty());
+    BOOST_CHECK(updates[0].buckets.empty());
+
+    BOOST_TEST_MESSAGE("--- Trades of dropped pending transactions aren't sent");
+    signed_transaction tx;
+    limit_order_create_operation op;
+    op.owner = "bob";
+    op.amount_to_sell = ASSET("1.500 GOLOS");
+    op.min_to_receive = ASSET("0.750 GBG");
+    push_tx_with_ops(tx, bob_private_key, op);
+    db->clear_pending();
+    generate_block();
+    // orders touched by pending transactions can be sent as changed levels with the same amounts
+    for (size_t i = 1; i < updates.size(); ++i) {
+        BOOST_CHECK(updates[i].trades.empty());
+        BOOST_CHECK(updates[i].buckets.empty());
+    }
+
+    BOOST_TEST_MESSAGE("--- Trades and their buckets are sent with the changed levels");
+    auto sent = updates.size();
+    db->push_transaction(tx, 0);
+    generate_block();
+    BOOST_REQUIRE_EQUAL(updates.size(), sent + 1);
+    const auto update = updates.back();
+    BOOST_CHECK(!update.reset);
+    BOOST_REQUIRE_EQUAL(update.bids.size(), 1);
+    BOOST_CHECK_EQUAL(update.bids[0].asset1.value, 500);
+    BOOST_CHECK_EQUAL(update.bids[0].asset2.value, 250);
+    BOOST_CHECK(update.asks.empty());
+    BOOST_REQUIRE_EQUAL(update.trades.size(), 1);
+    BOOST_CHECK(update.trades[0].current_pays == ASSET("1.500 GOLOS"));
+    BOOST_CHECK(update.trades[0].open_pays == ASSET("0.750 GBG"));
+    BOOST_REQUIRE_EQUAL(update.buckets.size(), mh_plugin->get_tracked_buckets().size());
+    for (const auto &b : update.buckets) {
+        BOOST_CHECK_EQUAL(b.open.sec_since_epoch(), bucket_open(update.trades[0].date, b.seconds).sec_since_epoch());
+        BOOST_CHECK_EQUAL(b.asset1_volume.value, 1500);
+        BOOST_CHECK_EQUAL(b.asset2_volume.value, 750);
+    }
+
+    BOOST_TEST_MESSAGE("--- All levels are sent after the book is rebuilt");
+    sent = updates.size();
+    db->pop_block();
+    db->clear_pending();
+    generate_block();
+    // the popped transaction is pushed back as pending
+    db->clear_pending();
+    BOOST_REQUIRE_EQUAL(updates.size(), sent + 1);
+    BOOST_CHECK(updates.back().reset);
+    BOOST_REQUIRE_EQUAL(updates.back().bids.size(), 1);
+    BOOST_CHECK_EQUAL(updates.back().bids[0].asset2.value, 1000);
+    BOOST_CHECK(updates.back().asks.empty());
+    BOOST_CHECK(updates.back().trades.empty());
+}
+
+BOOST_AUTO_TEST_CASE(mh_order_book) {
+    BOOST_TEST_MESSAGE("Testing: mh_order_book");
+    initialize_market_history();
+
+    const auto &book = mh_plugin->get_order_book_cache();
+
+    // the book must be the same as the chain index after each block
+    auto check_book = [&]() {
+        const auto &order_idx = db->get_index<limit_order_index>().indices();
+        BOOST_REQUIRE_EQUAL(book.size(), order_idx.size());
+
+        std::map<std::pair<asset_symbol_type, asset_symbol_type>, share_type> depths;
+        for (const auto &order : order_idx) {
+            auto itr = book.orders().get<by_book_order>().find(std::make_tuple(order.seller, order.orderid));
+            BOOST_REQUIRE(itr != book.orders().get<by_book_order>().end());
+            BOOST_CHECK_EQUAL(itr->for_sale.value, order.for_sale.value);
+            BOOST_CHECK(itr->sell_price == order.sell_price);
+            depths[std::make_pair(order.sell_price.base.symbol, order.sell_price.quote.symbol)] += order.for_sale;
+        }
+        for (const auto &depth : depths) {
+            BOOST_CHECK_EQUAL(book.depth(depth.first.first, depth.first.second).amount.value, depth.second.value);
+        }
+    };
+
+    ACTORS((alice)(bob));
+    generate_block();
+
+    fund("alice", ASSET("1000.000 GBG"));
+    fund("bob", ASSET("1000.000 GOLOS"));
+
+    set_price_feed(price(ASSET("0.500 GBG"), ASSET("1.000 GOLOS")));
+
+    BOOST_TEST_MESSAGE("--- orders of the same price are aggregated to one level");
+    signed_transaction tx;
+    limit_order_create_operation op;
+    op.owner = "alice";
+    op.amount_to_sell = ASSET("1.000 GBG");
+    op.min_to_receive = ASSET("2.000 GOLOS");
+    for (uint32_t i = 1; i <= 3; ++i) {
+        op.orderid = i;
+        tx.operations.push_back(op);
     }
+    op.orderid = 4;
+    op.amount_to_sell = ASSET("1.000 GBG");
+    op.min_to_receive = ASSET("4.000 GOLOS");
+    op.expiration = db->head_block_time() + 60;
+    tx.operations.push_back(op);
+    tx.set_expiration(db->head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+    tx.sign(alice_private_key, db->get_chain_id());
+    db->push_transaction(tx, 0);
+    generate_block();
+    check_book();
+
+    auto bids = book.find_side(SBD_SYMBOL, STEEM_SYMBOL);
+    BOOST_REQUIRE(bids != nullptr);
+    BOOST_CHECK_EQUAL(bids->levels.size(), 2);
+    BOOST_CHECK_EQUAL(bids->levels.begin()->second.value, 3000);
+    BOOST_CHECK_EQUAL(bids->for_sale.value, 4000);
+    BOOST_CHECK(book.find_side(STEEM_SYMBOL, SBD_SYMBOL) == nullptr);
+
+    BOOST_TEST_MESSAGE("--- fill and cancel update the levels");
+    tx.operations.clear();
+    tx.signatures.clear();
+    op.owner = "bob";
+    op.orderid = 1;
+    op.amount_to_sell = ASSET("3.000 GOLOS");
+    op.min_to_receive = ASSET("1.500 GBG");
+    op.expiration = fc::time_point_sec::maximum();
+    tx.operations.push_back(op);
+    tx.sign(bob_private_key, db->get_chain_id());
+    db->push_transaction(tx, 0);
+
+    tx.operations.clear();
+    tx.signatures.clear();
+    limit_order_cancel_operation cancel;
+    cancel.owner = "alice";
+    cancel.orderid = 3;
+    tx.operations.push_back(cancel);
+    tx.sign(alice_private_key, db->get_chain_id());
+    db->push_transaction(tx, 0);
+    generate_block();
+    check_book();
+
+    bids = book.find_side(SBD_SYMBOL, STEEM_SYMBOL);
+    BOOST_REQUIRE(bids != nullptr);
+    BOOST_CHECK_EQUAL(bids->levels.begin()->second.value, 500);
+    BOOST_CHECK_EQUAL(bids->for_sale.value, 1500);
+
+    BOOST_TEST_MESSAGE("--- expired order is removed");
+    generate_blocks(db->head_block_time() + 120);
+    check_book();
+    BOOST_CHECK_EQUAL(book.size(), 1);
+
+    BOOST_TEST_MESSAGE("--- book is rebuilt after popped block");
+    tx.operations.clear();
+    tx.signatures.clear();
+    cancel.orderid = 2;
+    tx.operations.push_back(cancel);
+    tx.sign(alice_private_key, db->get_chain_id());
+    db->push_transaction(tx, 0);
+    generate_block();
+    check_book();
+    BOOST_CHECK_EQUAL(book.size(), 0);
+
+    db->pop_block();
+    db->clear_pending();
+    generate_block();
+    // the popped transaction is pushed back as pending, and the book has only changes of blocks
+    db->clear_pending();
+    check_book();
+    BOOST_CHECK_EQUAL(book.size(), 1);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
-#endif
\ No newline at end of file
+#endif
@@ -2,12 +2,15 @@
 
 #include "database_fixture.hpp"
 
+#include <graphene/utilities/tempdir.hpp>
+
 #include <string>
 #include <cstdint>
 
 using golos::chain::add_operations_database_fixture;
 using golos::plugins::operation_history::applied_operation;
 using golos::plugins::json_rpc::msg_pack;
+using golos::plugins::account_history::history_operations;
 using golos::protocol::account_create_operation;
 
 static const std::string OPERATIONS = "account_create_operation,delete_comment_operation,vote,comment";
@@ -51,6 +54,15 @@ struct operation_history_fixture : public add_operations_database_fixture {
         }
         return _found_ops;
     }
+
+    // blocks of operations, which are still in the shared memory, by transaction ids
+    std::map<std::string, uint32_t> kept_operation_blocks() {
+        std::map<std::string, uint32_t> result;
+        for (const auto& o : db->get_index<golos::plugins::operation_history::operation_index>().indices()) {
+            result.emplace(o.trx_id.str(), o.block);
+        }
+        return result;
+    }
 };
 
 BOOST_FIXTURE_TEST_SUITE(operation_history_plugin, operation_history_fixture)
@@ -83,6 +95,41 @@ BOOST_AUTO_TEST_CASE(operation_history_blocks) {
     BOOST_CHECK_EQUAL(_checked_ops_count, HISTORY_BLOCKS);
 }
 
+BOOST_AUTO_TEST_CASE(operation_history_prune_interval) {
+    const uint32_t PRUNE_INTERVAL = 3;
+    BOOST_TEST_MESSAGE("Testing: operation_history_prune_interval");
+    initialize({
+        {"history-blocks", "1"},
+        {"history-prune-interval", std::to_string(PRUNE_INTERVAL)},
+        {"history-whitelist-ops", OPERATIONS}
+    });
+
+    add_operations();
+    const auto blocks = kept_operation_blocks();
+    uint32_t last_op_block = 0;
+    for (const auto& b : blocks) {
+        last_op_block = std::max(last_op_block, b.second);
+    }
+
+    BOOST_TEST_MESSAGE("--- Operations out of history-blocks are hidden before they are removed");
+    generate_block();
+    BOOST_CHECK(check_operations().empty());
+    BOOST_CHECK_GT(kept_operation_blocks().size(), 0);
+
+    BOOST_TEST_MESSAGE("--- Operations are removed once per history-prune-interval irreversible blocks");
+    while (db->last_non_undoable_block_num() <= last_op_block + PRUNE_INTERVAL) {
+        generate_block();
+
+        // the irreversible block grows by one per block, so it reaches each multiple of the interval
+        const auto pruned_block = db->last_non_undoable_block_num() / PRUNE_INTERVAL * PRUNE_INTERVAL;
+        const auto kept = kept_operation_blocks();
+        for (const auto& b : blocks) {
+            BOOST_CHECK_EQUAL(kept.count(b.first) != 0, b.second > pruned_block);
+        }
+    }
+    BOOST_CHECK(kept_operation_blocks().empty());
+}
+
 BOOST_AUTO_TEST_CASE(black_options_postfix) {
     BOOST_TEST_MESSAGE("Testing: black_options_postfix");
     initialize({{"history-blacklist-ops", OPERATIONS}});
@@ -150,4 +197,127 @@ BOOST_AUTO_TEST_CASE(short_operation_history_blocks) {
     BOOST_CHECK_EQUAL(_checked_ops_count, 3);
 }
 
+BOOST_AUTO_TEST_CASE(history_store) {
+    BOOST_TEST_MESSAGE("Testing: history_store");
+    fc::temp_directory store_dir(golos::utilities::temp_directory_path());
+    initialize({{"history-store-dir", store_dir.path().string()}});
+    BOOST_REQUIRE(oh_plugin->store());
+
+    auto get_history = [this](const std::string& account) {
+        msg_pack mp;
+        mp.args = std::vector<fc::variant>({fc::variant(account), fc::variant(-1), fc::variant(100)});
+        return ah_plugin->get_account_history(mp);
+    };
+
+    auto _added_ops = add_operations();
+    auto _found_ops = check_operations();
+    auto _bob_history = get_history("bob");
+
+    const auto head_block_num = db->head_block_num();
+    for (uint32_t i = 0; i < 100 && db->last_non_undoable_block_num() <= head_block_num; ++i) {
+        generate_block();
+    }
+    generate_block();
+    BOOST_REQUIRE_GT(db->last_non_undoable_block_num(), head_block_num);
+    BOOST_CHECK_GE(oh_plugin->store()->head_block(), head_block_num);
+
+    BOOST_TEST_MESSAGE("--- Operations are moved out of the shared memory");
+    const auto& idx = db->get_index<golos::plugins::operation_history::operation_index>().indices()
+        .get<golos::plugins::operation_history::by_location>();
+    BOOST_CHECK(idx.empty() || idx.begin()->block > head_block_num);
+
+    BOOST_TEST_MESSAGE("--- Operations are read from the store");
+    BOOST_CHECK(check_operations() == _found_ops);
+
+    for (const auto& op: _added_ops) {
+        msg_pack mp;
+        mp.args = std::vector<fc::variant>({fc::variant(op.first)});
+        auto trx = oh_plugin->get_transaction(mp);
+        BOOST_CHECK_EQUAL(trx.id().str(), op.first);
+    }
+
+    auto bob_history = get_history("bob");
+    BOOST_REQUIRE_GE(bob_history.size(), _bob_history.size());
+    for (const auto& item: _bob_history) {
+        auto itr = bob_history.find(item.first);
+        BOOST_REQUIRE(itr != bob_history.end());
+        BOOST_CHECK_EQUAL(itr->second.block, item.second.block);
+        BOOST_CHECK_EQUAL(itr->second.trx_id.str(), item.second.trx_id.str());
+        BOOST_CHECK_EQUAL(itr->second.op.which(), item.second.op.which());
+    }
+
+    BOOST_TEST_MESSAGE("--- New operations continue sequences of the store");
+    fund("bob", 1000);
+    generate_block();
+    auto last_history = get_history("bob");
+    BOOST_CHECK_EQUAL(last_history.rbegin()->first, bob_history.rbegin()->first + 1);
+}
+
+BOOST_AUTO_TEST_CASE(history_store_account_tags) {
+    BOOST_TEST_MESSAGE("Testing: history_store_account_tags");
+    using namespace golos::plugins::operation_history;
+
+    fc::temp_directory store_dir(golos::utilities::temp_directory_path());
+    history_store store;
+    store.open(store_dir.path(), 1024 * 1024);
+
+    // sequences from 0 to 599 with a gap, which starts a new block of tags
+    std::vector<stored_account_operation> ops;
+    for (uint32_t seq = 0; seq < 600; ++seq) {
+        if (seq >= 300 && seq < 310) {
+            continue;
+        }
+        stored_account_operation op;
+        op.sequence = seq;
+        op.op_tag = seq % 7;
+        op.dir = 1 + seq % 3;
+        op.op_pos = seq * 100;
+        ops.push_back(op);
+        store.append_account_operation("alice", op);
+    }
+    store.append_account_operation("bob", ops.front());
+
+    account_operation_filter filter;
+    filter.accept(3, 1);
+    filter.accept(3, 3);
+    filter.accept(5, 2);
+
+    auto check = [&](uint32_t from, uint32_t limit) {
+        std::vector<uint32_t> expected;
+        for (auto itr = ops.rbegin(); itr != ops.rend() && expected.size() < limit; ++itr) {
+            if (itr->sequence <= from && filter.matches(itr->op_tag, itr->dir)) {
+                expected.push_back(itr->sequence);
+            }
+        }
+
+        std::vector<uint32_t> found;
+        store.walk_account_history("alice", from, filter, [&](const stored_account_operation& op) {
+            BOOST_CHECK_EQUAL(op.op_pos, op.sequence * 100);
+            found.push_back(op.sequence);
+            return found.size() < limit;
+        });
+        BOOST_CHECK(found == expected);
+    };
+
+    BOOST_TEST_MESSAGE("--- Filtered operations are found by tags");
+    check(uint32_t(-1), 1000);
+    check(599, 10);
+    check(305, 20);
+    check(7, 1000);
+
+    std::vector<uint32_t> bob_found;
+    store.walk_account_history("bob", uint32_t(-1), filter, [&](const stored_account_operation& op) {
+        bob_found.push_back(op.sequence);
+        return true;
+    });
+    BOOST_CHECK(bob_found.empty());
+
+    BOOST_TEST_MESSAGE("--- Index of tags is built for the store without it");
+    store.close();
+    boost::filesystem::remove(store_dir.path() / "account_tags.index");
+    store.open(store_dir.path(), 1024 * 1024);
+    check(uint32_t(-1), 1000);
+    check(400, 15);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,182 @@
+#include <boost/test/unit_test.hpp>
+
+#include "database_fixture.hpp"
+#include "helpers.hpp"
+
+#include <golos/plugins/social_network/social_network.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+using golos::plugins::json_rpc::msg_pack;
+using golos::protocol::comment_operation;
+using golos::protocol::delete_comment_operation;
+using golos::protocol::signed_transaction;
+using golos::plugins::social_network::comment_content_object;
+using golos::plugins::social_network::comment_content_index;
+using golos::plugins::social_network::by_comment;
+
+struct content_store_fixture : public golos::chain::database_fixture {
+    void initialize_store() {
+        initialize({{"comment-content-store-dir", store_dir.path().string()}});
+        open_database();
+        startup();
+    }
+
+    const comment_content_object& get_content(const std::string& author, const std::string& permlink) {
+        return sn_plugin->get_comment_content(db->get_comment(author, permlink).id);
+    }
+
+    golos::api::discussion get_discussion(const std::string& author, const std::string& permlink) {
+        msg_pack mp;
+        mp.args = std::vector<fc::variant>({fc::variant(author), fc::variant(permlink)});
+        return sn_plugin->get_content(mp);
+    }
+
+    void generate_irreversible_blocks() {
+        const auto head_block_num = db->head_block_num();
+        for (uint32_t i = 0; i < 100 && db->last_non_undoable_block_num() <= head_block_num; ++i) {
+            generate_block();
+        }
+        generate_block();
+        BOOST_REQUIRE_GT(db->last_non_undoable_block_num(), head_block_num);
+    }
+
+    fc::temp_directory store_dir{golos::utilities::temp_directory_path()};
+};
+
+BOOST_FIXTURE_TEST_SUITE(social_network_plugin, content_store_fixture)
+
+BOOST_AUTO_TEST_CASE(comment_content_store) {
+    BOOST_TEST_MESSAGE("Testing: comment_content_store");
+    initialize_store();
+    BOOST_REQUIRE(sn_plugin->store());
+
+    ACTORS((alice)(bob));
+    generate_block();
+
+    comment_operation op;
+    op.author = "alice";
+    op.permlink = "lorem";
+    op.parent_permlink = "ipsum";
+    op.title = "Lorem Ipsum";
+    op.body = "abcdef";
+    op.json_metadata = "{\"foo\":\"bar\"}";
+
+    comment_operation reply;
+    reply.author = "bob";
+    reply.permlink = "re-lorem";
+    reply.parent_author = "alice";
+    reply.parent_permlink = "lorem";
+    reply.body = "reply";
+
+    signed_transaction tx;
+    BOOST_CHECK_NO_THROW(push_tx_with_ops(tx, alice_private_key, op));
+    generate_block();
+    BOOST_CHECK_NO_THROW(push_tx_with_ops(tx, bob_private_key, reply));
+    generate_block();
+
+    BOOST_TEST_MESSAGE("--- Content of reversible change is kept in the shared memory");
+    BOOST_CHECK(!get_content("alice", "lorem").in_store);
+    BOOST_CHECK_EQUAL(to_string(get_content("alice", "lorem").body), op.body);
+
+    generate_irreversible_blocks();
+
+    BOOST_TEST_MESSAGE("--- Content of irreversible change is moved to the store");
+    const auto& content = get_content("alice", "lorem");
+    BOOST_CHECK(content.in_store);
+    BOOST_CHECK_EQUAL(content.store_block, 0);
+    BOOST_CHECK(content.body.empty());
+    BOOST_CHECK_GE(sn_plugin->store()->head_block(), db->last_non_undoable_block_num());
+
+    auto text = sn_plugin->get_comment_text(content);
+    BOOST_CHECK_EQUAL(text.title, op.title);
+    BOOST_CHECK_EQUAL(text.body, op.body);
+    BOOST_CHECK_EQUAL(text.json_metadata, op.json_metadata);
+
+    BOOST_TEST_MESSAGE("--- Stored content is returned by API");
+    auto d = get_discussion("alice", "lorem");
+    BOOST_CHECK_EQUAL(d.title, op.title);
+    BOOST_CHECK_EQUAL(d.body, op.body);
+    BOOST_CHECK_EQUAL(d.json_metadata, op.json_metadata);
+    BOOST_CHECK_EQUAL(d.root_title, op.title);
+
+    auto r = get_discussion("bob", "re-lorem");
+    BOOST_CHECK_EQUAL(r.body, reply.body);
+    BOOST_CHECK_EQUAL(r.root_title, op.title);
+    BOOST_CHECK_EQUAL(golos::plugins::social_network::get_json_metadata(*db, db->get_comment("alice", "lorem")),
+        op.json_metadata);
+
+    BOOST_TEST_MESSAGE("--- Patch of body is applied to the stored content");
+    op.title = "";
+    op.json_metadata = "";
+    op.body = "@@ -1,6 +1,6 @@\n ab\n-c\n+X\n def\n";
+    BOOST_CHECK_NO_THROW(push_tx_with_ops(tx, alice_private_key, op));
+    generate_block();
+
+    const auto& edited = get_content("alice", "lorem");
+    BOOST_CHECK(!edited.in_store);
+    BOOST_CHECK_EQUAL(to_string(edited.title), "Lorem Ipsum");
+    BOOST_CHECK_EQUAL(to_string(edited.body), "abXdef");
+    BOOST_CHECK_EQUAL(get_discussion("alice", "lorem").body, "abXdef");
+
+    generate_irreversible_blocks();
+
+    BOOST_CHECK(get_content("alice", "lorem").in_store);
+    BOOST_CHECK_EQUAL(get_discussion("alice", "lorem").body, "abXdef");
+    BOOST_CHECK_EQUAL(get_discussion("alice", "lorem").title, "Lorem Ipsum");
+    BOOST_CHECK_GT(sn_plugin->store()->garbage_size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(comment_content_store_removal) {
+    BOOST_TEST_MESSAGE("Testing: comment_content_store_removal");
+    initialize_store();
+    BOOST_REQUIRE(sn_plugin->store());
+
+    ACTORS((alice));
+    generate_block();
+
+    comment_operation op;
+    op.author = "alice";
+    op.permlink = "lorem";
+    op.parent_permlink = "ipsum";
+    op.title = "Lorem Ipsum";
+    op.body = "abcdef";
+
+    signed_transaction tx;
+    BOOST_CHECK_NO_THROW(push_tx_with_ops(tx, alice_private_key, op));
+    generate_block();
+    generate_irreversible_blocks();
+
+    const auto comment_id = db->get_comment("alice", "lorem").id;
+    BOOST_CHECK(get_content("alice", "lorem").in_store);
+    BOOST_CHECK(sn_plugin->store()->find(comment_id._id));
+
+    BOOST_TEST_MESSAGE("--- Deferred API object is filled from the store by in_store flags");
+    const auto& comment = db->get_comment("alice", "lorem");
+    golos::api::comment_api_object d;
+    d.id = comment.id;
+    d.root_comment = comment.root_comment;
+    golos::plugins::social_network::fill_comment_info_deferred(*db, comment, d);
+    BOOST_CHECK(d.content_in_store);
+    BOOST_CHECK(d.root_content_in_store);
+    BOOST_CHECK(sn_plugin->fill_stored_content(d));
+    BOOST_CHECK_EQUAL(d.body, op.body);
+    BOOST_CHECK_EQUAL(d.root_title, op.title);
+
+    BOOST_TEST_MESSAGE("--- Content of deleted comment is kept in the store until the deletion is irreversible");
+    delete_comment_operation dop;
+    dop.author = "alice";
+    dop.permlink = "lorem";
+    BOOST_CHECK_NO_THROW(push_tx_with_ops(tx, alice_private_key, dop));
+    generate_block();
+
+    BOOST_CHECK(!sn_plugin->find_comment_content(comment_id));
+    BOOST_CHECK(sn_plugin->store()->find(comment_id._id));
+
+    generate_irreversible_blocks();
+
+    BOOST_CHECK(!sn_plugin->store()->find(comment_id._id));
+    BOOST_CHECK(db->get_index<golos::plugins::social_network::comment_content_removal_index>().indices().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <boost/test/unit_test.hpp>
+
+#include <golos/plugins/webserver/request_executor.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using golos::plugins::webserver::request_executor;
+using golos::plugins::webserver::request_priority;
+
+namespace {
+    // Occupies the only thread of executor until release() is called
+    struct blocker final {
+        blocker(request_executor& executor) {
+            auto started = std::make_shared<std::promise<void>>();
+            auto future = released.get_future().share();
+            executor.post("blocker", request_priority::high, [started, future]() {
+                started->set_value();
+                future.wait();
+            }, []() {});
+            started->get_future().wait();
+        }
+
+        void release() {
+            released.set_value();
+        }
+
+        std::promise<void> released;
+    };
+
+    struct recorder final {
+        request_executor::task_type task(std::string name) {
+            return [this, name]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                executed.push_back(name);
+            };
+        }
+
+        request_executor::task_type reject(std::string name) {
+            return [this, name]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                rejected.push_back(name);
+            };
+        }
+
+        std::mutex mutex;
+        std::vector<std::string> executed;
+        std::vector<std::string> rejected;
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(webserver)
+
+    BOOST_AUTO_TEST_CASE(request_executor_priorities) {
+        try {
+            recorder r;
+            request_executor executor(1, 100, 100, fc::microseconds());
+            blocker b(executor);
+
+            BOOST_TEST_MESSAGE("--- requests are executed in order of priorities");
+            BOOST_CHECK(executor.post("api.low", request_priority::low, r.task("low"), r.reject("low")));
+            BOOST_CHECK(executor.post("api.normal", request_priority::normal, r.task("normal"), r.reject("normal")));
+            BOOST_CHECK(executor.post("api.high", request_priority::high, r.task("high"), r.reject("high")));
+
+            auto stats = executor.get_stats();
+            BOOST_CHECK_EQUAL(stats.threads, 1);
+            BOOST_CHECK_EQUAL(stats.high_queued, 1);
+            BOOST_CHECK_EQUAL(stats.normal_queued, 1);
+            BOOST_CHECK_EQUAL(stats.low_queued, 1);
+            BOOST_CHECK_EQUAL(stats.methods["api.low"].queued, 1);
+
+            std::promise<void> done;
+            executor.post("api.last", request_priority::low, [&]() { done.set_value(); }, []() {});
+
+            b.release();
+            done.get_future().wait();
+
+            std::vector<std::string> expected = {"high", "normal", "low"};
+            BOOST_CHECK(r.executed == expected);
+            BOOST_CHECK(r.rejected.empty());
+
+            stats = executor.get_stats();
+            BOOST_CHECK_EQUAL(stats.methods["api.low"].queued, 0);
+            BOOST_CHECK_EQUAL(stats.methods["api.low"].max_queued, 1);
+            BOOST_CHECK_EQUAL(stats.methods["api.low"].executed, 1);
+            BOOST_CHECK_GT(stats.methods["api.low"].max_wait_time, 0);
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(request_executor_admission) {
+        try {
+            recorder r;
+            request_executor executor(1, 3, 2, fc::microseconds());
+            blocker b(executor);
+
+            BOOST_TEST_MESSAGE("--- full queue of method rejects its requests");
+            BOOST_CHECK(executor.post("api.a", request_priority::normal, r.task("a1"), r.reject("a1")));
+            BOOST_CHECK(executor.post("api.a", request_priority::normal, r.task("a2"), r.reject("a2")));
+            BOOST_CHECK(!executor.post("api.a", request_priority::normal, r.task("a3"), r.reject("a3")));
+
+            BOOST_TEST_MESSAGE("--- full total queue rejects all requests");
+            BOOST_CHECK(executor.post("api.b", request_priority::normal, r.task("b1"), r.reject("b1")));
+            BOOST_CHECK(!executor.post("api.b", request_priority::high, r.task("b2"), r.reject("b2")));
+
+            std::vector<std::string> expected = {"a3", "b2"};
+            BOOST_CHECK(r.rejected == expected);
+
+            auto stats = executor.get_stats();
+            BOOST_CHECK_EQUAL(stats.rejected, 2);
+            BOOST_CHECK_EQUAL(stats.methods["api.a"].rejected, 1);
+            BOOST_CHECK_EQUAL(stats.methods["api.b"].rejected, 1);
+
+            b.release();
+            executor.stop();
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+    BOOST_AUTO_TEST_CASE(request_executor_wait_limit) {
+        try {
+            recorder r;
+            request_executor executor(1, 100, 100, fc::milliseconds(1));
+            blocker b(executor);
+
+            BOOST_TEST_MESSAGE("--- request waiting too long is rejected");
+            std::promise<void> done;
+            BOOST_CHECK(executor.post("api.a", request_priority::normal, r.task("a"), r.reject("a")));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            executor.post("api.last", request_priority::low, [&]() { done.set_value(); }, [&]() { done.set_value(); });
+
+            b.release();
+            done.get_future().wait();
+
+            std::vector<std::string> expected = {"a"};
+            BOOST_CHECK(r.executed.empty());
+            BOOST_CHECK(r.rejected == expected);
+            BOOST_CHECK_EQUAL(executor.get_stats().methods["api.a"].rejected, 1);
+        }
+        FC_LOG_AND_RETHROW()
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -26,11 +26,13 @@
 #include <boost/test/unit_test_monitor.hpp>
 
 #include <golos/chain/database.hpp>
+#include <golos/protocol/signature_cache.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include "database_fixture.hpp"
 
 #include <random>
+#include <thread>
 
 using namespace golos;
 using namespace golos::chain;
@@ -313,4 +315,147 @@ BOOST_FIXTURE_TEST_SUITE(basic_tests, clean_database_fixture)
         BOOST_CHECK(block.calculate_merkle_root() == c(dO));
     }
 
+    BOOST_AUTO_TEST_CASE(signature_cache_test) {
+        auto& cache = signature_cache::instance();
+        cache.set_max_size(2);
+
+        auto key1 = fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("key1")));
+        auto key2 = fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("key2")));
+        const auto& chain_id = db->get_chain_id();
+
+        signed_transaction trx;
+        trx.ref_block_prefix = 1;
+        trx.set_expiration(fc::time_point_sec(1000));
+        trx.sign(key1, chain_id);
+        trx.sign(key2, chain_id);
+
+        auto stats = cache.get_stats();
+        auto keys = trx.get_signature_keys(chain_id);
+        BOOST_CHECK_EQUAL(cache.get_stats().misses, stats.misses + 2);
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 2);
+
+        BOOST_CHECK(trx.get_signature_keys(chain_id) == keys);
+        BOOST_CHECK_EQUAL(cache.get_stats().hits, stats.hits + 2);
+        BOOST_CHECK(keys.count(key1.get_public_key()) && keys.count(key2.get_public_key()));
+
+        BOOST_TEST_MESSAGE("--- Test eviction by expiration");
+        cache.remove_expired(fc::time_point_sec(1000));
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 2);
+        cache.remove_expired(fc::time_point_sec(1001));
+        BOOST_CHECK_EQUAL(cache.get_stats().size, 0);
+
+        cache.set_max_size(0);
+    }
+
+    BOOST_AUTO_TEST_CASE(read_epoch_test) {
+        BOOST_TEST_MESSAGE("--- Test waiting of readers for block writer");
+        read_epoch_gate gate;
+        gate.set_enabled(true);
+
+        std::atomic<bool> entered{false};
+        std::thread reader_thread;
+        {
+            read_epoch_gate::writer writer(gate);
+            reader_thread = std::thread([&]() {
+                read_epoch_gate::reader reader(gate);
+                entered = true;
+            });
+
+            // nested reader in the writer thread passes the gate
+            { read_epoch_gate::reader reader(gate); }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            BOOST_CHECK(!entered);
+        }
+        reader_thread.join();
+        BOOST_CHECK(entered);
+        BOOST_CHECK_EQUAL(gate.epoch(), 1);
+
+        BOOST_TEST_MESSAGE("--- Test timeout of readers waiting for block writer");
+        gate.set_wait_timeout(fc::milliseconds(10));
+        entered = false;
+        {
+            read_epoch_gate::writer writer(gate);
+            reader_thread = std::thread([&]() {
+                read_epoch_gate::reader reader(gate);
+                entered = true;
+            });
+            reader_thread.join();
+            BOOST_CHECK(entered);
+        }
+        BOOST_CHECK_EQUAL(gate.epoch(), 2);
+
+        BOOST_TEST_MESSAGE("--- Test lock metrics per API method");
+        db->set_lock_metrics(true);
+        auto epoch = db->get_lock_stats().epoch;
+        {
+            api_method_scope scope("database_api.get_config");
+            db->with_weak_read_lock([&]() {});
+        }
+        generate_block();
+
+        auto stats = db->get_lock_stats();
+        BOOST_CHECK_EQUAL(stats.read.at("database_api.get_config").calls, 1);
+        BOOST_CHECK_EQUAL(stats.block_write.calls, 1);
+        BOOST_CHECK_EQUAL(stats.epoch, epoch + 1);
+        db->set_lock_metrics(false);
+    }
+
+    BOOST_AUTO_TEST_CASE(async_block_subscription_test) {
+        ACTORS((alice))
+        fund("alice", 10000);
+        generate_block();
+
+        std::mutex mutex;
+        std::vector<uint32_t> blocks;
+        std::vector<transaction_id_type> transfers;
+
+        auto subscription = db->subscribe_async("test", 2, [&](const applied_block_bundle& bundle) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks.push_back(bundle.block_num);
+            for (const auto& item: bundle.operations) {
+                if (item.op.which() == operation::tag<transfer_operation>::value) {
+                    transfers.push_back(item.trx_id);
+                }
+            }
+        });
+
+        transfer("alice", STEEMIT_INIT_MINER_NAME, 1000);
+        auto first_block = db->head_block_num() + 1;
+        generate_blocks(5);
+
+        db->unsubscribe_async(subscription);
+
+        auto stats = subscription->get_stats();
+        BOOST_CHECK_EQUAL(stats.pushed, 5);
+        BOOST_CHECK_EQUAL(stats.processed, 5);
+        BOOST_CHECK_EQUAL(stats.lag_blocks, 0);
+        BOOST_CHECK(stats.max_lag_blocks <= 2);
+        BOOST_CHECK_EQUAL(stats.last_processed_block, db->head_block_num());
+
+        BOOST_REQUIRE_EQUAL(blocks.size(), 5);
+        for (uint32_t i = 0; i < blocks.size(); ++i) {
+            BOOST_CHECK_EQUAL(blocks[i], first_block + i);
+        }
+        BOOST_REQUIRE_EQUAL(transfers.size(), 1);
+        BOOST_CHECK(transfers[0] != transaction_id_type());
+
+        BOOST_TEST_MESSAGE("--- Test failures of handler don't stop subscription");
+        uint32_t calls = 0;
+        auto failing = db->subscribe_async("failing", 2, [&](const applied_block_bundle& bundle) {
+            if (++calls % 2) {
+                throw 1;
+            }
+            throw std::runtime_error("test");
+        });
+        generate_blocks(4);
+        db->unsubscribe_async(failing);
+
+        stats = failing->get_stats();
+        BOOST_CHECK_EQUAL(stats.processed, 4);
+        BOOST_CHECK_EQUAL(stats.failed, 4);
+        BOOST_CHECK_EQUAL(calls, 4);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
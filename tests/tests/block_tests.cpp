@@ -28,6 +28,9 @@
 #include <golos/protocol/exceptions.hpp>
 
 #include <golos/chain/database.hpp>
+#include <golos/chain/compressed_block_log.hpp>
+#include <golos/chain/index.hpp>
+#include <golos/chain/state_snapshot.hpp>
 #include <golos/chain/steem_objects.hpp>
 
 #include <golos/plugins/account_history/history_object.hpp>
@@ -36,6 +39,9 @@
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/io/json.hpp>
+
+#include <fstream>
 
 #include "database_fixture.hpp"
 
@@ -108,6 +114,373 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(pipelined_replay) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+            block_id_type lib_id;
+            uint32_t lib_num = 0;
+            {
+                database db;
+                db._log_hardforks = false;
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                signed_transaction trx;
+                account_create_operation cop;
+                cop.new_account_name = "alice";
+                cop.creator = STEEMIT_INIT_MINER_NAME;
+                cop.owner = authority(1, init_account_pub_key, 1);
+                cop.active = cop.owner;
+                trx.operations.push_back(cop);
+                trx.set_expiration(db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                trx.sign(init_account_priv_key, db.get_chain_id());
+                PUSH_TX(db, trx, 0);
+
+                for (uint32_t i = 0; i < 100; ++i) {
+                    db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                }
+
+                lib_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+                BOOST_REQUIRE(lib_num > 1);
+                lib_id = db.get_block_id_for_num(lib_num);
+                db.close();
+            }
+            {
+                database db;
+                db._log_hardforks = false;
+                db.set_replay_pipeline_size(4);
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                db.wipe(data_dir.path(), data_dir.path(), false);
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                db.reindex(data_dir.path(), data_dir.path(), 1, TEST_SHARED_MEM_SIZE);
+
+                BOOST_CHECK_EQUAL(db.head_block_num(), lib_num);
+                BOOST_CHECK(db.head_block_id() == lib_id);
+                BOOST_CHECK(db.find_account("alice") != nullptr);
+            }
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(checkpoint_bulk_sync) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            fc::temp_directory data_dir2(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+
+            database db;
+            db._log_hardforks = false;
+            db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            for (uint32_t i = 0; i < 100; ++i) {
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            }
+
+            auto checkpoint_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+            BOOST_REQUIRE(checkpoint_num > 2);
+            flat_map<uint32_t, block_id_type> checkpoints;
+            checkpoints[checkpoint_num] = db.get_block_id_for_num(checkpoint_num);
+
+            database db2;
+            db2._log_hardforks = false;
+            db2.add_checkpoints(checkpoints);
+            db2.open(data_dir2.path(), data_dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+            BOOST_TEST_MESSAGE("--- blocks are kept in memory until the block of the checkpoint is received");
+            BOOST_CHECK(!db2.bulk_sync_block(*db.fetch_block_by_number(2)));
+            for (uint32_t num = 1; num < checkpoint_num; ++num) {
+                BOOST_CHECK(db2.bulk_sync_block(*db.fetch_block_by_number(num)));
+            }
+            BOOST_CHECK(!db2.get_block_log().head());
+
+            BOOST_TEST_MESSAGE("--- block, which doesn't match the checkpoint, drops received blocks");
+            auto fake_checkpoint = *db.fetch_block_by_number(checkpoint_num);
+            fake_checkpoint.timestamp += STEEMIT_BLOCK_INTERVAL;
+            BOOST_CHECK_THROW(db2.bulk_sync_block(fake_checkpoint), fc::exception);
+            BOOST_CHECK(!db2.get_block_log().head());
+            BOOST_CHECK(!db2.bulk_sync_block(*db.fetch_block_by_number(2)));
+
+            BOOST_TEST_MESSAGE("--- blocks up to the checkpoint are written to the block log without applying");
+            for (uint32_t num = 1; num <= checkpoint_num; ++num) {
+                BOOST_CHECK(db2.bulk_sync_block(*db.fetch_block_by_number(num)));
+            }
+            BOOST_CHECK(db2.bulk_sync_block(*db.fetch_block_by_number(1)));
+            BOOST_CHECK_THROW(db2.bulk_sync_block(fake_checkpoint), fc::exception);
+            BOOST_CHECK(!db2.bulk_sync_block(*db.fetch_block_by_number(checkpoint_num + 1)));
+            BOOST_CHECK_EQUAL(db2.get_block_log().head()->block_num(), checkpoint_num);
+            BOOST_CHECK_EQUAL(db2.head_block_num(), 0);
+
+            BOOST_TEST_MESSAGE("--- written blocks are applied by batches");
+            BOOST_CHECK_EQUAL(db2.apply_bulk_synced_blocks(2), 2);
+            BOOST_CHECK_EQUAL(db2.head_block_num(), 2);
+            while (db2.apply_bulk_synced_blocks(10));
+            BOOST_CHECK_EQUAL(db2.head_block_num(), checkpoint_num);
+            BOOST_CHECK(db2.head_block_id() == checkpoints[checkpoint_num]);
+
+            BOOST_TEST_MESSAGE("--- blocks after the checkpoint are pushed as usual");
+            for (uint32_t num = checkpoint_num + 1; num <= db.head_block_num(); ++num) {
+                PUSH_BLOCK(db2, *db.fetch_block_by_number(num));
+            }
+            BOOST_CHECK(db2.head_block_id() == db.head_block_id());
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+#ifdef GOLOS_BLOCK_LOG_COMPRESSION
+    BOOST_AUTO_TEST_CASE(compressed_block_log_reading) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            fc::temp_directory out_dir(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            {
+                database db;
+                db._log_hardforks = false;
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                for (uint32_t i = 0; i < 100; ++i) {
+                    db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                }
+                db.close();
+            }
+
+            block_log src;
+            src.open(data_dir.path() / "block_log");
+            const uint32_t head_num = src.head()->block_num();
+            BOOST_REQUIRE(head_num > 64);
+
+            compressed_block_log_options opts;
+            opts.blocks_per_chunk = 16;
+            opts.dictionary_size = 0;
+            compressed_block_log::write(src, 64, out_dir.path() / "block_log", opts);
+
+            block_log dst;
+            dst.set_chunk_cache_size(2);
+            dst.open(out_dir.path() / "block_log");
+            BOOST_CHECK_EQUAL(dst.first_block_num(), 65);
+            BOOST_CHECK_EQUAL(dst.head()->block_num(), 64);
+            BOOST_CHECK(dst.get_block_pos(64) == block_log::npos);
+
+            for (uint32_t block_num = 65; block_num <= head_num; ++block_num) {
+                dst.append(*src.read_block_by_num(block_num));
+            }
+            BOOST_CHECK_EQUAL(dst.get_block_pos(65), 0);
+
+            // read backwards to check misses of the chunk cache
+            for (uint32_t block_num = head_num; block_num > 0; --block_num) {
+                auto block = dst.read_block_by_num(block_num);
+                BOOST_REQUIRE(block.valid());
+                BOOST_CHECK(block->id() == src.read_block_by_num(block_num)->id());
+            }
+            BOOST_CHECK(!dst.read_block_by_num(head_num + 1).valid());
+
+            // reopen to check the head and the continuity of files
+            dst.close();
+            dst.open(out_dir.path() / "block_log");
+            BOOST_CHECK_EQUAL(dst.head()->block_num(), head_num);
+            BOOST_CHECK(dst.read_block_by_num(1)->id() == src.read_block_by_num(1)->id());
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+#endif
+
+    BOOST_AUTO_TEST_CASE(state_snapshot) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            fc::temp_directory snapshot_dir(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+            fc::path snapshot_path;
+            uint32_t head_num = 0;
+            uint32_t snapshot_num = 0;
+            asset alice_vesting;
+            account_id_type alice_id;
+            {
+                database db;
+                db._log_hardforks = false;
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                signed_transaction trx;
+                account_create_operation cop;
+                cop.new_account_name = "alice";
+                cop.creator = STEEMIT_INIT_MINER_NAME;
+                cop.owner = authority(1, init_account_pub_key, 1);
+                cop.active = cop.owner;
+                trx.operations.push_back(cop);
+                trx.set_expiration(db.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+                trx.sign(init_account_priv_key, db.get_chain_id());
+                PUSH_TX(db, trx, 0);
+
+                for (uint32_t i = 0; i < 100; ++i) {
+                    db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                }
+                db.close();
+
+                // open() rewinds the state to the last irreversible block
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                snapshot_num = db.head_block_num();
+                head_num = db.get_block_log().head()->block_num();
+                BOOST_REQUIRE(snapshot_num > 1);
+                alice_vesting = db.get_account("alice").vesting_shares;
+                alice_id = db.get_account("alice").id;
+
+                snapshot_path = db.write_snapshot(snapshot_dir.path(), 2);
+                db.close();
+            }
+
+            auto manifest = fc::json::from_file(snapshot_path / "manifest.json").as<state_snapshot_manifest>();
+            BOOST_CHECK_EQUAL(manifest.block_num, snapshot_num);
+            BOOST_CHECK(!manifest.indexes.empty());
+            for (const auto& index: manifest.indexes) {
+                for (const auto& chunk: index.chunks) {
+                    BOOST_CHECK(fc::exists(snapshot_path / chunk.file));
+                }
+            }
+
+            {
+                database db;
+                db._log_hardforks = false;
+                db.wipe(data_dir.path(), data_dir.path(), false);
+                db.set_snapshot_to_load(snapshot_path, 2);
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                BOOST_CHECK_EQUAL(db.head_block_num(), snapshot_num);
+                BOOST_CHECK_EQUAL(db.revision(), snapshot_num);
+                BOOST_CHECK_EQUAL(db.get_account("alice").vesting_shares, alice_vesting);
+                // ids of referenced objects are kept, other objects are renumbered in the same order
+                BOOST_CHECK(db.get_account("alice").id == alice_id);
+                const auto& trx_idx = db.get_index<transaction_index>().indices();
+                if (!trx_idx.empty()) {
+                    BOOST_CHECK_EQUAL(trx_idx.rbegin()->id._id + 1, trx_idx.size());
+                }
+
+                // the rest of block log is replayed over the snapshot
+                db.reindex(data_dir.path(), data_dir.path(), db.head_block_num() + 1, TEST_SHARED_MEM_SIZE);
+                BOOST_CHECK_EQUAL(db.head_block_num(), head_num);
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                BOOST_CHECK_EQUAL(db.head_block_num(), head_num + 1);
+                db.close();
+            }
+
+            {
+                BOOST_TEST_MESSAGE("--- Test refusing of snapshot with indexes of plugins, which aren't in snapshots");
+                database db;
+                db._log_hardforks = false;
+                db.wipe(data_dir.path(), data_dir.path(), false);
+                golos::chain::add_plugin_index<golos::plugins::account_history::account_history_index>(db);
+                db.set_snapshot_to_load(snapshot_path, 2);
+                BOOST_CHECK_THROW(
+                    db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write),
+                    fc::exception);
+            }
+
+            {
+                const auto& chunk = manifest.indexes.front().chunks.front();
+                std::fstream file((snapshot_path / chunk.file).string(), std::ios::in | std::ios::out | std::ios::binary);
+                file.seekg(chunk.size - 1);
+                char last = file.get();
+                file.seekp(chunk.size - 1);
+                file.put(~last);
+                file.close();
+
+                database db;
+                db._log_hardforks = false;
+                db.wipe(data_dir.path(), data_dir.path(), false);
+                db.set_snapshot_to_load(snapshot_path, 2);
+                BOOST_CHECK_THROW(
+                    db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write),
+                    golos::database_corrupted);
+            }
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(state_snapshot_fields) {
+        try {
+            fc::temp_directory data_dir(golos::utilities::temp_directory_path());
+            fc::temp_directory snapshot_dir(golos::utilities::temp_directory_path());
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            fc::path snapshot_path;
+            fc::variant props, account, witness;
+            {
+                database db;
+                db._log_hardforks = false;
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                for (uint32_t i = 0; i < 30; ++i) {
+                    db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+                }
+                db.close();
+
+                // open() rewinds all undo states, so the changes below stay in the state
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+                const auto now = db.head_block_time();
+                db.modify(db.get_dynamic_global_properties(), [&](dynamic_global_property_object& o) {
+                    o.sbd_interest_rate = 1000;
+                });
+                db.modify(db.get_account(STEEMIT_INIT_MINER_NAME), [&](account_object& a) {
+                    a.sbd_balance = asset(1234, SBD_SYMBOL);
+                    a.sbd_seconds = 5678;
+                    a.sbd_seconds_last_update = now - 60;
+                    a.sbd_last_interest_payment = now - 120;
+                    a.savings_sbd_balance = asset(4321, SBD_SYMBOL);
+                    a.savings_sbd_seconds = 8765;
+                    a.savings_sbd_seconds_last_update = now - 180;
+                    a.savings_sbd_last_interest_payment = now - 240;
+                    a.savings_withdraw_requests = 3;
+                });
+                db.modify(db.get_witness(STEEMIT_INIT_MINER_NAME), [&](witness_object& w) {
+                    w.virtual_last_update = 11;
+                    w.virtual_position = 22;
+                    w.virtual_scheduled_time = 33;
+                });
+                props = fc::variant(db.get_dynamic_global_properties());
+                account = fc::variant(db.get_account(STEEMIT_INIT_MINER_NAME));
+                witness = fc::variant(db.get_witness(STEEMIT_INIT_MINER_NAME));
+
+                snapshot_path = db.write_snapshot(snapshot_dir.path(), 2);
+                db.close();
+            }
+
+            // all reflected fields are compared, except ids, which can be renumbered
+            auto check_fields = [](const fc::variant& expected, const fc::variant& loaded) {
+                const auto& loaded_fields = loaded.get_object();
+                for (const auto& field: expected.get_object()) {
+                    if (field.key() == "id") {
+                        continue;
+                    }
+                    auto itr = loaded_fields.find(field.key());
+                    BOOST_REQUIRE(itr != loaded_fields.end());
+                    BOOST_CHECK_MESSAGE(
+                        fc::json::to_string(itr->value()) == fc::json::to_string(field.value()),
+                        "field " << field.key() << ": " << fc::json::to_string(itr->value())
+                            << " != " << fc::json::to_string(field.value()));
+                }
+            };
+
+            {
+                database db;
+                db._log_hardforks = false;
+                db.wipe(data_dir.path(), data_dir.path(), false);
+                db.set_snapshot_to_load(snapshot_path, 2);
+                db.open(data_dir.path(), data_dir.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+
+                check_fields(props, fc::variant(db.get_dynamic_global_properties()));
+                check_fields(account, fc::variant(db.get_account(STEEMIT_INIT_MINER_NAME)));
+                check_fields(witness, fc::variant(db.get_witness(STEEMIT_INIT_MINER_NAME)));
+                db.close();
+            }
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(undo_block) {
         try {
             fc::temp_directory data_dir(golos::utilities::temp_directory_path());
@@ -332,6 +705,114 @@ BOOST_AUTO_TEST_SUITE(block_tests)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(parallel_signature_recovery) {
+        try {
+            fc::temp_directory dir1(golos::utilities::temp_directory_path()),
+                    dir2(golos::utilities::temp_directory_path());
+            database db1,
+                    db2;
+            db1._log_hardforks = false;
+            db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2._log_hardforks = false;
+            db2.open(dir2.path(), dir2.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            db2.set_signature_recovery_threads(2);
+
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = STEEMIT_INIT_MINER_NAME;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration(db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db1.get_chain_id());
+            PUSH_TX(db1, trx, 0);
+
+            auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+            BOOST_TEST_MESSAGE("--- Test block with a wrong transaction signature");
+            auto bad_block = b;
+            bad_block.transactions[0].signatures[0] = fc::ecc::private_key::regenerate(fc::sha256::hash(std::string("bad")))
+                .sign_compact(bad_block.transactions[0].sig_digest(db1.get_chain_id()));
+            db2.recover_signature_keys(bad_block);
+            STEEMIT_CHECK_THROW(PUSH_BLOCK(db2, bad_block, database::skip_nothing), fc::exception);
+            BOOST_CHECK_EQUAL(db2.head_block_num(), 0);
+
+            BOOST_TEST_MESSAGE("--- Test block with recovered keys");
+            db2.recover_signature_keys(b);
+            PUSH_BLOCK(db2, b, database::skip_nothing);
+            BOOST_CHECK(db2.head_block_id() == b.id());
+            BOOST_CHECK(db2.find_account("alice") != nullptr);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(operation_profiler) {
+        try {
+            fc::temp_directory dir1(golos::utilities::temp_directory_path());
+            database db1;
+            db1._log_hardforks = false;
+            db1.open(dir1.path(), dir1.path(), INITIAL_TEST_SUPPLY, TEST_SHARED_MEM_SIZE, chainbase::database::read_write);
+            BOOST_CHECK(db1.profiler() == nullptr);
+            db1.set_operation_profiling(true, 0);
+            BOOST_REQUIRE(db1.profiler() != nullptr);
+
+            auto init_account_priv_key = STEEMIT_INIT_PRIVATE_KEY;
+            public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+
+            signed_transaction trx;
+            account_create_operation cop;
+            cop.new_account_name = "alice";
+            cop.creator = STEEMIT_INIT_MINER_NAME;
+            cop.owner = authority(1, init_account_pub_key, 1);
+            cop.active = cop.owner;
+            trx.operations.push_back(cop);
+            trx.set_expiration(db1.head_block_time() + STEEMIT_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db1.get_chain_id());
+            PUSH_TX(db1, trx, 0);
+
+            db1.profiler()->reset();
+            db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+            auto stats = db1.profiler()->get_stats();
+            BOOST_CHECK_EQUAL(stats.first_block, 1);
+            BOOST_CHECK_EQUAL(stats.last_block, 2);
+            BOOST_CHECK_EQUAL(stats.blocks, 2);
+
+            BOOST_REQUIRE(stats.operations.count("account_create"));
+            const auto& create = stats.operations.at("account_create");
+            BOOST_CHECK_EQUAL(create.calls, 1);
+            BOOST_CHECK_GE(create.creates, 3);
+            BOOST_CHECK_GT(create.memory, 0);
+
+            BOOST_REQUIRE(stats.block_phases.count("update_global_properties"));
+            const auto& props = stats.block_phases.at("update_global_properties");
+            BOOST_CHECK_EQUAL(props.calls, 2);
+            BOOST_CHECK_GT(props.modifies, 0);
+            BOOST_CHECK_EQUAL(stats.block_phases.at("apply_transactions").calls, 2);
+            BOOST_CHECK_GE(stats.total.creates, create.creates);
+
+            BOOST_TEST_MESSAGE("--- Test reset of profile");
+            db1.profiler()->reset();
+            stats = db1.profiler()->get_stats();
+            BOOST_CHECK_EQUAL(stats.blocks, 0);
+            BOOST_CHECK(stats.operations.empty());
+            BOOST_CHECK_EQUAL(stats.block_phases.at("apply_transactions").calls, 0);
+
+            db1.set_operation_profiling(false, 0);
+            BOOST_CHECK(db1.profiler() == nullptr);
+        } catch (fc::exception &e) {
+            edump((e.to_detail_string()));
+            throw;
+        }
+    }
+
     BOOST_AUTO_TEST_CASE(tapos) {
         try {
             fc::temp_directory dir1(golos::utilities::temp_directory_path());